@@ -18,6 +18,7 @@
  */
 
 #include "filter-blur.hpp"
+#include <algorithm>
 #include <cfloat>
 #include <cinttypes>
 #include <cmath>
@@ -25,9 +26,11 @@
 #include "gfx/blur/gfx-blur-box-linear.hpp"
 #include "gfx/blur/gfx-blur-box.hpp"
 #include "gfx/blur/gfx-blur-dual-filtering.hpp"
+#include "gfx/blur/gfx-blur-gaussian-kernel.hpp"
 #include "gfx/blur/gfx-blur-gaussian-linear.hpp"
 #include "gfx/blur/gfx-blur-gaussian.hpp"
 #include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-render-state.hpp"
 #include "obs/obs-source-tracker.hpp"
 #include "strings.hpp"
 #include "util-math.hpp"
@@ -58,6 +61,11 @@
 #define ST_STEPSCALE "Filter.Blur.StepScale"
 #define ST_STEPSCALE_X "Filter.Blur.StepScale.X"
 #define ST_STEPSCALE_Y "Filter.Blur.StepScale.Y"
+#define ST_SCALE "Filter.Blur.Scale"
+#define ST_SCALE_FULL "Filter.Blur.Scale.Full"
+#define ST_SCALE_HALF "Filter.Blur.Scale.Half"
+#define ST_SCALE_QUARTER "Filter.Blur.Scale.Quarter"
+#define ST_BATCH "Filter.Blur.Batch"
 #define ST_MASK "Filter.Blur.Mask"
 #define ST_MASK_TYPE "Filter.Blur.Mask.Type"
 #define ST_MASK_TYPE_REGION "Filter.Blur.Mask.Type.Region"
@@ -170,8 +178,20 @@ void filter::blur::blur_factory::on_list_fill()
 		char* file = obs_module_file("effects/mask.effect");
 		try {
 			_mask_effect = gs::effect::create(file);
+			_mask_parameters.image_orig.bind(*_mask_effect, "image_orig");
+			_mask_parameters.image_blur.bind(*_mask_effect, "image_blur");
+			_mask_parameters.region_left.bind(*_mask_effect, "mask_region_left");
+			_mask_parameters.region_right.bind(*_mask_effect, "mask_region_right");
+			_mask_parameters.region_top.bind(*_mask_effect, "mask_region_top");
+			_mask_parameters.region_bottom.bind(*_mask_effect, "mask_region_bottom");
+			_mask_parameters.region_feather.bind(*_mask_effect, "mask_region_feather");
+			_mask_parameters.region_feather_shift.bind(*_mask_effect, "mask_region_feather_shift");
+			_mask_parameters.image.bind(*_mask_effect, "mask_image");
+			_mask_parameters.color.bind(*_mask_effect, "mask_color");
+			_mask_parameters.multiplier.bind(*_mask_effect, "mask_multiplier");
 		} catch (std::runtime_error& ex) {
 			P_LOG_ERROR("<filter-blur> Loading _effect '%s' failed with error(s): %s", file, ex.what());
+			_mask_effect.reset();
 		}
 		bfree(file);
 	}
@@ -228,6 +248,7 @@ void filter::blur::blur_factory::get_defaults(obs_data_t* data)
 	obs_data_set_default_bool(data, ST_STEPSCALE, false);
 	obs_data_set_default_double(data, ST_STEPSCALE_X, 1.);
 	obs_data_set_default_double(data, ST_STEPSCALE_Y, 1.);
+	obs_data_set_default_int(data, ST_SCALE, processing_scale::Full);
 
 	// Masking
 	obs_data_set_default_bool(data, ST_MASK, false);
@@ -247,6 +268,8 @@ void filter::blur::blur_factory::get_defaults(obs_data_t* data)
 	obs_data_set_default_string(data, ST_MASK_SOURCE, "");
 	obs_data_set_default_int(data, ST_MASK_COLOR, 0xFFFFFFFFull);
 	obs_data_set_default_double(data, ST_MASK_MULTIPLIER, 1.0);
+
+	obs_data_set_default_bool(data, S_STATICINPUT, false);
 }
 
 obs_properties_t* filter::blur::blur_factory::get_properties(void* inptr)
@@ -309,92 +332,159 @@ std::shared_ptr<gs::effect> filter::blur::blur_factory::get_mask_effect()
 	return _mask_effect;
 }
 
+filter::blur::blur_factory::mask_parameters& filter::blur::blur_factory::get_mask_parameters()
+{
+	return _mask_parameters;
+}
+
 filter::blur::blur_instance::blur_instance(obs_data_t* settings, obs_source_t* parent)
-	: _self(parent), _source_rendered(false), _output_rendered(false)
+	: _self(parent), _pool(gs::rendertarget_pool::get()), _source_rendered(false), _output_rendered(false),
+	  _blur_scale(1.0), _static_enabled(false)
 {
 	_self = parent;
-
-	// Create RenderTargets
-	try {
-		this->_source_rt = std::make_shared<gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-		this->_output_rt = std::make_shared<gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-	} catch (std::exception& ex) {
-		P_LOG_ERROR("<filter-blur:%s> Failed to create rendertargets, error %s.", obs_source_get_name(_self),
-					ex.what());
-	}
+	_profiler.register_procedures(_self);
 
 	update(settings);
 }
 
 filter::blur::blur_instance::~blur_instance()
 {
+	if (_batch) {
+		_batch->leave(this);
+	}
 	this->_mask.source.source_texture.reset();
 	this->_source_rt.reset();
 	this->_output_texture.reset();
+	this->_output_rt.reset();
 }
 
-bool filter::blur::blur_instance::apply_mask_parameters(std::shared_ptr<gs::effect> effect,
-														gs_texture_t* original_texture, gs_texture_t* blurred_texture)
+bool filter::blur::blur_instance::apply_mask_parameters(gs_texture_t* original_texture, gs_texture_t* blurred_texture)
 {
-	if (effect->has_parameter("image_orig")) {
-		effect->get_parameter("image_orig")->set_texture(original_texture);
-	}
-	if (effect->has_parameter("image_blur")) {
-		effect->get_parameter("image_blur")->set_texture(blurred_texture);
-	}
+	auto& params = blur_factory::get()->get_mask_parameters();
+
+	params.image_orig.set(original_texture);
+	params.image_blur.set(blurred_texture);
 
 	// Region
 	if (_mask.type == mask_type::Region) {
-		if (effect->has_parameter("mask_region_left")) {
-			effect->get_parameter("mask_region_left")->set_float(_mask.region.left);
-		}
-		if (effect->has_parameter("mask_region_right")) {
-			effect->get_parameter("mask_region_right")->set_float(_mask.region.right);
-		}
-		if (effect->has_parameter("mask_region_top")) {
-			effect->get_parameter("mask_region_top")->set_float(_mask.region.top);
-		}
-		if (effect->has_parameter("mask_region_bottom")) {
-			effect->get_parameter("mask_region_bottom")->set_float(_mask.region.bottom);
-		}
-		if (effect->has_parameter("mask_region_feather")) {
-			effect->get_parameter("mask_region_feather")->set_float(_mask.region.feather);
-		}
-		if (effect->has_parameter("mask_region_feather_shift")) {
-			effect->get_parameter("mask_region_feather_shift")->set_float(_mask.region.feather_shift);
-		}
+		params.region_left.set(_mask.region.left);
+		params.region_right.set(_mask.region.right);
+		params.region_top.set(_mask.region.top);
+		params.region_bottom.set(_mask.region.bottom);
+		params.region_feather.set(_mask.region.feather);
+		params.region_feather_shift.set(_mask.region.feather_shift);
 	}
 
 	// Image
 	if (_mask.type == mask_type::Image) {
-		if (effect->has_parameter("mask_image")) {
-			if (_mask.image.texture) {
-				effect->get_parameter("mask_image")->set_texture(_mask.image.texture);
-			} else {
-				effect->get_parameter("mask_image")->set_texture(nullptr);
-			}
+		if (_mask.image.texture) {
+			params.image.set(_mask.image.texture);
+		} else {
+			params.image.set(nullptr);
 		}
 	}
 
 	// Source
 	if (_mask.type == mask_type::Source) {
-		if (effect->has_parameter("mask_image")) {
-			if (_mask.source.texture) {
-				effect->get_parameter("mask_image")->set_texture(_mask.source.texture);
-			} else {
-				effect->get_parameter("mask_image")->set_texture(nullptr);
-			}
+		if (_mask.source.texture) {
+			params.image.set(_mask.source.texture);
+		} else {
+			params.image.set(nullptr);
 		}
 	}
 
 	// Shared
-	if (effect->has_parameter("mask_color")) {
-		effect->get_parameter("mask_color")->set_float4(_mask.color.r, _mask.color.g, _mask.color.b, _mask.color.a);
+	params.color.set(_mask.color.r, _mask.color.g, _mask.color.b, _mask.color.a);
+	params.multiplier.set(_mask.multiplier);
+
+	return true;
+}
+
+void filter::blur::blur_instance::apply_blur_parameters(std::shared_ptr<::gfx::blur::base> blur)
+{
+	// The blur runs on the downsampled input, where the same look takes fewer texels.
+	if (std::dynamic_pointer_cast<::gfx::blur::dual_filtering>(blur)) {
+		// Dual Filtering counts halvings, and each halving of the input already saves one of them.
+		blur->set_size(std::max(_blur_size - log2(1.0 / _blur_scale), 0.0));
+	} else if (std::dynamic_pointer_cast<::gfx::blur::gaussian>(blur)
+			   || std::dynamic_pointer_cast<::gfx::blur::gaussian_linear>(blur)) {
+		blur->set_size(::gfx::blur::gaussian_kernel_table::get_scaled_width(_blur_size, _blur_scale));
+	} else {
+		blur->set_size(_blur_size * _blur_scale);
+	}
+	if (_blur_step_scaling) {
+		blur->set_step_scale(_blur_step_scale.first, _blur_step_scale.second);
+	} else {
+		blur->set_step_scale(1.0, 1.0);
 	}
-	if (effect->has_parameter("mask_multiplier")) {
-		effect->get_parameter("mask_multiplier")->set_float(_mask.multiplier);
+	if ((blur->get_type() == ::gfx::blur::type::Directional) || (blur->get_type() == ::gfx::blur::type::Rotational)) {
+		auto obj = std::dynamic_pointer_cast<::gfx::blur::base_angle>(blur);
+		obj->set_angle(_blur_angle);
 	}
+	if ((blur->get_type() == ::gfx::blur::type::Zoom) || (blur->get_type() == ::gfx::blur::type::Rotational)) {
+		auto obj = std::dynamic_pointer_cast<::gfx::blur::base_center>(blur);
+		obj->set_center(_blur_center.first, _blur_center.second);
+	}
+}
+
+bool filter::blur::blur_instance::render_source()
+{
+	if (_source_rendered)
+		return true;
+
+	obs_source_t* target        = obs_filter_get_target(this->_self);
+	gs_effect_t*  defaultEffect = obs_get_base_effect(obs_base_effect::OBS_EFFECT_DEFAULT);
+	uint32_t      baseW         = obs_source_get_base_width(target);
+	uint32_t      baseH         = obs_source_get_base_height(target);
+	if (!target || (baseW == 0) || (baseH == 0))
+		return false;
+
+	try {
+		this->_source_rt = _pool->acquire(baseW, baseH, GS_RGBA);
+	} catch (std::exception& ex) {
+		P_LOG_ERROR("<filter-blur:%s> Failed to create rendertarget, error %s.", obs_source_get_name(_self),
+					ex.what());
+		return false;
+	}
+
+	// Source To Texture
+	if (!obs_source_process_filter_begin(this->_self, GS_RGBA, OBS_ALLOW_DIRECT_RENDERING))
+		return false;
+
+	{
+		auto op = this->_source_rt->render(baseW, baseH);
+
+		gs_blend_state_push();
+		gs_reset_blend_state();
+		gs_enable_blending(false);
+		gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+		gs_set_cull_mode(GS_NEITHER);
+		gs_enable_color(true, true, true, true);
+
+		gs_enable_depth_test(false);
+		gs_depth_function(GS_ALWAYS);
+
+		gs_enable_stencil_test(false);
+		gs_enable_stencil_write(false);
+		gs_stencil_function(GS_STENCIL_BOTH, GS_ALWAYS);
+		gs_stencil_op(GS_STENCIL_BOTH, GS_KEEP, GS_KEEP, GS_KEEP);
+
+		// Orthographic Camera and clear RenderTarget.
+		gs_ortho(0, (float)baseW, 0, (float)baseH, -1., 1.);
+		//gs_clear(GS_CLEAR_COLOR | GS_CLEAR_DEPTH, &black, 0, 0);
+
+		// Render
+		obs_source_process_filter_end(this->_self, defaultEffect, baseW, baseH);
 
+		gs_blend_state_pop();
+	}
+
+	_source_texture = this->_source_rt->get_texture();
+	if (!_source_texture)
+		return false;
+
+	_source_rendered = true;
 	return true;
 }
 
@@ -654,6 +744,15 @@ obs_properties_t* filter::blur::blur_instance::get_properties()
 		obs_property_set_long_description(p, D_TRANSLATE(D_DESC(ST_STEPSCALE_X)));
 		p = obs_properties_add_float_slider(pr, ST_STEPSCALE_Y, D_TRANSLATE(ST_STEPSCALE_Y), 0.0, 1000.0, 0.01);
 		obs_property_set_long_description(p, D_TRANSLATE(D_DESC(ST_STEPSCALE_Y)));
+
+		p = obs_properties_add_list(pr, ST_SCALE, D_TRANSLATE(ST_SCALE), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+		obs_property_set_long_description(p, D_TRANSLATE(D_DESC(ST_SCALE)));
+		obs_property_list_add_int(p, D_TRANSLATE(ST_SCALE_FULL), processing_scale::Full);
+		obs_property_list_add_int(p, D_TRANSLATE(ST_SCALE_HALF), processing_scale::Half);
+		obs_property_list_add_int(p, D_TRANSLATE(ST_SCALE_QUARTER), processing_scale::Quarter);
+
+		p = obs_properties_add_bool(pr, ST_BATCH, D_TRANSLATE(ST_BATCH));
+		obs_property_set_long_description(p, D_TRANSLATE(D_DESC(ST_BATCH)));
 	}
 
 	// Masking
@@ -719,6 +818,12 @@ obs_properties_t* filter::blur::blur_instance::get_properties()
 		obs_property_set_long_description(p, D_TRANSLATE(D_DESC(ST_MASK_MULTIPLIER)));
 	}
 
+	// Static Input
+	{
+		p = obs_properties_add_bool(pr, S_STATICINPUT, D_TRANSLATE(S_STATICINPUT));
+		obs_property_set_long_description(p, D_TRANSLATE(D_DESC(S_STATICINPUT)));
+	}
+
 	return pr;
 }
 
@@ -755,6 +860,9 @@ void filter::blur::blur_instance::update(obs_data_t* settings)
 		this->_blur_step_scaling      = obs_data_get_bool(settings, ST_STEPSCALE);
 		this->_blur_step_scale.first  = obs_data_get_double(settings, ST_STEPSCALE_X) / 100.0;
 		this->_blur_step_scale.second = obs_data_get_double(settings, ST_STEPSCALE_Y) / 100.0;
+
+		// Processing Scale
+		this->_blur_scale = std::clamp(obs_data_get_int(settings, ST_SCALE), 1ll, 100ll) / 100.0;
 	}
 
 	{ // Masking
@@ -789,6 +897,43 @@ void filter::blur::blur_instance::update(obs_data_t* settings)
 			}
 		}
 	}
+
+	{ // Batching
+		// Only blurs that treat every texel alike can share an atlas, and the mask needs the unblurred input.
+		std::string blur_type  = obs_data_get_string(settings, ST_TYPE);
+		auto        type_found = list_of_types.find(blur_type);
+		bool        batchable  = obs_data_get_bool(settings, ST_BATCH) && _blur && !_mask.enabled
+						 && (_blur_scale >= 1.0) && (type_found != list_of_types.end())
+						 && (blur_type != "dual_filtering")
+						 && ((_blur->get_type() == ::gfx::blur::type::Area)
+							 || (_blur->get_type() == ::gfx::blur::type::Directional));
+
+		std::string key;
+		if (batchable) {
+			key = blur_type + ":" + std::to_string(int64_t(_blur->get_type())) + ":" + std::to_string(_blur_size);
+			if (_blur_step_scaling) {
+				key += ":" + std::to_string(_blur_step_scale.first) + ":" + std::to_string(_blur_step_scale.second);
+			}
+			if (_blur->get_type() == ::gfx::blur::type::Directional) {
+				key += ":" + std::to_string(_blur_angle);
+			}
+		}
+
+		if (key != _batch_key) {
+			if (_batch) {
+				_batch->leave(this);
+				_batch.reset();
+			}
+			if (!key.empty()) {
+				auto              fn      = type_found->second.fn;
+				::gfx::blur::type subtype = _blur->get_type();
+				_batch = ::gfx::blur::batch::get(key, [fn, subtype]() { return fn().create(subtype); });
+			}
+			_batch_key = key;
+		}
+	}
+
+	this->_static_enabled = obs_data_get_bool(settings, S_STATICINPUT);
 }
 
 void filter::blur::blur_instance::load(obs_data_t* settings)
@@ -812,23 +957,14 @@ void filter::blur::blur_instance::deactivate() {}
 
 void filter::blur::blur_instance::video_tick(float)
 {
+	auto profile = _profiler.track(util::profiler::stage::Tick);
+
 	// Blur
 	if (_blur) {
-		_blur->set_size(_blur_size);
-		if (_blur_step_scaling) {
-			_blur->set_step_scale(_blur_step_scale.first, _blur_step_scale.second);
-		} else {
-			_blur->set_step_scale(1.0, 1.0);
-		}
-		if ((_blur->get_type() == ::gfx::blur::type::Directional)
-			|| (_blur->get_type() == ::gfx::blur::type::Rotational)) {
-			auto obj = std::dynamic_pointer_cast<::gfx::blur::base_angle>(_blur);
-			obj->set_angle(_blur_angle);
-		}
-		if ((_blur->get_type() == ::gfx::blur::type::Zoom) || (_blur->get_type() == ::gfx::blur::type::Rotational)) {
-			auto obj = std::dynamic_pointer_cast<::gfx::blur::base_center>(_blur);
-			obj->set_center(_blur_center.first, _blur_center.second);
-		}
+		apply_blur_parameters(_blur);
+	}
+	if (_batch) {
+		apply_blur_parameters(_batch->get_blur());
 	}
 
 	// Load Mask
@@ -855,12 +991,39 @@ void filter::blur::blur_instance::video_tick(float)
 		}
 	}
 
+	// Show last frame's result again if neither the input nor a mask source can have changed since.
+	bool reuse = false;
+	if (_static_enabled) {
+		obs_source_t* dependency = nullptr;
+		if (_mask.enabled && (_mask.type == mask_type::Source) && _mask.source.source_texture) {
+			dependency = _mask.source.source_texture->get_object();
+		}
+		reuse = _static_input.update(_self, dependency) && _output_rendered;
+	} else {
+		_static_input.reset();
+	}
+
+	if (reuse) {
+		_profiler.count_frame(true);
+		return;
+	}
+
+	// Return last frame's result to the pool, instances that are not rendered this frame don't need it.
+	_output_texture.reset();
+	_output_rt.reset();
 	_source_rendered = false;
 	_output_rendered = false;
+
+	// Hidden sources would only be rendered for nothing by whichever member renders the batch.
+	if (_batch && obs_source_showing(obs_filter_get_parent(_self))) {
+		_batch->join(this, [this]() { return render_source() ? _source_texture : nullptr; });
+	}
 }
 
 void filter::blur::blur_instance::video_render(gs_effect_t* effect)
 {
+	auto profile = _profiler.track(util::profiler::stage::Render);
+
 	obs_source_t* parent        = obs_filter_get_parent(this->_self);
 	obs_source_t* target        = obs_filter_get_target(this->_self);
 	gs_effect_t*  defaultEffect = obs_get_base_effect(obs_base_effect::OBS_EFFECT_DEFAULT);
@@ -878,72 +1041,56 @@ void filter::blur::blur_instance::video_render(gs_effect_t* effect)
 		return;
 	}
 
-	if (!_source_rendered) {
-		// Source To Texture
-		{
-			if (obs_source_process_filter_begin(this->_self, GS_RGBA, OBS_ALLOW_DIRECT_RENDERING)) {
-				{
-					auto op = this->_source_rt->render(baseW, baseH);
-
-					gs_blend_state_push();
-					gs_reset_blend_state();
-					gs_enable_blending(false);
-					gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+	// Another member of the batch may already have blurred this one.
+	if (!_output_rendered && _batch) {
+		if (std::shared_ptr<gs::rendertarget> batched = _batch->render(this)) {
+			_output_rt       = batched;
+			_output_texture  = batched->get_texture();
+			_output_rendered = true;
+			_profiler.count_frame(false);
 
-					gs_set_cull_mode(GS_NEITHER);
-					gs_enable_color(true, true, true, true);
-
-					gs_enable_depth_test(false);
-					gs_depth_function(GS_ALWAYS);
-
-					gs_enable_stencil_test(false);
-					gs_enable_stencil_write(false);
-					gs_stencil_function(GS_STENCIL_BOTH, GS_ALWAYS);
-					gs_stencil_op(GS_STENCIL_BOTH, GS_KEEP, GS_KEEP, GS_KEEP);
-
-					// Orthographic Camera and clear RenderTarget.
-					gs_ortho(0, (float)baseW, 0, (float)baseH, -1., 1.);
-					//gs_clear(GS_CLEAR_COLOR | GS_CLEAR_DEPTH, &black, 0, 0);
+			_source_texture.reset();
+			_source_rt.reset();
+		}
+	}
 
-					// Render
-					obs_source_process_filter_end(this->_self, defaultEffect, baseW, baseH);
+	if (!_output_rendered) {
+		if (!render_source()) {
+			obs_source_skip_video_filter(this->_self);
+			return;
+		}
 
-					gs_blend_state_pop();
-				}
+		// The mask source renders other sources, which may change any state, so it goes first.
+		if (_mask.enabled && _mask.source.source_texture) {
+			uint32_t source_width  = obs_source_get_width(this->_mask.source.source_texture->get_object());
+			uint32_t source_height = obs_source_get_height(this->_mask.source.source_texture->get_object());
 
-				_source_texture = this->_source_rt->get_texture();
-				if (!_source_texture) {
-					obs_source_skip_video_filter(this->_self);
-					return;
+			if (source_width == 0) {
+				source_width = baseW;
+			}
+			if (source_height == 0) {
+				source_height = baseH;
+			}
+			if (this->_mask.source.is_scene) {
+				obs_video_info ovi;
+				if (obs_get_video_info(&ovi)) {
+					source_width  = ovi.base_width;
+					source_height = ovi.base_height;
 				}
-			} else {
-				obs_source_skip_video_filter(this->_self);
-				return;
 			}
+
+			this->_mask.source.texture = this->_mask.source.source_texture->render(source_width, source_height);
 		}
 
-		_source_rendered = true;
-	}
+		auto state = ::gs::render_state::opaque().apply();
 
-	if (!_output_rendered) {
-		_blur->set_input(_source_texture);
+		// Upscaled again by the sampler when the result is drawn at full size.
+		_blur->set_input(_downsampler.render(_source_texture, std::max(uint32_t(baseW * _blur_scale), 1u),
+											 std::max(uint32_t(baseH * _blur_scale), 1u)));
 		_output_texture = _blur->render();
 
 		// Mask
-		if (_mask.enabled) {
-			gs_blend_state_push();
-			gs_reset_blend_state();
-			gs_enable_color(true, true, true, true);
-			gs_enable_blending(false);
-			gs_enable_depth_test(false);
-			gs_enable_stencil_test(false);
-			gs_enable_stencil_write(false);
-			gs_set_cull_mode(GS_NEITHER);
-			gs_depth_function(GS_ALWAYS);
-			gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-			gs_stencil_function(GS_STENCIL_BOTH, GS_ALWAYS);
-			gs_stencil_op(GS_STENCIL_BOTH, GS_ZERO, GS_ZERO, GS_ZERO);
-
+		if (_mask.enabled && blur_factory::get()->get_mask_effect()) {
 			std::string technique = "";
 			switch (this->_mask.type) {
 			case Region:
@@ -967,44 +1114,22 @@ void filter::blur::blur_instance::video_render(gs_effect_t* effect)
 				break;
 			}
 
-			if (_mask.source.source_texture) {
-				uint32_t source_width  = obs_source_get_width(this->_mask.source.source_texture->get_object());
-				uint32_t source_height = obs_source_get_height(this->_mask.source.source_texture->get_object());
-
-				if (source_width == 0) {
-					source_width = baseW;
-				}
-				if (source_height == 0) {
-					source_height = baseH;
-				}
-				if (this->_mask.source.is_scene) {
-					obs_video_info ovi;
-					if (obs_get_video_info(&ovi)) {
-						source_width  = ovi.base_width;
-						source_height = ovi.base_height;
-					}
-				}
-
-				this->_mask.source.texture = this->_mask.source.source_texture->render(source_width, source_height);
-			}
-
 			std::shared_ptr<gs::effect> mask_effect = blur_factory::get()->get_mask_effect();
-			apply_mask_parameters(mask_effect, _source_texture->get_object(), _output_texture->get_object());
+			apply_mask_parameters(_source_texture->get_object(), _output_texture->get_object());
 
 			try {
-				auto op = this->_output_rt->render(baseW, baseH);
+				this->_output_rt = _pool->acquire(baseW, baseH, GS_RGBA);
+				auto op          = this->_output_rt->render(baseW, baseH);
 				gs_ortho(0, (float)baseW, 0, (float)baseH, -1, 1);
 
 				// Render
 				while (gs_effect_loop(mask_effect->get_object(), technique.c_str())) {
-					gs_draw_sprite(_output_texture->get_object(), 0, baseW, baseH);
+					gs::draw_sprite(_output_texture->get_object(), 0, baseW, baseH);
 				}
 			} catch (const std::exception&) {
-				gs_blend_state_pop();
 				obs_source_skip_video_filter(this->_self);
 				return;
 			}
-			gs_blend_state_pop();
 
 			if (!(_output_texture = this->_output_rt->get_texture())) {
 				obs_source_skip_video_filter(this->_self);
@@ -1013,6 +1138,11 @@ void filter::blur::blur_instance::video_render(gs_effect_t* effect)
 		}
 
 		_output_rendered = true;
+		_profiler.count_frame(false);
+
+		// Only the result is needed for the rest of the frame.
+		_source_texture.reset();
+		_source_rt.reset();
 	}
 
 	// Draw source
@@ -1039,7 +1169,7 @@ void filter::blur::blur_instance::video_render(gs_effect_t* effect)
 			gs_effect_set_texture(param, _output_texture->get_object());
 		}
 		while (gs_effect_loop(finalEffect, technique)) {
-			gs_draw_sprite(_output_texture->get_object(), 0, baseW, baseH);
+			gs::draw_sprite(_output_texture->get_object(), 0, baseW, baseH);
 		}
 	}
 }
@@ -24,12 +24,17 @@
 #include <map>
 #include <memory>
 #include "gfx/blur/gfx-blur-base.hpp"
+#include "gfx/blur/gfx-blur-batch.hpp"
+#include "gfx/gfx-downsampler.hpp"
 #include "gfx/gfx-source-texture.hpp"
 #include "obs/gs/gs-effect.hpp"
 #include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-rendertarget-pool.hpp"
 #include "obs/gs/gs-rendertarget.hpp"
 #include "obs/gs/gs-texture.hpp"
+#include "obs/obs-static-input.hpp"
 #include "plugin.hpp"
+#include "util-profiler.hpp"
 
 // OBS
 #ifdef _MSC_VER
@@ -51,11 +56,34 @@ namespace filter {
 			Source,
 		};
 
+		enum processing_scale : int64_t {
+			Quarter = 25,
+			Half    = 50,
+			Full    = 100,
+		};
+
 		class blur_factory {
+			public:
+			struct mask_parameters {
+				gs::texture_parameter image_orig;
+				gs::texture_parameter image_blur;
+				gs::float_parameter   region_left;
+				gs::float_parameter   region_right;
+				gs::float_parameter   region_top;
+				gs::float_parameter   region_bottom;
+				gs::float_parameter   region_feather;
+				gs::float_parameter   region_feather_shift;
+				gs::texture_parameter image;
+				gs::float4_parameter  color;
+				gs::float_parameter   multiplier;
+			};
+
+			private:
 			obs_source_info             _source_info;
 			std::list<blur_instance*>   _sources;
 			std::shared_ptr<gs::effect> _color_converter_effect;
 			std::shared_ptr<gs::effect> _mask_effect;
+			mask_parameters             _mask_parameters;
 
 			std::map<std::string, std::string> _translation_map;
 
@@ -95,11 +123,19 @@ namespace filter {
 			std::shared_ptr<gs::effect> get_color_converter_effect();
 
 			std::shared_ptr<gs::effect> get_mask_effect();
+
+			mask_parameters& get_mask_parameters();
 		};
 
 		class blur_instance {
 			obs_source_t* _self;
 
+			// Profiling
+			util::profiler _profiler;
+
+			// Render targets are taken from the pool when needed and returned as soon as possible.
+			std::shared_ptr<gs::rendertarget_pool> _pool;
+
 			// Input
 			std::shared_ptr<gs::rendertarget> _source_rt;
 			std::shared_ptr<gs::texture>      _source_texture;
@@ -117,6 +153,12 @@ namespace filter {
 			std::pair<double_t, double_t>       _blur_center;
 			bool                                _blur_step_scaling;
 			std::pair<double_t, double_t>       _blur_step_scale;
+			double_t                            _blur_scale;
+			::gfx::downsampler                  _downsampler;
+
+			// Batching
+			std::shared_ptr<::gfx::blur::batch> _batch;
+			std::string                         _batch_key;
 
 			// Masking
 			struct {
@@ -152,13 +194,21 @@ namespace filter {
 				float_t multiplier;
 			} _mask;
 
+			// Static Input
+			bool              _static_enabled;
+			obs::static_input _static_input;
+
 			public:
 			blur_instance(obs_data_t* settings, obs_source_t* self);
 			~blur_instance();
 
 			private:
-			bool apply_mask_parameters(std::shared_ptr<gs::effect> effect, gs_texture_t* original_texture,
-									   gs_texture_t* blurred_texture);
+			bool apply_mask_parameters(gs_texture_t* original_texture, gs_texture_t* blurred_texture);
+
+			void apply_blur_parameters(std::shared_ptr<::gfx::blur::base> blur);
+
+			// Capture the input into _source_texture, unless that already happened this frame.
+			bool render_source();
 
 			static bool modified_properties(void* ptr, obs_properties_t* props, obs_property* prop,
 											obs_data_t* settings);
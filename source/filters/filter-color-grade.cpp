@@ -18,6 +18,11 @@
  */
 
 #include "filter-color-grade.hpp"
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include "gfx/lut/gfx-lut-cube.hpp"
+#include "obs/gs/gs-helper.hpp"
 #include "strings.hpp"
 #include "util-math.hpp"
 
@@ -47,6 +52,15 @@
 #define ST_TINT_(x, y) ST_TINT "." D_VSTR(x) "." D_VSTR(y)
 #define ST_CORRECTION ST ".Correction"
 #define ST_CORRECTION_(x) ST_CORRECTION "." D_VSTR(x)
+#define ST_LUT ST ".LUT"
+#define ST_LUT_DISABLED ST_LUT ".Disabled"
+#define ST_LUT_FILE ST_LUT ".File"
+#define ST_LUT_SIZE32 ST_LUT ".Size32"
+#define ST_LUT_SIZE64 ST_LUT ".Size64"
+#define ST_LUT_PATH ST_LUT ".Path"
+#define ST_LUT_PATH_TYPES ST_LUT ".Path.Types"
+#define ST_LUT_EXPORT ST_LUT ".Export"
+#define ST_LUT_EXPORT_SAVE ST_LUT ".Export.Save"
 
 #define RED Red
 #define GREEN Green
@@ -60,6 +74,9 @@
 #define TONE_MID Midtone
 #define TONE_HIG Highlight
 
+// Time between two checks of the .cube file for changes, in nanoseconds.
+#define LUT_FILE_CHECK_INTERVAL 1000000000ull
+
 // Initializer & Finalizer
 P_INITIALIZER(FilterColorGradeInit)
 {
@@ -104,6 +121,10 @@ void get_defaults(obs_data_t* data)
 	obs_data_set_default_double(data, ST_CORRECTION_(SATURATION), 100.0);
 	obs_data_set_default_double(data, ST_CORRECTION_(LIGHTNESS), 100.0);
 	obs_data_set_default_double(data, ST_CORRECTION_(CONTRAST), 100.0);
+	obs_data_set_default_int(data, ST_LUT, filter::color_grade::lut_mode::Disabled);
+	obs_data_set_default_string(data, ST_LUT_PATH, "");
+	obs_data_set_default_string(data, ST_LUT_EXPORT, "");
+	obs_data_set_default_bool(data, S_STATICINPUT, false);
 }
 
 bool tool_modified(obs_properties_t* props, obs_property_t* property, obs_data_t* settings)
@@ -146,6 +167,22 @@ bool tool_modified(obs_properties_t* props, obs_property_t* property, obs_data_t
 	return true;
 }
 
+bool lut_modified(obs_properties_t* props, obs_property_t*, obs_data_t* settings)
+{
+	auto mode = static_cast<filter::color_grade::lut_mode>(obs_data_get_int(settings, ST_LUT));
+	obs_property_set_visible(obs_properties_get(props, ST_LUT_PATH), mode == filter::color_grade::lut_mode::File);
+	return true;
+}
+
+bool lut_export_clicked(obs_properties_t*, obs_property_t*, void* ptr)
+try {
+	reinterpret_cast<filter::color_grade::color_grade_instance*>(ptr)->export_lut();
+	return false;
+} catch (std::exception& ex) {
+	P_LOG_ERROR("<filter-color-grade> Failed to export lookup table: %s", ex.what());
+	return false;
+}
+
 obs_properties_t* get_properties(void*)
 {
 	obs_properties_t* pr = obs_properties_create();
@@ -259,6 +296,30 @@ obs_properties_t* get_properties(void*)
 										1000.0, 0.01);
 	}
 
+	{
+		auto p = obs_properties_add_list(pr, ST_LUT, D_TRANSLATE(ST_LUT), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+		obs_property_set_long_description(p, D_TRANSLATE(D_DESC(ST_LUT)));
+		obs_property_set_modified_callback(p, &lut_modified);
+		obs_property_list_add_int(p, D_TRANSLATE(ST_LUT_DISABLED), filter::color_grade::lut_mode::Disabled);
+		obs_property_list_add_int(p, D_TRANSLATE(ST_LUT_FILE), filter::color_grade::lut_mode::File);
+		obs_property_list_add_int(p, D_TRANSLATE(ST_LUT_SIZE32), filter::color_grade::lut_mode::Bake32);
+		obs_property_list_add_int(p, D_TRANSLATE(ST_LUT_SIZE64), filter::color_grade::lut_mode::Bake64);
+
+		p = obs_properties_add_path(pr, ST_LUT_PATH, D_TRANSLATE(ST_LUT_PATH), OBS_PATH_FILE,
+									D_TRANSLATE(ST_LUT_PATH_TYPES), nullptr);
+		obs_property_set_long_description(p, D_TRANSLATE(D_DESC(ST_LUT_PATH)));
+
+		p = obs_properties_add_path(pr, ST_LUT_EXPORT, D_TRANSLATE(ST_LUT_EXPORT), OBS_PATH_FILE_SAVE,
+									D_TRANSLATE(ST_LUT_PATH_TYPES), nullptr);
+		obs_property_set_long_description(p, D_TRANSLATE(D_DESC(ST_LUT_EXPORT)));
+		obs_properties_add_button(pr, ST_LUT_EXPORT_SAVE, D_TRANSLATE(ST_LUT_EXPORT_SAVE), &lut_export_clicked);
+	}
+
+	{
+		auto p = obs_properties_add_bool(pr, S_STATICINPUT, D_TRANSLATE(S_STATICINPUT));
+		obs_property_set_long_description(p, D_TRANSLATE(D_DESC(S_STATICINPUT)));
+	}
+
 	return pr;
 }
 
@@ -368,11 +429,22 @@ filter::color_grade::color_grade_factory::color_grade_factory()
 
 filter::color_grade::color_grade_factory::~color_grade_factory() {}
 
-filter::color_grade::color_grade_instance::~color_grade_instance() {}
+util::worker& filter::color_grade::color_grade_factory::get_cube_worker()
+{
+	return _cube_worker;
+}
+
+filter::color_grade::color_grade_instance::~color_grade_instance()
+{
+	cancel_lut_file();
+}
 
 filter::color_grade::color_grade_instance::color_grade_instance(obs_data_t* data, obs_source_t* context)
-	: _active(true), _self(context)
+	: _active(true), _self(context), _pool(gs::rendertarget_pool::get()), _lut_mode(lut_mode::Disabled),
+	  _lut_parameters(), _lut_file_stamp(0), _lut_file_checked(0), _static_enabled(false)
 {
+	_profiler.register_procedures(_self);
+
 	update(data);
 
 	{
@@ -380,6 +452,19 @@ filter::color_grade::color_grade_instance::color_grade_instance(obs_data_t* data
 		if (file) {
 			try {
 				_effect = gs::effect::create(file);
+				_parameters.image.bind(*_effect, "image");
+				_parameters.lift.bind(*_effect, "pLift");
+				_parameters.gamma.bind(*_effect, "pGamma");
+				_parameters.gain.bind(*_effect, "pGain");
+				_parameters.offset.bind(*_effect, "pOffset");
+				_parameters.tint_low.bind(*_effect, "pTintLow");
+				_parameters.tint_mid.bind(*_effect, "pTintMid");
+				_parameters.tint_hig.bind(*_effect, "pTintHig");
+				_parameters.correction.bind(*_effect, "pCorrection");
+				_parameters.lut.bind(*_effect, "pLUT");
+				_parameters.lut_size.bind(*_effect, "pLUTSize");
+				_parameters.lut_domain_min.bind(*_effect, "pLUTDomainMin");
+				_parameters.lut_domain_max.bind(*_effect, "pLUTDomainMax");
 				bfree(file);
 			} catch (std::runtime_error& ex) {
 				P_LOG_ERROR("<filter-color-grade> Loading _effect '%s' failed with error(s): %s", file, ex.what());
@@ -390,20 +475,6 @@ filter::color_grade::color_grade_instance::color_grade_instance(obs_data_t* data
 			throw std::runtime_error("Missing file color-grade.effect.");
 		}
 	}
-	{
-		_rt_source = std::make_unique<gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-		{
-			auto op = _rt_source->render(1, 1);
-		}
-		_tex_source = _rt_source->get_texture();
-	}
-	{
-		_rt_grade = std::make_unique<gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-		{
-			auto op = _rt_grade->render(1, 1);
-		}
-		_tex_grade = _rt_grade->get_texture();
-	}
 }
 
 uint32_t filter::color_grade::color_grade_instance::get_width()
@@ -456,6 +527,12 @@ void filter::color_grade::color_grade_instance::update(obs_data_t* data)
 	_correction.y = static_cast<float_t>(obs_data_get_double(data, ST_CORRECTION_(SATURATION)) / 100.0);
 	_correction.z = static_cast<float_t>(obs_data_get_double(data, ST_CORRECTION_(LIGHTNESS)) / 100.0);
 	_correction.w = static_cast<float_t>(obs_data_get_double(data, ST_CORRECTION_(CONTRAST)) / 100.0);
+
+	_lut_mode        = static_cast<lut_mode>(obs_data_get_int(data, ST_LUT));
+	_lut_file        = obs_data_get_string(data, ST_LUT_PATH);
+	_lut_export_file = obs_data_get_string(data, ST_LUT_EXPORT);
+
+	_static_enabled = obs_data_get_bool(data, S_STATICINPUT);
 }
 
 void filter::color_grade::color_grade_instance::activate()
@@ -470,12 +547,105 @@ void filter::color_grade::color_grade_instance::deactivate()
 
 void filter::color_grade::color_grade_instance::video_tick(float)
 {
-	_source_updated = false;
-	_grade_updated  = false;
+	auto profile = _profiler.track(util::profiler::stage::Tick);
+
+	// Load the .cube file, instances using the same table share one texture.
+	if (_lut_mode == lut_mode::File) {
+		update_lut_file();
+	} else {
+		_lut_cube.reset();
+		cancel_lut_file();
+		_lut_file_loaded.clear();
+		_lut_file_stamp = 0;
+	}
+
+	// Show last frame's result again if the input can't have changed since, nor the table that was loaded.
+	bool reuse = false;
+	if (_static_enabled) {
+		uint64_t lut_key = _lut_file_stamp ^ uint64_t(reinterpret_cast<uintptr_t>(_lut_cube.get()));
+		reuse            = _static_input.update(_self, nullptr, lut_key) && _grade_updated;
+	} else {
+		_static_input.reset();
+	}
+
+	if (reuse) {
+		_profiler.count_frame(true);
+	} else {
+		// Return last frame's result to the pool, instances that are not rendered this frame don't need it.
+		_tex_grade.reset();
+		_rt_grade.reset();
+		_source_updated = false;
+		_grade_updated  = false;
+	}
+}
+
+void filter::color_grade::color_grade_instance::update_lut_file()
+{
+	// Upload a table that finished loading, unless another file was picked in the meantime.
+	if (_lut_loading && _lut_loading->done.load(std::memory_order_acquire)) {
+		std::shared_ptr<cube_load> loaded = std::move(_lut_loading);
+		_lut_loading_task.reset();
+		if (loaded->file == _lut_file) {
+			if (loaded->table) {
+				_lut_cube = gfx::lut::cube_cache::get()->upload(loaded->table);
+			} else {
+				// An edited file may just be half written, the previous table stays until it reads fine.
+				P_LOG_ERROR("<filter-color-grade> Instance '%s' failed to load lookup table '%s': %s",
+							obs_source_get_name(_self), loaded->file.c_str(), loaded->error.c_str());
+			}
+		}
+	}
+
+	// Modification time and size are enough to notice edits, and are cheap to check once in a while.
+	uint64_t now = os_gettime_ns();
+	if ((_lut_file_loaded == _lut_file) && ((now - _lut_file_checked) < LUT_FILE_CHECK_INTERVAL))
+		return;
+	_lut_file_checked = now;
+
+	uint64_t    stamp = 0;
+	struct stat stats;
+	if (!_lut_file.empty() && (os_stat(_lut_file.c_str(), &stats) == 0)) {
+		stamp = (uint64_t(stats.st_mtime) << 32) ^ uint64_t(stats.st_size);
+	}
+	if (_lut_file_loaded != _lut_file) {
+		_lut_file_loaded = _lut_file;
+		_lut_cube.reset();
+	} else if (stamp == _lut_file_stamp) {
+		return;
+	}
+	_lut_file_stamp = stamp;
+	cancel_lut_file();
+	if (_lut_file.empty())
+		return;
+
+	// An outdated load that already started finishes into a result nobody looks at anymore.
+	auto loading  = std::make_shared<cube_load>();
+	loading->file = _lut_file;
+	loading->done.store(false, std::memory_order_relaxed);
+	_lut_loading      = loading;
+	_lut_loading_task = color_grade_factory::get()->get_cube_worker().push([loading](util::worker::task&) {
+		try {
+			loading->table = gfx::lut::cube_cache::get()->read(loading->file);
+		} catch (std::exception& ex) {
+			loading->error = ex.what();
+		}
+		loading->done.store(true, std::memory_order_release);
+	});
+}
+
+void filter::color_grade::color_grade_instance::cancel_lut_file()
+{
+	if (_lut_loading_task) {
+		_lut_loading_task->cancel();
+		_lut_loading_task.reset();
+	}
+	_lut_loading.reset();
 }
 
 void filter::color_grade::color_grade_instance::video_render(gs_effect_t*)
 {
+	auto profile = _profiler.track(util::profiler::stage::Render);
+
 	// Grab initial values.
 	obs_source_t* parent         = obs_filter_get_parent(_self);
 	obs_source_t* target         = obs_filter_get_target(_self);
@@ -490,6 +660,7 @@ void filter::color_grade::color_grade_instance::video_render(gs_effect_t*)
 	}
 
 	if (!_source_updated) {
+		_rt_source = _pool->acquire(width, height, GS_RGBA);
 		if (obs_source_process_filter_begin(_self, GS_RGBA, OBS_ALLOW_DIRECT_RENDERING)) {
 			auto op = _rt_source->render(width, height);
 			gs_blend_state_push();
@@ -503,6 +674,10 @@ void filter::color_grade::color_grade_instance::video_render(gs_effect_t*)
 			gs_ortho(0, static_cast<float_t>(width), 0, static_cast<float_t>(height), -1., 1.);
 			obs_source_process_filter_end(_self, effect_default, width, height);
 			gs_blend_state_pop();
+		} else {
+			// A pooled target holds whatever was last rendered to it.
+			obs_source_skip_video_filter(_self);
+			return;
 		}
 
 		_tex_source     = _rt_source->get_texture();
@@ -510,6 +685,7 @@ void filter::color_grade::color_grade_instance::video_render(gs_effect_t*)
 	}
 
 	if (!_grade_updated) {
+		_rt_grade = _pool->acquire(width, height, GS_RGBA);
 		{
 			auto op = _rt_grade->render(width, height);
 			gs_blend_state_push();
@@ -522,34 +698,56 @@ void filter::color_grade::color_grade_instance::video_render(gs_effect_t*)
 			gs_enable_stencil_write(false);
 			gs_ortho(0, static_cast<float_t>(width), 0, static_cast<float_t>(height), -1., 1.);
 
-			if (_effect->has_parameter("image"))
-				_effect->get_parameter("image")->set_texture(_tex_source);
-			if (_effect->has_parameter("pLift"))
-				_effect->get_parameter("pLift")->set_float4(_lift);
-			if (_effect->has_parameter("pGamma"))
-				_effect->get_parameter("pGamma")->set_float4(_gamma);
-			if (_effect->has_parameter("pGain"))
-				_effect->get_parameter("pGain")->set_float4(_gain);
-			if (_effect->has_parameter("pOffset"))
-				_effect->get_parameter("pOffset")->set_float4(_offset);
-			if (_effect->has_parameter("pTintLow"))
-				_effect->get_parameter("pTintLow")->set_float3(_tint_low);
-			if (_effect->has_parameter("pTintMid"))
-				_effect->get_parameter("pTintMid")->set_float3(_tint_mid);
-			if (_effect->has_parameter("pTintHig"))
-				_effect->get_parameter("pTintHig")->set_float3(_tint_hig);
-			if (_effect->has_parameter("pCorrection"))
-				_effect->get_parameter("pCorrection")->set_float4(_correction);
-
-			while (gs_effect_loop(_effect->get_object(), "Draw")) {
-				gs_draw_sprite(nullptr, 0, width, height);
+			_parameters.image.set(_tex_source);
+			if ((_lut_mode == lut_mode::File) && _lut_cube) {
+				_parameters.lut.set(_lut_cube->texture);
+				_parameters.lut_size.set(static_cast<float_t>(_lut_cube->size));
+				_parameters.lut_domain_min.set(_lut_cube->domain_min[0], _lut_cube->domain_min[1],
+											   _lut_cube->domain_min[2]);
+				_parameters.lut_domain_max.set(_lut_cube->domain_max[0], _lut_cube->domain_max[1],
+											   _lut_cube->domain_max[2]);
+
+				while (gs_effect_loop(_effect->get_object(), "DrawLUT")) {
+					gs::draw_sprite(nullptr, 0, width, height);
+				}
+			} else if ((_lut_mode == lut_mode::Bake32) || (_lut_mode == lut_mode::Bake64)) {
+				update_lut();
+				_parameters.lut.set(_lut_texture);
+				_parameters.lut_size.set(static_cast<float_t>(_lut->get_size()));
+				_parameters.lut_domain_min.set(0.f, 0.f, 0.f);
+				_parameters.lut_domain_max.set(1.f, 1.f, 1.f);
+
+				while (gs_effect_loop(_effect->get_object(), "DrawLUT")) {
+					gs::draw_sprite(nullptr, 0, width, height);
+				}
+			} else {
+				_lut_texture.reset();
+				_lut.reset();
+
+				_parameters.lift.set(_lift);
+				_parameters.gamma.set(_gamma);
+				_parameters.gain.set(_gain);
+				_parameters.offset.set(_offset);
+				_parameters.tint_low.set(_tint_low);
+				_parameters.tint_mid.set(_tint_mid);
+				_parameters.tint_hig.set(_tint_hig);
+				_parameters.correction.set(_correction);
+
+				while (gs_effect_loop(_effect->get_object(), "Draw")) {
+					gs::draw_sprite(nullptr, 0, width, height);
+				}
 			}
 
 			gs_blend_state_pop();
 		}
 
-		_tex_grade      = _rt_grade->get_texture();
-		_source_updated = true;
+		_tex_grade     = _rt_grade->get_texture();
+		_grade_updated = true;
+		_profiler.count_frame(false);
+
+		// Only the result is needed for the rest of the frame.
+		_tex_source.reset();
+		_rt_source.reset();
 	}
 
 	// Render final result.
@@ -559,7 +757,62 @@ void filter::color_grade::color_grade_instance::video_render(gs_effect_t*)
 		while (gs_effect_loop(shader, "Draw")) {
 			gs_effect_set_texture(gs_effect_get_param_by_name(shader, "image"),
 								  _tex_grade ? _tex_grade->get_object() : nullptr);
-			gs_draw_sprite(nullptr, 0, width, height);
+			gs::draw_sprite(nullptr, 0, width, height);
 		}
 	}
 }
+
+void filter::color_grade::color_grade_instance::export_lut()
+{
+	if (_lut_export_file.empty())
+		throw std::runtime_error("No export file selected.");
+
+	gfx::lut::color_grade grade(33);
+	grade.bake(get_grade_parameters());
+
+	gfx::lut::cube cube(grade);
+	cube.set_title(obs_source_get_name(_self));
+
+	std::ofstream stream(_lut_export_file, std::ios::trunc);
+	if (!stream)
+		throw std::runtime_error("Could not open '" + _lut_export_file + "' for writing.");
+	cube.save(stream);
+
+	P_LOG_INFO("<filter-color-grade> Instance '%s' exported its grade to '%s'.", obs_source_get_name(_self),
+			   _lut_export_file.c_str());
+}
+
+gfx::lut::grade_parameters filter::color_grade::color_grade_instance::get_grade_parameters()
+{
+	gfx::lut::grade_parameters params = {
+		{_lift.x, _lift.y, _lift.z, _lift.w},
+		{_gamma.x, _gamma.y, _gamma.z, _gamma.w},
+		{_gain.x, _gain.y, _gain.z, _gain.w},
+		{_offset.x, _offset.y, _offset.z, _offset.w},
+		{_tint_low.x, _tint_low.y, _tint_low.z},
+		{_tint_mid.x, _tint_mid.y, _tint_mid.z},
+		{_tint_hig.x, _tint_hig.y, _tint_hig.z},
+		{_correction.x, _correction.y, _correction.z, _correction.w},
+	};
+	return params;
+}
+
+void filter::color_grade::color_grade_instance::update_lut()
+{
+	gfx::lut::grade_parameters params = get_grade_parameters();
+	if (_lut && _lut_texture && (_lut->get_size() == static_cast<uint32_t>(_lut_mode))
+		&& (memcmp(&params, &_lut_parameters, sizeof(gfx::lut::grade_parameters)) == 0)) {
+		return;
+	}
+
+	if (!_lut || (_lut->get_size() != static_cast<uint32_t>(_lut_mode))) {
+		_lut = std::make_shared<gfx::lut::color_grade>(static_cast<uint32_t>(_lut_mode));
+	}
+	_lut->bake(params);
+	_lut_parameters = params;
+
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(_lut->get_data());
+
+	_lut_texture = std::make_shared<gs::texture>(_lut->get_width(), _lut->get_height(), GS_RGBA32F, 1, &data,
+												 gs::texture::flags::None);
+}
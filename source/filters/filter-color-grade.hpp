@@ -18,19 +18,36 @@
  */
 
 #pragma once
+#include <atomic>
 #include <memory>
 #include <vector>
+#include "gfx/lut/gfx-lut-cache.hpp"
+#include "gfx/lut/gfx-lut-color-grade.hpp"
 #include "obs/gs/gs-mipmapper.hpp"
+#include "obs/gs/gs-rendertarget-pool.hpp"
 #include "obs/gs/gs-rendertarget.hpp"
 #include "obs/gs/gs-texture.hpp"
 #include "obs/gs/gs-vertexbuffer.hpp"
+#include "obs/obs-static-input.hpp"
 #include "plugin.hpp"
+#include "util-profiler.hpp"
+#include "util-worker.hpp"
 
 namespace filter {
 	namespace color_grade {
+		enum lut_mode : int64_t {
+			Disabled = 0,
+			File     = 1,
+			Bake32   = 32,
+			Bake64   = 64,
+		};
+
 		class color_grade_factory {
 			obs_source_info             sourceInfo;
 
+			// Reads .cube files for all instances, joined together with the factory when the module unloads.
+			util::worker _cube_worker;
+
 			public: // Singleton
 			static void                               initialize();
 			static void                               finalize();
@@ -39,21 +56,44 @@ namespace filter {
 			public:
 			color_grade_factory();
 			~color_grade_factory();
+
+			util::worker& get_cube_worker();
 		};
 
 		class color_grade_instance {
 			bool          _active;
 			obs_source_t* _self;
 
+			// Profiling
+			util::profiler _profiler;
+
 			std::shared_ptr<gs::effect> _effect;
+			struct {
+				gs::texture_parameter image;
+				gs::float4_parameter  lift;
+				gs::float4_parameter  gamma;
+				gs::float4_parameter  gain;
+				gs::float4_parameter  offset;
+				gs::float3_parameter  tint_low;
+				gs::float3_parameter  tint_mid;
+				gs::float3_parameter  tint_hig;
+				gs::float4_parameter  correction;
+				gs::texture_parameter lut;
+				gs::float_parameter   lut_size;
+				gs::float3_parameter  lut_domain_min;
+				gs::float3_parameter  lut_domain_max;
+			} _parameters;
+
+			// Render targets are taken from the pool when needed and returned as soon as possible.
+			std::shared_ptr<gs::rendertarget_pool> _pool;
 
 			// Source
-			std::unique_ptr<gs::rendertarget> _rt_source;
+			std::shared_ptr<gs::rendertarget> _rt_source;
 			std::shared_ptr<gs::texture>      _tex_source;
 			bool                              _source_updated;
 
 			// Grading
-			std::unique_ptr<gs::rendertarget> _rt_grade;
+			std::shared_ptr<gs::rendertarget> _rt_grade;
 			std::shared_ptr<gs::texture>      _tex_grade;
 			bool                              _grade_updated;
 
@@ -67,6 +107,33 @@ namespace filter {
 			vec3 _tint_hig;
 			vec4 _correction;
 
+			// Lookup table, baked again only when the parameters differ from the ones it was baked with.
+			lut_mode                               _lut_mode;
+			std::shared_ptr<gfx::lut::color_grade> _lut;
+			gfx::lut::grade_parameters             _lut_parameters;
+			std::shared_ptr<gs::texture>           _lut_texture;
+
+			// Lookup table from a .cube file, shared with every other instance using the same table.
+			//  The file is read and parsed on the worker of the factory, and read again when it changes on disk.
+			struct cube_load {
+				std::string                           file;
+				std::shared_ptr<gfx::lut::cube_table> table;
+				std::string                           error;
+				std::atomic<bool>                     done;
+			};
+			std::string                             _lut_file;
+			std::string                             _lut_file_loaded;
+			uint64_t                                _lut_file_stamp;
+			uint64_t                                _lut_file_checked;
+			std::shared_ptr<cube_load>              _lut_loading;
+			std::shared_ptr<util::worker::task>     _lut_loading_task;
+			std::shared_ptr<gfx::lut::cube_texture> _lut_cube;
+			std::string                             _lut_export_file;
+
+			// Graded result is shown again while the input is static.
+			bool              _static_enabled;
+			obs::static_input _static_input;
+
 			public:
 			~color_grade_instance();
 			color_grade_instance(obs_data_t*, obs_source_t*);
@@ -79,6 +146,22 @@ namespace filter {
 			void deactivate();
 			void video_tick(float);
 			void video_render(gs_effect_t*);
+
+			/*!
+			 * \brief Write the current grade to the export file as a 33x33x33 .cube table.
+			 */
+			void export_lut();
+
+			private:
+			gfx::lut::grade_parameters get_grade_parameters();
+
+			void update_lut();
+
+			// Reload the .cube file if it was changed, picked or edited, and upload it once read.
+			void update_lut_file();
+
+			// Drop a load that is no longer wanted, skipping it if it didn't start yet.
+			void cancel_lut_file();
 		};
 	} // namespace color_grade
 } // namespace filter
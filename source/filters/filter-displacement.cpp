@@ -200,6 +200,8 @@ filter::displacement::displacement_instance::displacement_instance(obs_data_t* d
 	: _self(context), _timer(0), _effect(nullptr), _distance(0), _file_create_time(0), _file_modified_time(0),
 	  _file_size(0)
 {
+	_profiler.register_procedures(_self);
+
 	char* effectFile = obs_module_file("effects/displace.effect");
 	if (effectFile) {
 		try {
@@ -248,6 +250,8 @@ void filter::displacement::displacement_instance::hide() {}
 
 void filter::displacement::displacement_instance::video_tick(float time)
 {
+	auto profile = _profiler.track(util::profiler::stage::Tick);
+
 	_timer += time;
 	if (_timer >= 1.0f) {
 		_timer -= 1.0f;
@@ -262,6 +266,8 @@ static float interp(float a, float b, float v)
 
 void filter::displacement::displacement_instance::video_render(gs_effect_t*)
 {
+	auto profile = _profiler.track(util::profiler::stage::Render);
+
 	obs_source_t* parent = obs_filter_get_parent(_self);
 	obs_source_t* target = obs_filter_get_target(_self);
 	uint32_t      baseW = obs_source_get_base_width(target), baseH = obs_source_get_base_height(target);
@@ -278,14 +284,14 @@ void filter::displacement::displacement_instance::video_render(gs_effect_t*)
 	}
 
 	if (_effect->has_parameter("texelScale")) {
-		_effect->get_parameter("texelScale")
+		_effect->find_parameter("texelScale")
 			->set_float2(interp((1.0f / baseW), 1.0f, _distance), interp((1.0f / baseH), 1.0f, _distance));
 	}
 	if (_effect->has_parameter("displacementScale")) {
-		_effect->get_parameter("displacementScale")->set_float2(_displacement_scale);
+		_effect->find_parameter("displacementScale")->set_float2(_displacement_scale);
 	}
 	if (_effect->has_parameter("displacementMap")) {
-		_effect->get_parameter("displacementMap")->set_texture(_file_texture);
+		_effect->find_parameter("displacementMap")->set_texture(_file_texture);
 	}
 
 	obs_source_process_filter_end(_self, _effect->get_object(), baseW, baseH);
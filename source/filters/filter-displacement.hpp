@@ -22,6 +22,7 @@
 #include <string>
 #include "obs/gs/gs-effect.hpp"
 #include "plugin.hpp"
+#include "util-profiler.hpp"
 
 // OBS
 #ifdef _MSC_VER
@@ -69,6 +70,9 @@ namespace filter {
 			obs_source_t* _self;
 			float_t       _timer;
 
+			// Profiling
+			util::profiler _profiler;
+
 			// Rendering
 			std::shared_ptr<gs::effect> _effect;
 			float_t                     _distance;
@@ -19,6 +19,7 @@
 
 #include "filter-dynamic-mask.hpp"
 #include <sstream>
+#include "obs/gs/gs-helper.hpp"
 #include "strings.hpp"
 
 // Filter to allow dynamic masking
@@ -94,6 +95,7 @@ filter::dynamic_mask::dynamic_mask_factory::dynamic_mask_factory()
 					settings, (std::string(ST_CHANNEL_INPUT) + "." + kv.second + "." + kv2.second).c_str(), 0.0);
 			}
 		}
+		obs_data_set_default_bool(settings, S_STATICINPUT, false);
 	};
 	_source_info.get_properties2 = [](void* _ptr, void* _type_data_ptr) {
 		obs_properties_t* props = obs_properties_create_param(_type_data_ptr, nullptr);
@@ -122,8 +124,12 @@ filter::dynamic_mask::dynamic_mask_factory::dynamic_mask_factory()
 
 filter::dynamic_mask::dynamic_mask_factory::~dynamic_mask_factory() {}
 
-filter::dynamic_mask::dynamic_mask_instance::dynamic_mask_instance(obs_data_t* data, obs_source_t* self) : _self(self)
+filter::dynamic_mask::dynamic_mask_instance::dynamic_mask_instance(obs_data_t* data, obs_source_t* self)
+	: _self(self), _have_filter_texture(false), _have_input_texture(false), _have_final_texture(false),
+	  _static_enabled(false)
 {
+	_profiler.register_procedures(_self);
+
 	this->update(data);
 
 	this->_filter_rt = std::make_shared<gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
@@ -133,8 +139,14 @@ filter::dynamic_mask::dynamic_mask_instance::dynamic_mask_instance(obs_data_t* d
 		char* file = obs_module_file("effects/channel-mask.effect");
 		try {
 			this->_effect = gs::effect::create(file);
+			this->_parameters.input_a.bind(*this->_effect, "pMaskInputA");
+			this->_parameters.input_b.bind(*this->_effect, "pMaskInputB");
+			this->_parameters.base.bind(*this->_effect, "pMaskBase");
+			this->_parameters.matrix.bind(*this->_effect, "pMaskMatrix");
+			this->_parameters.multiplier.bind(*this->_effect, "pMaskMultiplier");
 		} catch (std::exception& ex) {
 			P_LOG_ERROR("Loading channel mask _effect failed with error(s):\n%s", ex.what());
+			this->_effect.reset();
 		}
 		assert(this->_effect != nullptr);
 		bfree(file);
@@ -242,6 +254,11 @@ void filter::dynamic_mask::dynamic_mask_instance::get_properties(obs_properties_
 			}
 		}
 	}
+
+	{
+		p = obs_properties_add_bool(properties, S_STATICINPUT, D_TRANSLATE(S_STATICINPUT));
+		obs_property_set_long_description(p, D_TRANSLATE(D_DESC(S_STATICINPUT)));
+	}
 }
 
 void filter::dynamic_mask::dynamic_mask_instance::update(obs_data_t* settings)
@@ -301,6 +318,8 @@ void filter::dynamic_mask::dynamic_mask_instance::update(obs_data_t* settings)
 			ch->ptr[static_cast<size_t>(kv2.first)] = found->second.values.ptr[static_cast<size_t>(kv2.first)];
 		}
 	}
+
+	this->_static_enabled = obs_data_get_bool(settings, S_STATICINPUT);
 }
 
 void filter::dynamic_mask::dynamic_mask_instance::load(obs_data_t* settings)
@@ -369,6 +388,21 @@ bool filter::dynamic_mask::dynamic_mask_instance::modified(void*, obs_properties
 
 void filter::dynamic_mask::dynamic_mask_instance::video_tick(float)
 {
+	auto profile = _profiler.track(util::profiler::stage::Tick);
+
+	// Show last frame's result again if neither the filtered source nor the input can have changed since.
+	bool reuse = false;
+	if (_static_enabled) {
+		reuse = _static_input.update(_self, _input ? _input->get() : nullptr) && _have_final_texture;
+	} else {
+		_static_input.reset();
+	}
+
+	if (reuse) {
+		_profiler.count_frame(true);
+		return;
+	}
+
 	_have_input_texture  = false;
 	_have_filter_texture = false;
 	_have_final_texture  = false;
@@ -376,6 +410,8 @@ void filter::dynamic_mask::dynamic_mask_instance::video_tick(float)
 
 void filter::dynamic_mask::dynamic_mask_instance::video_render(gs_effect_t* in_effect)
 {
+	auto profile = _profiler.track(util::profiler::stage::Render);
+
 	obs_source_t* parent = obs_filter_get_parent(this->_self);
 	obs_source_t* target = obs_filter_get_target(this->_self);
 	uint32_t      width  = obs_source_get_base_width(target);
@@ -451,15 +487,15 @@ void filter::dynamic_mask::dynamic_mask_instance::video_render(gs_effect_t* in_e
 				gs_stencil_op(GS_STENCIL_BOTH, GS_KEEP, GS_KEEP, GS_KEEP);
 				gs_ortho(0, (float)width, 0, (float)height, -1., 1.);
 
-				this->_effect->get_parameter("pMaskInputA")->set_texture(this->_filter_texture);
-				this->_effect->get_parameter("pMaskInputB")->set_texture(this->_input_texture);
+				this->_parameters.input_a.set(this->_filter_texture);
+				this->_parameters.input_b.set(this->_input_texture);
 
-				this->_effect->get_parameter("pMaskBase")->set_float4(this->_precalc.base);
-				this->_effect->get_parameter("pMaskMatrix")->set_matrix(this->_precalc.matrix);
-				this->_effect->get_parameter("pMaskMultiplier")->set_float4(this->_precalc.scale);
+				this->_parameters.base.set(this->_precalc.base);
+				this->_parameters.matrix.set(this->_precalc.matrix);
+				this->_parameters.multiplier.set(this->_precalc.scale);
 
 				while (gs_effect_loop(this->_effect->get_object(), "Mask")) {
-					gs_draw_sprite(0, 0, width, height);
+					gs::draw_sprite(0, 0, width, height);
 				}
 
 				gs_blend_state_pop();
@@ -467,6 +503,7 @@ void filter::dynamic_mask::dynamic_mask_instance::video_render(gs_effect_t* in_e
 
 			this->_final_texture      = this->_final_rt->get_texture();
 			this->_have_final_texture = true;
+			this->_profiler.count_frame(false);
 		}
 	} catch (...) {
 		obs_source_skip_video_filter(this->_self);
@@ -504,7 +541,7 @@ void filter::dynamic_mask::dynamic_mask_instance::video_render(gs_effect_t* in_e
 			gs_effect_set_texture(param, this->_final_texture->get_object());
 		}
 		while (gs_effect_loop(final_effect, "Draw")) {
-			gs_draw_sprite(0, 0, width, height);
+			gs::draw_sprite(0, 0, width, height);
 		}
 	}
 }
@@ -24,7 +24,9 @@
 #include "obs/gs/gs-effect.hpp"
 #include "obs/obs-source-tracker.hpp"
 #include "obs/obs-source.hpp"
+#include "obs/obs-static-input.hpp"
 #include "plugin.hpp"
+#include "util-profiler.hpp"
 
 // OBS
 #ifdef _MSC_VER
@@ -57,9 +59,19 @@ namespace filter {
 		class dynamic_mask_instance {
 			obs_source_t* _self;
 
+			// Profiling
+			util::profiler _profiler;
+
 			std::map<std::tuple<channel, channel, std::string>, std::string> _translation_map;
 
 			std::shared_ptr<gs::effect> _effect;
+			struct {
+				gs::texture_parameter input_a;
+				gs::texture_parameter input_b;
+				gs::float4_parameter  base;
+				gs::matrix_parameter  matrix;
+				gs::float4_parameter  multiplier;
+			} _parameters;
 
 			bool                              _have_filter_texture;
 			std::shared_ptr<gs::rendertarget> _filter_rt;
@@ -87,6 +99,9 @@ namespace filter {
 				matrix4 matrix;
 			} _precalc;
 
+			bool              _static_enabled;
+			obs::static_input _static_input;
+
 			public:
 			dynamic_mask_instance(obs_data_t* data, obs_source_t* self);
 			~dynamic_mask_instance();
@@ -18,7 +18,12 @@
  */
 
 #include "filter-sdf-effects.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "gfx/sdf/gfx-sdf-edt.hpp"
 #include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-render-state.hpp"
 #include "strings.hpp"
 
 #define LOG_PREFIX "<filter-sdf-effects> "
@@ -63,6 +68,11 @@
 
 #define ST_SDF_SCALE "Filter.SDFEffects.SDF.Scale"
 #define ST_SDF_THRESHOLD "Filter.SDFEffects.SDF.Threshold"
+#define ST_SDF_INCREMENTAL "Filter.SDFEffects.SDF.Incremental"
+#define ST_SDF_BAKE "Filter.SDFEffects.SDF.Bake"
+#define ST_SDF_PRODUCER "Filter.SDFEffects.SDF.Producer"
+#define ST_SDF_PRODUCER_ITERATIVE "Filter.SDFEffects.SDF.Producer.Iterative"
+#define ST_SDF_PRODUCER_JUMPFLOODING "Filter.SDFEffects.SDF.Producer.JumpFlooding"
 
 // Initializer & Finalizer
 P_INITIALIZER(filterShadowFactoryInitializer)
@@ -117,6 +127,7 @@ void filter::sdf_effects::sdf_effects_factory::on_list_fill()
 
 	std::pair<const char*, std::shared_ptr<gs::effect>&> load_arr[] = {
 		{"effects/sdf/sdf-producer.effect", this->_sdf_producer_effect},
+		{"effects/sdf/sdf-jump-flooding.effect", this->_sdf_jump_flooding_effect},
 		{"effects/sdf/sdf-consumer.effect", this->_sdf_consumer_effect},
 	};
 	for (auto& kv : load_arr) {
@@ -133,11 +144,64 @@ void filter::sdf_effects::sdf_effects_factory::on_list_fill()
 		}
 		bfree(path);
 	}
+
+	// Effects that don't provide what the filter expects are not used at all.
+	if (this->_sdf_producer_effect) {
+		try {
+			this->_sdf_producer_parameters.image.bind(*this->_sdf_producer_effect, "_image");
+			this->_sdf_producer_parameters.size.bind(*this->_sdf_producer_effect, "_size");
+			this->_sdf_producer_parameters.sdf.bind(*this->_sdf_producer_effect, "_sdf");
+			this->_sdf_producer_parameters.threshold.bind(*this->_sdf_producer_effect, "_threshold");
+		} catch (std::exception& ex) {
+			P_LOG_ERROR(LOG_PREFIX "SDF producer effect is incompatible: %s", ex.what());
+			this->_sdf_producer_effect.reset();
+		}
+	}
+	if (this->_sdf_jump_flooding_effect) {
+		auto& effect = *this->_sdf_jump_flooding_effect;
+		auto& params = this->_sdf_jump_flooding_parameters;
+		try {
+			params.image.bind(effect, "_image");
+			params.size.bind(effect, "_size");
+			params.sdf.bind(effect, "_sdf");
+			params.threshold.bind(effect, "_threshold");
+			params.step.bind(effect, "_step");
+		} catch (std::exception& ex) {
+			P_LOG_ERROR(LOG_PREFIX "SDF jump flooding effect is incompatible: %s", ex.what());
+			this->_sdf_jump_flooding_effect.reset();
+		}
+	}
+	if (this->_sdf_consumer_effect) {
+		auto& effect = *this->_sdf_consumer_effect;
+		auto& params = this->_sdf_consumer_parameters;
+		try {
+			params.sdf.bind(effect, "pSDFTexture");
+			params.sdf_threshold.bind(effect, "pSDFThreshold");
+			params.image.bind(effect, "pImageTexture");
+			params.shadow_color.bind(effect, "pShadowColor");
+			params.shadow_min.bind(effect, "pShadowMin");
+			params.shadow_max.bind(effect, "pShadowMax");
+			params.shadow_offset.bind(effect, "pShadowOffset");
+			params.glow_color.bind(effect, "pGlowColor");
+			params.glow_width.bind(effect, "pGlowWidth");
+			params.glow_sharpness.bind(effect, "pGlowSharpness");
+			params.glow_sharpness_inverse.bind(effect, "pGlowSharpnessInverse");
+			params.outline_color.bind(effect, "pOutlineColor");
+			params.outline_width.bind(effect, "pOutlineWidth");
+			params.outline_offset.bind(effect, "pOutlineOffset");
+			params.outline_sharpness.bind(effect, "pOutlineSharpness");
+			params.outline_sharpness_inverse.bind(effect, "pOutlineSharpnessInverse");
+		} catch (std::exception& ex) {
+			P_LOG_ERROR(LOG_PREFIX "SDF consumer effect is incompatible: %s", ex.what());
+			this->_sdf_consumer_effect.reset();
+		}
+	}
 }
 
 void filter::sdf_effects::sdf_effects_factory::on_list_empty()
 {
 	this->_sdf_producer_effect.reset();
+	this->_sdf_jump_flooding_effect.reset();
 	this->_sdf_consumer_effect.reset();
 }
 
@@ -202,6 +266,11 @@ void filter::sdf_effects::sdf_effects_factory::get_defaults(obs_data_t* data)
 	obs_data_set_default_bool(data, S_ADVANCED, false);
 	obs_data_set_default_double(data, ST_SDF_SCALE, 100.0);
 	obs_data_set_default_double(data, ST_SDF_THRESHOLD, 50.0);
+	obs_data_set_default_bool(data, ST_SDF_INCREMENTAL, false);
+	obs_data_set_default_bool(data, ST_SDF_BAKE, false);
+	obs_data_set_default_int(data, ST_SDF_PRODUCER, producer_type::Iterative);
+
+	obs_data_set_default_bool(data, S_STATICINPUT, false);
 }
 
 obs_properties_t* filter::sdf_effects::sdf_effects_factory::get_properties(void* inptr)
@@ -254,11 +323,39 @@ std::shared_ptr<gs::effect> filter::sdf_effects::sdf_effects_factory::get_sdf_pr
 	return this->_sdf_producer_effect;
 }
 
+std::shared_ptr<gs::effect> filter::sdf_effects::sdf_effects_factory::get_sdf_jump_flooding_effect()
+{
+	return this->_sdf_jump_flooding_effect;
+}
+
 std::shared_ptr<gs::effect> filter::sdf_effects::sdf_effects_factory::get_sdf_consumer_effect()
 {
 	return this->_sdf_consumer_effect;
 }
 
+filter::sdf_effects::sdf_effects_factory::producer_parameters&
+	filter::sdf_effects::sdf_effects_factory::get_sdf_producer_parameters()
+{
+	return this->_sdf_producer_parameters;
+}
+
+filter::sdf_effects::sdf_effects_factory::jump_flooding_parameters&
+	filter::sdf_effects::sdf_effects_factory::get_sdf_jump_flooding_parameters()
+{
+	return this->_sdf_jump_flooding_parameters;
+}
+
+filter::sdf_effects::sdf_effects_factory::consumer_parameters&
+	filter::sdf_effects::sdf_effects_factory::get_sdf_consumer_parameters()
+{
+	return this->_sdf_consumer_parameters;
+}
+
+util::worker& filter::sdf_effects::sdf_effects_factory::get_bake_worker()
+{
+	return this->_bake_worker;
+}
+
 bool filter::sdf_effects::sdf_effects_instance::cb_modified_shadow_inside(void*, obs_properties_t* props, obs_property*,
 																		  obs_data_t* settings)
 {
@@ -325,32 +422,41 @@ bool filter::sdf_effects::sdf_effects_instance::cb_modified_advanced(void*, obs_
 	bool show_advanced = obs_data_get_bool(settings, S_ADVANCED);
 	obs_property_set_visible(obs_properties_get(props, ST_SDF_SCALE), show_advanced);
 	obs_property_set_visible(obs_properties_get(props, ST_SDF_THRESHOLD), show_advanced);
+	obs_property_set_visible(obs_properties_get(props, ST_SDF_PRODUCER), show_advanced);
+	obs_property_set_visible(obs_properties_get(props, ST_SDF_INCREMENTAL), show_advanced);
+	obs_property_set_visible(obs_properties_get(props, ST_SDF_BAKE), show_advanced);
 	return true;
 }
 
 filter::sdf_effects::sdf_effects_instance::sdf_effects_instance(obs_data_t* settings, obs_source_t* self)
-	: _self(self), _source_rendered(false), _sdf_scale(1.0)
+	: _self(self), _pool(gs::rendertarget_pool::get()), _source_rendered(false), _sdf_scale(1.0),
+	  _sdf_producer(producer_type::Iterative), _sdf_incremental(false), _sdf_range(0), _sdf_mask_stage(),
+	  _sdf_mask_staged(), _sdf_mask_index(0), _sdf_bake_enabled(false), _sdf_bake_stage(nullptr),
+	  _sdf_complete(false), _output_rendered(false), _static_enabled(false)
 {
+	_profiler.register_procedures(_self);
+
 	{
 		auto gctx        = gs::context();
 		vec4 transparent = {0};
 
-		this->_source_rt = std::make_shared<gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-		this->_sdf_write = std::make_shared<gs::rendertarget>(GS_RGBA32F, GS_ZS_NONE);
-		this->_sdf_read  = std::make_shared<gs::rendertarget>(GS_RGBA32F, GS_ZS_NONE);
-		this->_output_rt = std::make_shared<gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-
-		std::shared_ptr<gs::rendertarget> initialize_rts[] = {this->_source_rt, this->_sdf_write, this->_sdf_read,
-															  this->_output_rt};
-		for (auto rt : initialize_rts) {
-			auto op = rt->render(1, 1);
+		// The first refinement starts from an empty field.
+		this->_sdf_read = _pool->acquire(1, 1, GS_RGBA32F);
+		{
+			auto op = this->_sdf_read->render(1, 1);
 			gs_clear(GS_CLEAR_COLOR | GS_CLEAR_DEPTH, &transparent, 0, 0);
 		}
 	}
 	update(settings);
 }
 
-filter::sdf_effects::sdf_effects_instance::~sdf_effects_instance() {}
+filter::sdf_effects::sdf_effects_instance::~sdf_effects_instance()
+{
+	auto gctx = gs::context();
+	release_sdf_mask();
+	release_sdf_bake();
+	cancel_sdf_bake();
+}
 
 obs_properties_t* filter::sdf_effects::sdf_effects_instance::get_properties()
 {
@@ -473,6 +579,23 @@ obs_properties_t* filter::sdf_effects::sdf_effects_instance::get_properties()
 
 		p = obs_properties_add_float_slider(props, ST_SDF_THRESHOLD, D_TRANSLATE(ST_SDF_THRESHOLD), 0.0, 100.0, 0.01);
 		obs_property_set_long_description(p, D_TRANSLATE(D_DESC(ST_SDF_THRESHOLD)));
+
+		p = obs_properties_add_list(props, ST_SDF_PRODUCER, D_TRANSLATE(ST_SDF_PRODUCER), OBS_COMBO_TYPE_LIST,
+									OBS_COMBO_FORMAT_INT);
+		obs_property_set_long_description(p, D_TRANSLATE(D_DESC(ST_SDF_PRODUCER)));
+		obs_property_list_add_int(p, D_TRANSLATE(ST_SDF_PRODUCER_ITERATIVE), producer_type::Iterative);
+		obs_property_list_add_int(p, D_TRANSLATE(ST_SDF_PRODUCER_JUMPFLOODING), producer_type::JumpFlooding);
+
+		p = obs_properties_add_bool(props, ST_SDF_INCREMENTAL, D_TRANSLATE(ST_SDF_INCREMENTAL));
+		obs_property_set_long_description(p, D_TRANSLATE(D_DESC(ST_SDF_INCREMENTAL)));
+
+		p = obs_properties_add_bool(props, ST_SDF_BAKE, D_TRANSLATE(ST_SDF_BAKE));
+		obs_property_set_long_description(p, D_TRANSLATE(D_DESC(ST_SDF_BAKE)));
+	}
+
+	{
+		p = obs_properties_add_bool(props, S_STATICINPUT, D_TRANSLATE(S_STATICINPUT));
+		obs_property_set_long_description(p, D_TRANSLATE(D_DESC(S_STATICINPUT)));
 	}
 
 	return props;
@@ -606,8 +729,341 @@ void filter::sdf_effects::sdf_effects_instance::update(obs_data_t* data)
 		}
 	}
 
-	this->_sdf_scale     = double_t(obs_data_get_double(data, ST_SDF_SCALE) / 100.0);
-	this->_sdf_threshold = float_t(obs_data_get_double(data, ST_SDF_THRESHOLD) / 100.0);
+	this->_sdf_scale        = double_t(obs_data_get_double(data, ST_SDF_SCALE) / 100.0);
+	this->_sdf_threshold    = float_t(obs_data_get_double(data, ST_SDF_THRESHOLD) / 100.0);
+	this->_sdf_producer     = static_cast<producer_type>(obs_data_get_int(data, ST_SDF_PRODUCER));
+	this->_sdf_incremental  = obs_data_get_bool(data, ST_SDF_INCREMENTAL);
+	this->_sdf_bake_enabled = obs_data_get_bool(data, ST_SDF_BAKE);
+
+	this->_static_enabled = obs_data_get_bool(data, S_STATICINPUT);
+
+	// Largest distance (in SDF texels) any enabled effect reads, anything further out may stay stale.
+	{
+		float_t range = 0;
+		if (this->_outer_shadow) {
+			range = std::max(
+				{range, std::fabs(this->_outer_shadow_range_min), std::fabs(this->_outer_shadow_range_max)});
+		}
+		if (this->_inner_shadow) {
+			range = std::max(
+				{range, std::fabs(this->_inner_shadow_range_min), std::fabs(this->_inner_shadow_range_max)});
+		}
+		if (this->_outer_glow) {
+			range = std::max(range, this->_outer_glow_width);
+		}
+		if (this->_inner_glow) {
+			range = std::max(range, this->_inner_glow_width);
+		}
+		if (this->_outline) {
+			range = std::max(range, std::fabs(this->_outline_offset) + this->_outline_width);
+		}
+		this->_sdf_range = uint32_t(std::ceil(range));
+	}
+}
+
+void filter::sdf_effects::sdf_effects_instance::render_iterative(uint32_t width, uint32_t height)
+{
+	vec4 color_transparent = {0};
+
+	std::shared_ptr<gs::effect> sdf_effect = filter::sdf_effects::sdf_effects_factory::get()->get_sdf_producer_effect();
+	if (!sdf_effect) {
+		throw std::runtime_error("SDF Effect no loaded");
+	}
+	auto& producer = filter::sdf_effects::sdf_effects_factory::get()->get_sdf_producer_parameters();
+
+	// Incremental refinement needs last frame's field at the same size, otherwise refine everything.
+	const std::vector<gfx::sdf::rect>* areas = nullptr;
+	if (this->_sdf_incremental) {
+		areas = &update_sdf_tiles(width, height);
+		if ((this->_sdf_texture->get_width() != width) || (this->_sdf_texture->get_height() != height)) {
+			areas = nullptr;
+		}
+	} else {
+		release_sdf_mask();
+	}
+
+	// A settled field is simply kept.
+	if (!areas || !areas->empty()) {
+		auto sdf_write = _pool->acquire(width, height, GS_RGBA32F);
+		{
+			auto op = sdf_write->render(width, height);
+			gs_ortho(0, float(width), 0, float(height), -1, 1);
+			if (areas) {
+				gs_copy_texture(sdf_write->get_object(), this->_sdf_texture->get_object());
+			} else {
+				gs_clear(GS_CLEAR_COLOR | GS_CLEAR_DEPTH, &color_transparent, 0, 0);
+			}
+
+			producer.image.set(this->_sdf_source);
+			producer.size.set(float_t(width), float_t(height));
+			producer.sdf.set(this->_sdf_texture);
+			producer.threshold.set(this->_sdf_threshold);
+
+			if (areas) {
+				// Restrict the pass to each area, the sprite itself still covers the whole field.
+				for (const gfx::sdf::rect& area : *areas) {
+					gs_set_viewport(int(area.x), int(area.y), int(area.width), int(area.height));
+					gs_ortho(float(area.x), float(area.x + area.width), float(area.y), float(area.y + area.height), -1,
+							 1);
+					while (gs_effect_loop(sdf_effect->get_object(), "Draw")) {
+						gs::draw_sprite(this->_sdf_texture->get_object(), 0, width, height);
+					}
+				}
+			} else {
+				while (gs_effect_loop(sdf_effect->get_object(), "Draw")) {
+					gs::draw_sprite(this->_sdf_texture->get_object(), 0, width, height);
+				}
+			}
+		}
+		this->_sdf_read = sdf_write;
+		this->_sdf_read->get_texture(this->_sdf_texture);
+		if (!this->_sdf_texture) {
+			throw std::runtime_error("SDF Backbuffer empty");
+		}
+	}
+}
+
+void filter::sdf_effects::sdf_effects_instance::render_jump_flooding(uint32_t width, uint32_t height)
+{
+	std::shared_ptr<gs::effect> effect =
+		filter::sdf_effects::sdf_effects_factory::get()->get_sdf_jump_flooding_effect();
+	if (!effect) {
+		throw std::runtime_error("SDF Jump Flooding Effect not loaded");
+	}
+	auto& params = filter::sdf_effects::sdf_effects_factory::get()->get_sdf_jump_flooding_parameters();
+
+	params.image.set(this->_sdf_source);
+	params.size.set(float_t(width), float_t(height));
+	params.threshold.set(this->_sdf_threshold);
+
+	// Seeds ping-pong between two pooled targets.
+	std::shared_ptr<gs::rendertarget> seeds = _pool->acquire(width, height, GS_RGBA32F);
+	std::shared_ptr<gs::texture>      seeds_texture;
+	{
+		auto op = seeds->render(width, height);
+		gs_ortho(0, float(width), 0, float(height), -1, 1);
+		while (gs_effect_loop(effect->get_object(), "Seed")) {
+			gs::draw_sprite(this->_sdf_source->get_object(), 0, width, height);
+		}
+	}
+
+	// Halve the step from the largest power of two below the size down to one, then add one more
+	//  pass with a step of one which fixes most of the errors jump flooding is known for.
+	std::vector<uint32_t> steps;
+	for (uint32_t step = 1; step < std::max(width, height); step *= 2) {
+		steps.insert(steps.begin(), step);
+	}
+	steps.push_back(1);
+
+	for (uint32_t step : steps) {
+		seeds->get_texture(seeds_texture);
+		auto flooded = _pool->acquire(width, height, GS_RGBA32F);
+		{
+			auto op = flooded->render(width, height);
+			gs_ortho(0, float(width), 0, float(height), -1, 1);
+			params.sdf.set(seeds_texture);
+			params.step.set(float_t(step));
+			while (gs_effect_loop(effect->get_object(), "Flood")) {
+				gs::draw_sprite(seeds_texture->get_object(), 0, width, height);
+			}
+		}
+		seeds = flooded;
+	}
+
+	seeds->get_texture(seeds_texture);
+	auto sdf_write = _pool->acquire(width, height, GS_RGBA32F);
+	{
+		auto op = sdf_write->render(width, height);
+		gs_ortho(0, float(width), 0, float(height), -1, 1);
+		params.sdf.set(seeds_texture);
+		while (gs_effect_loop(effect->get_object(), "Resolve")) {
+			gs::draw_sprite(seeds_texture->get_object(), 0, width, height);
+		}
+	}
+	this->_sdf_read = sdf_write;
+	this->_sdf_read->get_texture(this->_sdf_texture);
+	if (!this->_sdf_texture) {
+		throw std::runtime_error("SDF Backbuffer empty");
+	}
+}
+
+std::shared_ptr<gs::rendertarget> filter::sdf_effects::sdf_effects_instance::render_sdf_mask(uint32_t width,
+																							  uint32_t height)
+{
+	std::shared_ptr<gs::effect> sdf_effect = filter::sdf_effects::sdf_effects_factory::get()->get_sdf_producer_effect();
+	if (!sdf_effect) {
+		throw std::runtime_error("SDF Effect no loaded");
+	}
+	auto& producer = filter::sdf_effects::sdf_effects_factory::get()->get_sdf_producer_parameters();
+
+	auto mask_rt = _pool->acquire(width, height, GS_R8);
+	{
+		auto op = mask_rt->render(width, height);
+		gs_ortho(0, float(width), 0, float(height), -1, 1);
+
+		producer.image.set(this->_sdf_source);
+		producer.threshold.set(this->_sdf_threshold);
+		while (gs_effect_loop(sdf_effect->get_object(), "Mask")) {
+			gs::draw_sprite(this->_sdf_source->get_object(), 0, width, height);
+		}
+	}
+	return mask_rt;
+}
+
+const std::vector<gfx::sdf::rect>& filter::sdf_effects::sdf_effects_instance::update_sdf_tiles(uint32_t width,
+																								 uint32_t height)
+{
+	if ((this->_sdf_tiles.get_width() != width) || (this->_sdf_tiles.get_height() != height)) {
+		release_sdf_mask();
+		this->_sdf_tiles.resize(width, height);
+	}
+	this->_sdf_tiles.set_range(this->_sdf_range);
+
+	// Compare against the mask staged last frame, which the GPU is done with by now.
+	size_t last = this->_sdf_mask_index ^ 1;
+	if (this->_sdf_mask_staged[last]) {
+		uint8_t* data     = nullptr;
+		uint32_t linesize = 0;
+		if (gs_stagesurface_map(this->_sdf_mask_stage[last], &data, &linesize)) {
+			this->_sdf_tiles.update(data, linesize);
+			gs_stagesurface_unmap(this->_sdf_mask_stage[last]);
+		}
+		this->_sdf_mask_staged[last] = false;
+	}
+
+	// Stage this frame's mask for the next frame.
+	auto             mask_rt = render_sdf_mask(width, height);
+	gs_stagesurf_t*& stage = this->_sdf_mask_stage[this->_sdf_mask_index];
+	if (!stage) {
+		stage = gs_stagesurface_create(width, height, GS_R8);
+	}
+	if (stage) {
+		gs_stage_texture(stage, mask_rt->get_object());
+		this->_sdf_mask_staged[this->_sdf_mask_index] = true;
+	}
+	this->_sdf_mask_index = last;
+
+	return this->_sdf_tiles.advance();
+}
+
+bool filter::sdf_effects::sdf_effects_instance::use_baked_sdf(uint32_t width, uint32_t height)
+{
+	if (this->_sdf_static_key.empty()) {
+		this->_sdf_baked.reset();
+		this->_sdf_baked_key.clear();
+		release_sdf_bake();
+		cancel_sdf_bake();
+		return false;
+	}
+
+	std::string key = this->_sdf_static_key + "|" + std::to_string(width) + "x" + std::to_string(height) + "|"
+					  + std::to_string(this->_sdf_threshold);
+
+	// Pick up a finished bake, unless the input changed in the meantime.
+	if (this->_sdf_bake && this->_sdf_bake->done.load(std::memory_order_acquire)) {
+		std::shared_ptr<baked_field> baked = std::move(this->_sdf_bake);
+		this->_sdf_bake_task.reset();
+		if (baked->key == key) {
+			const uint8_t* data = reinterpret_cast<const uint8_t*>(baked->field.data());
+			this->_sdf_baked    = std::make_shared<gs::texture>(baked->width, baked->height, GS_RGBA32F, 1, &data,
+			                                                    gs::texture::flags::None);
+			this->_sdf_baked_key = key;
+		}
+	}
+
+	if (this->_sdf_baked && (this->_sdf_baked_key == key)) {
+		release_sdf_bake();
+		this->_sdf_texture = this->_sdf_baked;
+		return true;
+	}
+	if (this->_sdf_bake) {
+		if (this->_sdf_bake->key == key) {
+			// Still baking, the regular generators fill in until then.
+			return false;
+		}
+		// Outdated, so stop it instead of holding up the bake of the new input.
+		cancel_sdf_bake();
+	}
+
+	// The mask staged last frame is read back now that the GPU is done with it, so mapping never stalls.
+	if (this->_sdf_bake_stage && (this->_sdf_bake_stage_key == key)) {
+		std::vector<uint8_t> mask(size_t(width) * height);
+		uint8_t*             data     = nullptr;
+		uint32_t             linesize = 0;
+		bool                 mapped   = gs_stagesurface_map(this->_sdf_bake_stage, &data, &linesize);
+		if (mapped) {
+			for (uint32_t y = 0; y < height; y++) {
+				std::memcpy(&mask[size_t(y) * width], data + size_t(linesize) * y, width);
+			}
+			gs_stagesurface_unmap(this->_sdf_bake_stage);
+		}
+		release_sdf_bake();
+		if (!mapped) {
+			return false;
+		}
+
+		// The task only shares the result with this instance, so destroying the filter just cancels it.
+		auto baked    = std::make_shared<baked_field>();
+		baked->key    = key;
+		baked->width  = width;
+		baked->height = height;
+		baked->done.store(false, std::memory_order_relaxed);
+		this->_sdf_bake      = baked;
+		this->_sdf_bake_task = filter::sdf_effects::sdf_effects_factory::get()->get_bake_worker().push(
+			[baked, mask{std::move(mask)}](util::worker::task& task) {
+				baked->field.resize(size_t(baked->width) * baked->height * 4);
+				if (gfx::sdf::edt(baked->width, baked->height)
+						.bake(mask.data(), baked->width, baked->field.data(), &task.get_cancelled())) {
+					baked->done.store(true, std::memory_order_release);
+				}
+			});
+		return false;
+	}
+
+	// Stage this frame's mask, to be read back and baked next frame.
+	if (this->_sdf_bake_stage
+		&& ((gs_stagesurface_get_width(this->_sdf_bake_stage) != width)
+			|| (gs_stagesurface_get_height(this->_sdf_bake_stage) != height))) {
+		release_sdf_bake();
+	}
+	if (!this->_sdf_bake_stage) {
+		this->_sdf_bake_stage = gs_stagesurface_create(width, height, GS_R8);
+	}
+	if (this->_sdf_bake_stage) {
+		auto mask_rt = render_sdf_mask(width, height);
+		gs_stage_texture(this->_sdf_bake_stage, mask_rt->get_object());
+		this->_sdf_bake_stage_key = key;
+	}
+	return false;
+}
+
+void filter::sdf_effects::sdf_effects_instance::release_sdf_bake()
+{
+	if (this->_sdf_bake_stage) {
+		gs_stagesurface_destroy(this->_sdf_bake_stage);
+		this->_sdf_bake_stage = nullptr;
+	}
+	this->_sdf_bake_stage_key.clear();
+}
+
+void filter::sdf_effects::sdf_effects_instance::cancel_sdf_bake()
+{
+	if (this->_sdf_bake_task) {
+		this->_sdf_bake_task->cancel();
+		this->_sdf_bake_task.reset();
+	}
+	this->_sdf_bake.reset();
+}
+
+void filter::sdf_effects::sdf_effects_instance::release_sdf_mask()
+{
+	for (size_t idx = 0; idx < 2; idx++) {
+		if (this->_sdf_mask_stage[idx]) {
+			gs_stagesurface_destroy(this->_sdf_mask_stage[idx]);
+			this->_sdf_mask_stage[idx] = nullptr;
+		}
+		this->_sdf_mask_staged[idx] = false;
+	}
 }
 
 uint32_t filter::sdf_effects::sdf_effects_instance::get_width()
@@ -626,6 +1082,16 @@ void filter::sdf_effects::sdf_effects_instance::deactivate() {}
 
 void filter::sdf_effects::sdf_effects_instance::video_tick(float)
 {
+	auto profile = _profiler.track(util::profiler::stage::Tick);
+
+	// Static inputs may get their field baked, whether or not the whole output may be reused.
+	bool     unchanged = this->_static_input.update(this->_self);
+	uint64_t input_key = this->_static_input.get_input_key();
+	this->_sdf_static_key.clear();
+	if (this->_sdf_bake_enabled && (input_key != 0)) {
+		this->_sdf_static_key = std::to_string(input_key);
+	}
+
 	uint32_t width  = 1;
 	uint32_t height = 1;
 
@@ -641,12 +1107,24 @@ void filter::sdf_effects::sdf_effects_instance::video_tick(float)
 		height = obs_source_get_height(target);
 	} while (false);
 
+	// Show last frame's result again if the input can't have changed since. A field that is still being
+	//  refined over multiple frames is not done yet, so that output can't be reused.
+	if (this->_static_enabled && unchanged && this->_output_rendered && this->_sdf_complete) {
+		this->_profiler.count_frame(true);
+		return;
+	}
+
+	// Return last frame's result to the pool, instances that are not rendered this frame don't need it.
+	this->_output_texture.reset();
+	this->_output_rt.reset();
 	this->_source_rendered = false;
 	this->_output_rendered = false;
 }
 
 void filter::sdf_effects::sdf_effects_instance::video_render(gs_effect_t* effect)
 {
+	auto profile = _profiler.track(util::profiler::stage::Render);
+
 	obs_source_t* parent         = obs_filter_get_parent(this->_self);
 	obs_source_t* target         = obs_filter_get_target(this->_self);
 	uint32_t      baseW          = obs_source_get_base_width(target);
@@ -680,6 +1158,7 @@ void filter::sdf_effects::sdf_effects_instance::video_render(gs_effect_t* effect
 
 		if (!this->_source_rendered) {
 			// Store input texture.
+			this->_source_rt = _pool->acquire(baseW, baseH, GS_RGBA);
 			{
 				auto op = _source_rt->render(baseW, baseH);
 				gs_ortho(0, (float)baseW, 0, (float)baseH, -1, 1);
@@ -696,19 +1175,15 @@ void filter::sdf_effects::sdf_effects_instance::video_render(gs_effect_t* effect
 				throw std::runtime_error("failed to draw source");
 			}
 
-			// Generate SDF Buffers
+			// Generate SDF Buffers, the source may have changed any state while it was rendered.
 			{
+				auto state = ::gs::render_state::opaque().apply();
+
 				this->_sdf_read->get_texture(this->_sdf_texture);
 				if (!this->_sdf_texture) {
 					throw std::runtime_error("SDF Backbuffer empty");
 				}
 
-				std::shared_ptr<gs::effect> sdf_effect =
-					filter::sdf_effects::sdf_effects_factory::get()->get_sdf_producer_effect();
-				if (!sdf_effect) {
-					throw std::runtime_error("SDF Effect no loaded");
-				}
-
 				// Scale SDF Size
 				double_t sdfW, sdfH;
 				sdfW = baseW * _sdf_scale;
@@ -720,25 +1195,25 @@ void filter::sdf_effects::sdf_effects_instance::video_render(gs_effect_t* effect
 					sdfH = 1.0;
 				}
 
-				{
-					auto op = this->_sdf_write->render(uint32_t(sdfW), uint32_t(sdfH));
-					gs_ortho(0, (float)sdfW, 0, (float)sdfH, -1, 1);
-					gs_clear(GS_CLEAR_COLOR | GS_CLEAR_DEPTH, &color_transparent, 0, 0);
+				uint32_t sdf_width  = uint32_t(sdfW);
+				uint32_t sdf_height = uint32_t(sdfH);
 
-					sdf_effect->get_parameter("_image")->set_texture(this->_source_texture);
-					sdf_effect->get_parameter("_size")->set_float2(float_t(sdfW), float_t(sdfH));
-					sdf_effect->get_parameter("_sdf")->set_texture(this->_sdf_texture);
-					sdf_effect->get_parameter("_threshold")->set_float(this->_sdf_threshold);
+				// Generators read the input at the size of the field, averaged down instead of point sampled.
+				this->_sdf_source = this->_sdf_downsampler.render(this->_source_texture, sdf_width, sdf_height);
 
-					while (gs_effect_loop(sdf_effect->get_object(), "Draw")) {
-						gs_draw_sprite(this->_sdf_texture->get_object(), 0, uint32_t(sdfW), uint32_t(sdfH));
-					}
-				}
-				std::swap(this->_sdf_read, this->_sdf_write);
-				this->_sdf_read->get_texture(this->_sdf_texture);
-				if (!this->_sdf_texture) {
-					throw std::runtime_error("SDF Backbuffer empty");
+				if (use_baked_sdf(sdf_width, sdf_height)) {
+					// Nothing to generate, the input is static.
+					this->_sdf_complete = true;
+				} else if (this->_sdf_producer == producer_type::JumpFlooding) {
+					// Complete every frame, there is nothing to refine incrementally.
+					release_sdf_mask();
+					render_jump_flooding(sdf_width, sdf_height);
+					this->_sdf_complete = true;
+				} else {
+					render_iterative(sdf_width, sdf_height);
+					this->_sdf_complete = false;
 				}
+				this->_sdf_source.reset();
 			}
 
 			this->_source_rendered = true;
@@ -760,12 +1235,12 @@ void filter::sdf_effects::sdf_effects_instance::video_render(gs_effect_t* effect
 			obs_source_skip_video_filter(this->_self);
 			return;
 		}
+		auto& consumer = filter::sdf_effects::sdf_effects_factory::get()->get_sdf_consumer_parameters();
 
-		gs_blend_state_push();
-		gs_reset_blend_state();
-		gs_enable_color(true, true, true, true);
-		gs_enable_depth_test(false);
-		gs_set_cull_mode(GS_NEITHER);
+		// Each effect is blended over the previous ones, the input is copied below them.
+		static const ::gs::render_state blend_over = ::gs::render_state::opaque().with_blending(
+			GS_BLEND_SRCALPHA, GS_BLEND_INVSRCALPHA, GS_BLEND_ONE, GS_BLEND_ONE);
+		auto state = ::gs::render_state::opaque().apply();
 
 		// SDF Effects Stack:
 		//   Normal Source
@@ -777,93 +1252,95 @@ void filter::sdf_effects::sdf_effects_instance::video_render(gs_effect_t* effect
 
 		// Optimized Render path.
 		try {
-			auto op = this->_output_rt->render(baseW, baseH);
+			this->_output_rt = _pool->acquire(baseW, baseH, GS_RGBA);
+			auto op          = this->_output_rt->render(baseW, baseH);
 			gs_ortho(0, 1, 0, 1, 0, 1);
 
-			gs_enable_blending(false);
-			gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
 			auto param = gs_effect_get_param_by_name(default_effect, "image");
 			if (param) {
 				gs_effect_set_texture(param, this->_output_texture->get_object());
 			}
 			while (gs_effect_loop(default_effect, "Draw")) {
-				gs_draw_sprite(0, 0, 1, 1);
+				gs::draw_sprite(0, 0, 1, 1);
 			}
 
-			gs_enable_blending(true);
-			gs_blend_function_separate(GS_BLEND_SRCALPHA, GS_BLEND_INVSRCALPHA, GS_BLEND_ONE, GS_BLEND_ONE);
+			auto blend_state = blend_over.apply();
 			if (this->_outer_shadow) {
-				consumer_effect->get_parameter("pSDFTexture")->set_texture(this->_sdf_texture);
-				consumer_effect->get_parameter("pSDFThreshold")->set_float(this->_sdf_threshold);
-				consumer_effect->get_parameter("pImageTexture")->set_texture(this->_source_texture->get_object());
-				consumer_effect->get_parameter("pShadowColor")->set_float4(this->_outer_shadow_color);
-				consumer_effect->get_parameter("pShadowMin")->set_float(this->_outer_shadow_range_min);
-				consumer_effect->get_parameter("pShadowMax")->set_float(this->_outer_shadow_range_max);
-				consumer_effect->get_parameter("pShadowOffset")
-					->set_float2(this->_outer_shadow_offset_x / float_t(baseW),
-								this->_outer_shadow_offset_y / float_t(baseH));
+				consumer.sdf.set(this->_sdf_texture);
+				consumer.sdf_threshold.set(this->_sdf_threshold);
+				consumer.image.set(this->_source_texture->get_object());
+				consumer.shadow_color.set(this->_outer_shadow_color);
+				consumer.shadow_min.set(this->_outer_shadow_range_min);
+				consumer.shadow_max.set(this->_outer_shadow_range_max);
+				consumer.shadow_offset.set(this->_outer_shadow_offset_x / float_t(baseW),
+										   this->_outer_shadow_offset_y / float_t(baseH));
 				while (gs_effect_loop(consumer_effect->get_object(), "ShadowOuter")) {
-					gs_draw_sprite(0, 0, 1, 1);
+					gs::draw_sprite(0, 0, 1, 1);
 				}
 			}
 			if (this->_inner_shadow) {
-				consumer_effect->get_parameter("pSDFTexture")->set_texture(this->_sdf_texture);
-				consumer_effect->get_parameter("pSDFThreshold")->set_float(this->_sdf_threshold);
-				consumer_effect->get_parameter("pImageTexture")->set_texture(this->_source_texture->get_object());
-				consumer_effect->get_parameter("pShadowColor")->set_float4(this->_inner_shadow_color);
-				consumer_effect->get_parameter("pShadowMin")->set_float(this->_inner_shadow_range_min);
-				consumer_effect->get_parameter("pShadowMax")->set_float(this->_inner_shadow_range_max);
-				consumer_effect->get_parameter("pShadowOffset")
-					->set_float2(this->_inner_shadow_offset_x / float_t(baseW),
-								this->_inner_shadow_offset_y / float_t(baseH));
+				consumer.sdf.set(this->_sdf_texture);
+				consumer.sdf_threshold.set(this->_sdf_threshold);
+				consumer.image.set(this->_source_texture->get_object());
+				consumer.shadow_color.set(this->_inner_shadow_color);
+				consumer.shadow_min.set(this->_inner_shadow_range_min);
+				consumer.shadow_max.set(this->_inner_shadow_range_max);
+				consumer.shadow_offset.set(this->_inner_shadow_offset_x / float_t(baseW),
+										   this->_inner_shadow_offset_y / float_t(baseH));
 				while (gs_effect_loop(consumer_effect->get_object(), "ShadowInner")) {
-					gs_draw_sprite(0, 0, 1, 1);
+					gs::draw_sprite(0, 0, 1, 1);
 				}
 			}
 			if (this->_outer_glow) {
-				consumer_effect->get_parameter("pSDFTexture")->set_texture(this->_sdf_texture);
-				consumer_effect->get_parameter("pSDFThreshold")->set_float(this->_sdf_threshold);
-				consumer_effect->get_parameter("pImageTexture")->set_texture(this->_source_texture->get_object());
-				consumer_effect->get_parameter("pGlowColor")->set_float4(this->_outer_glow_color);
-				consumer_effect->get_parameter("pGlowWidth")->set_float(this->_outer_glow_width);
-				consumer_effect->get_parameter("pGlowSharpness")->set_float(this->_outer_glow_sharpness);
-				consumer_effect->get_parameter("pGlowSharpnessInverse")->set_float(this->_outer_glow_sharpness_inv);
+				consumer.sdf.set(this->_sdf_texture);
+				consumer.sdf_threshold.set(this->_sdf_threshold);
+				consumer.image.set(this->_source_texture->get_object());
+				consumer.glow_color.set(this->_outer_glow_color);
+				consumer.glow_width.set(this->_outer_glow_width);
+				consumer.glow_sharpness.set(this->_outer_glow_sharpness);
+				consumer.glow_sharpness_inverse.set(this->_outer_glow_sharpness_inv);
 				while (gs_effect_loop(consumer_effect->get_object(), "GlowOuter")) {
-					gs_draw_sprite(0, 0, 1, 1);
+					gs::draw_sprite(0, 0, 1, 1);
 				}
 			}
 			if (this->_inner_glow) {
-				consumer_effect->get_parameter("pSDFTexture")->set_texture(this->_sdf_texture);
-				consumer_effect->get_parameter("pSDFThreshold")->set_float(this->_sdf_threshold);
-				consumer_effect->get_parameter("pImageTexture")->set_texture(this->_source_texture->get_object());
-				consumer_effect->get_parameter("pGlowColor")->set_float4(this->_inner_glow_color);
-				consumer_effect->get_parameter("pGlowWidth")->set_float(this->_inner_glow_width);
-				consumer_effect->get_parameter("pGlowSharpness")->set_float(this->_inner_glow_sharpness);
-				consumer_effect->get_parameter("pGlowSharpnessInverse")->set_float(this->_inner_glow_sharpness_inv);
+				consumer.sdf.set(this->_sdf_texture);
+				consumer.sdf_threshold.set(this->_sdf_threshold);
+				consumer.image.set(this->_source_texture->get_object());
+				consumer.glow_color.set(this->_inner_glow_color);
+				consumer.glow_width.set(this->_inner_glow_width);
+				consumer.glow_sharpness.set(this->_inner_glow_sharpness);
+				consumer.glow_sharpness_inverse.set(this->_inner_glow_sharpness_inv);
 				while (gs_effect_loop(consumer_effect->get_object(), "GlowInner")) {
-					gs_draw_sprite(0, 0, 1, 1);
+					gs::draw_sprite(0, 0, 1, 1);
 				}
 			}
 			if (this->_outline) {
-				consumer_effect->get_parameter("pSDFTexture")->set_texture(this->_sdf_texture);
-				consumer_effect->get_parameter("pSDFThreshold")->set_float(this->_sdf_threshold);
-				consumer_effect->get_parameter("pImageTexture")->set_texture(this->_source_texture->get_object());
-				consumer_effect->get_parameter("pOutlineColor")->set_float4(this->_outline_color);
-				consumer_effect->get_parameter("pOutlineWidth")->set_float(this->_outline_width);
-				consumer_effect->get_parameter("pOutlineOffset")->set_float(this->_outline_offset);
-				consumer_effect->get_parameter("pOutlineSharpness")->set_float(this->_outline_sharpness);
-				consumer_effect->get_parameter("pOutlineSharpnessInverse")->set_float(this->_outline_sharpness_inv);
+				consumer.sdf.set(this->_sdf_texture);
+				consumer.sdf_threshold.set(this->_sdf_threshold);
+				consumer.image.set(this->_source_texture->get_object());
+				consumer.outline_color.set(this->_outline_color);
+				consumer.outline_width.set(this->_outline_width);
+				consumer.outline_offset.set(this->_outline_offset);
+				consumer.outline_sharpness.set(this->_outline_sharpness);
+				consumer.outline_sharpness_inverse.set(this->_outline_sharpness_inv);
 				while (gs_effect_loop(consumer_effect->get_object(), "Outline")) {
-					gs_draw_sprite(0, 0, 1, 1);
+					gs::draw_sprite(0, 0, 1, 1);
 				}
 			}
 		} catch (...) {
 		}
 
-		this->_output_rt->get_texture(this->_output_texture);
+		if (this->_output_rt) {
+			this->_output_rt->get_texture(this->_output_texture);
+
+			// Only the result is needed for the rest of the frame.
+			this->_source_texture.reset();
+			this->_source_rt.reset();
+		}
 
-		gs_blend_state_pop();
 		this->_output_rendered = true;
+		this->_profiler.count_frame(false);
 	}
 
 	if (!this->_output_texture) {
@@ -876,6 +1353,6 @@ void filter::sdf_effects::sdf_effects_instance::video_render(gs_effect_t* effect
 		gs_effect_set_texture(ep, this->_output_texture->get_object());
 	}
 	while (gs_effect_loop(final_effect, "Draw")) {
-		gs_draw_sprite(0, 0, baseW, baseH);
+		gs::draw_sprite(0, 0, baseW, baseH);
 	}
 }
@@ -18,13 +18,22 @@
  */
 
 #pragma once
+#include <atomic>
 #include <memory>
+#include <string>
+#include <vector>
+#include "gfx/gfx-downsampler.hpp"
+#include "gfx/sdf/gfx-sdf-tiles.hpp"
 #include "obs/gs/gs-effect.hpp"
+#include "obs/gs/gs-rendertarget-pool.hpp"
 #include "obs/gs/gs-rendertarget.hpp"
 #include "obs/gs/gs-sampler.hpp"
 #include "obs/gs/gs-texture.hpp"
 #include "obs/gs/gs-vertexbuffer.hpp"
+#include "obs/obs-static-input.hpp"
 #include "plugin.hpp"
+#include "util-profiler.hpp"
+#include "util-worker.hpp"
 
 // OBS
 #ifdef _MSC_VER
@@ -40,13 +49,61 @@ namespace filter {
 	namespace sdf_effects {
 		class sdf_effects_instance;
 
+		enum producer_type : int64_t {
+			Iterative,
+			JumpFlooding,
+		};
+
 		class sdf_effects_factory {
+			public:
+			struct producer_parameters {
+				gs::texture_parameter image;
+				gs::float2_parameter  size;
+				gs::texture_parameter sdf;
+				gs::float_parameter   threshold;
+			};
+
+			struct jump_flooding_parameters {
+				gs::texture_parameter image;
+				gs::float2_parameter  size;
+				gs::texture_parameter sdf;
+				gs::float_parameter   threshold;
+				gs::float_parameter   step;
+			};
+
+			struct consumer_parameters {
+				gs::texture_parameter sdf;
+				gs::float_parameter   sdf_threshold;
+				gs::texture_parameter image;
+				gs::float4_parameter  shadow_color;
+				gs::float_parameter   shadow_min;
+				gs::float_parameter   shadow_max;
+				gs::float2_parameter  shadow_offset;
+				gs::float4_parameter  glow_color;
+				gs::float_parameter   glow_width;
+				gs::float_parameter   glow_sharpness;
+				gs::float_parameter   glow_sharpness_inverse;
+				gs::float4_parameter  outline_color;
+				gs::float_parameter   outline_width;
+				gs::float_parameter   outline_offset;
+				gs::float_parameter   outline_sharpness;
+				gs::float_parameter   outline_sharpness_inverse;
+			};
+
+			private:
 			obs_source_info _source_info;
 
 			std::list<sdf_effects_instance*> _sources;
 
 			std::shared_ptr<gs::effect> _sdf_producer_effect;
+			std::shared_ptr<gs::effect> _sdf_jump_flooding_effect;
 			std::shared_ptr<gs::effect> _sdf_consumer_effect;
+			producer_parameters         _sdf_producer_parameters;
+			jump_flooding_parameters    _sdf_jump_flooding_parameters;
+			consumer_parameters         _sdf_consumer_parameters;
+
+			// Bakes of all instances, joined together with the factory when the module unloads.
+			util::worker _bake_worker;
 
 			public: // Singleton
 			static void                                 initialize();
@@ -79,23 +136,62 @@ namespace filter {
 
 			public:
 			std::shared_ptr<gs::effect> get_sdf_producer_effect();
+			std::shared_ptr<gs::effect> get_sdf_jump_flooding_effect();
 			std::shared_ptr<gs::effect> get_sdf_consumer_effect();
+			producer_parameters&        get_sdf_producer_parameters();
+			jump_flooding_parameters&   get_sdf_jump_flooding_parameters();
+			consumer_parameters&        get_sdf_consumer_parameters();
+			util::worker&               get_bake_worker();
 		};
 
 		class sdf_effects_instance {
 			obs_source_t* _self;
 
+			// Profiling
+			util::profiler _profiler;
+
+			// Render targets are taken from the pool when needed and returned as soon as possible.
+			std::shared_ptr<gs::rendertarget_pool> _pool;
+
 			// Input
 			std::shared_ptr<gs::rendertarget> _source_rt;
 			std::shared_ptr<gs::texture>      _source_texture;
 			bool                              _source_rendered;
 
-			// Distance Field
-			std::shared_ptr<gs::rendertarget> _sdf_write;
+			// Distance Field, refined over multiple frames.
 			std::shared_ptr<gs::rendertarget> _sdf_read;
 			std::shared_ptr<gs::texture>      _sdf_texture;
 			double_t                          _sdf_scale;
 			float_t                           _sdf_threshold;
+			producer_type                     _sdf_producer;
+			gfx::downsampler                  _sdf_downsampler;
+			std::shared_ptr<gs::texture>      _sdf_source;
+
+			// Incremental refinement, only tiles whose thresholded input changed are refined again.
+			bool                   _sdf_incremental;
+			uint32_t               _sdf_range;
+			gfx::sdf::tile_tracker _sdf_tiles;
+			gs_stagesurf_t*        _sdf_mask_stage[2];
+			bool                   _sdf_mask_staged[2];
+			size_t                 _sdf_mask_index;
+
+			// Static inputs may get their field baked once on the CPU instead of generated every frame.
+			struct baked_field {
+				std::string          key;
+				uint32_t             width;
+				uint32_t             height;
+				std::vector<float_t> field;
+				std::atomic<bool>    done;
+			};
+			bool                                _sdf_bake_enabled;
+			std::string                         _sdf_static_key;
+			std::string                         _sdf_baked_key;
+			std::shared_ptr<gs::texture>        _sdf_baked;
+			std::shared_ptr<baked_field>        _sdf_bake;
+			std::shared_ptr<util::worker::task> _sdf_bake_task;
+			gs_stagesurf_t*                     _sdf_bake_stage;
+			std::string                         _sdf_bake_stage_key;
+			bool                                _sdf_complete;
 
 			// Effects
 			bool                              _output_rendered;
@@ -135,6 +231,10 @@ namespace filter {
 			float_t _outline_sharpness;
 			float_t _outline_sharpness_inv;
 
+			// Output Reuse
+			bool              _static_enabled;
+			obs::static_input _static_input;
+
 			static bool cb_modified_shadow_inside(void* ptr, obs_properties_t* props, obs_property* prop,
 												  obs_data_t* settings);
 
@@ -153,6 +253,22 @@ namespace filter {
 			static bool cb_modified_advanced(void* ptr, obs_properties_t* props, obs_property* prop,
 											 obs_data_t* settings);
 
+			std::shared_ptr<gs::rendertarget> render_sdf_mask(uint32_t width, uint32_t height);
+
+			const std::vector<gfx::sdf::rect>& update_sdf_tiles(uint32_t width, uint32_t height);
+
+			void release_sdf_mask();
+
+			void render_iterative(uint32_t width, uint32_t height);
+
+			void render_jump_flooding(uint32_t width, uint32_t height);
+
+			bool use_baked_sdf(uint32_t width, uint32_t height);
+
+			void release_sdf_bake();
+
+			void cancel_sdf_bake();
+
 			public:
 			sdf_effects_instance(obs_data_t* settings, obs_source_t* self);
 			~sdf_effects_instance();
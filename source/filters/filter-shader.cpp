@@ -18,6 +18,7 @@
  */
 
 #include "filter-shader.hpp"
+#include "obs/gs/gs-helper.hpp"
 #include "strings.hpp"
 #include "utility.hpp"
 
@@ -193,6 +194,8 @@ filter::shader::shader_factory::~shader_factory() {}
 filter::shader::shader_instance::shader_instance(obs_data_t* data, obs_source_t* self)
 	: _self(self), _active(true), _width(0), _height(0)
 {
+	_profiler.register_procedures(_self);
+
 	_fx = std::make_shared<gfx::effect_source::effect_source>(self);
 	_fx->set_valid_property_cb(std::bind(&filter::shader::shader_instance::valid_param, this, std::placeholders::_1));
 	_fx->set_override_cb(std::bind(&filter::shader::shader_instance::override_param, this, std::placeholders::_1));
@@ -253,9 +256,9 @@ bool filter::shader::shader_instance::valid_param(std::shared_ptr<gs::effect_par
 
 void filter::shader::shader_instance::override_param(std::shared_ptr<gs::effect> effect)
 {
-	auto p_source       = effect->get_parameter("ImageSource");
-	auto p_source_size  = effect->get_parameter("ImageSource_Size");
-	auto p_source_texel = effect->get_parameter("ImageSource_Texel");
+	auto p_source       = effect->find_parameter("ImageSource");
+	auto p_source_size  = effect->find_parameter("ImageSource_Size");
+	auto p_source_texel = effect->find_parameter("ImageSource_Texel");
 
 	if (p_source && (p_source->get_type() == gs::effect_parameter::type::Texture)) {
 		p_source->set_texture(_rt_tex);
@@ -275,6 +278,8 @@ void filter::shader::shader_instance::enum_active_sources(obs_source_enum_proc_t
 
 void filter::shader::shader_instance::video_tick(float_t sec_since_last)
 {
+	auto profile = _profiler.track(util::profiler::stage::Tick);
+
 	obs_source_t* target = obs_filter_get_target(_self);
 
 	{ // Update width and height.
@@ -294,6 +299,8 @@ void filter::shader::shader_instance::video_tick(float_t sec_since_last)
 
 void filter::shader::shader_instance::video_render(gs_effect_t* effect)
 {
+	auto profile = _profiler.track(util::profiler::stage::Render);
+
 	// Grab initial values.
 	obs_source_t* parent         = obs_filter_get_parent(_self);
 	obs_source_t* target         = obs_filter_get_target(_self);
@@ -343,6 +350,6 @@ void filter::shader::shader_instance::video_render(gs_effect_t* effect)
 		gs_effect_set_texture(prm, _rt2_tex->get_object());
 
 	while (gs_effect_loop(ef, "Draw")) {
-		gs_draw_sprite(nullptr, 0, _width, _height);
+		gs::draw_sprite(nullptr, 0, _width, _height);
 	}
 }
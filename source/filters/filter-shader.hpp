@@ -22,6 +22,7 @@
 #include "gfx/gfx-effect-source.hpp"
 #include "obs/gs/gs-rendertarget.hpp"
 #include "plugin.hpp"
+#include "util-profiler.hpp"
 
 extern "C" {
 #include <obs.h>
@@ -46,6 +47,9 @@ namespace filter {
 			obs_source_t* _self;
 			bool          _active;
 
+			// Profiling
+			util::profiler _profiler;
+
 			uint32_t _width, _height;
 
 			std::shared_ptr<gs::rendertarget> _rt;
@@ -18,6 +18,7 @@
  */
 
 #include "filter-transform.hpp"
+#include "obs/gs/gs-helper.hpp"
 #include "strings.hpp"
 #include "util-math.hpp"
 
@@ -332,9 +333,12 @@ filter::transform::transform_instance::transform_instance(obs_data_t* data, obs_
 	  _mipmap_generator(gs::mipmapper::generator::Linear), _update_mesh(false), _rotation_order(RotationOrder::ZXY),
 	  _camera_orthographic(true), _camera_fov(90.0)
 {
+	_profiler.register_procedures(_self);
+
 	_source_rendertarget = std::make_shared<gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
 	_shape_rendertarget  = std::make_shared<gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-	_vertex_buffer       = std::make_shared<gs::vertex_buffer>(uint32_t(4u), uint8_t(1u));
+	_vertex_buffer       = std::make_shared<gs::vertex_buffer>(uint32_t(4u), uint8_t(1u),
+															gs::vertex_buffer::attributes::None);
 
 	_position = std::make_unique<util::vec3a>();
 	_rotation = std::make_unique<util::vec3a>();
@@ -399,6 +403,8 @@ void filter::transform::transform_instance::deactivate()
 
 void filter::transform::transform_instance::video_tick(float)
 {
+	auto profile = _profiler.track(util::profiler::stage::Tick);
+
 	uint32_t width  = 0;
 	uint32_t height = 0;
 
@@ -477,29 +483,25 @@ void filter::transform::transform_instance::video_tick(float)
 
 		/// Generate mesh
 		{
-			auto vtx   = _vertex_buffer->at(0);
-			*vtx.color = 0xFFFFFFFF;
+			auto vtx = _vertex_buffer->at(0);
 			vec4_set(vtx.uv[0], 0, 0, 0, 0);
 			vec3_set(vtx.position, -p_x + _shear->x, -p_y - _shear->y, 0);
 			vec3_transform(vtx.position, vtx.position, &ident);
 		}
 		{
-			auto vtx   = _vertex_buffer->at(1);
-			*vtx.color = 0xFFFFFFFF;
+			auto vtx = _vertex_buffer->at(1);
 			vec4_set(vtx.uv[0], 1, 0, 0, 0);
 			vec3_set(vtx.position, p_x + _shear->x, -p_y + _shear->y, 0);
 			vec3_transform(vtx.position, vtx.position, &ident);
 		}
 		{
-			auto vtx   = _vertex_buffer->at(2);
-			*vtx.color = 0xFFFFFFFF;
+			auto vtx = _vertex_buffer->at(2);
 			vec4_set(vtx.uv[0], 0, 1, 0, 0);
 			vec3_set(vtx.position, -p_x - _shear->x, p_y - _shear->y, 0);
 			vec3_transform(vtx.position, vtx.position, &ident);
 		}
 		{
-			auto vtx   = _vertex_buffer->at(3);
-			*vtx.color = 0xFFFFFFFF;
+			auto vtx = _vertex_buffer->at(3);
 			vec4_set(vtx.uv[0], 1, 1, 0, 0);
 			vec3_set(vtx.position, p_x - _shear->x, p_y + _shear->y, 0);
 			vec3_transform(vtx.position, vtx.position, &ident);
@@ -514,6 +516,8 @@ void filter::transform::transform_instance::video_tick(float)
 
 void filter::transform::transform_instance::video_render(gs_effect_t* paramEffect)
 {
+	auto profile = _profiler.track(util::profiler::stage::Render);
+
 	if (!_active) {
 		obs_source_skip_video_filter(_self);
 		return;
@@ -642,7 +646,7 @@ void filter::transform::transform_instance::video_render(gs_effect_t* paramEffec
 			while (gs_effect_loop(default_effect, "Draw")) {
 				gs_effect_set_texture(gs_effect_get_param_by_name(default_effect, "image"),
 									  _mipmap_enabled ? _source_texture->get_object() : source_tex->get_object());
-				gs_draw(GS_TRISTRIP, 0, 4);
+				gs::draw(GS_TRISTRIP, 0, 4);
 			}
 			gs_load_vertexbuffer(nullptr);
 		} catch (...) {
@@ -659,6 +663,6 @@ void filter::transform::transform_instance::video_render(gs_effect_t* paramEffec
 	gs_enable_depth_test(false);
 	while (gs_effect_loop(default_effect, "Draw")) {
 		gs_effect_set_texture(gs_effect_get_param_by_name(default_effect, "image"), _shape_texture->get_object());
-		gs_draw_sprite(_shape_texture->get_object(), 0, 0, 0);
+		gs::draw_sprite(_shape_texture->get_object(), 0, 0, 0);
 	}
 }
@@ -25,6 +25,7 @@
 #include "obs/gs/gs-texture.hpp"
 #include "obs/gs/gs-vertexbuffer.hpp"
 #include "plugin.hpp"
+#include "util-profiler.hpp"
 
 namespace filter {
 	namespace transform {
@@ -62,6 +63,9 @@ namespace filter {
 			bool          _active;
 			obs_source_t* _self;
 
+			// Profiling
+			util::profiler _profiler;
+
 			// Input
 			std::shared_ptr<gs::rendertarget> _source_rendertarget;
 			std::shared_ptr<gs::texture>      _source_texture;
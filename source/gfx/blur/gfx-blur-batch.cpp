@@ -0,0 +1,267 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+
+#include "gfx-blur-batch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-render-state.hpp"
+#include "plugin.hpp"
+
+// OBS
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)
+#endif
+#include <graphics/matrix4.h>
+#include <obs-module.h>
+#include <obs.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+// Batching is meant for many small inputs, anything larger gains little and wastes atlas space.
+#define MAX_INPUT_SIZE 1024
+#define MAX_ATLAS_SIZE 4096
+// Widest guard band allowed, wider blurs would leave most of the atlas to guard bands.
+#define MAX_GUARD_SIZE 64
+
+gfx::blur::batch::batch(std::shared_ptr<::gfx::blur::base> blur)
+	: _blur(blur), _pool(::gs::rendertarget_pool::get()), _frame(0), _rendered(false), _rendering(false)
+{
+	auto gctx = gs::context();
+	{
+		char* file = obs_module_file("effects/blur/batch.effect");
+		_effect   = gs::effect::create(file);
+		bfree(file);
+	}
+
+	_image.bind(*_effect, "pImage");
+	_transform.bind(*_effect, "pTransform");
+}
+
+gfx::blur::batch::~batch()
+{
+	auto gctx = gs::context();
+	_members.clear();
+	_blur.reset();
+	_effect.reset();
+}
+
+std::shared_ptr<::gfx::blur::base> gfx::blur::batch::get_blur()
+{
+	return _blur;
+}
+
+void gfx::blur::batch::join(const void* member, capture_t capture)
+{
+	std::unique_lock<std::recursive_mutex> ul(_lock);
+
+	// Ticks and renders of a frame share the same frame time, the first join of a new one starts over.
+	uint64_t frame = obs_get_video_frame_time();
+	if (frame != _frame) {
+		_members.clear();
+		_frame    = frame;
+		_rendered = false;
+	}
+
+	auto& entry   = _members[member];
+	entry.capture = capture;
+	entry.input.reset();
+	entry.output.reset();
+}
+
+void gfx::blur::batch::leave(const void* member)
+{
+	std::unique_lock<std::recursive_mutex> ul(_lock);
+	_members.erase(member);
+}
+
+std::shared_ptr<::gs::rendertarget> gfx::blur::batch::render(const void* member)
+{
+	std::unique_lock<std::recursive_mutex> ul(_lock);
+
+	// Capturing a member may render another member, which then has to blur on its own.
+	if (_rendering || (_frame != obs_get_video_frame_time()))
+		return nullptr;
+
+	auto found = _members.find(member);
+	if (found == _members.end())
+		return nullptr;
+
+	if (!_rendered) {
+		_rendered  = true;
+		_rendering = true;
+		try {
+			process();
+		} catch (const std::exception& ex) {
+			P_LOG_ERROR("<gfx::blur::batch> Failed to render batch: %s", ex.what());
+			for (auto& kv : _members) {
+				kv.second.output.reset();
+			}
+		}
+		for (auto& kv : _members) {
+			kv.second.input.reset();
+		}
+		_rendering = false;
+	}
+
+	return found->second.output;
+}
+
+void gfx::blur::batch::process()
+{
+	if (_members.size() < 2)
+		return;
+
+	// The guard band must cover every texel the blur reads outside of a tile, plus one for linear taps.
+	double_t step_x, step_y;
+	_blur->get_step_scale(step_x, step_y);
+	double_t reach = std::ceil(_blur->get_size() * std::max(std::abs(step_x), std::abs(step_y)));
+	if (!(reach < MAX_GUARD_SIZE))
+		return;
+	uint32_t guard = uint32_t(reach) + 1;
+
+	std::vector<member*> tiles;
+	for (auto& kv : _members) {
+		kv.second.input = kv.second.capture();
+		if (kv.second.input && (kv.second.input->get_width() <= MAX_INPUT_SIZE)
+			&& (kv.second.input->get_height() <= MAX_INPUT_SIZE)) {
+			tiles.push_back(&kv.second);
+		}
+	}
+	if (tiles.size() < 2)
+		return;
+
+	// Pack into shelves, tallest first, on an atlas about as wide as it is high.
+	std::sort(tiles.begin(), tiles.end(),
+			  [](member* a, member* b) { return a->input->get_height() > b->input->get_height(); });
+	uint64_t area   = 0;
+	uint32_t widest = 0;
+	for (member* tile : tiles) {
+		uint32_t width  = tile->input->get_width() + guard * 2;
+		uint32_t height = tile->input->get_height() + guard * 2;
+		area += uint64_t(width) * height;
+		widest = std::max(widest, width);
+	}
+
+	// Many inputs would want a square atlas past the limit, any tiles that then do not fit are blurred alone.
+	uint32_t atlas_width =
+		std::min(std::max(widest, uint32_t(std::ceil(std::sqrt(double_t(area))))), uint32_t(MAX_ATLAS_SIZE));
+	uint32_t atlas_height = 0;
+	uint32_t x = 0, y = 0, row = 0;
+	for (auto iter = tiles.begin(); iter != tiles.end();) {
+		uint32_t width  = (*iter)->input->get_width() + guard * 2;
+		uint32_t height = (*iter)->input->get_height() + guard * 2;
+		if ((x + width) > atlas_width) {
+			x = 0;
+			y += row;
+			row = 0;
+		}
+		if ((y + height) > MAX_ATLAS_SIZE) {
+			// Left out, blurred on its own instead.
+			iter = tiles.erase(iter);
+			continue;
+		}
+
+		(*iter)->x   = x;
+		(*iter)->y   = y;
+		row          = std::max(row, height);
+		atlas_height = std::max(atlas_height, y + height);
+		x += width;
+		iter++;
+	}
+	if (tiles.size() < 2)
+		return;
+
+	// Taken from the pool up front, so that nothing is left half done if the pool runs out.
+	std::shared_ptr<::gs::rendertarget> atlas = _pool->acquire(atlas_width, atlas_height, GS_RGBA);
+	for (member* tile : tiles) {
+		tile->output = _pool->acquire(tile->input->get_width(), tile->input->get_height(), GS_RGBA);
+	}
+
+	auto state = ::gs::render_state::opaque().apply();
+
+	// Pack, each input drawn over its whole tile so that clamping fills the guard band with its edge.
+	{
+		auto op = atlas->render(atlas_width, atlas_height);
+		gs_ortho(0, float_t(atlas_width), 0, float_t(atlas_height), -1., 1.);
+
+		vec4 black;
+		vec4_zero(&black);
+		gs_clear(GS_CLEAR_COLOR, &black, 0, 0);
+
+		for (member* tile : tiles) {
+			float_t width  = float_t(tile->input->get_width());
+			float_t height = float_t(tile->input->get_height());
+			gs_matrix_push();
+			gs_matrix_translate3f(float_t(tile->x), float_t(tile->y), 0.);
+			_image.set(tile->input);
+			_transform.set((width + guard * 2) / width, (height + guard * 2) / height, -float_t(guard) / width,
+						   -float_t(guard) / height);
+			while (gs_effect_loop(_effect->get_object(), "Copy")) {
+				gs::draw_sprite(tile->input->get_object(), 0, tile->input->get_width() + guard * 2,
+								tile->input->get_height() + guard * 2);
+			}
+			gs_matrix_pop();
+		}
+	}
+
+	// Blur everything in a single set of passes.
+	_blur->set_input(atlas->get_texture());
+	std::shared_ptr<::gs::texture> blurred = _blur->render();
+
+	// Unpack, leaving the guard bands behind.
+	for (member* tile : tiles) {
+		uint32_t width  = tile->input->get_width();
+		uint32_t height = tile->input->get_height();
+
+		auto op = tile->output->render(width, height);
+		gs_ortho(0, float_t(width), 0, float_t(height), -1., 1.);
+		_image.set(blurred);
+		_transform.set(float_t(width) / atlas_width, float_t(height) / atlas_height,
+					   float_t(tile->x + guard) / atlas_width, float_t(tile->y + guard) / atlas_height);
+		while (gs_effect_loop(_effect->get_object(), "Copy")) {
+			gs::draw_sprite(blurred->get_object(), 0, width, height);
+		}
+	}
+}
+
+std::shared_ptr<::gfx::blur::batch>
+	gfx::blur::batch::get(std::string key, std::function<std::shared_ptr<::gfx::blur::base>()> create)
+{
+	static std::mutex                                               instances_lock;
+	static std::map<std::string, std::weak_ptr<::gfx::blur::batch>> instances;
+
+	std::unique_lock<std::mutex> ul(instances_lock);
+	for (auto iter = instances.begin(); iter != instances.end();) {
+		if (iter->second.expired()) {
+			iter = instances.erase(iter);
+		} else {
+			iter++;
+		}
+	}
+
+	std::shared_ptr<::gfx::blur::batch> instance = instances[key].lock();
+	if (!instance) {
+		instance       = std::make_shared<::gfx::blur::batch>(create());
+		instances[key] = instance;
+	}
+	return instance;
+}
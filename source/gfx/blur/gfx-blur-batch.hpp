@@ -0,0 +1,117 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+
+#pragma once
+#include <cinttypes>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "gfx-blur-base.hpp"
+#include "obs/gs/gs-effect.hpp"
+#include "obs/gs/gs-rendertarget-pool.hpp"
+#include "obs/gs/gs-rendertarget.hpp"
+#include "obs/gs/gs-texture.hpp"
+
+namespace gfx {
+	namespace blur {
+		/*!
+		 * \brief Blurs the inputs of several instances with identical settings in one go.
+		 *
+		 * Members join during the tick. The first member rendered in a frame captures the input of
+		 *  every member, packs them into an atlas with a guard band around each one, runs the blur
+		 *  over the whole atlas once and copies each result into a texture of its own. The guard band
+		 *  repeats the edge of its input and is as wide as the blur reaches, so the result is the same
+		 *  as if each input had been blurred on its own.
+		 *
+		 * Only blurs that treat every texel the same work like this, which rules out rotational and
+		 *  zoom blur (their center is relative to each input) and dual filtering (which halves the
+		 *  whole atlas, tiles and guard bands alike).
+		 */
+		class batch {
+			public:
+			// Renders the input of a member and returns it, or nullptr if there is nothing to blur.
+			typedef std::function<std::shared_ptr<::gs::texture>()> capture_t;
+
+			private:
+			struct member {
+				capture_t                           capture;
+				std::shared_ptr<::gs::texture>      input;
+				uint32_t                            x;
+				uint32_t                            y;
+				std::shared_ptr<::gs::rendertarget> output;
+			};
+
+			std::recursive_mutex                     _lock;
+			std::shared_ptr<::gfx::blur::base>       _blur;
+			std::shared_ptr<::gs::effect>            _effect;
+			::gs::texture_parameter                  _image;
+			::gs::float4_parameter                   _transform;
+			std::shared_ptr<::gs::rendertarget_pool> _pool;
+
+			std::map<const void*, member> _members;
+			uint64_t                      _frame;
+			bool                          _rendered;
+			bool                          _rendering;
+
+			public:
+			batch(std::shared_ptr<::gfx::blur::base> blur);
+			~batch();
+
+			// The blur used for the atlas, its settings are kept in sync by the members.
+			std::shared_ptr<::gfx::blur::base> get_blur();
+
+			/*!
+			 * \brief Take part in the next render, call once per tick.
+			 *
+			 * \param member Identifies the member, usually its own address.
+			 * \param capture Called at most once per frame, from within render() of any member.
+			 */
+			void join(const void* member, capture_t capture);
+
+			// Stop taking part, must be called before a member is destroyed.
+			void leave(const void* member);
+
+			/*!
+			 * \brief Get the blurred input of a member, rendering the whole batch if needed.
+			 *
+			 * The render target stays with the batch until the next frame, holding on to it keeps it
+			 *  from going back to the pool.
+			 *
+			 * \return nullptr if the member has to blur its input itself, for example because it is the
+			 *  only one in the batch this frame, or its input is too large for the atlas.
+			 */
+			std::shared_ptr<::gs::rendertarget> render(const void* member);
+
+			private:
+			void process();
+
+			public:
+			/*!
+			 * \brief Get the batch for a set of blur settings, creating it if no instance holds it.
+			 *
+			 * \param key Must differ whenever the blur would give a different result for the same input.
+			 * \param create Creates the blur for a new batch.
+			 */
+			static std::shared_ptr<::gfx::blur::batch> get(std::string                                         key,
+														   std::function<std::shared_ptr<::gfx::blur::base>()> create);
+		};
+	} // namespace blur
+} // namespace gfx
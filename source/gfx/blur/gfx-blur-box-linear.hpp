@@ -21,6 +21,7 @@
 #include <mutex>
 #include "gfx-blur-base.hpp"
 #include "obs/gs/gs-effect.hpp"
+#include "obs/gs/gs-rendertarget-pool.hpp"
 #include "obs/gs/gs-rendertarget.hpp"
 #include "obs/gs/gs-texture.hpp"
 
@@ -84,13 +85,13 @@ namespace gfx {
 			protected:
 			std::shared_ptr<::gfx::blur::box_linear_data> _data;
 
-			double_t                            _size;
-			std::pair<double_t, double_t>       _step_scale;
-			std::shared_ptr<::gs::texture>      _input_texture;
-			std::shared_ptr<::gs::rendertarget> _rendertarget;
+			double_t                                 _size;
+			std::pair<double_t, double_t>            _step_scale;
+			std::shared_ptr<::gs::texture>           _input_texture;
+			std::shared_ptr<::gs::rendertarget_pool> _pool;
 
-			private:
-			std::shared_ptr<::gs::rendertarget> _rendertarget2;
+			// Output of the last render, held until the next one.
+			std::shared_ptr<::gs::rendertarget> _rendertarget;
 
 			public:
 			box_linear();
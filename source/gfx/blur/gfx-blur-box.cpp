@@ -19,6 +19,7 @@
 #include <cmath>
 #include <memory>
 #include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-render-state.hpp"
 #include "plugin.hpp"
 #include "util-math.hpp"
 
@@ -194,12 +195,10 @@ std::shared_ptr<::gfx::blur::box_data> gfx::blur::box_factory::data()
 	return instance;
 }
 
-gfx::blur::box::box() : _data(::gfx::blur::box_factory::get().data()), _size(1.), _step_scale({1., 1.})
-{
-	auto gctx       = gs::context();
-	_rendertarget  = std::make_shared<::gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-	_rendertarget2 = std::make_shared<::gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-}
+gfx::blur::box::box()
+	: _data(::gfx::blur::box_factory::get().data()), _size(1.), _step_scale({1., 1.}),
+	  _pool(::gs::rendertarget_pool::get())
+{}
 
 gfx::blur::box::~box() {}
 
@@ -256,57 +255,49 @@ std::shared_ptr<::gs::texture> gfx::blur::box::render()
 	float_t width  = float_t(_input_texture->get_width());
 	float_t height = float_t(_input_texture->get_height());
 
-	gs_set_cull_mode(GS_NEITHER);
-	gs_enable_color(true, true, true, true);
-	gs_enable_depth_test(false);
-	gs_depth_function(GS_ALWAYS);
-	gs_blend_state_push();
-	gs_reset_blend_state();
-	gs_enable_blending(false);
-	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-	gs_enable_stencil_test(false);
-	gs_enable_stencil_write(false);
-	gs_stencil_function(GS_STENCIL_BOTH, GS_ALWAYS);
-	gs_stencil_op(GS_STENCIL_BOTH, GS_ZERO, GS_ZERO, GS_ZERO);
+	auto state = ::gs::render_state::opaque().apply();
 
 	// Two Pass Blur
 	std::shared_ptr<::gs::effect> effect = _data->get_effect();
 	if (effect) {
 		// Pass 1
-		effect->get_parameter("pImage")->set_texture(_input_texture);
-		effect->get_parameter("pImageTexel")->set_float2(float_t(1.f / width), 0.f);
-		effect->get_parameter("pStepScale")->set_float2(float_t(_step_scale.first), float_t(_step_scale.second));
-		effect->get_parameter("pSize")->set_float(float_t(_size));
-		effect->get_parameter("pSizeInverseMul")->set_float(float_t(1.0f / (float_t(_size) * 2.0f + 1.0f)));
-
+		effect->find_parameter("pImage")->set_texture(_input_texture);
+		effect->find_parameter("pImageTexel")->set_float2(float_t(1.f / width), 0.f);
+		effect->find_parameter("pStepScale")->set_float2(float_t(_step_scale.first), float_t(_step_scale.second));
+		effect->find_parameter("pSize")->set_float(float_t(_size));
+		effect->find_parameter("pSizeInverseMul")->set_float(float_t(1.0f / (float_t(_size) * 2.0f + 1.0f)));
+
+		_rendertarget.reset();
+		auto intermediate = _pool->acquire(uint32_t(width), uint32_t(height), GS_RGBA);
 		{
-			auto op = _rendertarget2->render(uint32_t(width), uint32_t(height));
+			auto op = intermediate->render(uint32_t(width), uint32_t(height));
 			gs_ortho(0, 1., 0, 1., 0, 1.);
 			while (gs_effect_loop(effect->get_object(), "Draw")) {
-				gs_draw_sprite(nullptr, 0, 1, 1);
+				gs::draw_sprite(nullptr, 0, 1, 1);
 			}
 		}
 
 		// Pass 2
-		effect->get_parameter("pImage")->set_texture(_rendertarget2->get_texture());
-		effect->get_parameter("pImageTexel")->set_float2(0.f, float_t(1.f / height));
+		effect->find_parameter("pImage")->set_texture(intermediate->get_texture());
+		effect->find_parameter("pImageTexel")->set_float2(0.f, float_t(1.f / height));
 
+		_rendertarget = _pool->acquire(uint32_t(width), uint32_t(height), GS_RGBA);
 		{
 			auto op = _rendertarget->render(uint32_t(width), uint32_t(height));
 			gs_ortho(0, 1., 0, 1., 0, 1.);
 			while (gs_effect_loop(effect->get_object(), "Draw")) {
-				gs_draw_sprite(nullptr, 0, 1, 1);
+				gs::draw_sprite(nullptr, 0, 1, 1);
 			}
 		}
 	}
 
-	gs_blend_state_pop();
-
-	return _rendertarget->get_texture();
+	return this->get();
 }
 
 std::shared_ptr<::gs::texture> gfx::blur::box::get()
 {
+	if (!_rendertarget)
+		return _input_texture;
 	return _rendertarget->get_texture();
 }
 
@@ -333,41 +324,30 @@ std::shared_ptr<::gs::texture> gfx::blur::box_directional::render()
 	float_t width  = float_t(_input_texture->get_width());
 	float_t height = float_t(_input_texture->get_height());
 
-	gs_blend_state_push();
-	gs_reset_blend_state();
-	gs_enable_color(true, true, true, true);
-	gs_enable_blending(false);
-	gs_enable_depth_test(false);
-	gs_enable_stencil_test(false);
-	gs_enable_stencil_write(false);
-	gs_set_cull_mode(GS_NEITHER);
-	gs_depth_function(GS_ALWAYS);
-	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-	gs_stencil_function(GS_STENCIL_BOTH, GS_ALWAYS);
-	gs_stencil_op(GS_STENCIL_BOTH, GS_ZERO, GS_ZERO, GS_ZERO);
+	auto state = ::gs::render_state::opaque().apply();
 
 	// One Pass Blur
 	std::shared_ptr<::gs::effect> effect = _data->get_effect();
 	if (effect) {
-		effect->get_parameter("pImage")->set_texture(_input_texture);
-		effect->get_parameter("pImageTexel")
+		effect->find_parameter("pImage")->set_texture(_input_texture);
+		effect->find_parameter("pImageTexel")
 			->set_float2(float_t(1. / width * cos(_angle)), float_t(1.f / height * sin(_angle)));
-		effect->get_parameter("pStepScale")->set_float2(float_t(_step_scale.first), float_t(_step_scale.second));
-		effect->get_parameter("pSize")->set_float(float_t(_size));
-		effect->get_parameter("pSizeInverseMul")->set_float(float_t(1.0f / (float_t(_size) * 2.0f + 1.0f)));
+		effect->find_parameter("pStepScale")->set_float2(float_t(_step_scale.first), float_t(_step_scale.second));
+		effect->find_parameter("pSize")->set_float(float_t(_size));
+		effect->find_parameter("pSizeInverseMul")->set_float(float_t(1.0f / (float_t(_size) * 2.0f + 1.0f)));
 
+		_rendertarget.reset();
+		_rendertarget = _pool->acquire(uint32_t(width), uint32_t(height), GS_RGBA);
 		{
 			auto op = _rendertarget->render(uint32_t(width), uint32_t(height));
 			gs_ortho(0, 1., 0, 1., 0, 1.);
 			while (gs_effect_loop(effect->get_object(), "Draw")) {
-				gs_draw_sprite(nullptr, 0, 1, 1);
+				gs::draw_sprite(nullptr, 0, 1, 1);
 			}
 		}
 	}
 
-	gs_blend_state_pop();
-
-	return _rendertarget->get_texture();
+	return this->get();
 }
 
 ::gfx::blur::type gfx::blur::box_rotational::get_type()
@@ -403,42 +383,31 @@ std::shared_ptr<::gs::texture> gfx::blur::box_rotational::render()
 	float_t width  = float_t(_input_texture->get_width());
 	float_t height = float_t(_input_texture->get_height());
 
-	gs_blend_state_push();
-	gs_reset_blend_state();
-	gs_enable_color(true, true, true, true);
-	gs_enable_blending(false);
-	gs_enable_depth_test(false);
-	gs_enable_stencil_test(false);
-	gs_enable_stencil_write(false);
-	gs_set_cull_mode(GS_NEITHER);
-	gs_depth_function(GS_ALWAYS);
-	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-	gs_stencil_function(GS_STENCIL_BOTH, GS_ALWAYS);
-	gs_stencil_op(GS_STENCIL_BOTH, GS_ZERO, GS_ZERO, GS_ZERO);
+	auto state = ::gs::render_state::opaque().apply();
 
 	// One Pass Blur
 	std::shared_ptr<::gs::effect> effect = _data->get_effect();
 	if (effect) {
-		effect->get_parameter("pImage")->set_texture(_input_texture);
-		effect->get_parameter("pImageTexel")->set_float2(float_t(1.f / width), float_t(1.f / height));
-		effect->get_parameter("pStepScale")->set_float2(float_t(_step_scale.first), float_t(_step_scale.second));
-		effect->get_parameter("pSize")->set_float(float_t(_size));
-		effect->get_parameter("pSizeInverseMul")->set_float(float_t(1.0f / (float_t(_size) * 2.0f + 1.0f)));
-		effect->get_parameter("pAngle")->set_float(float_t(_angle / _size));
-		effect->get_parameter("pCenter")->set_float2(float_t(_center.first), float_t(_center.second));
-
+		effect->find_parameter("pImage")->set_texture(_input_texture);
+		effect->find_parameter("pImageTexel")->set_float2(float_t(1.f / width), float_t(1.f / height));
+		effect->find_parameter("pStepScale")->set_float2(float_t(_step_scale.first), float_t(_step_scale.second));
+		effect->find_parameter("pSize")->set_float(float_t(_size));
+		effect->find_parameter("pSizeInverseMul")->set_float(float_t(1.0f / (float_t(_size) * 2.0f + 1.0f)));
+		effect->find_parameter("pAngle")->set_float(float_t(_angle / _size));
+		effect->find_parameter("pCenter")->set_float2(float_t(_center.first), float_t(_center.second));
+
+		_rendertarget.reset();
+		_rendertarget = _pool->acquire(uint32_t(width), uint32_t(height), GS_RGBA);
 		{
 			auto op = _rendertarget->render(uint32_t(width), uint32_t(height));
 			gs_ortho(0, 1., 0, 1., 0, 1.);
 			while (gs_effect_loop(effect->get_object(), "Rotate")) {
-				gs_draw_sprite(nullptr, 0, 1, 1);
+				gs::draw_sprite(nullptr, 0, 1, 1);
 			}
 		}
 	}
 
-	gs_blend_state_pop();
-
-	return _rendertarget->get_texture();
+	return this->get();
 }
 
 ::gfx::blur::type gfx::blur::box_zoom::get_type()
@@ -464,39 +433,28 @@ std::shared_ptr<::gs::texture> gfx::blur::box_zoom::render()
 	float_t width  = float_t(_input_texture->get_width());
 	float_t height = float_t(_input_texture->get_height());
 
-	gs_blend_state_push();
-	gs_reset_blend_state();
-	gs_enable_color(true, true, true, true);
-	gs_enable_blending(false);
-	gs_enable_depth_test(false);
-	gs_enable_stencil_test(false);
-	gs_enable_stencil_write(false);
-	gs_set_cull_mode(GS_NEITHER);
-	gs_depth_function(GS_ALWAYS);
-	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-	gs_stencil_function(GS_STENCIL_BOTH, GS_ALWAYS);
-	gs_stencil_op(GS_STENCIL_BOTH, GS_ZERO, GS_ZERO, GS_ZERO);
+	auto state = ::gs::render_state::opaque().apply();
 
 	// One Pass Blur
 	std::shared_ptr<::gs::effect> effect = _data->get_effect();
 	if (effect) {
-		effect->get_parameter("pImage")->set_texture(_input_texture);
-		effect->get_parameter("pImageTexel")->set_float2(float_t(1.f / width), float_t(1.f / height));
-		effect->get_parameter("pStepScale")->set_float2(float_t(_step_scale.first), float_t(_step_scale.second));
-		effect->get_parameter("pSize")->set_float(float_t(_size));
-		effect->get_parameter("pSizeInverseMul")->set_float(float_t(1.0f / (float_t(_size) * 2.0f + 1.0f)));
-		effect->get_parameter("pCenter")->set_float2(float_t(_center.first), float_t(_center.second));
-
+		effect->find_parameter("pImage")->set_texture(_input_texture);
+		effect->find_parameter("pImageTexel")->set_float2(float_t(1.f / width), float_t(1.f / height));
+		effect->find_parameter("pStepScale")->set_float2(float_t(_step_scale.first), float_t(_step_scale.second));
+		effect->find_parameter("pSize")->set_float(float_t(_size));
+		effect->find_parameter("pSizeInverseMul")->set_float(float_t(1.0f / (float_t(_size) * 2.0f + 1.0f)));
+		effect->find_parameter("pCenter")->set_float2(float_t(_center.first), float_t(_center.second));
+
+		_rendertarget.reset();
+		_rendertarget = _pool->acquire(uint32_t(width), uint32_t(height), GS_RGBA);
 		{
 			auto op = _rendertarget->render(uint32_t(width), uint32_t(height));
 			gs_ortho(0, 1., 0, 1., 0, 1.);
 			while (gs_effect_loop(effect->get_object(), "Zoom")) {
-				gs_draw_sprite(nullptr, 0, 1, 1);
+				gs::draw_sprite(nullptr, 0, 1, 1);
 			}
 		}
 	}
 
-	gs_blend_state_pop();
-
-	return _rendertarget->get_texture();
+	return this->get();
 }
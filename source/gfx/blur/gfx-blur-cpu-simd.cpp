@@ -0,0 +1,269 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "gfx-blur-cpu-simd.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC allows any intrinsic in any function, GCC and Clang need to be told per function.
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMD_TARGET_AVX2
+#endif
+
+typedef void (*weighted_sum_t)(float_t* target, float_t const* const* sources, float_t const* weights, size_t taps,
+							   size_t offset, size_t count);
+
+// target[i] = sum(sources[t][offset + i] * weights[t])
+static void weighted_sum_scalar(float_t* target, float_t const* const* sources, float_t const* weights, size_t taps,
+								size_t offset, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		float_t value = 0;
+		for (size_t t = 0; t < taps; t++) {
+			value += sources[t][offset + i] * weights[t];
+		}
+		target[i] = value;
+	}
+}
+
+#ifdef SIMD_X86
+static void weighted_sum_sse2(float_t* target, float_t const* const* sources, float_t const* weights, size_t taps,
+							  size_t offset, size_t count)
+{
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128 a = _mm_setzero_ps(), b = _mm_setzero_ps(), c = _mm_setzero_ps(), d = _mm_setzero_ps();
+		for (size_t t = 0; t < taps; t++) {
+			float_t const* src = sources[t] + offset + i;
+			__m128         w   = _mm_set1_ps(weights[t]);
+			a                  = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(src), w));
+			b                  = _mm_add_ps(b, _mm_mul_ps(_mm_loadu_ps(src + 4), w));
+			c                  = _mm_add_ps(c, _mm_mul_ps(_mm_loadu_ps(src + 8), w));
+			d                  = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(src + 12), w));
+		}
+		_mm_storeu_ps(target + i, a);
+		_mm_storeu_ps(target + i + 4, b);
+		_mm_storeu_ps(target + i + 8, c);
+		_mm_storeu_ps(target + i + 12, d);
+	}
+	for (; i + 4 <= count; i += 4) {
+		__m128 a = _mm_setzero_ps();
+		for (size_t t = 0; t < taps; t++) {
+			a = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(sources[t] + offset + i), _mm_set1_ps(weights[t])));
+		}
+		_mm_storeu_ps(target + i, a);
+	}
+	weighted_sum_scalar(target + i, sources, weights, taps, offset + i, count - i);
+}
+
+SIMD_TARGET_AVX2 static void weighted_sum_avx2(float_t* target, float_t const* const* sources, float_t const* weights,
+											   size_t taps, size_t offset, size_t count)
+{
+	size_t i = 0;
+	for (; i + 32 <= count; i += 32) {
+		__m256 a = _mm256_setzero_ps(), b = _mm256_setzero_ps(), c = _mm256_setzero_ps(), d = _mm256_setzero_ps();
+		for (size_t t = 0; t < taps; t++) {
+			float_t const* src = sources[t] + offset + i;
+			__m256         w   = _mm256_set1_ps(weights[t]);
+			a                  = _mm256_add_ps(a, _mm256_mul_ps(_mm256_loadu_ps(src), w));
+			b                  = _mm256_add_ps(b, _mm256_mul_ps(_mm256_loadu_ps(src + 8), w));
+			c                  = _mm256_add_ps(c, _mm256_mul_ps(_mm256_loadu_ps(src + 16), w));
+			d                  = _mm256_add_ps(d, _mm256_mul_ps(_mm256_loadu_ps(src + 24), w));
+		}
+		_mm256_storeu_ps(target + i, a);
+		_mm256_storeu_ps(target + i + 8, b);
+		_mm256_storeu_ps(target + i + 16, c);
+		_mm256_storeu_ps(target + i + 24, d);
+	}
+	for (; i + 8 <= count; i += 8) {
+		__m256 a = _mm256_setzero_ps();
+		for (size_t t = 0; t < taps; t++) {
+			a = _mm256_add_ps(a, _mm256_mul_ps(_mm256_loadu_ps(sources[t] + offset + i), _mm256_set1_ps(weights[t])));
+		}
+		_mm256_storeu_ps(target + i, a);
+	}
+	_mm256_zeroupper();
+	weighted_sum_sse2(target + i, sources, weights, taps, offset + i, count - i);
+}
+#endif
+
+static ::gfx::blur::simd::level detect_level()
+{
+#ifdef SIMD_X86
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int max_leaf = info[0];
+
+	__cpuid(info, 1);
+	bool sse2    = (info[3] & (1 << 26)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx     = (info[2] & (1 << 28)) != 0;
+	bool avx2    = false;
+	if (osxsave && avx && (max_leaf >= 7)) {
+		// The OS must save the YMM registers on context switches.
+		if ((_xgetbv(0) & 0x6) == 0x6) {
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+		}
+	}
+#else
+	__builtin_cpu_init();
+	bool sse2 = __builtin_cpu_supports("sse2");
+	bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+	if (avx2)
+		return ::gfx::blur::simd::level::AVX2;
+	if (sse2)
+		return ::gfx::blur::simd::level::SSE2;
+#endif
+	return ::gfx::blur::simd::level::Scalar;
+}
+
+static std::atomic<::gfx::blur::simd::level> current_level{::gfx::blur::simd::get_supported_level()};
+
+static weighted_sum_t get_weighted_sum()
+{
+	switch (current_level.load()) {
+#ifdef SIMD_X86
+	case ::gfx::blur::simd::level::AVX2:
+		return weighted_sum_avx2;
+	case ::gfx::blur::simd::level::SSE2:
+		return weighted_sum_sse2;
+#endif
+	default:
+		return weighted_sum_scalar;
+	}
+}
+
+::gfx::blur::simd::level gfx::blur::simd::get_supported_level()
+{
+	static ::gfx::blur::simd::level supported = detect_level();
+	return supported;
+}
+
+::gfx::blur::simd::level gfx::blur::simd::get_level()
+{
+	return current_level.load();
+}
+
+void gfx::blur::simd::set_level(::gfx::blur::simd::level level)
+{
+	current_level.store(std::min(level, get_supported_level()));
+}
+
+const char* gfx::blur::simd::get_level_name(::gfx::blur::simd::level level)
+{
+	switch (level) {
+	case ::gfx::blur::simd::level::Scalar:
+		return "Scalar";
+	case ::gfx::blur::simd::level::SSE2:
+		return "SSE2";
+	case ::gfx::blur::simd::level::AVX2:
+		return "AVX2";
+	}
+	return "Unknown";
+}
+
+void gfx::blur::simd::convolve_horizontal(float_t const* source, float_t* target, uint32_t width, uint32_t height,
+										  std::vector<::gfx::blur::simd::tap> const& taps)
+{
+	if (taps.empty()) {
+		std::memset(target, 0, sizeof(float_t) * width * height * 4);
+		return;
+	}
+
+	weighted_sum_t              weighted_sum = get_weighted_sum();
+	int64_t                     w            = int64_t(width);
+	std::vector<float_t>        weights(taps.size());
+	std::vector<float_t const*> sources(taps.size());
+
+	int32_t min_offset = 0, max_offset = 0;
+	for (size_t t = 0; t < taps.size(); t++) {
+		weights[t] = taps[t].weight;
+		min_offset = std::min(min_offset, taps[t].offset);
+		max_offset = std::max(max_offset, taps[t].offset);
+	}
+
+	// Only texels whose taps all land inside of the row can use the vectorized path, the rest clamps.
+	int64_t begin = std::clamp<int64_t>(-int64_t(min_offset), 0, w);
+	int64_t end   = std::clamp<int64_t>(w - int64_t(max_offset), begin, w);
+
+	for (uint32_t y = 0; y < height; y++) {
+		float_t const* src = source + size_t(y) * width * 4;
+		float_t*       dst = target + size_t(y) * width * 4;
+
+		if (begin < end) {
+			for (size_t t = 0; t < taps.size(); t++) {
+				sources[t] = src + (begin + taps[t].offset) * 4;
+			}
+			weighted_sum(dst + begin * 4, sources.data(), weights.data(), taps.size(), 0, size_t(end - begin) * 4);
+		}
+
+		for (int64_t x = 0; x < w; x++) {
+			if (x == begin)
+				x = std::max(x, end);
+			if (x >= w)
+				break;
+
+			float_t* px = dst + x * 4;
+			std::fill_n(px, 4, 0.f);
+			for (auto const& tap : taps) {
+				float_t const* sp = src + std::clamp<int64_t>(x + tap.offset, 0, w - 1) * 4;
+				for (size_t c = 0; c < 4; c++) {
+					px[c] += sp[c] * tap.weight;
+				}
+			}
+		}
+	}
+}
+
+void gfx::blur::simd::convolve_vertical(float_t const* source, float_t* target, uint32_t width, uint32_t height,
+										std::vector<::gfx::blur::simd::tap> const& taps)
+{
+	if (taps.empty()) {
+		std::memset(target, 0, sizeof(float_t) * width * height * 4);
+		return;
+	}
+
+	weighted_sum_t              weighted_sum = get_weighted_sum();
+	size_t                      stride       = size_t(width) * 4;
+	std::vector<float_t>        weights(taps.size());
+	std::vector<float_t const*> sources(taps.size());
+	for (size_t t = 0; t < taps.size(); t++) {
+		weights[t] = taps[t].weight;
+	}
+
+	for (uint32_t y = 0; y < height; y++) {
+		for (size_t t = 0; t < taps.size(); t++) {
+			int64_t sy = std::clamp<int64_t>(int64_t(y) + taps[t].offset, 0, int64_t(height) - 1);
+			sources[t] = source + size_t(sy) * stride;
+		}
+		weighted_sum(target + size_t(y) * stride, sources.data(), weights.data(), taps.size(), 0, stride);
+	}
+}
@@ -0,0 +1,70 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#pragma once
+#include <cinttypes>
+#include <cmath>
+#include <vector>
+
+namespace gfx {
+	namespace blur {
+		namespace simd {
+			enum class level : uint8_t {
+				Scalar,
+				SSE2,
+				AVX2,
+			};
+
+			/*!
+			 * \brief A single weighted tap of a separable convolution, relative to the output texel.
+			 */
+			struct tap {
+				int32_t offset;
+				float_t weight;
+			};
+
+			// Highest level supported by the CPU and OS.
+			::gfx::blur::simd::level get_supported_level();
+
+			// Level currently used by the convolution functions.
+			::gfx::blur::simd::level get_level();
+
+			// Override the level, clamped to the supported level. Mainly useful to compare against the scalar path.
+			void set_level(::gfx::blur::simd::level level);
+
+			const char* get_level_name(::gfx::blur::simd::level level);
+
+			/*!
+			 * \brief Convolve each row of an RGBA float image with the given taps, clamping at the edges.
+			 *
+			 * \param source Source image, 4 floats per texel.
+			 * \param target Target image of the same size, must not alias the source.
+			 */
+			void convolve_horizontal(float_t const* source, float_t* target, uint32_t width, uint32_t height,
+									 std::vector<::gfx::blur::simd::tap> const& taps);
+
+			/*!
+			 * \brief Convolve each column of an RGBA float image with the given taps, clamping at the edges.
+			 *
+			 * \param source Source image, 4 floats per texel.
+			 * \param target Target image of the same size, must not alias the source.
+			 */
+			void convolve_vertical(float_t const* source, float_t* target, uint32_t width, uint32_t height,
+								   std::vector<::gfx::blur::simd::tap> const& taps);
+		} // namespace simd
+	}     // namespace blur
+} // namespace gfx
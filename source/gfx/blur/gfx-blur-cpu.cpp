@@ -0,0 +1,827 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "gfx-blur-cpu.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include "gfx-blur-cpu-simd.hpp"
+#include "gfx-blur-gaussian-kernel.hpp"
+#include "obs/gs/gs-helper.hpp"
+#include "plugin.hpp"
+#include "util-math.hpp"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)
+#endif
+#include <obs.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+// Must match the limits of the GPU implementations.
+#define MAX_BOX_SIZE 128
+#define MAX_KERNEL_SIZE 128
+#define MAX_GAUSSIAN_SIZE (MAX_KERNEL_SIZE - 1)
+#define MAX_LARGE_GAUSSIAN_SIZE 1024
+#define LARGE_GAUSSIAN_BASE_SIZE 32
+#define MAX_LEVELS 16
+
+gfx::blur::cpu_image::cpu_image(uint32_t width, uint32_t height)
+	: _width(width), _height(height), _data(size_t(width) * size_t(height) * 4, 0.f)
+{
+	if (width == 0)
+		throw std::logic_error("width must be at least 1");
+	if (height == 0)
+		throw std::logic_error("height must be at least 1");
+}
+
+gfx::blur::cpu_image::~cpu_image() {}
+
+uint32_t gfx::blur::cpu_image::get_width()
+{
+	return _width;
+}
+
+uint32_t gfx::blur::cpu_image::get_height()
+{
+	return _height;
+}
+
+float_t* gfx::blur::cpu_image::get_data()
+{
+	return _data.data();
+}
+
+float_t* gfx::blur::cpu_image::at(uint32_t x, uint32_t y)
+{
+	return &_data[(size_t(y) * _width + x) * 4];
+}
+
+void gfx::blur::cpu_image::sample(float_t u, float_t v, float_t out[4])
+{
+	// Texel centers are at (n + 0.5) / size, so shift by half a texel first.
+	float_t x  = u * _width - 0.5f;
+	float_t y  = v * _height - 0.5f;
+	float_t fx = floor(x);
+	float_t fy = floor(y);
+	float_t wx = x - fx;
+	float_t wy = y - fy;
+
+	int64_t max_x = int64_t(_width) - 1;
+	int64_t max_y = int64_t(_height) - 1;
+	int64_t x0    = std::clamp<int64_t>(int64_t(fx), 0, max_x);
+	int64_t x1    = std::clamp<int64_t>(int64_t(fx) + 1, 0, max_x);
+	int64_t y0    = std::clamp<int64_t>(int64_t(fy), 0, max_y);
+	int64_t y1    = std::clamp<int64_t>(int64_t(fy) + 1, 0, max_y);
+
+	float_t* p00 = at(uint32_t(x0), uint32_t(y0));
+	float_t* p10 = at(uint32_t(x1), uint32_t(y0));
+	float_t* p01 = at(uint32_t(x0), uint32_t(y1));
+	float_t* p11 = at(uint32_t(x1), uint32_t(y1));
+	for (size_t c = 0; c < 4; c++) {
+		float_t top    = p00[c] + (p10[c] - p00[c]) * wx;
+		float_t bottom = p01[c] + (p11[c] - p01[c]) * wx;
+		out[c]         = top + (bottom - top) * wy;
+	}
+}
+
+// Runs a pixel shader like function for every texel of the output image.
+template<typename T>
+static void process(std::shared_ptr<::gfx::blur::cpu_image> output, T shader)
+{
+	float_t inv_width  = 1.f / float_t(output->get_width());
+	float_t inv_height = 1.f / float_t(output->get_height());
+	for (uint32_t y = 0; y < output->get_height(); y++) {
+		float_t v = (float_t(y) + 0.5f) * inv_height;
+		for (uint32_t x = 0; x < output->get_width(); x++) {
+			float_t  u     = (float_t(x) + 0.5f) * inv_width;
+			float_t* pixel = output->at(x, y);
+			shader(u, v, pixel);
+		}
+	}
+}
+
+// Bilinear resize, same as drawing the image into a render target of the given size.
+static std::shared_ptr<::gfx::blur::cpu_image> resample(std::shared_ptr<::gfx::blur::cpu_image> input, uint32_t width,
+														uint32_t height)
+{
+	auto output = std::make_shared<::gfx::blur::cpu_image>(width, height);
+	process(output, [&input](float_t u, float_t v, float_t final[4]) { input->sample(u, v, final); });
+	return output;
+}
+
+static inline void accumulate(float_t final[4], float_t const sample[4], float_t weight)
+{
+	for (size_t c = 0; c < 4; c++) {
+		final[c] += sample[c] * weight;
+	}
+}
+
+// Same loop bound as the effects: "for (n = 1; ...) { ...; if (n >= pSize) break; }".
+static inline size_t iterations(double_t size, size_t limit)
+{
+	return std::clamp<size_t>(size_t(ceil(size)), 1, limit);
+}
+
+static inline void rotate_around(float_t u, float_t v, float_t cu, float_t cv, float_t angle, float_t& ou, float_t& ov)
+{
+	float_t cp = cos(angle);
+	float_t sp = sin(angle);
+	float_t du = u - cu;
+	float_t dv = v - cv;
+	ou         = (du * cp) - (dv * sp) + cu;
+	ov         = (du * sp) + (dv * cp) + cv;
+}
+
+gfx::blur::cpu_factory::cpu_factory(::gfx::blur::cpu_algorithm algorithm) : _algorithm(algorithm) {}
+
+gfx::blur::cpu_factory::~cpu_factory() {}
+
+bool gfx::blur::cpu_factory::is_type_supported(::gfx::blur::type type)
+{
+	switch (_algorithm) {
+	case ::gfx::blur::cpu_algorithm::Box:
+	case ::gfx::blur::cpu_algorithm::Gaussian:
+		switch (type) {
+		case ::gfx::blur::type::Area:
+		case ::gfx::blur::type::Directional:
+		case ::gfx::blur::type::Rotational:
+		case ::gfx::blur::type::Zoom:
+			return true;
+		default:
+			return false;
+		}
+	case ::gfx::blur::cpu_algorithm::BoxLinear:
+	case ::gfx::blur::cpu_algorithm::GaussianLinear:
+		switch (type) {
+		case ::gfx::blur::type::Area:
+		case ::gfx::blur::type::Directional:
+			return true;
+		default:
+			return false;
+		}
+	case ::gfx::blur::cpu_algorithm::DualFiltering:
+		return (type == ::gfx::blur::type::Area);
+	}
+	return false;
+}
+
+std::shared_ptr<::gfx::blur::base> gfx::blur::cpu_factory::create(::gfx::blur::type type)
+{
+	if (!is_type_supported(type))
+		throw std::runtime_error("Invalid type.");
+	return std::make_shared<::gfx::blur::cpu>(_algorithm, type);
+}
+
+double_t gfx::blur::cpu_factory::get_min_size(::gfx::blur::type)
+{
+	return double_t(1.0);
+}
+
+double_t gfx::blur::cpu_factory::get_step_size(::gfx::blur::type)
+{
+	return double_t(1.0);
+}
+
+double_t gfx::blur::cpu_factory::get_max_size(::gfx::blur::type type)
+{
+	switch (_algorithm) {
+	case ::gfx::blur::cpu_algorithm::Gaussian:
+		if (type == ::gfx::blur::type::Area)
+			return double_t(MAX_LARGE_GAUSSIAN_SIZE);
+		return double_t(MAX_GAUSSIAN_SIZE);
+	case ::gfx::blur::cpu_algorithm::GaussianLinear:
+		return double_t(MAX_GAUSSIAN_SIZE);
+	case ::gfx::blur::cpu_algorithm::DualFiltering:
+		return double_t(MAX_LEVELS);
+	default:
+		return double_t(MAX_BOX_SIZE);
+	}
+}
+
+double_t gfx::blur::cpu_factory::get_min_angle(::gfx::blur::type type)
+{
+	switch (type) {
+	case ::gfx::blur::type::Directional:
+	case ::gfx::blur::type::Rotational:
+		return -180.0;
+	default:
+		return 0;
+	}
+}
+
+double_t gfx::blur::cpu_factory::get_step_angle(::gfx::blur::type)
+{
+	return double_t(0.01);
+}
+
+double_t gfx::blur::cpu_factory::get_max_angle(::gfx::blur::type type)
+{
+	switch (type) {
+	case ::gfx::blur::type::Directional:
+	case ::gfx::blur::type::Rotational:
+		return 180.0;
+	default:
+		return 0;
+	}
+}
+
+bool gfx::blur::cpu_factory::is_step_scale_supported(::gfx::blur::type type)
+{
+	if (_algorithm == ::gfx::blur::cpu_algorithm::DualFiltering)
+		return false;
+
+	switch (type) {
+	case ::gfx::blur::type::Area:
+	case ::gfx::blur::type::Zoom:
+	case ::gfx::blur::type::Directional:
+		return true;
+	default:
+		return false;
+	}
+}
+
+double_t gfx::blur::cpu_factory::get_min_step_scale_x(::gfx::blur::type)
+{
+	return double_t(0.01);
+}
+
+double_t gfx::blur::cpu_factory::get_step_step_scale_x(::gfx::blur::type)
+{
+	return double_t(0.01);
+}
+
+double_t gfx::blur::cpu_factory::get_max_step_scale_x(::gfx::blur::type)
+{
+	return double_t(1000.0);
+}
+
+double_t gfx::blur::cpu_factory::get_min_step_scale_y(::gfx::blur::type)
+{
+	return double_t(0.01);
+}
+
+double_t gfx::blur::cpu_factory::get_step_step_scale_y(::gfx::blur::type)
+{
+	return double_t(0.01);
+}
+
+double_t gfx::blur::cpu_factory::get_max_step_scale_y(::gfx::blur::type)
+{
+	return double_t(1000.0);
+}
+
+::gfx::blur::cpu_algorithm gfx::blur::cpu_factory::get_algorithm()
+{
+	return _algorithm;
+}
+
+::gfx::blur::cpu_factory& gfx::blur::cpu_factory::get(::gfx::blur::cpu_algorithm algorithm)
+{
+	static ::gfx::blur::cpu_factory box(::gfx::blur::cpu_algorithm::Box);
+	static ::gfx::blur::cpu_factory box_linear(::gfx::blur::cpu_algorithm::BoxLinear);
+	static ::gfx::blur::cpu_factory gaussian(::gfx::blur::cpu_algorithm::Gaussian);
+	static ::gfx::blur::cpu_factory gaussian_linear(::gfx::blur::cpu_algorithm::GaussianLinear);
+	static ::gfx::blur::cpu_factory dual_filtering(::gfx::blur::cpu_algorithm::DualFiltering);
+
+	switch (algorithm) {
+	case ::gfx::blur::cpu_algorithm::Box:
+		return box;
+	case ::gfx::blur::cpu_algorithm::BoxLinear:
+		return box_linear;
+	case ::gfx::blur::cpu_algorithm::Gaussian:
+		return gaussian;
+	case ::gfx::blur::cpu_algorithm::GaussianLinear:
+		return gaussian_linear;
+	case ::gfx::blur::cpu_algorithm::DualFiltering:
+		return dual_filtering;
+	}
+	throw std::invalid_argument("Invalid algorithm.");
+}
+
+gfx::blur::cpu::cpu(::gfx::blur::cpu_algorithm algorithm, ::gfx::blur::type type)
+	: _algorithm(algorithm), _type(type), _size(1.), _step_scale({1., 1.}), _angle(0), _center({0.5, 0.5})
+{
+	if (!::gfx::blur::cpu_factory::get(algorithm).is_type_supported(type))
+		throw std::invalid_argument("Algorithm does not support the given type.");
+}
+
+gfx::blur::cpu::~cpu()
+{
+	if (_output_texture) {
+		auto gctx = gs::context();
+		_output_texture.reset();
+	}
+}
+
+void gfx::blur::cpu::set_input(std::shared_ptr<::gs::texture> texture)
+{
+	_input_texture = texture;
+}
+
+::gfx::blur::type gfx::blur::cpu::get_type()
+{
+	return _type;
+}
+
+double_t gfx::blur::cpu::get_size()
+{
+	return _size;
+}
+
+void gfx::blur::cpu::set_size(double_t width)
+{
+	auto& factory = ::gfx::blur::cpu_factory::get(_algorithm);
+	_size         = std::clamp(width, factory.get_min_size(_type), factory.get_max_size(_type));
+}
+
+void gfx::blur::cpu::set_step_scale(double_t x, double_t y)
+{
+	_step_scale = {x, y};
+}
+
+void gfx::blur::cpu::get_step_scale(double_t& x, double_t& y)
+{
+	x = _step_scale.first;
+	y = _step_scale.second;
+}
+
+double_t gfx::blur::cpu::get_step_scale_x()
+{
+	return _step_scale.first;
+}
+
+double_t gfx::blur::cpu::get_step_scale_y()
+{
+	return _step_scale.second;
+}
+
+std::shared_ptr<::gs::texture> gfx::blur::cpu::render()
+{
+	if (!_input_texture)
+		return nullptr;
+
+	auto     gctx   = gs::context();
+	uint32_t width  = _input_texture->get_width();
+	uint32_t height = _input_texture->get_height();
+
+	// Download the input texture.
+	{
+		gs_color_format format = _input_texture->get_color_format();
+		if ((format != GS_RGBA) && (format != GS_BGRA) && (format != GS_BGRX) && (format != GS_RGBA32F))
+			throw std::runtime_error("Unsupported color format for CPU blur.");
+
+		gs_stagesurf_t* stage = gs_stagesurface_create(width, height, format);
+		if (!stage)
+			throw std::runtime_error("Failed to create staging surface.");
+
+		gs_stage_texture(stage, _input_texture->get_object());
+
+		uint8_t* data     = nullptr;
+		uint32_t linesize = 0;
+		if (!gs_stagesurface_map(stage, &data, &linesize)) {
+			gs_stagesurface_destroy(stage);
+			throw std::runtime_error("Failed to map staging surface.");
+		}
+
+		if (!_input_image || (_input_image->get_width() != width) || (_input_image->get_height() != height))
+			_input_image = std::make_shared<::gfx::blur::cpu_image>(width, height);
+
+		for (uint32_t y = 0; y < height; y++) {
+			uint8_t* row = data + size_t(linesize) * y;
+			for (uint32_t x = 0; x < width; x++) {
+				float_t* px = _input_image->at(x, y);
+				switch (format) {
+				case GS_RGBA32F:
+					std::copy_n(reinterpret_cast<float_t*>(row) + size_t(x) * 4, 4, px);
+					break;
+				case GS_RGBA:
+					px[0] = row[x * 4 + 0] / 255.f;
+					px[1] = row[x * 4 + 1] / 255.f;
+					px[2] = row[x * 4 + 2] / 255.f;
+					px[3] = row[x * 4 + 3] / 255.f;
+					break;
+				default: // GS_BGRA, GS_BGRX
+					px[0] = row[x * 4 + 2] / 255.f;
+					px[1] = row[x * 4 + 1] / 255.f;
+					px[2] = row[x * 4 + 0] / 255.f;
+					px[3] = (format == GS_BGRX) ? 1.f : row[x * 4 + 3] / 255.f;
+					break;
+				}
+			}
+		}
+
+		gs_stagesurface_unmap(stage);
+		gs_stagesurface_destroy(stage);
+	}
+
+	auto image = render_image();
+
+	// Upload the result.
+	if (!_output_texture || (_output_texture->get_width() != image->get_width())
+		|| (_output_texture->get_height() != image->get_height())) {
+		const uint8_t* mip_data = reinterpret_cast<const uint8_t*>(image->get_data());
+		_output_texture = std::make_shared<::gs::texture>(image->get_width(), image->get_height(), GS_RGBA32F, 1,
+														  &mip_data, ::gs::texture::flags::Dynamic);
+	} else {
+		gs_texture_set_image(_output_texture->get_object(), reinterpret_cast<const uint8_t*>(image->get_data()),
+							 image->get_width() * 4 * sizeof(float_t), false);
+	}
+
+	return _output_texture;
+}
+
+std::shared_ptr<::gs::texture> gfx::blur::cpu::get()
+{
+	return _output_texture;
+}
+
+double_t gfx::blur::cpu::get_angle()
+{
+	return D_RAD_TO_DEG(_angle);
+}
+
+void gfx::blur::cpu::set_angle(double_t angle)
+{
+	_angle = D_DEG_TO_RAD(angle);
+}
+
+void gfx::blur::cpu::set_center(double_t x, double_t y)
+{
+	_center.first  = x;
+	_center.second = y;
+}
+
+void gfx::blur::cpu::get_center(double_t& x, double_t& y)
+{
+	x = _center.first;
+	y = _center.second;
+}
+
+void gfx::blur::cpu::set_input(std::shared_ptr<::gfx::blur::cpu_image> image)
+{
+	_input_image = image;
+}
+
+std::shared_ptr<::gfx::blur::cpu_image> gfx::blur::cpu::render_image()
+{
+	if (!_input_image)
+		return nullptr;
+
+	if (_algorithm == ::gfx::blur::cpu_algorithm::DualFiltering) {
+		_output_image = render_dual_filtering(_input_image);
+		return _output_image;
+	}
+
+	// Large Gaussian blurs work on a downsampled copy, like gfx::blur::gaussian.
+	size_t levels = get_pyramid_levels(_input_image);
+	if (levels > 0) {
+		if ((_step_scale.first + _step_scale.second) < std::numeric_limits<double_t>::epsilon()) {
+			_output_image = _input_image;
+			return _output_image;
+		}
+
+		std::shared_ptr<::gfx::blur::cpu_image> image = _input_image;
+		for (size_t n = 0; n < levels; n++) {
+			image = resample(image, image->get_width() / 2, image->get_height() / 2);
+		}
+
+		image         = render_area(image, get_samples(_size / double_t(size_t(1) << levels)));
+		_output_image = resample(image, _input_image->get_width(), _input_image->get_height());
+		return _output_image;
+	}
+
+	switch (_type) {
+	case ::gfx::blur::type::Area:
+		_output_image = render_area(_input_image, get_samples(_size));
+		break;
+	case ::gfx::blur::type::Directional:
+		_output_image = render_directional(_input_image, _size);
+		break;
+	case ::gfx::blur::type::Rotational:
+		_output_image = render_rotational(_input_image);
+		break;
+	case ::gfx::blur::type::Zoom:
+		_output_image = render_zoom(_input_image);
+		break;
+	default:
+		throw std::runtime_error("Invalid type.");
+	}
+	return _output_image;
+}
+
+std::shared_ptr<::gfx::blur::cpu_image> gfx::blur::cpu::get_image()
+{
+	return _output_image;
+}
+
+std::shared_ptr<::gfx::blur::cpu_image> gfx::blur::cpu::render_exact()
+{
+	if (!_input_image)
+		return nullptr;
+	if ((_algorithm != ::gfx::blur::cpu_algorithm::Gaussian) || (_type != ::gfx::blur::type::Area))
+		throw std::logic_error("Only Gaussian Area blurs have an exact reference.");
+
+	// The pyramid blurs with the kernel of the reduced width, so one of its texels covers 2^levels input texels.
+	size_t   scale = size_t(1) << get_pyramid_levels(_input_image);
+	size_t   width = size_t(_size / double_t(scale));
+	double_t sigma = ::gfx::blur::gaussian_kernel_table::get_sigma(width) * double_t(scale);
+	size_t   reach = width * scale;
+
+	std::vector<double_t> weights(reach + 1);
+	double_t              sum = 0.;
+	for (size_t p = 0; p <= reach; p++) {
+		weights[p] = util::math::gaussian<double_t>(double_t(p), sigma);
+		sum += weights[p] * (p > 0 ? 2 : 1);
+	}
+
+	std::vector<std::pair<float_t, float_t>> samples;
+	samples.reserve(reach * 2 + 1);
+	samples.emplace_back(0.f, float_t(weights[0] / sum));
+	for (size_t p = 1; p <= reach; p++) {
+		samples.emplace_back(float_t(p), float_t(weights[p] / sum));
+		samples.emplace_back(-float_t(p), float_t(weights[p] / sum));
+	}
+
+	return render_area(_input_image, samples);
+}
+
+std::vector<std::pair<float_t, float_t>> gfx::blur::cpu::get_samples(double_t width)
+{
+	std::vector<std::pair<float_t, float_t>> samples;
+	float_t                                  size = float_t(width);
+
+	switch (_algorithm) {
+	case ::gfx::blur::cpu_algorithm::Box: {
+		float_t inv_mul = 1.0f / (size * 2.0f + 1.0f);
+		samples.emplace_back(0.f, inv_mul);
+		for (size_t n = 1; n <= iterations(width, MAX_BOX_SIZE); n++) {
+			samples.emplace_back(float_t(n), inv_mul);
+			samples.emplace_back(-float_t(n), inv_mul);
+		}
+		break;
+	}
+	case ::gfx::blur::cpu_algorithm::BoxLinear: {
+		float_t inv_mul = 1.0f / (size * 2.0f + 1.0f);
+		samples.emplace_back(0.f, inv_mul);
+		for (size_t n = 1; n <= MAX_BOX_SIZE; n += 2) {
+			if (n >= size)
+				break;
+			samples.emplace_back(float_t(n) + 0.5f, inv_mul * 2.f);
+			samples.emplace_back(-(float_t(n) + 0.5f), inv_mul * 2.f);
+		}
+		if ((int64_t(round(size)) % 2) == 1) {
+			samples.emplace_back(size, inv_mul);
+			samples.emplace_back(-size, inv_mul);
+		}
+		break;
+	}
+	case ::gfx::blur::cpu_algorithm::Gaussian: {
+		auto& kernel = ::gfx::blur::gaussian_kernel_table::get().get_kernel(size_t(width));
+		samples.emplace_back(0.f, kernel[0]);
+		for (size_t n = 1; n <= iterations(width, MAX_GAUSSIAN_SIZE); n++) {
+			samples.emplace_back(float_t(n), kernel[n]);
+			samples.emplace_back(-float_t(n), kernel[n]);
+		}
+		break;
+	}
+	case ::gfx::blur::cpu_algorithm::GaussianLinear: {
+		auto& kernel = ::gfx::blur::gaussian_kernel_table::get().get_kernel(size_t(width));
+		samples.emplace_back(0.f, kernel[0]);
+		for (size_t n = 1; n < MAX_KERNEL_SIZE - 1; n += 2) {
+			if (n >= size)
+				break;
+			samples.emplace_back(float_t(n) + 0.5f, kernel[n] + kernel[n + 1]);
+			samples.emplace_back(-(float_t(n) + 0.5f), kernel[n] + kernel[n + 1]);
+		}
+		if ((int64_t(round(size)) % 2) == 1) {
+			samples.emplace_back(size, kernel[size_t(size)]);
+			samples.emplace_back(-size, kernel[size_t(size)]);
+		}
+		break;
+	}
+	default:
+		throw std::logic_error("Algorithm has no one dimensional samples.");
+	}
+
+	return samples;
+}
+
+size_t gfx::blur::cpu::get_pyramid_levels(std::shared_ptr<::gfx::blur::cpu_image> input)
+{
+	if ((_algorithm != ::gfx::blur::cpu_algorithm::Gaussian) || (_size <= MAX_GAUSSIAN_SIZE))
+		return 0;
+	if (_type != ::gfx::blur::type::Area)
+		return 0;
+
+	size_t levels = size_t(ceil(log2(_size / LARGE_GAUSSIAN_BASE_SIZE)));
+	while ((levels > 0)
+		   && (((input->get_width() >> levels) == 0) || ((input->get_height() >> levels) == 0))) {
+		levels--;
+	}
+	return levels;
+}
+
+std::shared_ptr<::gfx::blur::cpu_image>
+	gfx::blur::cpu::render_area(std::shared_ptr<::gfx::blur::cpu_image>         input,
+								std::vector<std::pair<float_t, float_t>> const& samples)
+{
+	// The Gaussian engines skip passes without any step, the Box engines always render both.
+	bool skip_empty = (_algorithm == ::gfx::blur::cpu_algorithm::Gaussian)
+					  || (_algorithm == ::gfx::blur::cpu_algorithm::GaussianLinear);
+	if (skip_empty && ((_step_scale.first + _step_scale.second) < std::numeric_limits<double_t>::epsilon()))
+		return input;
+
+	// Every output texel of a pass samples at the same relative offsets, so each bilinear sample can be
+	//  split into two weighted integer taps, which turns the pass into a plain separable convolution.
+	auto build_taps = [&samples](float_t step) {
+		std::map<int32_t, float_t> weights;
+		for (auto const& sample : samples) {
+			float_t position = sample.first * step;
+			float_t base     = floor(position);
+			float_t fraction = position - base;
+			weights[int32_t(base)] += sample.second * (1.f - fraction);
+			if (fraction > 0.f)
+				weights[int32_t(base) + 1] += sample.second * fraction;
+		}
+
+		std::vector<::gfx::blur::simd::tap> taps;
+		taps.reserve(weights.size());
+		for (auto const& kv : weights) {
+			if (kv.second != 0.f)
+				taps.push_back({kv.first, kv.second});
+		}
+		return taps;
+	};
+
+	std::shared_ptr<::gfx::blur::cpu_image> current = input;
+	if (!skip_empty || (_step_scale.first >= std::numeric_limits<double_t>::epsilon())) {
+		auto next = std::make_shared<::gfx::blur::cpu_image>(input->get_width(), input->get_height());
+		::gfx::blur::simd::convolve_horizontal(current->get_data(), next->get_data(), next->get_width(),
+											   next->get_height(), build_taps(float_t(_step_scale.first)));
+		current = next;
+	}
+	if (!skip_empty || (_step_scale.second >= std::numeric_limits<double_t>::epsilon())) {
+		auto next = std::make_shared<::gfx::blur::cpu_image>(input->get_width(), input->get_height());
+		::gfx::blur::simd::convolve_vertical(current->get_data(), next->get_data(), next->get_width(),
+											 next->get_height(), build_taps(float_t(_step_scale.second)));
+		current = next;
+	}
+	return current;
+}
+
+std::shared_ptr<::gfx::blur::cpu_image>
+	gfx::blur::cpu::render_directional(std::shared_ptr<::gfx::blur::cpu_image> input, double_t size)
+{
+	auto    samples = get_samples(size);
+	float_t step_x  = float_t(1. / input->get_width() * cos(_angle)) * float_t(_step_scale.first);
+	float_t step_y  = float_t(1. / input->get_height() * sin(_angle)) * float_t(_step_scale.second);
+
+	auto output = std::make_shared<::gfx::blur::cpu_image>(input->get_width(), input->get_height());
+	process(output, [&](float_t u, float_t v, float_t final[4]) {
+		float_t px[4];
+		std::fill_n(final, 4, 0.f);
+		for (auto const& sample : samples) {
+			input->sample(u + step_x * sample.first, v + step_y * sample.first, px);
+			accumulate(final, px, sample.second);
+		}
+	});
+	return output;
+}
+
+std::shared_ptr<::gfx::blur::cpu_image>
+	gfx::blur::cpu::render_rotational(std::shared_ptr<::gfx::blur::cpu_image> input)
+{
+	auto    samples = get_samples(_size);
+	float_t angstep = float_t(_angle / _size) * float_t(_step_scale.first);
+	float_t cu      = float_t(_center.first);
+	float_t cv      = float_t(_center.second);
+
+	auto output = std::make_shared<::gfx::blur::cpu_image>(input->get_width(), input->get_height());
+	process(output, [&](float_t u, float_t v, float_t final[4]) {
+		float_t px[4], su, sv;
+		std::fill_n(final, 4, 0.f);
+		for (auto const& sample : samples) {
+			rotate_around(u, v, cu, cv, angstep * sample.first, su, sv);
+			input->sample(su, sv, px);
+			accumulate(final, px, sample.second);
+		}
+	});
+	return output;
+}
+
+std::shared_ptr<::gfx::blur::cpu_image> gfx::blur::cpu::render_zoom(std::shared_ptr<::gfx::blur::cpu_image> input)
+{
+	auto    samples = get_samples(_size);
+	float_t ssx     = float_t(_step_scale.first) / float_t(input->get_width());
+	float_t ssy     = float_t(_step_scale.second) / float_t(input->get_height());
+	float_t cu      = float_t(_center.first);
+	float_t cv      = float_t(_center.second);
+
+	auto output = std::make_shared<::gfx::blur::cpu_image>(input->get_width(), input->get_height());
+	process(output, [&](float_t u, float_t v, float_t final[4]) {
+		// normalize(uv - center) * distance(uv, center) cancels out, which also avoids the NaN at the center.
+		float_t px[4];
+		float_t dir_x = (u - cu) * ssx;
+		float_t dir_y = (v - cv) * ssy;
+		std::fill_n(final, 4, 0.f);
+		for (auto const& sample : samples) {
+			input->sample(u + dir_x * sample.first, v + dir_y * sample.first, px);
+			accumulate(final, px, sample.second);
+		}
+	});
+	return output;
+}
+
+std::shared_ptr<::gfx::blur::cpu_image>
+	gfx::blur::cpu::render_dual_filtering(std::shared_ptr<::gfx::blur::cpu_image> input)
+{
+	size_t levels = std::min<size_t>(size_t(round(_size)), MAX_LEVELS);
+
+	// Downsample
+	std::vector<std::shared_ptr<::gfx::blur::cpu_image>> chain;
+	chain.push_back(input);
+	for (size_t n = 1; n <= levels; n++) {
+		auto     src    = chain.back();
+		uint32_t width  = src->get_width() / 2;
+		uint32_t height = src->get_height() / 2;
+		if ((width <= 0) || (height <= 0))
+			break;
+
+		auto    dst = std::make_shared<::gfx::blur::cpu_image>(width, height);
+		float_t hx  = 0.5f / width;
+		float_t hy  = 0.5f / height;
+		process(dst, [&](float_t u, float_t v, float_t final[4]) {
+			float_t px[4];
+			src->sample(u, v, px);
+			std::fill_n(final, 4, 0.f);
+			accumulate(final, px, 4.f);
+			src->sample(u - hx, v - hy, px);
+			accumulate(final, px, 1.f);
+			src->sample(u + hx, v + hy, px);
+			accumulate(final, px, 1.f);
+			src->sample(u + hx, v - hy, px);
+			accumulate(final, px, 1.f);
+			src->sample(u - hx, v + hy, px);
+			accumulate(final, px, 1.f);
+			for (size_t c = 0; c < 4; c++)
+				final[c] *= 0.125f;
+		});
+		chain.push_back(dst);
+	}
+
+	// Upsample
+	std::shared_ptr<::gfx::blur::cpu_image> current = chain.back();
+	for (size_t n = chain.size() - 1; n > 0; n--) {
+		auto     src    = current;
+		uint32_t width  = src->get_width();
+		uint32_t height = src->get_height();
+		float_t  hx     = 0.5f / width;
+		float_t  hy     = 0.5f / height;
+
+		auto dst = std::make_shared<::gfx::blur::cpu_image>(width * 2, height * 2);
+		process(dst, [&](float_t u, float_t v, float_t final[4]) {
+			float_t px[4];
+			std::fill_n(final, 4, 0.f);
+			src->sample(u - hx * 2.f, v, px);
+			accumulate(final, px, 1.f);
+			src->sample(u - hx, v + hy, px);
+			accumulate(final, px, 2.f);
+			src->sample(u, v + hy * 2.f, px);
+			accumulate(final, px, 1.f);
+			src->sample(u + hx, v + hy, px);
+			accumulate(final, px, 2.f);
+			src->sample(u + hx * 2.f, v, px);
+			accumulate(final, px, 1.f);
+			src->sample(u + hx, v - hy, px);
+			accumulate(final, px, 2.f);
+			src->sample(u, v - hy * 2.f, px);
+			accumulate(final, px, 1.f);
+			src->sample(u - hx, v - hy, px);
+			accumulate(final, px, 2.f);
+			for (size_t c = 0; c < 4; c++)
+				final[c] /= 12.f;
+		});
+		current = dst;
+	}
+
+	return current;
+}
@@ -0,0 +1,204 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#pragma once
+#include <cinttypes>
+#include <memory>
+#include <vector>
+#include "gfx-blur-base.hpp"
+#include "obs/gs/gs-texture.hpp"
+
+namespace gfx {
+	namespace blur {
+		enum class cpu_algorithm : int64_t {
+			Box,
+			BoxLinear,
+			Gaussian,
+			GaussianLinear,
+			DualFiltering,
+		};
+
+		/*!
+		 * \brief Plain RGBA float image used by the CPU blur.
+		 *
+		 * Pixels are stored as four consecutive floats per texel, row by row.
+		 */
+		class cpu_image {
+			uint32_t             _width;
+			uint32_t             _height;
+			std::vector<float_t> _data;
+
+			public:
+			cpu_image(uint32_t width, uint32_t height);
+			virtual ~cpu_image();
+
+			uint32_t get_width();
+
+			uint32_t get_height();
+
+			float_t* get_data();
+
+			float_t* at(uint32_t x, uint32_t y);
+
+			/*!
+			 * \brief Bilinear sample with clamped addressing, identical to the 'linearSampler' in the blur effects.
+			 *
+			 * \param u Horizontal texture coordinate (0..1)
+			 * \param v Vertical texture coordinate (0..1)
+			 * \param out RGBA result
+			 */
+			void sample(float_t u, float_t v, float_t out[4]);
+		};
+
+		class cpu_factory : public ::gfx::blur::ifactory {
+			::gfx::blur::cpu_algorithm _algorithm;
+
+			public:
+			cpu_factory(::gfx::blur::cpu_algorithm algorithm);
+			virtual ~cpu_factory() override;
+
+			virtual bool is_type_supported(::gfx::blur::type type) override;
+
+			virtual std::shared_ptr<::gfx::blur::base> create(::gfx::blur::type type) override;
+
+			virtual double_t get_min_size(::gfx::blur::type type) override;
+
+			virtual double_t get_step_size(::gfx::blur::type type) override;
+
+			virtual double_t get_max_size(::gfx::blur::type type) override;
+
+			virtual double_t get_min_angle(::gfx::blur::type type) override;
+
+			virtual double_t get_step_angle(::gfx::blur::type type) override;
+
+			virtual double_t get_max_angle(::gfx::blur::type type) override;
+
+			virtual bool is_step_scale_supported(::gfx::blur::type type) override;
+
+			virtual double_t get_min_step_scale_x(::gfx::blur::type type) override;
+
+			virtual double_t get_step_step_scale_x(::gfx::blur::type type) override;
+
+			virtual double_t get_max_step_scale_x(::gfx::blur::type type) override;
+
+			virtual double_t get_min_step_scale_y(::gfx::blur::type type) override;
+
+			virtual double_t get_step_step_scale_y(::gfx::blur::type type) override;
+
+			virtual double_t get_max_step_scale_y(::gfx::blur::type type) override;
+
+			::gfx::blur::cpu_algorithm get_algorithm();
+
+			public: // Singleton
+			static ::gfx::blur::cpu_factory& get(::gfx::blur::cpu_algorithm algorithm);
+		};
+
+		/*!
+		 * \brief Reference implementation of the GPU blur engines on the CPU.
+		 *
+		 * Mirrors the math of the blur effects pass for pass, so it can be used to verify
+		 *  them and to blur without a graphics context. Images are supplied with
+		 *  set_input(cpu_image) and retrieved with render_image(). The gs::texture
+		 *  interface is still available, but requires a graphics context to transfer
+		 *  the data from and to the GPU.
+		 */
+		class cpu : public ::gfx::blur::base, public ::gfx::blur::base_angle, public ::gfx::blur::base_center {
+			::gfx::blur::cpu_algorithm _algorithm;
+			::gfx::blur::type          _type;
+
+			double_t                      _size;
+			std::pair<double_t, double_t> _step_scale;
+			double_t                      _angle;
+			std::pair<double_t, double_t> _center;
+
+			std::shared_ptr<::gfx::blur::cpu_image> _input_image;
+			std::shared_ptr<::gfx::blur::cpu_image> _output_image;
+
+			std::shared_ptr<::gs::texture> _input_texture;
+			std::shared_ptr<::gs::texture> _output_texture;
+
+			public:
+			cpu(::gfx::blur::cpu_algorithm algorithm, ::gfx::blur::type type);
+			virtual ~cpu() override;
+
+			virtual void set_input(std::shared_ptr<::gs::texture> texture) override;
+
+			virtual ::gfx::blur::type get_type() override;
+
+			virtual double_t get_size() override;
+
+			virtual void set_size(double_t width) override;
+
+			virtual void set_step_scale(double_t x, double_t y) override;
+
+			virtual void get_step_scale(double_t& x, double_t& y) override;
+
+			virtual double_t get_step_scale_x() override;
+
+			virtual double_t get_step_scale_y() override;
+
+			virtual std::shared_ptr<::gs::texture> render() override;
+
+			virtual std::shared_ptr<::gs::texture> get() override;
+
+			virtual double_t get_angle() override;
+
+			virtual void set_angle(double_t angle) override;
+
+			virtual void set_center(double_t x, double_t y) override;
+
+			virtual void get_center(double_t& x, double_t& y) override;
+
+			public /* CPU */:
+			void set_input(std::shared_ptr<::gfx::blur::cpu_image> image);
+
+			std::shared_ptr<::gfx::blur::cpu_image> render_image();
+
+			std::shared_ptr<::gfx::blur::cpu_image> get_image();
+
+			/*!
+			 * \brief Blur the input with the Gaussian a large Area blur approximates, at full resolution.
+			 *
+			 * Uses the standard deviation of the kernel the pyramid blurs with, scaled back up to input
+			 *  texels, so that render_image() can be measured against it. Identical to render_image()
+			 *  for sizes that do not need the pyramid. Only valid for Gaussian Area blurs.
+			 */
+			std::shared_ptr<::gfx::blur::cpu_image> render_exact();
+
+			private:
+			// One dimensional sample positions (in steps) and weights of the selected algorithm.
+			std::vector<std::pair<float_t, float_t>> get_samples(double_t size);
+
+			// Same as gaussian::get_pyramid_levels().
+			size_t get_pyramid_levels(std::shared_ptr<::gfx::blur::cpu_image> input);
+
+			std::shared_ptr<::gfx::blur::cpu_image>
+				render_area(std::shared_ptr<::gfx::blur::cpu_image>         input,
+							std::vector<std::pair<float_t, float_t>> const& samples);
+
+			std::shared_ptr<::gfx::blur::cpu_image> render_directional(std::shared_ptr<::gfx::blur::cpu_image> input,
+																	   double_t                                size);
+
+			std::shared_ptr<::gfx::blur::cpu_image> render_rotational(std::shared_ptr<::gfx::blur::cpu_image> input);
+
+			std::shared_ptr<::gfx::blur::cpu_image> render_zoom(std::shared_ptr<::gfx::blur::cpu_image> input);
+
+			std::shared_ptr<::gfx::blur::cpu_image>
+				render_dual_filtering(std::shared_ptr<::gfx::blur::cpu_image> input);
+		};
+	} // namespace blur
+} // namespace gfx
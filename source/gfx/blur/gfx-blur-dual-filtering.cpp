@@ -17,6 +17,7 @@
 
 #include "gfx-blur-dual-filtering.hpp"
 #include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-render-state.hpp"
 #include "plugin.hpp"
 #include "util-math.hpp"
 
@@ -57,8 +58,17 @@ gfx::blur::dual_filtering_data::dual_filtering_data()
 		char* file = obs_module_file("effects/blur/dual-filtering.effect");
 		_effect   = std::make_shared<::gs::effect>(file);
 		bfree(file);
+
+		_parameters.image.bind(*_effect, "pImage");
+		_parameters.image_size.bind(*_effect, "pImageSize");
+		_parameters.image_texel.bind(*_effect, "pImageTexel");
+		_parameters.image_half_texel.bind(*_effect, "pImageHalfTexel");
+	} catch (std::exception const& ex) {
+		P_LOG_ERROR("<gfx::blur::dual_filtering> Failed to load effect: %s", ex.what());
+		_effect.reset();
 	} catch (...) {
-		P_LOG_ERROR("<gfx::blur::box_linear> Failed to load _effect.");
+		P_LOG_ERROR("<gfx::blur::dual_filtering> Failed to load effect.");
+		_effect.reset();
 	}
 }
 
@@ -73,6 +83,11 @@ std::shared_ptr<::gs::effect> gfx::blur::dual_filtering_data::get_effect()
 	return _effect;
 }
 
+::gfx::blur::dual_filtering_data::parameters& gfx::blur::dual_filtering_data::get_parameters()
+{
+	return _parameters;
+}
+
 gfx::blur::dual_filtering_factory::dual_filtering_factory() {}
 
 gfx::blur::dual_filtering_factory::~dual_filtering_factory() {}
@@ -180,14 +195,9 @@ std::shared_ptr<::gfx::blur::dual_filtering_data> gfx::blur::dual_filtering_fact
 }
 
 gfx::blur::dual_filtering::dual_filtering()
-	: _data(::gfx::blur::dual_filtering_factory::get().data()), _size(0), _size_iterations(0)
-{
-	auto gctx = gs::context();
-	_rendertargets.resize(MAX_LEVELS + 1);
-	for (size_t n = 0; n <= MAX_LEVELS; n++) {
-		_rendertargets[n] = std::make_shared<gs::rendertarget>(GS_RGBA32F, GS_ZS_NONE);
-	}
-}
+	: _data(::gfx::blur::dual_filtering_factory::get().data()), _size(0), _size_iterations(0),
+	  _pool(gs::rendertarget_pool::get())
+{}
 
 gfx::blur::dual_filtering::~dual_filtering() {}
 
@@ -221,26 +231,20 @@ void gfx::blur::dual_filtering::get_step_scale(double_t&, double_t&) {}
 
 std::shared_ptr<::gs::texture> gfx::blur::dual_filtering::render()
 {
-	auto gctx   = gs::context();
-	auto effect = _data->get_effect();
+	auto  gctx   = gs::context();
+	auto  effect = _data->get_effect();
+	auto& params = _data->get_parameters();
 	if (!effect) {
 		return _input_texture;
 	}
 
 	size_t actual_iterations = _size_iterations;
 
-	gs_blend_state_push();
-	gs_reset_blend_state();
-	gs_enable_color(true, true, true, true);
-	gs_enable_blending(false);
-	gs_enable_depth_test(false);
-	gs_enable_stencil_test(false);
-	gs_enable_stencil_write(false);
-	gs_set_cull_mode(GS_NEITHER);
-	gs_depth_function(GS_ALWAYS);
-	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-	gs_stencil_function(GS_STENCIL_BOTH, GS_ALWAYS);
-	gs_stencil_op(GS_STENCIL_BOTH, GS_ZERO, GS_ZERO, GS_ZERO);
+	// Levels are only needed while rendering, only the output is kept until the next render.
+	std::vector<std::shared_ptr<gs::rendertarget>> levels(actual_iterations + 1);
+	_rendertarget.reset();
+
+	auto state = ::gs::render_state::opaque().apply();
 
 	// Downsample
 	for (size_t n = 1; n <= actual_iterations; n++) {
@@ -249,7 +253,7 @@ std::shared_ptr<::gs::texture> gfx::blur::dual_filtering::render()
 		// Select Texture
 		std::shared_ptr<gs::texture> tex_cur;
 		if (n > 1) {
-			tex_cur = _rendertargets[n - 1]->get_texture();
+			tex_cur = levels[n - 1]->get_texture();
 		} else {
 			tex_cur = _input_texture;
 		}
@@ -263,16 +267,17 @@ std::shared_ptr<::gs::texture> gfx::blur::dual_filtering::render()
 		}
 
 		// Apply
-		effect->get_parameter("pImage")->set_texture(tex_cur);
-		effect->get_parameter("pImageSize")->set_float2(float_t(width), float_t(height));
-		effect->get_parameter("pImageTexel")->set_float2(1.0f / width, 1.0f / height);
-		effect->get_parameter("pImageHalfTexel")->set_float2(0.5f / width, 0.5f / height);
+		params.image.set(tex_cur);
+		params.image_size.set(float_t(width), float_t(height));
+		params.image_texel.set(1.0f / width, 1.0f / height);
+		params.image_half_texel.set(0.5f / width, 0.5f / height);
 
+		levels[n] = _pool->acquire(width, height, GS_RGBA32F);
 		{
-			auto op = _rendertargets[n]->render(width, height);
+			auto op = levels[n]->render(width, height);
 			gs_ortho(0., 1., 0., 1., 0., 1.);
 			while (gs_effect_loop(effect->get_object(), "Down")) {
-				gs_draw_sprite(tex_cur->get_object(), 0, 1, 1);
+				gs::draw_sprite(tex_cur->get_object(), 0, 1, 1);
 			}
 		}
 	}
@@ -280,37 +285,42 @@ std::shared_ptr<::gs::texture> gfx::blur::dual_filtering::render()
 	// Upsample
 	for (size_t n = actual_iterations; n > 0; n--) {
 		// Select Texture
-		std::shared_ptr<gs::texture> tex_cur = _rendertargets[n]->get_texture();
+		std::shared_ptr<gs::texture> tex_cur = levels[n]->get_texture();
 
 		// Get Size
 		uint32_t width  = tex_cur->get_width();
 		uint32_t height = tex_cur->get_height();
 
 		// Apply
-		effect->get_parameter("pImage")->set_texture(tex_cur);
-		effect->get_parameter("pImageSize")->set_float2(float_t(width), float_t(height));
-		effect->get_parameter("pImageTexel")->set_float2(1.0f / width, 1.0f / height);
-		effect->get_parameter("pImageHalfTexel")->set_float2(0.5f / width, 0.5f / height);
+		params.image.set(tex_cur);
+		params.image_size.set(float_t(width), float_t(height));
+		params.image_texel.set(1.0f / width, 1.0f / height);
+		params.image_half_texel.set(0.5f / width, 0.5f / height);
 
 		// Increase Size
 		width *= 2;
 		height *= 2;
 
+		// The downsampled content of the target level is no longer needed, so it may be reused.
+		levels[n - 1].reset();
+		levels[n - 1] = _pool->acquire(width, height, GS_RGBA32F);
 		{
-			auto op = _rendertargets[n - 1]->render(width, height);
+			auto op = levels[n - 1]->render(width, height);
 			gs_ortho(0., 1., 0., 1., 0., 1.);
 			while (gs_effect_loop(effect->get_object(), "Up")) {
-				gs_draw_sprite(tex_cur->get_object(), 0, 1, 1);
+				gs::draw_sprite(tex_cur->get_object(), 0, 1, 1);
 			}
 		}
+		levels[n].reset();
 	}
 
-	gs_blend_state_pop();
-
-	return _rendertargets[0]->get_texture();
+	_rendertarget = levels[0];
+	return this->get();
 }
 
 std::shared_ptr<::gs::texture> gfx::blur::dual_filtering::get()
 {
-	return _rendertargets[0]->get_texture();
+	if (!_rendertarget)
+		return _input_texture;
+	return _rendertarget->get_texture();
 }
@@ -22,19 +22,32 @@
 #include <vector>
 #include "gfx-blur-base.hpp"
 #include "obs/gs/gs-effect.hpp"
+#include "obs/gs/gs-rendertarget-pool.hpp"
 #include "obs/gs/gs-rendertarget.hpp"
 #include "obs/gs/gs-texture.hpp"
 
 namespace gfx {
 	namespace blur {
 		class dual_filtering_data {
-			std::shared_ptr<::gs::effect> _effect;
+			public:
+			struct parameters {
+				::gs::texture_parameter image;
+				::gs::float2_parameter  image_size;
+				::gs::float2_parameter  image_texel;
+				::gs::float2_parameter  image_half_texel;
+			};
+
+			private:
+			std::shared_ptr<::gs::effect>                _effect;
+			::gfx::blur::dual_filtering_data::parameters _parameters;
 
 			public:
 			dual_filtering_data();
 			virtual ~dual_filtering_data();
 
 			std::shared_ptr<::gs::effect> get_effect();
+
+			::gfx::blur::dual_filtering_data::parameters& get_parameters();
 		};
 
 		class dual_filtering_factory : public ::gfx::blur::ifactory {
@@ -89,7 +102,10 @@ namespace gfx {
 
 			std::shared_ptr<gs::texture> _input_texture;
 
-			std::vector<std::shared_ptr<gs::rendertarget>> _rendertargets;
+			std::shared_ptr<gs::rendertarget_pool> _pool;
+
+			// Output of the last render, held until the next one.
+			std::shared_ptr<gs::rendertarget> _rendertarget;
 
 			public:
 			dual_filtering();
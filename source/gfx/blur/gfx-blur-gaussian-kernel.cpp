@@ -0,0 +1,116 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "gfx-blur-gaussian-kernel.hpp"
+#include <chrono>
+#include "plugin.hpp"
+#include "util-math.hpp"
+
+#define MAX_KERNEL_SIZE 128
+#define MAX_BLUR_SIZE (MAX_KERNEL_SIZE - 1)
+#define KERNEL_THRESHOLD double_t(1. / (MAX_KERNEL_SIZE * 5))
+#define KERNEL_EXTENSION 1
+#define SOLVE_ITERATIONS 16
+
+gfx::blur::gaussian_kernel_table::gaussian_kernel_table() : _kernels(MAX_BLUR_SIZE) {}
+
+gfx::blur::gaussian_kernel_table::~gaussian_kernel_table() {}
+
+std::vector<float_t> const& gfx::blur::gaussian_kernel_table::get_kernel(size_t width)
+{
+	if (width < 1)
+		width = 1;
+	if (width > MAX_BLUR_SIZE)
+		width = MAX_BLUR_SIZE;
+
+	std::unique_lock<std::mutex> ul(_lock);
+	std::vector<float_t>&        kernel = _kernels[width - 1];
+	if (kernel.size() != 0)
+		return kernel;
+
+	auto                  start = std::chrono::high_resolution_clock::now();
+	std::vector<double_t> kernel_math(MAX_KERNEL_SIZE);
+	std::vector<float_t>  kernel_data(MAX_KERNEL_SIZE);
+	double_t              sigma = get_sigma(width);
+
+	// Calculate and normalize
+	double_t sum = 0;
+	for (size_t p = 0; p <= width; p++) {
+		kernel_math[p] = util::math::gaussian<double_t>(double_t(p), sigma);
+		sum += kernel_math[p] * (p > 0 ? 2 : 1);
+	}
+
+	// Normalize to fill the entire 0..1 range over the width.
+	double_t inverse_sum = 1.0 / sum;
+	for (size_t p = 0; p <= width; p++) {
+		kernel_data[p] = float_t(kernel_math[p] * inverse_sum);
+	}
+	kernel = std::move(kernel_data);
+
+	P_LOG_DEBUG("<gfx::blur::gaussian_kernel_table> Calculated kernel for width %zu (sigma %f) in %lld ns.", width,
+				sigma,
+				static_cast<long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+										   std::chrono::high_resolution_clock::now() - start)
+										   .count()));
+	return kernel;
+}
+
+double_t gfx::blur::gaussian_kernel_table::get_sigma(size_t width)
+{
+	// ln g(x, o) = -x² / (2o²) - ln(o√(2Π)) rises monotonically for 0 < o < x, so Newton's
+	//  method started left of the root converges on the smaller solution within a few steps.
+	static const double_t ln_two_pi_sqroot = log(2.506628274631000502415765284811);
+	const double_t        ln_threshold     = log(KERNEL_THRESHOLD);
+	const double_t        x                = double_t(width + KERNEL_EXTENSION);
+	const double_t        x2               = x * x;
+
+	double_t sigma = x / sqrt(-2. * ln_threshold);
+	for (size_t n = 0; n < SOLVE_ITERATIONS; n++) {
+		double_t f     = -x2 / (2. * sigma * sigma) - log(sigma) - ln_two_pi_sqroot - ln_threshold;
+		double_t df    = x2 / (sigma * sigma * sigma) - 1. / sigma;
+		double_t delta = f / df;
+		sigma -= delta;
+		if (std::abs(delta) < 1e-9)
+			break;
+	}
+	return sigma;
+}
+
+double_t gfx::blur::gaussian_kernel_table::get_scaled_width(double_t width, double_t scale)
+{
+	if ((scale >= 1.) || (width < 1.) || (width >= double_t(MAX_BLUR_SIZE + 1)))
+		return width * scale;
+
+	// Pick the width with the closest standard deviation, which only grows with the width.
+	double_t sigma      = get_sigma(size_t(width)) * scale;
+	size_t   best_width = 1;
+	double_t best_error = std::abs(get_sigma(1) - sigma);
+	for (size_t candidate = 2; candidate <= size_t(width); candidate++) {
+		double_t error = std::abs(get_sigma(candidate) - sigma);
+		if (error >= best_error)
+			break;
+		best_width = candidate;
+		best_error = error;
+	}
+	return double_t(best_width);
+}
+
+::gfx::blur::gaussian_kernel_table& gfx::blur::gaussian_kernel_table::get()
+{
+	static ::gfx::blur::gaussian_kernel_table instance;
+	return instance;
+}
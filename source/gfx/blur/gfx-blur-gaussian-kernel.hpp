@@ -0,0 +1,66 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#pragma once
+#include <cinttypes>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+namespace gfx {
+	namespace blur {
+		/*!
+		 * \brief Gaussian kernels shared by all Gaussian blur engines.
+		 *
+		 * Kernels are calculated the first time a width is requested and stay valid for the
+		 *  lifetime of the process. Each kernel holds 128 weights, of which only the first
+		 *  width + 1 are non-zero, normalized so that center + 2 * sides add up to 1.
+		 */
+		class gaussian_kernel_table {
+			std::mutex                        _lock;
+			std::vector<std::vector<float_t>> _kernels;
+
+			public:
+			gaussian_kernel_table();
+			~gaussian_kernel_table();
+
+			/*!
+			 * \brief Get the kernel for a given width, clamped to 1..127.
+			 */
+			std::vector<float_t> const& get_kernel(size_t width);
+
+			/*!
+			 * \brief Standard deviation at which the Gaussian reaches the kernel threshold just past width.
+			 *
+			 * Solves g(width + 1, sigma) = threshold for the smaller of the two solutions, which
+			 *  previously was found by brute-force search.
+			 */
+			static double_t get_sigma(size_t width);
+
+			/*!
+			 * \brief Width whose kernel is the kernel of the given width scaled by a factor below one.
+			 *
+			 * The standard deviation grows faster than the width, so scaling the width itself gives
+			 *  a narrower blur. Widths outside the table are scaled as they are.
+			 */
+			static double_t get_scaled_width(double_t width, double_t scale);
+
+			public: // Singleton
+			static ::gfx::blur::gaussian_kernel_table& get();
+		};
+	} // namespace blur
+} // namespace gfx
@@ -16,7 +16,9 @@
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
 
 #include "gfx-blur-gaussian-linear.hpp"
+#include "gfx-blur-gaussian-kernel.hpp"
 #include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-render-state.hpp"
 #include "util-math.hpp"
 
 #ifdef _MSC_VER
@@ -29,16 +31,8 @@
 #pragma warning(pop)
 #endif
 
-// FIXME: This breaks when MAX_KERNEL_SIZE is changed, due to the way the Gaussian
-//  function first goes up at the point, and then once we pass the critical point
-//  will go down again and it is not handled well. This is a pretty basic
-//  approximation anyway at the moment.
 #define MAX_KERNEL_SIZE 128
 #define MAX_BLUR_SIZE (MAX_KERNEL_SIZE - 1)
-#define SEARCH_DENSITY double_t(1. / 500.)
-#define SEARCH_THRESHOLD double_t(1. / (MAX_KERNEL_SIZE * 5))
-#define SEARCH_EXTENSION 1
-#define SEARCH_RANGE MAX_KERNEL_SIZE * 2
 
 gfx::blur::gaussian_linear_data::gaussian_linear_data()
 {
@@ -49,36 +43,6 @@ gfx::blur::gaussian_linear_data::gaussian_linear_data()
 		_effect   = gs::effect::create(file);
 		bfree(file);
 	}
-
-	// Precalculate Kernels
-	for (size_t kernel_size = 1; kernel_size <= MAX_BLUR_SIZE; kernel_size++) {
-		std::vector<double_t> kernel_math(MAX_KERNEL_SIZE);
-		std::vector<float_t>  kernel_data(MAX_KERNEL_SIZE);
-		double_t              actual_width = 1.;
-
-		// Find actual kernel width.
-		for (double_t h = SEARCH_DENSITY; h < SEARCH_RANGE; h += SEARCH_DENSITY) {
-			if (util::math::gaussian<double_t>(double_t(kernel_size + SEARCH_EXTENSION), h) > SEARCH_THRESHOLD) {
-				actual_width = h;
-				break;
-			}
-		}
-
-		// Calculate and normalize
-		double_t sum = 0;
-		for (size_t p = 0; p <= kernel_size; p++) {
-			kernel_math[p] = util::math::gaussian<double_t>(double_t(p), actual_width);
-			sum += kernel_math[p] * (p > 0 ? 2 : 1);
-		}
-
-		// Normalize to fill the entire 0..1 range over the width.
-		double_t inverse_sum = 1.0 / sum;
-		for (size_t p = 0; p <= kernel_size; p++) {
-			kernel_data.at(p) = float_t(kernel_math[p] * inverse_sum);
-		}
-
-		_kernels.push_back(std::move(kernel_data));
-	}
 }
 
 gfx::blur::gaussian_linear_data::~gaussian_linear_data()
@@ -93,12 +57,7 @@ std::shared_ptr<::gs::effect> gfx::blur::gaussian_linear_data::get_effect()
 
 std::vector<float_t> const& gfx::blur::gaussian_linear_data::get_kernel(size_t width)
 {
-	if (width < 1)
-		width = 1;
-	if (width > MAX_BLUR_SIZE)
-		width = MAX_BLUR_SIZE;
-	width -= 1;
-	return _kernels[width];
+	return ::gfx::blur::gaussian_kernel_table::get().get_kernel(width);
 }
 
 gfx::blur::gaussian_linear_factory::gaussian_linear_factory() {}
@@ -232,13 +191,9 @@ std::shared_ptr<::gfx::blur::gaussian_linear_data> gfx::blur::gaussian_linear_fa
 }
 
 gfx::blur::gaussian_linear::gaussian_linear()
-	: _data(::gfx::blur::gaussian_linear_factory::get().data()), _size(1.), _step_scale({1., 1.})
-{
-	auto gctx = gs::context();
-
-	_rendertarget  = std::make_shared<gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-	_rendertarget2 = std::make_shared<gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-}
+	: _data(::gfx::blur::gaussian_linear_factory::get().data()), _size(1.), _step_scale({1., 1.}),
+	  _pool(::gs::rendertarget_pool::get())
+{}
 
 gfx::blur::gaussian_linear::~gaussian_linear() {}
 
@@ -303,62 +258,56 @@ std::shared_ptr<::gs::texture> gfx::blur::gaussian_linear::render()
 	float_t height = float_t(_input_texture->get_height());
 
 	// Setup
-	gs_set_cull_mode(GS_NEITHER);
-	gs_enable_color(true, true, true, true);
-	gs_enable_depth_test(false);
-	gs_depth_function(GS_ALWAYS);
-	gs_blend_state_push();
-	gs_reset_blend_state();
-	gs_enable_blending(false);
-	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-	gs_enable_stencil_test(false);
-	gs_enable_stencil_write(false);
-	gs_stencil_function(GS_STENCIL_BOTH, GS_ALWAYS);
-	gs_stencil_op(GS_STENCIL_BOTH, GS_ZERO, GS_ZERO, GS_ZERO);
-
-	effect->get_parameter("pImage")->set_texture(_input_texture);
-	effect->get_parameter("pStepScale")->set_float2(float_t(_step_scale.first), float_t(_step_scale.second));
-	effect->get_parameter("pSize")->set_float(float_t(_size));
-	effect->get_parameter("pKernel")->set_float_array(kernel.data(), MAX_KERNEL_SIZE);
+	auto state = ::gs::render_state::opaque().apply();
+
+	effect->find_parameter("pImage")->set_texture(_input_texture);
+	effect->find_parameter("pStepScale")->set_float2(float_t(_step_scale.first), float_t(_step_scale.second));
+	effect->find_parameter("pSize")->set_float(float_t(_size));
+	effect->find_parameter("pKernel")->set_float_array(kernel.data(), MAX_KERNEL_SIZE);
+
+	// The previous output is no longer needed, return it to the pool first so that it can be reused.
+	_rendertarget.reset();
 
 	// First Pass
 	if (_step_scale.first > std::numeric_limits<double_t>::epsilon()) {
-		effect->get_parameter("pImageTexel")->set_float2(float_t(1.f / width), 0.f);
+		effect->find_parameter("pImageTexel")->set_float2(float_t(1.f / width), 0.f);
 
+		auto target = _pool->acquire(uint32_t(width), uint32_t(height), GS_RGBA);
 		{
-			auto op = _rendertarget2->render(uint32_t(width), uint32_t(height));
+			auto op = target->render(uint32_t(width), uint32_t(height));
 			gs_ortho(0, 1., 0, 1., 0, 1.);
 			while (gs_effect_loop(effect->get_object(), "Draw")) {
-				gs_draw_sprite(nullptr, 0, 1, 1);
+				gs::draw_sprite(nullptr, 0, 1, 1);
 			}
 		}
 
-		std::swap(_rendertarget, _rendertarget2);
-		effect->get_parameter("pImage")->set_texture(_rendertarget->get_texture());
+		_rendertarget = target;
+		effect->find_parameter("pImage")->set_texture(_rendertarget->get_texture());
 	}
 
 	// Second Pass
 	if (_step_scale.second > std::numeric_limits<double_t>::epsilon()) {
-		effect->get_parameter("pImageTexel")->set_float2(0.f, float_t(1.f / height));
+		effect->find_parameter("pImageTexel")->set_float2(0.f, float_t(1.f / height));
 
+		auto target = _pool->acquire(uint32_t(width), uint32_t(height), GS_RGBA);
 		{
-			auto op = _rendertarget2->render(uint32_t(width), uint32_t(height));
+			auto op = target->render(uint32_t(width), uint32_t(height));
 			gs_ortho(0, 1., 0, 1., 0, 1.);
 			while (gs_effect_loop(effect->get_object(), "Draw")) {
-				gs_draw_sprite(nullptr, 0, 1, 1);
+				gs::draw_sprite(nullptr, 0, 1, 1);
 			}
 		}
 
-		std::swap(_rendertarget, _rendertarget2);
+		_rendertarget = target;
 	}
 
-	gs_blend_state_pop();
-
 	return this->get();
 }
 
 std::shared_ptr<::gs::texture> gfx::blur::gaussian_linear::get()
 {
+	if (!_rendertarget)
+		return _input_texture;
 	return _rendertarget->get_texture();
 }
 
@@ -396,36 +345,25 @@ std::shared_ptr<::gs::texture> gfx::blur::gaussian_linear_directional::render()
 	float_t height = float_t(_input_texture->get_height());
 
 	// Setup
-	gs_set_cull_mode(GS_NEITHER);
-	gs_enable_color(true, true, true, true);
-	gs_enable_depth_test(false);
-	gs_depth_function(GS_ALWAYS);
-	gs_blend_state_push();
-	gs_reset_blend_state();
-	gs_enable_blending(false);
-	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-	gs_enable_stencil_test(false);
-	gs_enable_stencil_write(false);
-	gs_stencil_function(GS_STENCIL_BOTH, GS_ALWAYS);
-	gs_stencil_op(GS_STENCIL_BOTH, GS_ZERO, GS_ZERO, GS_ZERO);
-
-	effect->get_parameter("pImage")->set_texture(_input_texture);
-	effect->get_parameter("pImageTexel")
+	auto state = ::gs::render_state::opaque().apply();
+
+	effect->find_parameter("pImage")->set_texture(_input_texture);
+	effect->find_parameter("pImageTexel")
 		->set_float2(float_t(1.f / width * cos(_angle)), float_t(1.f / height * sin(_angle)));
-	effect->get_parameter("pStepScale")->set_float2(float_t(_step_scale.first), float_t(_step_scale.second));
-	effect->get_parameter("pSize")->set_float(float_t(_size));
-	effect->get_parameter("pKernel")->set_float_array(kernel.data(), MAX_KERNEL_SIZE);
+	effect->find_parameter("pStepScale")->set_float2(float_t(_step_scale.first), float_t(_step_scale.second));
+	effect->find_parameter("pSize")->set_float(float_t(_size));
+	effect->find_parameter("pKernel")->set_float_array(kernel.data(), MAX_KERNEL_SIZE);
 
 	// First Pass
+	_rendertarget.reset();
+	_rendertarget = _pool->acquire(uint32_t(width), uint32_t(height), GS_RGBA);
 	{
 		auto op = _rendertarget->render(uint32_t(width), uint32_t(height));
 		gs_ortho(0, 1., 0, 1., 0, 1.);
 		while (gs_effect_loop(effect->get_object(), "Draw")) {
-			gs_draw_sprite(nullptr, 0, 1, 1);
+			gs::draw_sprite(nullptr, 0, 1, 1);
 		}
 	}
 
-	gs_blend_state_pop();
-
 	return this->get();
 }
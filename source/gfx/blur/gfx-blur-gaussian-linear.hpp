@@ -20,14 +20,14 @@
 #include <vector>
 #include "gfx-blur-base.hpp"
 #include "obs/gs/gs-effect.hpp"
+#include "obs/gs/gs-rendertarget-pool.hpp"
 #include "obs/gs/gs-rendertarget.hpp"
 #include "obs/gs/gs-texture.hpp"
 
 namespace gfx {
 	namespace blur {
 		class gaussian_linear_data {
-			std::shared_ptr<::gs::effect>     _effect;
-			std::vector<std::vector<float_t>> _kernels;
+			std::shared_ptr<::gs::effect> _effect;
 
 			public:
 			gaussian_linear_data();
@@ -86,13 +86,13 @@ namespace gfx {
 			protected:
 			std::shared_ptr<::gfx::blur::gaussian_linear_data> _data;
 
-			double_t                            _size;
-			std::pair<double_t, double_t>       _step_scale;
-			std::shared_ptr<::gs::texture>      _input_texture;
-			std::shared_ptr<::gs::rendertarget> _rendertarget;
+			double_t                                 _size;
+			std::pair<double_t, double_t>            _step_scale;
+			std::shared_ptr<::gs::texture>           _input_texture;
+			std::shared_ptr<::gs::rendertarget_pool> _pool;
 
-			private:
-			std::shared_ptr<::gs::rendertarget> _rendertarget2;
+			// Output of the last render, held until the next one.
+			std::shared_ptr<::gs::rendertarget> _rendertarget;
 
 			public:
 			gaussian_linear();
@@ -16,7 +16,9 @@
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
 
 #include "gfx-blur-gaussian.hpp"
+#include "gfx-blur-gaussian-kernel.hpp"
 #include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-render-state.hpp"
 #include "plugin.hpp"
 #include "util-math.hpp"
 
@@ -30,16 +32,10 @@
 #pragma warning(pop)
 #endif
 
-// FIXME: This breaks when MAX_KERNEL_SIZE is changed, due to the way the Gaussian
-//  function first goes up at the point, and then once we pass the critical point
-//  will go down again and it is not handled well. This is a pretty basic
-//  approximation anyway at the moment.
 #define MAX_KERNEL_SIZE 128
 #define MAX_BLUR_SIZE (MAX_KERNEL_SIZE - 1)
-#define SEARCH_DENSITY double_t(1. / 500.)
-#define SEARCH_THRESHOLD double_t(1. / (MAX_KERNEL_SIZE * 5))
-#define SEARCH_EXTENSION 1
-#define SEARCH_RANGE MAX_KERNEL_SIZE * 2
+#define MAX_LARGE_BLUR_SIZE 1024
+#define LARGE_BLUR_BASE_SIZE 32
 
 gfx::blur::gaussian_data::gaussian_data()
 {
@@ -50,35 +46,13 @@ gfx::blur::gaussian_data::gaussian_data()
 		bfree(file);
 	}
 
-	// Precalculate Kernels
-	for (size_t kernel_size = 1; kernel_size <= MAX_BLUR_SIZE; kernel_size++) {
-		std::vector<double_t> kernel_math(MAX_KERNEL_SIZE);
-		std::vector<float_t>  kernel_data(MAX_KERNEL_SIZE);
-		double_t              actual_width = 1.;
-
-		// Find actual kernel width.
-		for (double_t h = SEARCH_DENSITY; h < SEARCH_RANGE; h += SEARCH_DENSITY) {
-			if (util::math::gaussian<double_t>(double_t(kernel_size + SEARCH_EXTENSION), h) > SEARCH_THRESHOLD) {
-				actual_width = h;
-				break;
-			}
-		}
-
-		// Calculate and normalize
-		double_t sum = 0;
-		for (size_t p = 0; p <= kernel_size; p++) {
-			kernel_math[p] = util::math::gaussian<double_t>(double_t(p), actual_width);
-			sum += kernel_math[p] * (p > 0 ? 2 : 1);
-		}
-
-		// Normalize to fill the entire 0..1 range over the width.
-		double_t inverse_sum = 1.0 / sum;
-		for (size_t p = 0; p <= kernel_size; p++) {
-			kernel_data.at(p) = float_t(kernel_math[p] * inverse_sum);
-		}
-
-		_kernels.push_back(std::move(kernel_data));
-	}
+	_parameters.image.bind(*_effect, "pImage");
+	_parameters.image_texel.bind(*_effect, "pImageTexel");
+	_parameters.size.bind(*_effect, "pSize");
+	_parameters.angle.bind(*_effect, "pAngle");
+	_parameters.center.bind(*_effect, "pCenter");
+	_parameters.step_scale.bind(*_effect, "pStepScale");
+	_parameters.kernel.bind(*_effect, "pKernel");
 }
 
 gfx::blur::gaussian_data::~gaussian_data()
@@ -92,14 +66,14 @@ std::shared_ptr<::gs::effect> gfx::blur::gaussian_data::get_effect()
 	return _effect;
 }
 
+::gfx::blur::gaussian_data::parameters& gfx::blur::gaussian_data::get_parameters()
+{
+	return _parameters;
+}
+
 std::vector<float_t> const& gfx::blur::gaussian_data::get_kernel(size_t width)
 {
-	if (width < 1)
-		width = 1;
-	if (width > MAX_BLUR_SIZE)
-		width = MAX_BLUR_SIZE;
-	width -= 1;
-	return _kernels[width];
+	return ::gfx::blur::gaussian_kernel_table::get().get_kernel(width);
 }
 
 gfx::blur::gaussian_factory::gaussian_factory() {}
@@ -148,9 +122,15 @@ double_t gfx::blur::gaussian_factory::get_step_size(::gfx::blur::type)
 	return double_t(1.0);
 }
 
-double_t gfx::blur::gaussian_factory::get_max_size(::gfx::blur::type)
+double_t gfx::blur::gaussian_factory::get_max_size(::gfx::blur::type v)
 {
-	return double_t(MAX_BLUR_SIZE);
+	switch (v) {
+	case ::gfx::blur::type::Area:
+		// Halving both axes would also blur across a Directional blur, so only Area blurs get large sizes.
+		return double_t(MAX_LARGE_BLUR_SIZE);
+	default:
+		return double_t(MAX_BLUR_SIZE);
+	}
 }
 
 double_t gfx::blur::gaussian_factory::get_min_angle(::gfx::blur::type v)
@@ -240,12 +220,9 @@ std::shared_ptr<::gfx::blur::gaussian_data> gfx::blur::gaussian_factory::data()
 }
 
 gfx::blur::gaussian::gaussian()
-	: _data(::gfx::blur::gaussian_factory::get().data()), _size(1.), _step_scale({1., 1.})
-{
-	auto gctx       = gs::context();
-	_rendertarget  = std::make_shared<gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-	_rendertarget2 = std::make_shared<gs::rendertarget>(GS_RGBA, GS_ZS_NONE);
-}
+	: _data(::gfx::blur::gaussian_factory::get().data()), _size(1.), _step_scale({1., 1.}),
+	  _pool(::gs::rendertarget_pool::get()), _upsampled(false)
+{}
 
 gfx::blur::gaussian::~gaussian() {}
 
@@ -266,10 +243,11 @@ double_t gfx::blur::gaussian::get_size()
 
 void gfx::blur::gaussian::set_size(double_t width)
 {
+	double_t max_size = ::gfx::blur::gaussian_factory::get().get_max_size(get_type());
 	if (width < 1.)
 		width = 1.;
-	if (width > MAX_BLUR_SIZE)
-		width = MAX_BLUR_SIZE;
+	if (width > max_size)
+		width = max_size;
 	_size = width;
 }
 
@@ -300,75 +278,152 @@ std::shared_ptr<::gs::texture> gfx::blur::gaussian::render()
 	auto gctx = gs::context();
 
 	std::shared_ptr<::gs::effect> effect = _data->get_effect();
-	auto                          kernel = _data->get_kernel(size_t(_size));
+	auto&                         params = _data->get_parameters();
+	size_t                        levels = get_pyramid_levels();
+	double_t                      size   = _size / double_t(size_t(1) << levels);
+	auto                          kernel = _data->get_kernel(size_t(size));
 
 	if (!effect || ((_step_scale.first + _step_scale.second) < std::numeric_limits<double_t>::epsilon())) {
+		// get() must not hand out the result of an earlier, larger blur.
+		_upsampled = false;
+		_upsample_rendertarget.reset();
 		return _input_texture;
 	}
 
-	float_t width  = float_t(_input_texture->get_width());
-	float_t height = float_t(_input_texture->get_height());
-
 	// Setup
-	gs_set_cull_mode(GS_NEITHER);
-	gs_enable_color(true, true, true, true);
-	gs_enable_depth_test(false);
-	gs_depth_function(GS_ALWAYS);
-	gs_blend_state_push();
-	gs_reset_blend_state();
-	gs_enable_blending(false);
-	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-	gs_enable_stencil_test(false);
-	gs_enable_stencil_write(false);
-	gs_stencil_function(GS_STENCIL_BOTH, GS_ALWAYS);
-	gs_stencil_op(GS_STENCIL_BOTH, GS_ZERO, GS_ZERO, GS_ZERO);
-
-	effect->get_parameter("pImage")->set_texture(_input_texture);
-	effect->get_parameter("pStepScale")->set_float2(float_t(_step_scale.first), float_t(_step_scale.second));
-	effect->get_parameter("pSize")->set_float(float_t(_size));
-	effect->get_parameter("pKernel")->set_float_array(kernel.data(), MAX_KERNEL_SIZE);
+	auto state = ::gs::render_state::opaque().apply();
+
+	std::shared_ptr<::gs::texture> input  = downsample(levels);
+	float_t                        width  = float_t(input->get_width());
+	float_t                        height = float_t(input->get_height());
+
+	params.image.set(input);
+	params.step_scale.set(float_t(_step_scale.first), float_t(_step_scale.second));
+	params.size.set(float_t(size));
+	params.kernel.set_array(kernel.data(), MAX_KERNEL_SIZE);
+
+	// The previous output is no longer needed, return it to the pool first so that it can be reused.
+	_rendertarget.reset();
 
 	// First Pass
 	if (_step_scale.first > std::numeric_limits<double_t>::epsilon()) {
-		effect->get_parameter("pImageTexel")->set_float2(float_t(1.f / width), 0.f);
+		params.image_texel.set(float_t(1.f / width), 0.f);
 
+		auto target = _pool->acquire(uint32_t(width), uint32_t(height), GS_RGBA);
 		{
-			auto op = _rendertarget2->render(uint32_t(width), uint32_t(height));
+			auto op = target->render(uint32_t(width), uint32_t(height));
 			gs_ortho(0, 1., 0, 1., 0, 1.);
 			while (gs_effect_loop(effect->get_object(), "Draw")) {
-				gs_draw_sprite(nullptr, 0, 1, 1);
+				gs::draw_sprite(nullptr, 0, 1, 1);
 			}
 		}
 
-		std::swap(_rendertarget, _rendertarget2);
-		effect->get_parameter("pImage")->set_texture(_rendertarget->get_texture());
+		_rendertarget = target;
+		params.image.set(_rendertarget->get_texture());
 	}
 
 	// Second Pass
 	if (_step_scale.second > std::numeric_limits<double_t>::epsilon()) {
-		effect->get_parameter("pImageTexel")->set_float2(0.f, float_t(1.f / height));
+		params.image_texel.set(0.f, float_t(1.f / height));
 
+		auto target = _pool->acquire(uint32_t(width), uint32_t(height), GS_RGBA);
 		{
-			auto op = _rendertarget2->render(uint32_t(width), uint32_t(height));
+			auto op = target->render(uint32_t(width), uint32_t(height));
 			gs_ortho(0, 1., 0, 1., 0, 1.);
 			while (gs_effect_loop(effect->get_object(), "Draw")) {
-				gs_draw_sprite(nullptr, 0, 1, 1);
+				gs::draw_sprite(nullptr, 0, 1, 1);
 			}
 		}
 
-		std::swap(_rendertarget, _rendertarget2);
+		_rendertarget = target;
 	}
 
-	gs_blend_state_pop();
+	upsample(levels);
 
 	return this->get();
 }
 
 std::shared_ptr<::gs::texture> gfx::blur::gaussian::get()
 {
+	if (_upsampled)
+		return _upsample_rendertarget->get_texture();
+	if (!_rendertarget)
+		return _input_texture;
 	return _rendertarget->get_texture();
 }
 
+size_t gfx::blur::gaussian::get_pyramid_levels()
+{
+	if ((_size <= MAX_BLUR_SIZE) || !_input_texture)
+		return 0;
+
+	// Halve until the remaining size is at most LARGE_BLUR_BASE_SIZE, but keep at least one texel.
+	size_t   levels = size_t(ceil(log2(_size / LARGE_BLUR_BASE_SIZE)));
+	uint32_t width  = _input_texture->get_width();
+	uint32_t height = _input_texture->get_height();
+	while ((levels > 0) && (((width >> levels) == 0) || ((height >> levels) == 0))) {
+		levels--;
+	}
+	return levels;
+}
+
+std::shared_ptr<::gs::texture> gfx::blur::gaussian::downsample(size_t levels)
+{
+	std::shared_ptr<::gs::texture> texture = _input_texture;
+	gs_effect_t*                   effect  = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+
+	_pyramid.clear();
+
+	// A bilinear sample in the center of each target texel averages 2x2 source texels.
+	for (size_t n = 0; n < levels; n++) {
+		uint32_t width  = texture->get_width() / 2;
+		uint32_t height = texture->get_height() / 2;
+
+		_pyramid.push_back(_pool->acquire(width, height, GS_RGBA));
+		{
+			auto op = _pyramid[n]->render(width, height);
+			gs_ortho(0, 1., 0, 1., 0, 1.);
+			gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), texture->get_object());
+			while (gs_effect_loop(effect, "Draw")) {
+				gs::draw_sprite(texture->get_object(), 0, 1, 1);
+			}
+		}
+
+		texture = _pyramid[n]->get_texture();
+	}
+
+	return texture;
+}
+
+void gfx::blur::gaussian::upsample(size_t levels)
+{
+	gs_effect_t* effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+
+	// The downsampled input is only needed by the blur passes.
+	_pyramid.clear();
+	_upsample_rendertarget.reset();
+	_upsampled = (levels > 0);
+	if (!_upsampled)
+		return;
+
+	uint32_t                       width   = _input_texture->get_width();
+	uint32_t                       height  = _input_texture->get_height();
+	std::shared_ptr<::gs::texture> texture = _rendertarget->get_texture();
+
+	_upsample_rendertarget = _pool->acquire(width, height, GS_RGBA);
+	{
+		auto op = _upsample_rendertarget->render(width, height);
+		gs_ortho(0, 1., 0, 1., 0, 1.);
+		gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), texture->get_object());
+		while (gs_effect_loop(effect, "Draw")) {
+			gs::draw_sprite(texture->get_object(), 0, 1, 1);
+		}
+	}
+
+	// Only the full size result has to stay around.
+	_rendertarget.reset();
+}
+
 gfx::blur::gaussian_directional::gaussian_directional() : m_angle(0.) {}
 
 gfx::blur::gaussian_directional::~gaussian_directional() {}
@@ -393,6 +448,7 @@ std::shared_ptr<::gs::texture> gfx::blur::gaussian_directional::render()
 	auto gctx = gs::context();
 
 	std::shared_ptr<::gs::effect> effect = _data->get_effect();
+	auto&                         params = _data->get_parameters();
 	auto                          kernel = _data->get_kernel(size_t(_size));
 
 	if (!effect || ((_step_scale.first + _step_scale.second) < std::numeric_limits<double_t>::epsilon())) {
@@ -403,38 +459,25 @@ std::shared_ptr<::gs::texture> gfx::blur::gaussian_directional::render()
 	float_t height = float_t(_input_texture->get_height());
 
 	// Setup
-	obs_enter_graphics();
-	gs_set_cull_mode(GS_NEITHER);
-	gs_enable_color(true, true, true, true);
-	gs_enable_depth_test(false);
-	gs_depth_function(GS_ALWAYS);
-	gs_blend_state_push();
-	gs_reset_blend_state();
-	gs_enable_blending(false);
-	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-	gs_enable_stencil_test(false);
-	gs_enable_stencil_write(false);
-	gs_stencil_function(GS_STENCIL_BOTH, GS_ALWAYS);
-	gs_stencil_op(GS_STENCIL_BOTH, GS_ZERO, GS_ZERO, GS_ZERO);
-
-	effect->get_parameter("pImage")->set_texture(_input_texture);
-	effect->get_parameter("pImageTexel")
-		->set_float2(float_t(1.f / width * cos(m_angle)), float_t(1.f / height * sin(m_angle)));
-	effect->get_parameter("pStepScale")->set_float2(float_t(_step_scale.first), float_t(_step_scale.second));
-	effect->get_parameter("pSize")->set_float(float_t(_size));
-	effect->get_parameter("pKernel")->set_float_array(kernel.data(), MAX_KERNEL_SIZE);
+	auto state = ::gs::render_state::opaque().apply();
+
+	params.image.set(_input_texture);
+	params.image_texel.set(float_t(1.f / width * cos(m_angle)), float_t(1.f / height * sin(m_angle)));
+	params.step_scale.set(float_t(_step_scale.first), float_t(_step_scale.second));
+	params.size.set(float_t(_size));
+	params.kernel.set_array(kernel.data(), MAX_KERNEL_SIZE);
 
 	// First Pass
+	_rendertarget.reset();
+	_rendertarget = _pool->acquire(uint32_t(width), uint32_t(height), GS_RGBA);
 	{
 		auto op = _rendertarget->render(uint32_t(width), uint32_t(height));
 		gs_ortho(0, 1., 0, 1., 0, 1.);
 		while (gs_effect_loop(effect->get_object(), "Draw")) {
-			gs_draw_sprite(nullptr, 0, 1, 1);
+			gs::draw_sprite(nullptr, 0, 1, 1);
 		}
 	}
 
-	gs_blend_state_pop();
-
 	return this->get();
 }
 
@@ -448,6 +491,7 @@ std::shared_ptr<::gs::texture> gfx::blur::gaussian_rotational::render()
 	auto gctx = gs::context();
 
 	std::shared_ptr<::gs::effect> effect = _data->get_effect();
+	auto&                         params = _data->get_parameters();
 	auto                          kernel = _data->get_kernel(size_t(_size));
 
 	if (!effect || ((_step_scale.first + _step_scale.second) < std::numeric_limits<double_t>::epsilon())) {
@@ -458,38 +502,27 @@ std::shared_ptr<::gs::texture> gfx::blur::gaussian_rotational::render()
 	float_t height = float_t(_input_texture->get_height());
 
 	// Setup
-	gs_set_cull_mode(GS_NEITHER);
-	gs_enable_color(true, true, true, true);
-	gs_enable_depth_test(false);
-	gs_depth_function(GS_ALWAYS);
-	gs_blend_state_push();
-	gs_reset_blend_state();
-	gs_enable_blending(false);
-	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-	gs_enable_stencil_test(false);
-	gs_enable_stencil_write(false);
-	gs_stencil_function(GS_STENCIL_BOTH, GS_ALWAYS);
-	gs_stencil_op(GS_STENCIL_BOTH, GS_ZERO, GS_ZERO, GS_ZERO);
-
-	effect->get_parameter("pImage")->set_texture(_input_texture);
-	effect->get_parameter("pImageTexel")->set_float2(float_t(1.f / width), float_t(1.f / height));
-	effect->get_parameter("pStepScale")->set_float2(float_t(_step_scale.first), float_t(_step_scale.second));
-	effect->get_parameter("pSize")->set_float(float_t(_size));
-	effect->get_parameter("pAngle")->set_float(float_t(m_angle / _size));
-	effect->get_parameter("pCenter")->set_float2(float_t(m_center.first), float_t(m_center.second));
-	effect->get_parameter("pKernel")->set_float_array(kernel.data(), MAX_KERNEL_SIZE);
+	auto state = ::gs::render_state::opaque().apply();
+
+	params.image.set(_input_texture);
+	params.image_texel.set(float_t(1.f / width), float_t(1.f / height));
+	params.step_scale.set(float_t(_step_scale.first), float_t(_step_scale.second));
+	params.size.set(float_t(_size));
+	params.angle.set(float_t(m_angle / _size));
+	params.center.set(float_t(m_center.first), float_t(m_center.second));
+	params.kernel.set_array(kernel.data(), MAX_KERNEL_SIZE);
 
 	// First Pass
+	_rendertarget.reset();
+	_rendertarget = _pool->acquire(uint32_t(width), uint32_t(height), GS_RGBA);
 	{
 		auto op = _rendertarget->render(uint32_t(width), uint32_t(height));
 		gs_ortho(0, 1., 0, 1., 0, 1.);
 		while (gs_effect_loop(effect->get_object(), "Rotate")) {
-			gs_draw_sprite(nullptr, 0, 1, 1);
+			gs::draw_sprite(nullptr, 0, 1, 1);
 		}
 	}
 
-	gs_blend_state_pop();
-
 	return this->get();
 }
 
@@ -525,6 +558,7 @@ std::shared_ptr<::gs::texture> gfx::blur::gaussian_zoom::render()
 	auto gctx = gs::context();
 
 	std::shared_ptr<::gs::effect> effect = _data->get_effect();
+	auto&                         params = _data->get_parameters();
 	auto                          kernel = _data->get_kernel(size_t(_size));
 
 	if (!effect || ((_step_scale.first + _step_scale.second) < std::numeric_limits<double_t>::epsilon())) {
@@ -535,37 +569,26 @@ std::shared_ptr<::gs::texture> gfx::blur::gaussian_zoom::render()
 	float_t height = float_t(_input_texture->get_height());
 
 	// Setup
-	gs_set_cull_mode(GS_NEITHER);
-	gs_enable_color(true, true, true, true);
-	gs_enable_depth_test(false);
-	gs_depth_function(GS_ALWAYS);
-	gs_blend_state_push();
-	gs_reset_blend_state();
-	gs_enable_blending(false);
-	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-	gs_enable_stencil_test(false);
-	gs_enable_stencil_write(false);
-	gs_stencil_function(GS_STENCIL_BOTH, GS_ALWAYS);
-	gs_stencil_op(GS_STENCIL_BOTH, GS_ZERO, GS_ZERO, GS_ZERO);
-
-	effect->get_parameter("pImage")->set_texture(_input_texture);
-	effect->get_parameter("pImageTexel")->set_float2(float_t(1.f / width), float_t(1.f / height));
-	effect->get_parameter("pStepScale")->set_float2(float_t(_step_scale.first), float_t(_step_scale.second));
-	effect->get_parameter("pSize")->set_float(float_t(_size));
-	effect->get_parameter("pCenter")->set_float2(float_t(m_center.first), float_t(m_center.second));
-	effect->get_parameter("pKernel")->set_float_array(kernel.data(), MAX_KERNEL_SIZE);
+	auto state = ::gs::render_state::opaque().apply();
+
+	params.image.set(_input_texture);
+	params.image_texel.set(float_t(1.f / width), float_t(1.f / height));
+	params.step_scale.set(float_t(_step_scale.first), float_t(_step_scale.second));
+	params.size.set(float_t(_size));
+	params.center.set(float_t(m_center.first), float_t(m_center.second));
+	params.kernel.set_array(kernel.data(), MAX_KERNEL_SIZE);
 
 	// First Pass
+	_rendertarget.reset();
+	_rendertarget = _pool->acquire(uint32_t(width), uint32_t(height), GS_RGBA);
 	{
 		auto op = _rendertarget->render(uint32_t(width), uint32_t(height));
 		gs_ortho(0, 1., 0, 1., 0, 1.);
 		while (gs_effect_loop(effect->get_object(), "Zoom")) {
-			gs_draw_sprite(nullptr, 0, 1, 1);
+			gs::draw_sprite(nullptr, 0, 1, 1);
 		}
 	}
 
-	gs_blend_state_pop();
-
 	return this->get();
 }
 
@@ -20,14 +20,27 @@
 #include <vector>
 #include "gfx-blur-base.hpp"
 #include "obs/gs/gs-effect.hpp"
+#include "obs/gs/gs-rendertarget-pool.hpp"
 #include "obs/gs/gs-rendertarget.hpp"
 #include "obs/gs/gs-texture.hpp"
 
 namespace gfx {
 	namespace blur {
 		class gaussian_data {
-			std::shared_ptr<::gs::effect>     _effect;
-			std::vector<std::vector<float_t>> _kernels;
+			public:
+			struct parameters {
+				::gs::texture_parameter image;
+				::gs::float2_parameter  image_texel;
+				::gs::float_parameter   size;
+				::gs::float_parameter   angle;
+				::gs::float2_parameter  center;
+				::gs::float2_parameter  step_scale;
+				::gs::float4_parameter  kernel;
+			};
+
+			private:
+			std::shared_ptr<::gs::effect>          _effect;
+			::gfx::blur::gaussian_data::parameters _parameters;
 
 			public:
 			gaussian_data();
@@ -35,6 +48,8 @@ namespace gfx {
 
 			std::shared_ptr<::gs::effect> get_effect();
 
+			::gfx::blur::gaussian_data::parameters& get_parameters();
+
 			std::vector<float_t> const& get_kernel(size_t width);
 		};
 
@@ -86,13 +101,18 @@ namespace gfx {
 			protected:
 			std::shared_ptr<::gfx::blur::gaussian_data> _data;
 
-			double_t                            _size;
-			std::pair<double_t, double_t>       _step_scale;
-			std::shared_ptr<::gs::texture>      _input_texture;
+			double_t                                 _size;
+			std::pair<double_t, double_t>            _step_scale;
+			std::shared_ptr<::gs::texture>           _input_texture;
+			std::shared_ptr<::gs::rendertarget_pool> _pool;
+
+			// Output of the last render, held until the next one.
 			std::shared_ptr<::gs::rendertarget> _rendertarget;
 
-			private:
-			std::shared_ptr<::gs::rendertarget> _rendertarget2;
+			// Large sizes blur a downsampled copy of the input and scale the result back up.
+			std::vector<std::shared_ptr<::gs::rendertarget>> _pyramid;
+			std::shared_ptr<::gs::rendertarget>              _upsample_rendertarget;
+			bool                                             _upsampled;
 
 			public:
 			gaussian();
@@ -117,6 +137,21 @@ namespace gfx {
 			virtual std::shared_ptr<::gs::texture> render() override;
 
 			virtual std::shared_ptr<::gs::texture> get() override;
+
+			protected:
+			/*!
+			 * \brief Number of times the input is halved before blurring, 0 if the size fits into the kernel.
+			 */
+			size_t get_pyramid_levels();
+
+			std::shared_ptr<::gs::texture> downsample(size_t levels);
+
+			/*!
+			 * \brief Scale the blurred result back up to the input size if it was downsampled.
+			 *
+			 * Returns the pyramid to the render target pool either way.
+			 */
+			void upsample(size_t levels);
 		};
 
 		class gaussian_directional : public ::gfx::blur::gaussian, public ::gfx::blur::base_angle {
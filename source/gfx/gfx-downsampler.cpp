@@ -0,0 +1,80 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+
+#include "gfx-downsampler.hpp"
+#include <algorithm>
+#include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-render-state.hpp"
+
+// OBS
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)
+#endif
+#include <obs.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+gfx::downsampler::downsampler() : _pool(gs::rendertarget_pool::get()) {}
+
+gfx::downsampler::~downsampler() {}
+
+std::shared_ptr<gs::texture> gfx::downsampler::render(std::shared_ptr<gs::texture> input, uint32_t width,
+													  uint32_t height)
+{
+	_rendertarget.reset();
+
+	width  = std::max<uint32_t>(width, 1);
+	height = std::max<uint32_t>(height, 1);
+	if (!input || ((input->get_width() == width) && (input->get_height() == height))) {
+		return input;
+	}
+
+	gs_effect_t* effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	gs_eparam_t* image  = gs_effect_get_param_by_name(effect, "image");
+
+	auto state = ::gs::render_state::opaque().apply();
+
+	// The default effect samples bilinearly, which is an exact 2x2 box filter when the size is halved.
+	std::shared_ptr<gs::texture>      texture = input;
+	std::shared_ptr<gs::rendertarget> level;
+	do {
+		uint32_t level_width  = std::max(texture->get_width() / 2, width);
+		uint32_t level_height = std::max(texture->get_height() / 2, height);
+		if ((level_width == texture->get_width()) && (level_height == texture->get_height())) {
+			break;
+		}
+
+		// The previous level stays alive until this one is done reading from it.
+		std::shared_ptr<gs::rendertarget> next = _pool->acquire(level_width, level_height, GS_RGBA);
+		{
+			auto op = next->render(level_width, level_height);
+			gs_ortho(0, float_t(level_width), 0, float_t(level_height), -1., 1.);
+			gs_effect_set_texture(image, texture->get_object());
+			while (gs_effect_loop(effect, "Draw")) {
+				gs::draw_sprite(texture->get_object(), 0, level_width, level_height);
+			}
+		}
+		level   = next;
+		texture = level->get_texture();
+	} while ((texture->get_width() > width) || (texture->get_height() > height));
+
+	_rendertarget = level;
+	return texture;
+}
@@ -0,0 +1,50 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+
+#pragma once
+#include <cinttypes>
+#include <memory>
+#include "obs/gs/gs-rendertarget-pool.hpp"
+#include "obs/gs/gs-rendertarget.hpp"
+#include "obs/gs/gs-texture.hpp"
+
+namespace gfx {
+	/*!
+	 * \brief Reduces a texture to a smaller size without aliasing.
+	 *
+	 * The input is halved with a 2x2 box filter for as long as that doesn't go below the
+	 *  requested size, and only the remaining factor of less than two is left to a single
+	 *  bilinear resize. Content finer than the output can hold is averaged instead of skipped.
+	 */
+	class downsampler {
+		std::shared_ptr<gs::rendertarget_pool> _pool;
+		std::shared_ptr<gs::rendertarget>      _rendertarget;
+
+		public:
+		downsampler();
+		~downsampler();
+
+		/*!
+		 * \brief Downsample the input to the given size.
+		 *
+		 * Returns the input itself if it already has that size. The result stays valid until
+		 *  the next call.
+		 */
+		std::shared_ptr<gs::texture> render(std::shared_ptr<gs::texture> input, uint32_t width, uint32_t height);
+	};
+} // namespace gfx
@@ -996,22 +996,7 @@ gfx::effect_source::effect_source::effect_source(obs_source_t* self)
 {
 	auto gctx = gs::context();
 
-	_tri = std::make_shared<gs::vertex_buffer>(3ul, uint8_t(1));
-	{
-		auto& vtx = _tri->at(0);
-		vec3_set(vtx.position, 0, 0, 0);
-		vec4_set(vtx.uv[0], 0, 0, 0, 0);
-	}
-	{
-		auto& vtx = _tri->at(1);
-		vec3_set(vtx.position, 2, 0, 0);
-		vec4_set(vtx.uv[0], 2, 0, 0, 0);
-	}
-	{
-		auto& vtx = _tri->at(2);
-		vec3_set(vtx.position, 0, 2, 0);
-		vec4_set(vtx.uv[0], 0, 2, 0, 0);
-	}
+	_tri = gs::geometry::get_fullscreen_triangle();
 }
 
 gfx::effect_source::effect_source::~effect_source() {}
@@ -1105,11 +1090,11 @@ void gfx::effect_source::effect_source::render()
 	// Apply "special" parameters.
 	_time_active += _time_since_last_tick;
 	{
-		auto p_time = _effect->get_parameter("Time");
+		auto p_time = _effect->find_parameter("Time");
 		if (p_time && (p_time->get_type() == gs::effect_parameter::type::Float4)) {
 			p_time->set_float4(_time, _time_active, _time_since_last_tick, _random_dist(_random_generator));
 		}
-		auto p_random = _effect->get_parameter("Random");
+		auto p_random = _effect->find_parameter("Random");
 		if (p_random && (p_random->get_type() == gs::effect_parameter::type::Matrix)) {
 			matrix4 m;
 			vec4_set(&m.x, _random_dist(_random_generator), _random_dist(_random_generator),
@@ -1140,9 +1125,9 @@ void gfx::effect_source::effect_source::render()
 	gs_ortho(0, 1, 0, 1, -1., 1.);
 
 	while (gs_effect_loop(_effect->get_object(), _tech.c_str())) {
-		gs_load_vertexbuffer(_tri->update());
+		gs_load_vertexbuffer(_tri->get_object());
 		gs_load_indexbuffer(nullptr);
-		gs_draw(gs_draw_mode::GS_TRIS, 0, _tri->size());
+		gs::draw(gs_draw_mode::GS_TRIS, 0, _tri->size());
 	}
 
 	gs_matrix_pop();
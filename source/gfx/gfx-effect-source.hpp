@@ -25,10 +25,10 @@
 #include <vector>
 #include "gfx-source-texture.hpp"
 #include "obs/gs/gs-effect.hpp"
+#include "obs/gs/gs-geometry.hpp"
 #include "obs/gs/gs-mipmapper.hpp"
 #include "obs/gs/gs-rendertarget.hpp"
 #include "obs/gs/gs-texture.hpp"
-#include "obs/gs/gs-vertexbuffer.hpp"
 
 // OBS
 extern "C" {
@@ -283,7 +283,7 @@ namespace gfx {
 			std::string                                         _tech;
 			std::map<param_ident_t, std::shared_ptr<parameter>> _params;
 
-			std::shared_ptr<gs::vertex_buffer> _tri;
+			std::shared_ptr<gs::geometry> _tri;
 
 			float_t _last_check;
 			size_t  _last_size;
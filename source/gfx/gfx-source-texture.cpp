@@ -16,6 +16,7 @@
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
 
 #include "gfx-source-texture.hpp"
+#include <stdexcept>
 
 gfx::source_texture::~source_texture()
 {
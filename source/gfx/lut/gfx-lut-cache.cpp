@@ -0,0 +1,154 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "gfx-lut-cache.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "gfx-lut-cube.hpp"
+#include "plugin.hpp"
+
+// OBS
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)
+#endif
+#include <graphics/graphics.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+// 64-bit FNV-1a over the raw file content.
+static uint64_t hash_content(const std::string& content)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (char chr : content) {
+		hash ^= static_cast<uint8_t>(chr);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+gfx::lut::cube_cache::cube_cache() {}
+
+gfx::lut::cube_cache::~cube_cache() {}
+
+std::shared_ptr<::gfx::lut::cube_table> gfx::lut::cube_cache::read(std::string file)
+{
+	std::string content;
+	{
+		std::ifstream stream(file, std::ios::binary);
+		if (!stream)
+			throw std::runtime_error("could not open file");
+		std::ostringstream buffer;
+		buffer << stream.rdbuf();
+		if (stream.bad())
+			throw std::runtime_error("could not read file");
+		content = buffer.str();
+	}
+
+	auto table  = std::make_shared<::gfx::lut::cube_table>();
+	table->hash = hash_content(content);
+	table->file = file;
+	{
+		std::unique_lock<std::mutex> ul(_lock);
+		auto                         found = _entries.find(table->hash);
+		if (found != _entries.end()) {
+			table->existing = found->second.lock();
+		}
+	}
+	if (table->existing)
+		return table;
+
+	std::istringstream stream(content);
+	::gfx::lut::cube   cube(stream);
+	table->title = cube.get_title();
+	table->size  = cube.get_table_size();
+	table->is_3d = cube.is_3d();
+	std::copy_n(cube.get_domain_min(), 3, table->domain_min);
+	std::copy_n(cube.get_domain_max(), 3, table->domain_max);
+	table->table = cube.to_table();
+	return table;
+}
+
+std::shared_ptr<::gfx::lut::cube_texture> gfx::lut::cube_cache::upload(std::shared_ptr<::gfx::lut::cube_table> table)
+{
+	if (table->existing)
+		return table->existing;
+
+	std::unique_lock<std::mutex> ul(_lock);
+	for (auto iter = _entries.begin(); iter != _entries.end();) {
+		if (iter->second.expired()) {
+			iter = _entries.erase(iter);
+		} else {
+			iter++;
+		}
+	}
+
+	// Another instance may have uploaded the same table since it was read.
+	auto found = _entries.find(table->hash);
+	if (found != _entries.end()) {
+		if (auto entry = found->second.lock()) {
+			return entry;
+		}
+	}
+
+	auto entry   = std::make_shared<::gfx::lut::cube_texture>();
+	entry->title = table->title;
+	entry->size  = table->size;
+	std::copy_n(table->domain_min, 3, entry->domain_min);
+	std::copy_n(table->domain_max, 3, entry->domain_max);
+
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(table->table.data());
+	entry->texture = std::make_shared<gs::texture>(entry->size * entry->size, entry->size, GS_RGBA32F, 1, &data,
+												   gs::texture::flags::None);
+
+	P_LOG_DEBUG("<gfx::lut::cube_cache> Loaded '%s' as a %s table of size %u.", table->file.c_str(),
+				table->is_3d ? "3D" : "1D", entry->size);
+
+	_entries[table->hash] = entry;
+	return entry;
+}
+
+std::shared_ptr<::gfx::lut::cube_texture> gfx::lut::cube_cache::load(std::string file)
+{
+	return upload(read(file));
+}
+
+size_t gfx::lut::cube_cache::get_count()
+{
+	std::unique_lock<std::mutex> ul(_lock);
+	return size_t(std::count_if(_entries.begin(), _entries.end(),
+								[](const std::pair<const uint64_t, std::weak_ptr<::gfx::lut::cube_texture>>& kv) {
+									return !kv.second.expired();
+								}));
+}
+
+std::shared_ptr<::gfx::lut::cube_cache> gfx::lut::cube_cache::get()
+{
+	static std::mutex                            instance_lock;
+	static std::weak_ptr<::gfx::lut::cube_cache> instance;
+
+	std::unique_lock<std::mutex>            ul(instance_lock);
+	std::shared_ptr<::gfx::lut::cube_cache> cache = instance.lock();
+	if (!cache) {
+		cache    = std::make_shared<::gfx::lut::cube_cache>();
+		instance = cache;
+	}
+	return cache;
+}
@@ -0,0 +1,101 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#pragma once
+#include <cinttypes>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "obs/gs/gs-texture.hpp"
+
+namespace gfx {
+	namespace lut {
+		/*!
+		 * \brief A .cube file uploaded in the layout 'DrawLUT' expects.
+		 */
+		struct cube_texture {
+			std::string                  title;
+			uint32_t                     size;
+			float_t                      domain_min[3];
+			float_t                      domain_max[3];
+			std::shared_ptr<gs::texture> texture;
+		};
+
+		/*!
+		 * \brief A .cube file read into memory, ready to be uploaded.
+		 *
+		 * Holds either the converted table or, if the same content is already uploaded, the
+		 *  existing texture, in which case the file was not parsed at all.
+		 */
+		struct cube_table {
+			uint64_t                                  hash;
+			std::string                               file;
+			std::string                               title;
+			uint32_t                                  size;
+			bool                                      is_3d;
+			float_t                                   domain_min[3];
+			float_t                                   domain_max[3];
+			std::vector<float_t>                      table;
+			std::shared_ptr<::gfx::lut::cube_texture> existing;
+		};
+
+		/*!
+		 * \brief Textures of loaded .cube files, shared by every instance using the same table.
+		 *
+		 * Entries are keyed by a hash of the file content, so the same table under a different
+		 *  path is shared too, while an edited file is loaded again. An entry is released as soon
+		 *  as the last instance using it lets go of it.
+		 */
+		class cube_cache {
+			std::mutex                                      _lock;
+			std::map<uint64_t, std::weak_ptr<cube_texture>> _entries;
+
+			public:
+			cube_cache();
+			~cube_cache();
+
+			/*!
+			 * \brief Read a .cube file, parsing it only if no instance holds the same table yet.
+			 *
+			 * The file is read once for both hashing and parsing, and nothing touches the graphics
+			 *  subsystem, so this may run on any thread. Throws std::runtime_error if the file can
+			 *  not be read or parsed.
+			 */
+			std::shared_ptr<::gfx::lut::cube_table> read(std::string file);
+
+			/*!
+			 * \brief Get the texture for a table from read(), uploading it if nobody else did yet.
+			 */
+			std::shared_ptr<::gfx::lut::cube_texture> upload(std::shared_ptr<::gfx::lut::cube_table> table);
+
+			/*!
+			 * \brief Read and upload a .cube file in one go.
+			 *
+			 * Throws std::runtime_error if the file can not be read or parsed.
+			 */
+			std::shared_ptr<::gfx::lut::cube_texture> load(std::string file);
+
+			// Number of tables currently held by at least one instance.
+			size_t get_count();
+
+			public: // Singleton
+			static std::shared_ptr<::gfx::lut::cube_cache> get();
+		};
+	} // namespace lut
+} // namespace gfx
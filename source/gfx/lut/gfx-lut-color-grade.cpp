@@ -0,0 +1,319 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "gfx-lut-color-grade.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+// SSE2 is part of every x86-64 CPU, and OBS itself requires it on 32-bit x86.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define LUT_SSE2
+#include <emmintrin.h>
+#endif
+
+// Same epsilon as RGBtoHSV in 'color-grade.effect'.
+#define HSV_EPSILON 1.0e-10f
+
+// pow() in the effect is exp2(log2(x) * y), which has no result for negative values. Such a NaN is not
+//  carried all the way through though: min() and max() on the GPU return the other operand instead, the
+//  same as std::fmin()/std::fmax() and _mm_min_ps()/_mm_max_ps() with the NaN as the first operand.
+static inline float_t effect_pow(float_t x, float_t y)
+{
+	if (x < 0.f)
+		return std::numeric_limits<float_t>::quiet_NaN();
+	return std::pow(x, y);
+}
+
+// Lift, Gamma, Gain and Offset for one channel.
+static inline float_t grade_channel(const ::gfx::lut::grade_parameters& params, size_t channel, float_t value)
+{
+	value = params.lift[3] + value;
+	value = params.lift[channel] + value;
+	value = effect_pow(effect_pow(value, params.gamma[channel]), params.gamma[3]);
+	value *= params.gain[channel];
+	value *= params.gain[3];
+	value = params.offset[3] + value;
+	value = params.offset[channel] + value;
+	return value;
+}
+
+static inline void rgb_to_hsv(const float_t rgb[3], float_t hsv[3])
+{
+	float_t p[4];
+	if (rgb[1] >= rgb[2]) {
+		p[0] = rgb[1], p[1] = rgb[2], p[2] = 0.f, p[3] = -1.f / 3.f;
+	} else {
+		p[0] = rgb[2], p[1] = rgb[1], p[2] = -1.f, p[3] = 2.f / 3.f;
+	}
+
+	float_t q[4];
+	if (rgb[0] >= p[0]) {
+		q[0] = rgb[0], q[1] = p[1], q[2] = p[2], q[3] = p[0];
+	} else {
+		q[0] = p[0], q[1] = p[1], q[2] = p[3], q[3] = rgb[0];
+	}
+
+	float_t d = q[0] - std::fmin(q[3], q[1]);
+	hsv[0]    = std::abs(q[2] + (q[3] - q[1]) / (6.f * d + HSV_EPSILON));
+	hsv[1]    = d / (q[0] + HSV_EPSILON);
+	hsv[2]    = q[0];
+}
+
+static inline void hsv_to_rgb(const float_t hsv[3], float_t rgb[3])
+{
+	static const float_t offsets[3] = {1.f, 2.f / 3.f, 1.f / 3.f};
+	for (size_t idx = 0; idx < 3; idx++) {
+		float_t hue = hsv[0] + offsets[idx];
+		float_t v   = std::abs((hue - std::floor(hue)) * 6.f - 3.f) - 1.f;
+		v           = std::fmin(std::fmax(v, 0.f), 1.f);
+		rgb[idx]    = hsv[2] * (1.f + (v - 1.f) * hsv[1]);
+	}
+}
+
+// Tint and Correction, which mix all channels.
+static inline void grade_color(const ::gfx::lut::grade_parameters& params, float_t rgb[3])
+{
+	float_t hsv[3];
+	rgb_to_hsv(rgb, hsv);
+	for (size_t idx = 0; idx < 3; idx++) {
+		float_t tint;
+		if (hsv[2] > 0.5f) {
+			tint = params.tint_mid[idx] + (params.tint_hig[idx] - params.tint_mid[idx]) * (hsv[2] * 2.f - 1.f);
+		} else {
+			tint = params.tint_low[idx] + (params.tint_mid[idx] - params.tint_low[idx]) * (hsv[2] * 2.f);
+		}
+		rgb[idx] *= tint;
+	}
+
+	rgb_to_hsv(rgb, hsv);
+	hsv[0] += params.correction[0];
+	hsv[1] *= params.correction[1];
+	hsv[2] *= params.correction[2];
+	hsv_to_rgb(hsv, rgb);
+	for (size_t idx = 0; idx < 3; idx++) {
+		rgb[idx] = ((rgb[idx] - 0.5f) * std::max(params.correction[3], 0.f)) + 0.5f;
+	}
+}
+
+// Clamp to 0..1, anything that is not a number ends up as 0 just like it does in an 8-bit target.
+static inline float_t saturate(float_t value)
+{
+	return (value >= 0.f) ? std::min(value, 1.f) : 0.f;
+}
+
+#ifdef LUT_SSE2
+static inline __m128 select_ps(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 abs_ps(__m128 value)
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.f), value);
+}
+
+// std::fmin(), _mm_min_ps() alone returns NaN if that is the second operand.
+static inline __m128 fmin_ps(__m128 a, __m128 b)
+{
+	return select_ps(_mm_cmpord_ps(b, b), _mm_min_ps(a, b), a);
+}
+
+static inline __m128 floor_ps(__m128 value)
+{
+	__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(value));
+	return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, value), _mm_set1_ps(1.f)));
+}
+
+static inline void rgb_to_hsv_sse2(const __m128 rgb[3], __m128 hsv[3])
+{
+	__m128 step = _mm_cmpge_ps(rgb[1], rgb[2]);
+	__m128 p0   = select_ps(step, rgb[1], rgb[2]);
+	__m128 p1   = select_ps(step, rgb[2], rgb[1]);
+	__m128 p2   = select_ps(step, _mm_set1_ps(0.f), _mm_set1_ps(-1.f));
+	__m128 p3   = select_ps(step, _mm_set1_ps(-1.f / 3.f), _mm_set1_ps(2.f / 3.f));
+
+	step      = _mm_cmpge_ps(rgb[0], p0);
+	__m128 q0 = select_ps(step, rgb[0], p0);
+	__m128 q2 = select_ps(step, p2, p3);
+	__m128 q3 = select_ps(step, p0, rgb[0]);
+
+	__m128 d       = _mm_sub_ps(q0, fmin_ps(q3, p1));
+	__m128 divisor = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(6.f), d), _mm_set1_ps(HSV_EPSILON));
+	hsv[0]         = abs_ps(_mm_add_ps(q2, _mm_div_ps(_mm_sub_ps(q3, p1), divisor)));
+	hsv[1]         = _mm_div_ps(d, _mm_add_ps(q0, _mm_set1_ps(HSV_EPSILON)));
+	hsv[2]         = q0;
+}
+
+static inline void hsv_to_rgb_sse2(const __m128 hsv[3], __m128 rgb[3])
+{
+	static const float_t offsets[3] = {1.f, 2.f / 3.f, 1.f / 3.f};
+	for (size_t idx = 0; idx < 3; idx++) {
+		__m128 hue = _mm_add_ps(hsv[0], _mm_set1_ps(offsets[idx]));
+		__m128 v   = _mm_mul_ps(_mm_sub_ps(hue, floor_ps(hue)), _mm_set1_ps(6.f));
+		v          = _mm_sub_ps(abs_ps(_mm_sub_ps(v, _mm_set1_ps(3.f))), _mm_set1_ps(1.f));
+		v          = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(0.f)), _mm_set1_ps(1.f));
+		v          = _mm_add_ps(_mm_set1_ps(1.f), _mm_mul_ps(_mm_sub_ps(v, _mm_set1_ps(1.f)), hsv[1]));
+		rgb[idx]   = _mm_mul_ps(hsv[2], v);
+	}
+}
+
+static inline void grade_color_sse2(const ::gfx::lut::grade_parameters& params, __m128 rgb[3])
+{
+	__m128 hsv[3];
+	rgb_to_hsv_sse2(rgb, hsv);
+	__m128 high     = _mm_cmpgt_ps(hsv[2], _mm_set1_ps(0.5f));
+	__m128 high_pos = _mm_sub_ps(_mm_mul_ps(hsv[2], _mm_set1_ps(2.f)), _mm_set1_ps(1.f));
+	__m128 low_pos  = _mm_mul_ps(hsv[2], _mm_set1_ps(2.f));
+	for (size_t idx = 0; idx < 3; idx++) {
+		__m128 low  = _mm_set1_ps(params.tint_low[idx]);
+		__m128 mid  = _mm_set1_ps(params.tint_mid[idx]);
+		__m128 hig  = _mm_set1_ps(params.tint_hig[idx]);
+		__m128 tint = select_ps(high, _mm_add_ps(mid, _mm_mul_ps(_mm_sub_ps(hig, mid), high_pos)),
+								_mm_add_ps(low, _mm_mul_ps(_mm_sub_ps(mid, low), low_pos)));
+		rgb[idx]    = _mm_mul_ps(rgb[idx], tint);
+	}
+
+	rgb_to_hsv_sse2(rgb, hsv);
+	hsv[0] = _mm_add_ps(hsv[0], _mm_set1_ps(params.correction[0]));
+	hsv[1] = _mm_mul_ps(hsv[1], _mm_set1_ps(params.correction[1]));
+	hsv[2] = _mm_mul_ps(hsv[2], _mm_set1_ps(params.correction[2]));
+	hsv_to_rgb_sse2(hsv, rgb);
+	__m128 contrast = _mm_set1_ps(std::max(params.correction[3], 0.f));
+	for (size_t idx = 0; idx < 3; idx++) {
+		rgb[idx] = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(rgb[idx], _mm_set1_ps(0.5f)), contrast), _mm_set1_ps(0.5f));
+	}
+}
+
+static inline __m128 saturate_sse2(__m128 value)
+{
+	return _mm_and_ps(_mm_cmpge_ps(value, _mm_set1_ps(0.f)), _mm_min_ps(value, _mm_set1_ps(1.f)));
+}
+#endif
+
+gfx::lut::color_grade::color_grade(uint32_t size) : _size(size)
+{
+	if (size < 2)
+		throw std::invalid_argument("size must be at least 2");
+
+	_data.resize(size_t(size) * size * size * 4);
+}
+
+gfx::lut::color_grade::~color_grade() {}
+
+uint32_t gfx::lut::color_grade::get_size()
+{
+	return _size;
+}
+
+uint32_t gfx::lut::color_grade::get_width()
+{
+	return _size * _size;
+}
+
+uint32_t gfx::lut::color_grade::get_height()
+{
+	return _size;
+}
+
+const float_t* gfx::lut::color_grade::get_data()
+{
+	return _data.data();
+}
+
+void gfx::lut::color_grade::bake(const ::gfx::lut::grade_parameters& params)
+{
+	std::vector<float_t> axis[3];
+	for (size_t channel = 0; channel < 3; channel++) {
+		axis[channel].resize(_size);
+		for (uint32_t idx = 0; idx < _size; idx++) {
+			axis[channel][idx] = grade_channel(params, channel, float_t(idx) / float_t(_size - 1));
+		}
+	}
+
+	for (uint32_t b = 0; b < _size; b++) {
+		for (uint32_t g = 0; g < _size; g++) {
+			float_t* row = &_data[(size_t(g) * _size * _size + size_t(b) * _size) * 4];
+			uint32_t r   = 0;
+#ifdef LUT_SSE2
+			for (; r + 4 <= _size; r += 4) {
+				__m128 rgb[3] = {_mm_loadu_ps(&axis[0][r]), _mm_set1_ps(axis[1][g]), _mm_set1_ps(axis[2][b])};
+				grade_color_sse2(params, rgb);
+
+				// Transpose from one register per channel to one per entry, alpha is always 1.
+				__m128 red   = saturate_sse2(rgb[0]);
+				__m128 green = saturate_sse2(rgb[1]);
+				__m128 blue  = saturate_sse2(rgb[2]);
+				__m128 alpha = _mm_set1_ps(1.f);
+				_MM_TRANSPOSE4_PS(red, green, blue, alpha);
+				_mm_storeu_ps(row + (r + 0) * 4, red);
+				_mm_storeu_ps(row + (r + 1) * 4, green);
+				_mm_storeu_ps(row + (r + 2) * 4, blue);
+				_mm_storeu_ps(row + (r + 3) * 4, alpha);
+			}
+#endif
+			for (; r < _size; r++) {
+				float_t rgb[3] = {axis[0][r], axis[1][g], axis[2][b]};
+				grade_color(params, rgb);
+				row[r * 4 + 0] = saturate(rgb[0]);
+				row[r * 4 + 1] = saturate(rgb[1]);
+				row[r * 4 + 2] = saturate(rgb[2]);
+				row[r * 4 + 3] = 1.f;
+			}
+		}
+	}
+}
+
+void gfx::lut::color_grade::sample(const float_t rgb[3], float_t result[3])
+{
+	float_t max   = float_t(_size - 1);
+	float_t red   = std::min(std::max(rgb[0], 0.f), 1.f) * max;
+	float_t green = std::min(std::max(rgb[1], 0.f), 1.f) * max;
+	float_t blue  = std::min(std::max(rgb[2], 0.f), 1.f) * max;
+	float_t slice = std::min(std::floor(blue), max - 1.f);
+
+	// 'lutSampler' filters linearly and clamps, the red coordinate never leaves its slice.
+	auto bilinear = [this, green](float_t x, size_t channel) {
+		auto at = [this, channel](uint32_t tx, uint32_t ty) {
+			return _data[(size_t(ty) * get_width() + tx) * 4 + channel];
+		};
+
+		uint32_t x0 = uint32_t(x);
+		uint32_t y0 = uint32_t(green);
+		uint32_t x1 = std::min(x0 + 1, get_width() - 1);
+		uint32_t y1 = std::min(y0 + 1, _size - 1);
+		float_t  fx = x - float_t(x0);
+		float_t  fy = green - float_t(y0);
+		float_t  v0 = at(x0, y0) + (at(x1, y0) - at(x0, y0)) * fx;
+		float_t  v1 = at(x0, y1) + (at(x1, y1) - at(x0, y1)) * fx;
+		return v0 + (v1 - v0) * fy;
+	};
+
+	for (size_t channel = 0; channel < 3; channel++) {
+		float_t lo      = bilinear(slice * float_t(_size) + red, channel);
+		float_t hi      = bilinear((slice + 1.f) * float_t(_size) + red, channel);
+		result[channel] = lo + (hi - lo) * (blue - slice);
+	}
+}
+
+void gfx::lut::color_grade::grade(const ::gfx::lut::grade_parameters& params, float_t rgb[3])
+{
+	for (size_t channel = 0; channel < 3; channel++) {
+		rgb[channel] = grade_channel(params, channel, rgb[channel]);
+	}
+	grade_color(params, rgb);
+}
@@ -0,0 +1,83 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#pragma once
+#include <cinttypes>
+#include <cmath>
+#include <vector>
+
+namespace gfx {
+	namespace lut {
+		/*!
+		 * \brief Values of the uniforms in 'color-grade.effect', in the same order and units.
+		 */
+		struct grade_parameters {
+			float_t lift[4];
+			float_t gamma[4];
+			float_t gain[4];
+			float_t offset[4];
+			float_t tint_low[3];
+			float_t tint_mid[3];
+			float_t tint_hig[3];
+			float_t correction[4];
+		};
+
+		/*!
+		 * \brief The grading chain of 'color-grade.effect' baked into a 3D lookup table.
+		 *
+		 * The table holds size^3 RGBA float entries laid out as a 2D texture of size*size by size
+		 *  texels: one slice per blue step side by side, red increasing across each slice and
+		 *  green downwards. Entries are clamped to 0..1, as the graded image is stored in an
+		 *  8-bit target anyway.
+		 */
+		class color_grade {
+			uint32_t             _size;
+			std::vector<float_t> _data;
+
+			public:
+			color_grade(uint32_t size);
+			~color_grade();
+
+			uint32_t get_size();
+
+			uint32_t get_width();
+
+			uint32_t get_height();
+
+			const float_t* get_data();
+
+			/*!
+			 * \brief Evaluate the grading chain for every entry of the table.
+			 *
+			 * Lift, Gamma, Gain and Offset only depend on their own channel, so they are evaluated
+			 *  once per step along each axis. Tint and Correction are evaluated for four entries at
+			 *  a time where SSE2 is available.
+			 */
+			void bake(const ::gfx::lut::grade_parameters& params);
+
+			/*!
+			 * \brief Trilinear lookup, identical to the 'DrawLUT' technique.
+			 */
+			void sample(const float_t rgb[3], float_t result[3]);
+
+			/*!
+			 * \brief Port of 'PSColorGrade' for a single color, without any clamping.
+			 */
+			static void grade(const ::gfx::lut::grade_parameters& params, float_t rgb[3]);
+		};
+	} // namespace lut
+} // namespace gfx
@@ -0,0 +1,293 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "gfx-lut-cube.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+
+#define MAX_SIZE_1D 65536
+#define MAX_SIZE_3D 65
+
+static std::runtime_error parse_error(size_t line, std::string message)
+{
+	return std::runtime_error("line " + std::to_string(line) + ": " + message);
+}
+
+// Entries make up nearly all of a file, so they are read without a stream. Only '.' is accepted as
+//  the decimal separator, whatever the locale of the process is.
+static bool parse_number(const char*& cursor, float_t& value)
+{
+	while ((*cursor == ' ') || (*cursor == '\t')) {
+		cursor++;
+	}
+
+	bool negative = (*cursor == '-');
+	if ((*cursor == '-') || (*cursor == '+')) {
+		cursor++;
+	}
+
+	double_t mantissa = 0;
+	int32_t  exponent = 0;
+	bool     digits   = false;
+	for (; (*cursor >= '0') && (*cursor <= '9'); cursor++, digits = true) {
+		mantissa = mantissa * 10. + (*cursor - '0');
+	}
+	if (*cursor == '.') {
+		for (cursor++; (*cursor >= '0') && (*cursor <= '9'); cursor++, digits = true) {
+			mantissa = mantissa * 10. + (*cursor - '0');
+			exponent--;
+		}
+	}
+	if (!digits)
+		return false;
+
+	if ((*cursor == 'e') || (*cursor == 'E')) {
+		cursor++;
+		bool    exponent_negative = (*cursor == '-');
+		int32_t exponent_value    = 0;
+		if ((*cursor == '-') || (*cursor == '+')) {
+			cursor++;
+		}
+		if ((*cursor < '0') || (*cursor > '9'))
+			return false;
+		for (; (*cursor >= '0') && (*cursor <= '9') && (exponent_value < 1000); cursor++) {
+			exponent_value = exponent_value * 10 + (*cursor - '0');
+		}
+		exponent += exponent_negative ? -exponent_value : exponent_value;
+	}
+
+	value = float_t((negative ? -mantissa : mantissa) * std::pow(10., exponent));
+	return (*cursor == ' ') || (*cursor == '\t') || (*cursor == '\r') || (*cursor == '\0');
+}
+
+gfx::lut::cube::cube(std::istream& stream)
+	: _size(0), _is_3d(false), _domain_min{0.f, 0.f, 0.f}, _domain_max{1.f, 1.f, 1.f}
+{
+	// Keywords are rare enough to be read through a stream, which must not depend on the locale either.
+	std::istringstream parser;
+	parser.imbue(std::locale::classic());
+
+	std::string line;
+	size_t      line_number = 0;
+	size_t      expected    = 0;
+	while (std::getline(stream, line)) {
+		line_number++;
+
+		size_t start = line.find_first_not_of(" \t\r");
+		if ((start == std::string::npos) || (line[start] == '#')) {
+			continue;
+		}
+
+		char first = line[start];
+		if (((first >= '0') && (first <= '9')) || (first == '-') || (first == '+') || (first == '.')) {
+			if (expected == 0)
+				throw parse_error(line_number, "entry found before LUT_1D_SIZE or LUT_3D_SIZE");
+			if (_data.size() >= expected)
+				throw parse_error(line_number, "more entries than the size allows");
+
+			const char* cursor = line.c_str() + start;
+			float_t     rgb[3];
+			if (!parse_number(cursor, rgb[0]) || !parse_number(cursor, rgb[1]) || !parse_number(cursor, rgb[2]))
+				throw parse_error(line_number, "entry needs three numbers");
+			_data.insert(_data.end(), rgb, rgb + 3);
+			continue;
+		}
+
+		parser.clear();
+		parser.str(line.substr(start));
+
+		if (!_data.empty())
+			throw parse_error(line_number, "keyword found after the first entry");
+
+		std::string keyword;
+		parser >> keyword;
+		if (keyword == "TITLE") {
+			size_t open  = line.find('"', start);
+			size_t close = line.rfind('"');
+			if ((open == std::string::npos) || (close == open))
+				throw parse_error(line_number, "TITLE needs a quoted string");
+			_title = line.substr(open + 1, close - open - 1);
+		} else if ((keyword == "LUT_1D_SIZE") || (keyword == "LUT_3D_SIZE")) {
+			if (expected != 0)
+				throw parse_error(line_number, "size given more than once");
+
+			uint32_t size;
+			if (!(parser >> size))
+				throw parse_error(line_number, keyword + " needs a number");
+
+			_is_3d = (keyword == "LUT_3D_SIZE");
+			if ((size < 2) || (size > (_is_3d ? MAX_SIZE_3D : MAX_SIZE_1D)))
+				throw parse_error(line_number, keyword + " is out of range");
+
+			_size    = size;
+			expected = (_is_3d ? size_t(size) * size * size : size_t(size)) * 3;
+			_data.reserve(expected);
+		} else if ((keyword == "DOMAIN_MIN") || (keyword == "DOMAIN_MAX")) {
+			float_t* domain = (keyword == "DOMAIN_MIN") ? _domain_min : _domain_max;
+			if (!(parser >> domain[0] >> domain[1] >> domain[2]))
+				throw parse_error(line_number, keyword + " needs three numbers");
+		} else if ((keyword == "LUT_1D_INPUT_RANGE") || (keyword == "LUT_3D_INPUT_RANGE")) {
+			float_t range[2];
+			if (!(parser >> range[0] >> range[1]))
+				throw parse_error(line_number, keyword + " needs two numbers");
+			std::fill(_domain_min, _domain_min + 3, range[0]);
+			std::fill(_domain_max, _domain_max + 3, range[1]);
+		}
+		// Anything else is a vendor extension, which does not change how the entries are read.
+	}
+
+	if (expected == 0)
+		throw parse_error(line_number, "no LUT_1D_SIZE or LUT_3D_SIZE found");
+	if (_data.size() != expected)
+		throw parse_error(line_number, "expected " + std::to_string(expected / 3) + " entries, found "
+										   + std::to_string(_data.size() / 3));
+	for (size_t idx = 0; idx < 3; idx++) {
+		if (!(_domain_min[idx] < _domain_max[idx]))
+			throw parse_error(line_number, "DOMAIN_MIN must be below DOMAIN_MAX");
+	}
+}
+
+gfx::lut::cube::cube(::gfx::lut::color_grade& grade)
+	: _size(grade.get_size()), _is_3d(true), _domain_min{0.f, 0.f, 0.f}, _domain_max{1.f, 1.f, 1.f}
+{
+	// The table is stored slice by slice, with green as the row. The file wants red, green, blue.
+	const float_t* table = grade.get_data();
+	_data.resize(size_t(_size) * _size * _size * 3);
+	for (uint32_t b = 0; b < _size; b++) {
+		for (uint32_t g = 0; g < _size; g++) {
+			for (uint32_t r = 0; r < _size; r++) {
+				const float_t* entry = &table[(size_t(g) * _size * _size + size_t(b) * _size + r) * 4];
+				std::copy_n(entry, 3, &_data[((size_t(b) * _size + g) * _size + r) * 3]);
+			}
+		}
+	}
+}
+
+gfx::lut::cube::~cube() {}
+
+std::string gfx::lut::cube::get_title()
+{
+	return _title;
+}
+
+void gfx::lut::cube::set_title(std::string title)
+{
+	_title = title;
+}
+
+uint32_t gfx::lut::cube::get_size()
+{
+	return _size;
+}
+
+bool gfx::lut::cube::is_3d()
+{
+	return _is_3d;
+}
+
+const float_t* gfx::lut::cube::get_domain_min()
+{
+	return _domain_min;
+}
+
+const float_t* gfx::lut::cube::get_domain_max()
+{
+	return _domain_max;
+}
+
+const float_t* gfx::lut::cube::get_data()
+{
+	return _data.data();
+}
+
+void gfx::lut::cube::save(std::ostream& stream)
+{
+	std::ostringstream writer;
+	writer.imbue(std::locale::classic());
+	writer << std::fixed << std::setprecision(6);
+
+	if (!_title.empty())
+		writer << "TITLE \"" << _title << "\"\n";
+	writer << (_is_3d ? "LUT_3D_SIZE " : "LUT_1D_SIZE ") << _size << "\n";
+	writer << "DOMAIN_MIN " << _domain_min[0] << " " << _domain_min[1] << " " << _domain_min[2] << "\n";
+	writer << "DOMAIN_MAX " << _domain_max[0] << " " << _domain_max[1] << " " << _domain_max[2] << "\n";
+	for (size_t idx = 0; idx < _data.size(); idx += 3) {
+		writer << _data[idx] << " " << _data[idx + 1] << " " << _data[idx + 2] << "\n";
+
+		// Hand over every few thousand entries, a 65^3 table would otherwise be held in memory twice.
+		if ((idx % (3 * 4096)) == (3 * 4095)) {
+			stream << writer.str();
+			writer.str(std::string());
+		}
+	}
+	stream << writer.str();
+
+	if (!stream)
+		throw std::runtime_error("writing failed");
+}
+
+uint32_t gfx::lut::cube::get_table_size()
+{
+	return _is_3d ? _size : std::min<uint32_t>(_size, MAX_SIZE_3D);
+}
+
+std::vector<float_t> gfx::lut::cube::to_table()
+{
+	uint32_t             size = get_table_size();
+	std::vector<float_t> table(size_t(size) * size * size * 4);
+
+	if (_is_3d) {
+		for (uint32_t b = 0; b < size; b++) {
+			for (uint32_t g = 0; g < size; g++) {
+				for (uint32_t r = 0; r < size; r++) {
+					float_t* entry = &table[(size_t(g) * size * size + size_t(b) * size + r) * 4];
+					std::copy_n(&_data[((size_t(b) * size + g) * size + r) * 3], 3, entry);
+					entry[3] = 1.f;
+				}
+			}
+		}
+		return table;
+	}
+
+	// Resample each curve at the steps of the table, then combine them.
+	std::vector<float_t> curves(size_t(size) * 3);
+	for (uint32_t step = 0; step < size; step++) {
+		float_t  pos  = float_t(step) / float_t(size - 1) * float_t(_size - 1);
+		uint32_t lo   = std::min(uint32_t(pos), _size - 2);
+		float_t  frac = pos - float_t(lo);
+		for (size_t channel = 0; channel < 3; channel++) {
+			float_t a                       = _data[size_t(lo) * 3 + channel];
+			float_t b                       = _data[size_t(lo + 1) * 3 + channel];
+			curves[size_t(step) * 3 + channel] = a + (b - a) * frac;
+		}
+	}
+	for (uint32_t b = 0; b < size; b++) {
+		for (uint32_t g = 0; g < size; g++) {
+			for (uint32_t r = 0; r < size; r++) {
+				float_t* entry = &table[(size_t(g) * size * size + size_t(b) * size + r) * 4];
+				entry[0]       = curves[size_t(r) * 3 + 0];
+				entry[1]       = curves[size_t(g) * 3 + 1];
+				entry[2]       = curves[size_t(b) * 3 + 2];
+				entry[3]       = 1.f;
+			}
+		}
+	}
+	return table;
+}
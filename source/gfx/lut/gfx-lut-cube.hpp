@@ -0,0 +1,91 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#pragma once
+#include <cinttypes>
+#include <cmath>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "gfx-lut-color-grade.hpp"
+
+namespace gfx {
+	namespace lut {
+		/*!
+		 * \brief A lookup table in the Adobe/Resolve .cube format.
+		 *
+		 * Holds either a 1D table (one curve per channel) or a 3D table, with the entries in file
+		 *  order: red changes fastest, then green, then blue.
+		 */
+		class cube {
+			std::string          _title;
+			uint32_t             _size;
+			bool                 _is_3d;
+			float_t              _domain_min[3];
+			float_t              _domain_max[3];
+			std::vector<float_t> _data;
+
+			public:
+			/*!
+			 * \brief Read a .cube file line by line.
+			 *
+			 * Accepts 1D tables of up to 65536 entries and 3D tables of up to 65 entries per axis.
+			 *  Throws std::runtime_error naming the line of the first problem found.
+			 */
+			cube(std::istream& stream);
+
+			/*!
+			 * \brief 3D table holding the entries of a baked color grade.
+			 */
+			cube(::gfx::lut::color_grade& grade);
+
+			~cube();
+
+			std::string get_title();
+
+			void set_title(std::string title);
+
+			uint32_t get_size();
+
+			bool is_3d();
+
+			const float_t* get_domain_min();
+
+			const float_t* get_domain_max();
+
+			/*!
+			 * \brief Three floats per entry, in file order.
+			 */
+			const float_t* get_data();
+
+			void save(std::ostream& stream);
+
+			/*!
+			 * \brief Number of entries per axis of the table returned by to_table().
+			 *
+			 * A 1D table is expanded into a 3D table of at most 65 entries per axis.
+			 */
+			uint32_t get_table_size();
+
+			/*!
+			 * \brief Entries in the layout of ::gfx::lut::color_grade, ready for 'DrawLUT'.
+			 */
+			std::vector<float_t> to_table();
+		};
+	} // namespace lut
+} // namespace gfx
@@ -0,0 +1,248 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "gfx-sdf-cpu.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include "gfx-sdf-edt.hpp"
+
+// Must match the defines in 'sdf-producer.effect'.
+#define MAX_DISTANCE 65536.0f
+#define NEAR_INFINITE 18446744073709551616.0f
+#define RANGE 4
+
+gfx::sdf::cpu_reference::cpu_reference(uint32_t width, uint32_t height) : _width(width), _height(height)
+{
+	if ((width == 0) || (height == 0))
+		throw std::invalid_argument("width and height must be at least 1");
+
+	_front.resize(size_t(width) * height * 4);
+	_back.resize(_front.size());
+	clear();
+}
+
+gfx::sdf::cpu_reference::~cpu_reference() {}
+
+uint32_t gfx::sdf::cpu_reference::get_width()
+{
+	return _width;
+}
+
+uint32_t gfx::sdf::cpu_reference::get_height()
+{
+	return _height;
+}
+
+void gfx::sdf::cpu_reference::clear()
+{
+	std::fill(_front.begin(), _front.end(), 0.f);
+}
+
+const float_t* gfx::sdf::cpu_reference::at(uint32_t x, uint32_t y)
+{
+	return &_front[(size_t(y) * _width + x) * 4];
+}
+
+void gfx::sdf::cpu_reference::render(const uint8_t* mask, size_t stride)
+{
+	::gfx::sdf::rect area = {0, 0, _width, _height};
+	render_area(mask, stride, area);
+	std::swap(_front, _back);
+}
+
+void gfx::sdf::cpu_reference::render(const uint8_t* mask, size_t stride, const std::vector<::gfx::sdf::rect>& areas)
+{
+	_back = _front;
+	for (const ::gfx::sdf::rect& area : areas) {
+		render_area(mask, stride, area);
+	}
+	std::swap(_front, _back);
+}
+
+float_t gfx::sdf::cpu_reference::get_distance(uint32_t x, uint32_t y)
+{
+	const float_t* texel = at(x, y);
+	return (texel[0] - texel[1]) * MAX_DISTANCE;
+}
+
+void gfx::sdf::cpu_reference::render_area(const uint8_t* mask, size_t stride, const ::gfx::sdf::rect& area)
+{
+	if (!mask)
+		throw std::invalid_argument("mask");
+
+	const float_t step = 1.f / MAX_DISTANCE;
+
+	// 'sdfSampler1_1' uses a white border, and all offsets land exactly on texel centers.
+	auto sample = [this](int64_t x, int64_t y) -> const float_t* {
+		static const float_t border[4] = {1.f, 1.f, 1.f, 1.f};
+		if ((x < 0) || (y < 0) || (x >= int64_t(_width)) || (y >= int64_t(_height)))
+			return border;
+		return &_front[(size_t(y) * _width + size_t(x)) * 4];
+	};
+
+	uint32_t x_end = std::min(area.x + area.width, _width);
+	uint32_t y_end = std::min(area.y + area.height, _height);
+	for (uint32_t y = area.y; y < y_end; y++) {
+		for (uint32_t x = area.x; x < x_end; x++) {
+			float_t* out = &_back[(size_t(y) * _width + x) * 4];
+			out[0]       = 0.f;
+			out[1]       = 0.f;
+			out[2]       = (float_t(x) + 0.5f) / float_t(_width);
+			out[3]       = (float_t(y) + 0.5f) / float_t(_height);
+
+			// Inside texels track the distance in G, outside texels in R.
+			size_t channel = (mask[stride * y + x] != 0) ? 1 : 0;
+
+			float_t        lowest = NEAR_INFINITE;
+			const float_t* origin = nullptr;
+			for (int64_t dx = -RANGE; dx < RANGE; dx++) {
+				for (int64_t dy = -RANGE; dy < RANGE; dy++) {
+					if ((dx == 0) && (dy == 0)) {
+						continue;
+					}
+
+					const float_t* here = sample(int64_t(x) + dx, int64_t(y) + dy);
+					float_t        dst  = std::sqrt(float_t(dx * dx + dy * dy)) * step;
+					if (lowest > (here[channel] + dst)) {
+						lowest = here[channel] + dst;
+						origin = here;
+					}
+				}
+			}
+
+			if (origin) {
+				out[channel] = lowest;
+				out[2]       = origin[2];
+				out[3]       = origin[3];
+			} else {
+				out[channel] = sample(x, y)[channel] + step;
+			}
+		}
+	}
+}
+
+void gfx::sdf::cpu_reference::render_jump_flooding(const uint8_t* mask, size_t stride)
+{
+	if (!mask)
+		throw std::invalid_argument("mask");
+
+	// Seeds hold the nearest solid (X, Y) and the nearest empty (X, Y) texel, -1 if there is none yet.
+	std::vector<int64_t> seeds(size_t(_width) * _height * 4);
+	std::vector<int64_t> flooded(seeds.size());
+	for (uint32_t y = 0; y < _height; y++) {
+		for (uint32_t x = 0; x < _width; x++) {
+			int64_t* seed = &seeds[(size_t(y) * _width + x) * 4];
+			bool     solid = mask[stride * y + x] != 0;
+			seed[0]        = solid ? int64_t(x) : -1;
+			seed[1]        = solid ? int64_t(y) : -1;
+			seed[2]        = solid ? -1 : int64_t(x);
+			seed[3]        = solid ? -1 : int64_t(y);
+		}
+	}
+
+	auto seed_distance = [](const int64_t* seed, int64_t x, int64_t y) {
+		if (seed[0] < 0)
+			return std::numeric_limits<int64_t>::max();
+		return (seed[0] - x) * (seed[0] - x) + (seed[1] - y) * (seed[1] - y);
+	};
+
+	auto flood = [&](int64_t step) {
+		for (int64_t y = 0; y < int64_t(_height); y++) {
+			for (int64_t x = 0; x < int64_t(_width); x++) {
+				int64_t* best = &flooded[(size_t(y) * _width + size_t(x)) * 4];
+				std::copy_n(&seeds[(size_t(y) * _width + size_t(x)) * 4], 4, best);
+				int64_t best_solid = seed_distance(best, x, y);
+				int64_t best_empty = seed_distance(best + 2, x, y);
+
+				for (int64_t dx = -1; dx <= 1; dx++) {
+					for (int64_t dy = -1; dy <= 1; dy++) {
+						if ((dx == 0) && (dy == 0)) {
+							continue;
+						}
+
+						// 'seedSampler' clamps to the edge.
+						int64_t        sx    = std::clamp<int64_t>(x + dx * step, 0, _width - 1);
+						int64_t        sy    = std::clamp<int64_t>(y + dy * step, 0, _height - 1);
+						const int64_t* here  = &seeds[(size_t(sy) * _width + size_t(sx)) * 4];
+						int64_t        solid = seed_distance(here, x, y);
+						int64_t        empty = seed_distance(here + 2, x, y);
+						if (solid < best_solid) {
+							best_solid = solid;
+							best[0]    = here[0];
+							best[1]    = here[1];
+						}
+						if (empty < best_empty) {
+							best_empty = empty;
+							best[2]    = here[2];
+							best[3]    = here[3];
+						}
+					}
+				}
+			}
+		}
+		std::swap(seeds, flooded);
+	};
+
+	int64_t step = 1;
+	while ((step * 2) < int64_t(std::max(_width, _height))) {
+		step *= 2;
+	}
+	for (; step >= 1; step /= 2) {
+		flood(step);
+	}
+	flood(1);
+
+	for (uint32_t y = 0; y < _height; y++) {
+		for (uint32_t x = 0; x < _width; x++) {
+			const int64_t* seed = &seeds[(size_t(y) * _width + x) * 4];
+			if (mask[stride * y + x] != 0)
+				seed += 2;
+			int64_t dist = seed_distance(seed, x, y);
+			store(mask, stride, x, y,
+				  (dist == std::numeric_limits<int64_t>::max()) ? std::numeric_limits<double_t>::infinity()
+																: std::sqrt(double_t(dist)),
+				  seed[0], seed[1]);
+		}
+	}
+}
+
+void gfx::sdf::cpu_reference::render_exact(const uint8_t* mask, size_t stride)
+{
+	::gfx::sdf::edt(_width, _height).bake(mask, stride, _front.data());
+}
+
+void gfx::sdf::cpu_reference::store(const uint8_t* mask, size_t stride, uint32_t x, uint32_t y, double_t distance,
+									int64_t nearest_x, int64_t nearest_y)
+{
+	float_t* out = &_front[(size_t(y) * _width + x) * 4];
+	out[0]       = 0.f;
+	out[1]       = 0.f;
+	out[2]       = (float_t(x) + 0.5f) / float_t(_width);
+	out[3]       = (float_t(y) + 0.5f) / float_t(_height);
+
+	float_t dist = float_t(std::min(distance, double_t(MAX_DISTANCE)) / MAX_DISTANCE);
+	if (mask[stride * y + x] != 0) {
+		out[1] = dist;
+	} else {
+		out[0] = dist;
+	}
+	if (nearest_x >= 0) {
+		out[2] = (float_t(nearest_x) + 0.5f) / float_t(_width);
+		out[3] = (float_t(nearest_y) + 0.5f) / float_t(_height);
+	}
+}
@@ -0,0 +1,103 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#pragma once
+#include <cinttypes>
+#include <cmath>
+#include <vector>
+#include "gfx-sdf-tiles.hpp"
+
+namespace gfx {
+	namespace sdf {
+		/*!
+		 * \brief Reference implementation of the SDF producers on the CPU.
+		 *
+		 * Mirrors 'sdf-producer.effect' texel for texel: every call to render() is one pass of
+		 *  the iterative refinement, with R holding the outside and G the inside distance
+		 *  (divided by 65536) and BA the coordinates of the nearest edge. It is meant to verify
+		 *  the GPU path and anything that changes which texels are refined, such as the
+		 *  incremental mode driven by tile_tracker. The same layout is produced by the jump
+		 *  flooding producer and by an exact Euclidean distance transform, which serves as the
+		 *  ground truth for both.
+		 */
+		class cpu_reference {
+			uint32_t             _width;
+			uint32_t             _height;
+			std::vector<float_t> _front;
+			std::vector<float_t> _back;
+
+			public:
+			cpu_reference(uint32_t width, uint32_t height);
+			~cpu_reference();
+
+			uint32_t get_width();
+
+			uint32_t get_height();
+
+			/*!
+			 * \brief Reset the field to zero, same as a freshly cleared render target.
+			 */
+			void clear();
+
+			/*!
+			 * \brief Current value of a texel.
+			 *
+			 * \return Pointer to four floats (R, G, B, A).
+			 */
+			const float_t* at(uint32_t x, uint32_t y);
+
+			/*!
+			 * \brief Refine the whole field once.
+			 *
+			 * \param mask One byte per texel, non-zero where the input is solid.
+			 * \param stride Distance in bytes between two rows of the mask.
+			 */
+			void render(const uint8_t* mask, size_t stride);
+
+			/*!
+			 * \brief Refine only the given areas once, everything else keeps its value.
+			 */
+			void render(const uint8_t* mask, size_t stride, const std::vector<::gfx::sdf::rect>& areas);
+
+			/*!
+			 * \brief Replace the field with the result of 'sdf-jump-flooding.effect'.
+			 *
+			 * Runs the seed pass, one flood pass per power of two below the field size plus an
+			 *  extra pass with a step of one, and the resolve pass.
+			 */
+			void render_jump_flooding(const uint8_t* mask, size_t stride);
+
+			/*!
+			 * \brief Replace the field with the exact distance to the nearest opposite texel.
+			 *
+			 * Uses ::gfx::sdf::edt, which also tracks the nearest texel so BA matches the other producers.
+			 */
+			void render_exact(const uint8_t* mask, size_t stride);
+
+			/*!
+			 * \brief Signed distance in texels at a texel, positive outside and negative inside.
+			 */
+			float_t get_distance(uint32_t x, uint32_t y);
+
+			private:
+			void render_area(const uint8_t* mask, size_t stride, const ::gfx::sdf::rect& area);
+
+			void store(const uint8_t* mask, size_t stride, uint32_t x, uint32_t y, double_t distance,
+					   int64_t nearest_x, int64_t nearest_y);
+		};
+	} // namespace sdf
+} // namespace gfx
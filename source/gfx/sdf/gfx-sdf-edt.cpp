@@ -0,0 +1,212 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "gfx-sdf-edt.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+// Must match the define in 'sdf-producer.effect'.
+#define MAX_DISTANCE 65536.0
+
+// Anything at or above this is treated as "no texel found".
+#define INFINITE_DISTANCE 1e20
+
+#define NO_TEXEL std::numeric_limits<uint32_t>::max()
+
+gfx::sdf::edt::edt(uint32_t width, uint32_t height, size_t threads)
+	: _width(width), _height(height), _threads(threads), _cancel(nullptr)
+{
+	if ((width == 0) || (height == 0))
+		throw std::invalid_argument("width and height must be at least 1");
+
+	if (_threads == 0)
+		_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+	size_t texels = size_t(width) * height;
+	_column.resize(texels);
+	_solid_distance.resize(texels);
+	_solid_nearest.resize(texels);
+	_empty_distance.resize(texels);
+	_empty_nearest.resize(texels);
+}
+
+gfx::sdf::edt::~edt() {}
+
+uint32_t gfx::sdf::edt::get_width()
+{
+	return _width;
+}
+
+uint32_t gfx::sdf::edt::get_height()
+{
+	return _height;
+}
+
+size_t gfx::sdf::edt::get_threads()
+{
+	return _threads;
+}
+
+bool gfx::sdf::edt::bake(const uint8_t* mask, size_t stride, float_t* field, const std::atomic<bool>* cancel)
+{
+	if (!mask)
+		throw std::invalid_argument("mask");
+	if (!field)
+		throw std::invalid_argument("field");
+
+	_cancel = cancel;
+	transform(mask, stride, true, _solid_distance, _solid_nearest);
+	transform(mask, stride, false, _empty_distance, _empty_nearest);
+	if (is_cancelled()) {
+		_cancel = nullptr;
+		return false;
+	}
+
+	parallel(_height, [this, mask, stride, field](uint32_t begin, uint32_t end) {
+		for (uint32_t y = begin; y < end; y++) {
+			for (uint32_t x = 0; x < _width; x++) {
+				size_t   idx = size_t(y) * _width + x;
+				float_t* out = field + idx * 4;
+				out[0]       = 0.f;
+				out[1]       = 0.f;
+				out[2]       = (float_t(x) + 0.5f) / float_t(_width);
+				out[3]       = (float_t(y) + 0.5f) / float_t(_height);
+
+				// Inside looks for the nearest empty texel, outside for the nearest solid one.
+				bool     inside  = mask[stride * y + x] != 0;
+				uint32_t nearest = inside ? _empty_nearest[idx] : _solid_nearest[idx];
+				double_t dist    = MAX_DISTANCE;
+				if (nearest != NO_TEXEL) {
+					dist   = std::min(std::sqrt(inside ? _empty_distance[idx] : _solid_distance[idx]), MAX_DISTANCE);
+					out[2] = (float_t(nearest % _width) + 0.5f) / float_t(_width);
+					out[3] = (float_t(nearest / _width) + 0.5f) / float_t(_height);
+				}
+				out[inside ? 1 : 0] = float_t(dist / MAX_DISTANCE);
+			}
+		}
+	});
+	_cancel = nullptr;
+	return true;
+}
+
+void gfx::sdf::edt::transform(const uint8_t* mask, size_t stride, bool solid, std::vector<double_t>& distance,
+							  std::vector<uint32_t>& nearest)
+{
+	// Columns: row of the nearest matching texel in the same column. Walked row by row over a
+	//  chunk of columns, which keeps the accesses sequential.
+	if (is_cancelled())
+		return;
+	parallel(_width, [this, mask, stride, solid](uint32_t begin, uint32_t end) {
+		std::vector<uint32_t> last(end - begin, NO_TEXEL);
+		for (uint32_t y = 0; y < _height; y++) {
+			for (uint32_t x = begin; x < end; x++) {
+				if ((mask[stride * y + x] != 0) == solid)
+					last[x - begin] = y;
+				_column[size_t(y) * _width + x] = last[x - begin];
+			}
+		}
+		std::fill(last.begin(), last.end(), NO_TEXEL);
+		for (uint32_t y = _height; y > 0; y--) {
+			for (uint32_t x = begin; x < end; x++) {
+				if ((mask[stride * (y - 1) + x] != 0) == solid)
+					last[x - begin] = y - 1;
+
+				uint32_t  below = last[x - begin];
+				uint32_t& row   = _column[size_t(y - 1) * _width + x];
+				if ((below != NO_TEXEL) && ((row == NO_TEXEL) || ((below - (y - 1)) < ((y - 1) - row))))
+					row = below;
+			}
+		}
+	});
+
+	// Rows: lower envelope of the parabolas rooted at each column's squared distance.
+	parallel(_height, [this, &distance, &nearest](uint32_t begin, uint32_t end) {
+		std::vector<double_t> f(_width);
+		std::vector<uint32_t> v(_width);
+		std::vector<double_t> z(size_t(_width) + 1);
+		for (uint32_t y = begin; (y < end) && !is_cancelled(); y++) {
+			const uint32_t* column = &_column[size_t(y) * _width];
+			for (uint32_t x = 0; x < _width; x++) {
+				if (column[x] == NO_TEXEL) {
+					f[x] = INFINITE_DISTANCE;
+				} else {
+					double_t dy = double_t(column[x]) - double_t(y);
+					f[x]        = dy * dy;
+				}
+			}
+
+			size_t k = 0;
+			v[0]     = 0;
+			z[0]     = -std::numeric_limits<double_t>::infinity();
+			z[1]     = std::numeric_limits<double_t>::infinity();
+			for (uint32_t q = 1; q < _width; q++) {
+				double_t s = ((f[q] + double_t(q) * q) - (f[v[k]] + double_t(v[k]) * v[k])) / (2.0 * q - 2.0 * v[k]);
+				while (s <= z[k]) {
+					k--;
+					s = ((f[q] + double_t(q) * q) - (f[v[k]] + double_t(v[k]) * v[k])) / (2.0 * q - 2.0 * v[k]);
+				}
+				k++;
+				v[k]     = q;
+				z[k]     = s;
+				z[k + 1] = std::numeric_limits<double_t>::infinity();
+			}
+
+			k = 0;
+			for (uint32_t q = 0; q < _width; q++) {
+				while (z[k + 1] < q)
+					k++;
+				double_t dx  = double_t(q) - double_t(v[k]);
+				double_t d   = dx * dx + f[v[k]];
+				size_t   idx = size_t(y) * _width + q;
+				if (d >= INFINITE_DISTANCE) {
+					distance[idx] = std::numeric_limits<double_t>::infinity();
+					nearest[idx]  = NO_TEXEL;
+				} else {
+					distance[idx] = d;
+					nearest[idx]  = column[v[k]] * _width + v[k];
+				}
+			}
+		}
+	});
+}
+
+bool gfx::sdf::edt::is_cancelled()
+{
+	return _cancel && _cancel->load(std::memory_order_relaxed);
+}
+
+void gfx::sdf::edt::parallel(uint32_t count, std::function<void(uint32_t, uint32_t)> fn)
+{
+	size_t   threads = std::min<size_t>(_threads, count);
+	uint32_t chunk   = uint32_t((count + threads - 1) / threads);
+
+	// The calling thread takes the first chunk itself.
+	std::vector<std::thread> workers;
+	workers.reserve(threads - 1);
+	for (size_t idx = 1; idx < threads; idx++) {
+		uint32_t begin = uint32_t(std::min<size_t>(idx * chunk, count));
+		uint32_t end   = std::min(begin + chunk, count);
+		if (begin < end)
+			workers.emplace_back(fn, begin, end);
+	}
+	fn(0, std::min(chunk, count));
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
@@ -0,0 +1,88 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#pragma once
+#include <atomic>
+#include <cinttypes>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace gfx {
+	namespace sdf {
+		/*!
+		 * \brief Exact Euclidean distance transform on the CPU, for baking a distance field once.
+		 *
+		 * Separable squared distance transform by Felzenszwalb and Huttenlocher: every column
+		 *  is solved on its own first, then every row. Both passes are split into equal chunks
+		 *  across the worker threads. The result uses the same layout as 'sdf-producer.effect',
+		 *  so it can be handed to 'sdf-consumer.effect' as is.
+		 */
+		class edt {
+			uint32_t _width;
+			uint32_t _height;
+			size_t   _threads;
+
+			// Row of the nearest matching texel in the same column, per texel.
+			std::vector<uint32_t> _column;
+
+			// Squared distance to and index of the nearest solid and nearest empty texel, per texel.
+			std::vector<double_t> _solid_distance;
+			std::vector<uint32_t> _solid_nearest;
+			std::vector<double_t> _empty_distance;
+			std::vector<uint32_t> _empty_nearest;
+
+			// Set by bake() for as long as it runs.
+			const std::atomic<bool>* _cancel;
+
+			public:
+			/*!
+			 * \param threads Number of threads to split the work across, 0 for one per hardware thread.
+			 */
+			edt(uint32_t width, uint32_t height, size_t threads = 0);
+			~edt();
+
+			uint32_t get_width();
+
+			uint32_t get_height();
+
+			size_t get_threads();
+
+			/*!
+			 * \brief Compute the distance field for a mask.
+			 *
+			 * \param mask One byte per texel, non-zero where the input is solid.
+			 * \param stride Distance in bytes between two rows of the mask.
+			 * \param field Four floats per texel, row by row: R is the distance to the nearest solid
+			 *  texel for empty texels, G the distance to the nearest empty texel for solid ones (both
+			 *  divided by 65536) and BA the texture coordinates of that texel.
+			 * \param cancel Checked between passes and rows, the bake stops early once it is set.
+			 * \return false if the bake was cancelled, in which case the field is incomplete.
+			 */
+			bool bake(const uint8_t* mask, size_t stride, float_t* field, const std::atomic<bool>* cancel = nullptr);
+
+			private:
+			void transform(const uint8_t* mask, size_t stride, bool solid, std::vector<double_t>& distance,
+						   std::vector<uint32_t>& nearest);
+
+			bool is_cancelled();
+
+			// Run fn(begin, end) for equal chunks of [0, count) on all threads and wait for them.
+			void parallel(uint32_t count, std::function<void(uint32_t, uint32_t)> fn);
+		};
+	} // namespace sdf
+} // namespace gfx
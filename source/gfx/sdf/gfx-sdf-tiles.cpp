@@ -0,0 +1,193 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "gfx-sdf-tiles.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// Search radius of a single producer pass, see RANGE in 'sdf-producer.effect'.
+#define PRODUCER_RANGE 4
+
+gfx::sdf::tile_tracker::tile_tracker(uint32_t tile_size)
+	: _width(0), _height(0), _tile_size(tile_size), _tiles_x(0), _tiles_y(0), _range(0), _reach(0), _settle(0),
+	  _has_hashes(false), _pending_tiles(0)
+{
+	if (tile_size == 0)
+		throw std::invalid_argument("tile_size must be at least 1");
+	set_range(0);
+}
+
+gfx::sdf::tile_tracker::~tile_tracker() {}
+
+void gfx::sdf::tile_tracker::resize(uint32_t width, uint32_t height)
+{
+	_width   = width;
+	_height  = height;
+	_tiles_x = (width + _tile_size - 1) / _tile_size;
+	_tiles_y = (height + _tile_size - 1) / _tile_size;
+	_hashes.resize(size_t(_tiles_x) * _tiles_y);
+	_pending.resize(size_t(_tiles_x) * _tiles_y);
+	invalidate();
+}
+
+uint32_t gfx::sdf::tile_tracker::get_width()
+{
+	return _width;
+}
+
+uint32_t gfx::sdf::tile_tracker::get_height()
+{
+	return _height;
+}
+
+uint32_t gfx::sdf::tile_tracker::get_tile_size()
+{
+	return _tile_size;
+}
+
+void gfx::sdf::tile_tracker::set_range(uint32_t range)
+{
+	if ((range == _range) && (_settle != 0))
+		return;
+
+	// A change moves the field by up to PRODUCER_RANGE texels per pass towards smaller distances,
+	//  but grows distances by only a single texel per pass. Texels at the border of a pending
+	//  area may also pick up stale values from settled neighbours, which is covered by the margin.
+	uint32_t margin = PRODUCER_RANGE * 2;
+	_range          = range;
+	_reach          = (range + margin + _tile_size - 1) / _tile_size;
+	_settle         = range + margin + 1;
+	invalidate();
+}
+
+uint32_t gfx::sdf::tile_tracker::get_range()
+{
+	return _range;
+}
+
+void gfx::sdf::tile_tracker::invalidate()
+{
+	_has_hashes = false;
+	std::fill(_pending.begin(), _pending.end(), _settle);
+}
+
+void gfx::sdf::tile_tracker::update(const uint8_t* mask, size_t stride)
+{
+	if (!mask)
+		throw std::invalid_argument("mask");
+
+	bool had_hashes = _has_hashes;
+	for (uint32_t ty = 0; ty < _tiles_y; ty++) {
+		uint32_t y0 = ty * _tile_size;
+		uint32_t y1 = std::min(y0 + _tile_size, _height);
+		for (uint32_t tx = 0; tx < _tiles_x; tx++) {
+			uint32_t x0 = tx * _tile_size;
+			uint32_t x1 = std::min(x0 + _tile_size, _width);
+
+			// Word-wise multiplicative hash, each row is salted with its index so moved content shows up.
+			uint64_t hash = 0xCBF29CE484222325ull;
+			for (uint32_t y = y0; y < y1; y++) {
+				const uint8_t* row = mask + stride * y + x0;
+				size_t         len = x1 - x0;
+				size_t         idx = 0;
+				for (; (idx + sizeof(uint64_t)) <= len; idx += sizeof(uint64_t)) {
+					uint64_t word;
+					std::memcpy(&word, row + idx, sizeof(uint64_t));
+					hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+					hash ^= hash >> 32;
+				}
+				for (; idx < len; idx++) {
+					hash = (hash ^ row[idx]) * 0x100000001B3ull;
+				}
+				hash = (hash ^ y) * 0x9E3779B97F4A7C15ull;
+			}
+
+			uint64_t& last = _hashes[size_t(ty) * _tiles_x + tx];
+			if (had_hashes && (last != hash)) {
+				mark(tx, ty);
+			}
+			last = hash;
+		}
+	}
+	_has_hashes = true;
+}
+
+const std::vector<::gfx::sdf::rect>& gfx::sdf::tile_tracker::advance()
+{
+	_rects.clear();
+	_pending_tiles = 0;
+
+	// Merge pending tiles into horizontal runs, and runs into the rectangle directly above if they line up.
+	for (uint32_t ty = 0; ty < _tiles_y; ty++) {
+		uint32_t y      = ty * _tile_size;
+		uint32_t height = std::min(_tile_size, _height - y);
+		for (uint32_t tx = 0; tx < _tiles_x; tx++) {
+			if (_pending[size_t(ty) * _tiles_x + tx] == 0)
+				continue;
+
+			uint32_t first = tx;
+			for (; (tx < _tiles_x) && (_pending[size_t(ty) * _tiles_x + tx] != 0); tx++) {
+				_pending[size_t(ty) * _tiles_x + tx]--;
+				_pending_tiles++;
+			}
+
+			::gfx::sdf::rect run;
+			run.x      = first * _tile_size;
+			run.y      = y;
+			run.width  = std::min(tx * _tile_size, _width) - run.x;
+			run.height = height;
+
+			bool merged = false;
+			for (::gfx::sdf::rect& above : _rects) {
+				if ((above.x == run.x) && (above.width == run.width) && ((above.y + above.height) == run.y)) {
+					above.height += run.height;
+					merged = true;
+					break;
+				}
+			}
+			if (!merged)
+				_rects.push_back(run);
+		}
+	}
+
+	return _rects;
+}
+
+size_t gfx::sdf::tile_tracker::get_pending_tiles()
+{
+	return _pending_tiles;
+}
+
+size_t gfx::sdf::tile_tracker::get_total_tiles()
+{
+	return size_t(_tiles_x) * _tiles_y;
+}
+
+void gfx::sdf::tile_tracker::mark(uint32_t tx, uint32_t ty)
+{
+	uint32_t x0 = tx > _reach ? tx - _reach : 0;
+	uint32_t y0 = ty > _reach ? ty - _reach : 0;
+	uint32_t x1 = std::min(tx + _reach, _tiles_x - 1);
+	uint32_t y1 = std::min(ty + _reach, _tiles_y - 1);
+	for (uint32_t y = y0; y <= y1; y++) {
+		for (uint32_t x = x0; x <= x1; x++) {
+			uint32_t& pending = _pending[size_t(y) * _tiles_x + x];
+			pending           = std::max(pending, _settle);
+		}
+	}
+}
@@ -0,0 +1,113 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+namespace gfx {
+	namespace sdf {
+		struct rect {
+			uint32_t x;
+			uint32_t y;
+			uint32_t width;
+			uint32_t height;
+		};
+
+		/*!
+		 * \brief Tracks which parts of a distance field still need to be refined.
+		 *
+		 * The field is split into square tiles, each of which is hashed from the thresholded
+		 *  input mask. A tile whose hash changed marks itself and every tile within reach of
+		 *  the effect range as pending for as many frames as the iterative producer needs to
+		 *  settle again. Everything else keeps last frame's values.
+		 */
+		class tile_tracker {
+			uint32_t _width;
+			uint32_t _height;
+			uint32_t _tile_size;
+			uint32_t _tiles_x;
+			uint32_t _tiles_y;
+
+			uint32_t _range;
+			uint32_t _reach;
+			uint32_t _settle;
+
+			bool                  _has_hashes;
+			std::vector<uint64_t> _hashes;
+			std::vector<uint32_t> _pending;
+			std::vector<rect>     _rects;
+			size_t                _pending_tiles;
+
+			public:
+			tile_tracker(uint32_t tile_size = 32);
+			~tile_tracker();
+
+			/*!
+			 * \brief Change the size of the field, which marks everything as pending.
+			 */
+			void resize(uint32_t width, uint32_t height);
+
+			uint32_t get_width();
+
+			uint32_t get_height();
+
+			uint32_t get_tile_size();
+
+			/*!
+			 * \brief Set the largest distance (in texels) any effect reads from the field.
+			 *
+			 * Distances beyond this are never refined again once they are out of reach of a
+			 *  change. Changing the range marks everything as pending.
+			 */
+			void set_range(uint32_t range);
+
+			uint32_t get_range();
+
+			/*!
+			 * \brief Forget all hashes and mark every tile as pending.
+			 */
+			void invalidate();
+
+			/*!
+			 * \brief Compare the mask against the last one and mark changed tiles.
+			 *
+			 * \param mask One byte per texel, non-zero where the input is solid.
+			 * \param stride Distance in bytes between two rows of the mask.
+			 */
+			void update(const uint8_t* mask, size_t stride);
+
+			/*!
+			 * \brief Collect the pending areas for this frame and count down their remaining frames.
+			 *
+			 * \return Rectangles (in texels) that need to be refined, empty if the field is settled.
+			 */
+			const std::vector<::gfx::sdf::rect>& advance();
+
+			/*!
+			 * \brief Number of tiles that were returned by the last advance().
+			 */
+			size_t get_pending_tiles();
+
+			size_t get_total_tiles();
+
+			private:
+			void mark(uint32_t tx, uint32_t ty);
+		};
+	} // namespace sdf
+} // namespace gfx
@@ -80,6 +80,9 @@ gs::effect::effect(std::string file)
 		throw std::runtime_error(error);
 	}
 #endif
+
+	gs::count_object(gs::object_type::Effect, true);
+	cache_parameters();
 }
 
 gs::effect::effect(std::string code, std::string name)
@@ -95,12 +98,32 @@ gs::effect::effect(std::string code, std::string name)
 		}
 		throw std::runtime_error(error);
 	}
+
+	gs::count_object(gs::object_type::Effect, true);
+	cache_parameters();
 }
 
 gs::effect::~effect()
 {
+	_parameters.clear();
+
 	auto gctx = gs::context();
 	gs_effect_destroy(_effect);
+	gs::count_object(gs::object_type::Effect, false);
+}
+
+void gs::effect::cache_parameters()
+{
+	size_t num = gs_effect_get_num_params(_effect);
+	_parameters.reserve(num);
+	for (size_t idx = 0; idx < num; idx++) {
+		gs_eparam_t* param = gs_effect_get_param_by_idx(_effect, idx);
+		if (!param)
+			continue;
+
+		auto eprm = std::make_unique<effect_parameter>(this, param);
+		_parameters.emplace(std::string_view(eprm->_param_info.name), std::move(eprm));
+	}
 }
 
 gs_effect_t* gs::effect::get_object()
@@ -133,15 +156,23 @@ std::shared_ptr<gs::effect_parameter> gs::effect::get_parameter(size_t idx)
 
 std::shared_ptr<gs::effect_parameter> gs::effect::get_parameter(std::string name)
 {
-	gs_eparam_t* param = gs_effect_get_param_by_name(_effect, name.c_str());
-	if (!param)
+	auto eprm = find_parameter(name);
+	if (!eprm)
 		return nullptr;
-	return std::make_shared<effect_parameter>(this->shared_from_this(), param);
+	return std::make_shared<effect_parameter>(this->shared_from_this(), eprm->_param);
+}
+
+gs::effect_parameter* gs::effect::find_parameter(std::string_view name)
+{
+	auto kv = _parameters.find(name);
+	if (kv == _parameters.end())
+		return nullptr;
+	return kv->second.get();
 }
 
 bool gs::effect::has_parameter(std::string name)
 {
-	auto eprm = get_parameter(name);
+	auto eprm = find_parameter(name);
 	if (eprm)
 		return true;
 	return false;
@@ -149,7 +180,7 @@ bool gs::effect::has_parameter(std::string name)
 
 bool gs::effect::has_parameter(std::string name, effect_parameter::type type)
 {
-	auto eprm = get_parameter(name);
+	auto eprm = find_parameter(name);
 	if (eprm)
 		return eprm->get_type() == type;
 	return false;
@@ -166,7 +197,17 @@ std::shared_ptr<gs::effect> gs::effect::create(std::string code, std::string nam
 }
 
 gs::effect_parameter::effect_parameter(std::shared_ptr<gs::effect> effect, gs_eparam_t* param)
-	: _effect(effect), _param(param)
+	: _effect(effect), _parent(effect.get()), _param(param)
+{
+	if (!effect)
+		throw std::invalid_argument("effect");
+	if (!param)
+		throw std::invalid_argument("param");
+
+	gs_effect_get_param_info(_param, &_param_info);
+}
+
+gs::effect_parameter::effect_parameter(gs::effect* effect, gs_eparam_t* param) : _parent(effect), _param(param)
 {
 	if (!effect)
 		throw std::invalid_argument("effect");
@@ -757,7 +798,7 @@ std::shared_ptr<gs::effect_parameter> gs::effect_parameter::get_annotation(size_
 	gs_eparam_t* param = gs_param_get_annotation_by_idx(_param, idx);
 	if (!param)
 		return nullptr;
-	return std::make_shared<effect_parameter>(_effect, param);
+	return std::make_shared<effect_parameter>(_parent->shared_from_this(), param);
 }
 
 std::shared_ptr<gs::effect_parameter> gs::effect_parameter::get_annotation(std::string name)
@@ -765,7 +806,7 @@ std::shared_ptr<gs::effect_parameter> gs::effect_parameter::get_annotation(std::
 	gs_eparam_t* param = gs_param_get_annotation_by_name(_param, name.c_str());
 	if (!param)
 		return nullptr;
-	return std::make_shared<effect_parameter>(_effect, param);
+	return std::make_shared<effect_parameter>(_parent->shared_from_this(), param);
 }
 
 bool gs::effect_parameter::has_annotation(std::string name)
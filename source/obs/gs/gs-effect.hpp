@@ -21,7 +21,11 @@
 #include <cinttypes>
 #include <list>
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
 #include "gs-sampler.hpp"
 #include "gs-texture.hpp"
 
@@ -44,6 +48,7 @@ namespace gs {
 
 	class effect_parameter {
 		std::shared_ptr<::gs::effect> _effect;
+		::gs::effect*                 _parent;
 		gs_eparam_t*                  _param;
 		gs_effect_param_info          _param_info;
 
@@ -64,9 +69,14 @@ namespace gs {
 			Texture,
 		};
 
+		friend class ::gs::effect;
+
 		public:
 		effect_parameter(std::shared_ptr<gs::effect> effect, gs_eparam_t* param);
 
+		// Non-owning parameter, used for the parameters cached by the effect itself.
+		effect_parameter(gs::effect* effect, gs_eparam_t* param);
+
 		std::string get_name();
 		type        get_type();
 
@@ -251,6 +261,11 @@ namespace gs {
 		protected:
 		gs_effect_t* _effect;
 
+		// Parameters by name, resolved once at load. Keys point into the names held by libobs.
+		std::unordered_map<std::string_view, std::unique_ptr<effect_parameter>> _parameters;
+
+		void cache_parameters();
+
 		public:
 		effect(std::string file);
 		effect(std::string code, std::string name);
@@ -265,8 +280,143 @@ namespace gs {
 		bool                                         has_parameter(std::string name);
 		bool                                         has_parameter(std::string name, effect_parameter::type type);
 
+		/*!
+		 * \brief Look up a parameter without asking libobs or allocating, meant for per-frame use.
+		 *
+		 * \return Parameter owned by and valid for the lifetime of the effect, or nullptr if there is no
+		 *  parameter with that name.
+		 */
+		effect_parameter* find_parameter(std::string_view name);
+
 		public:
 		static std::shared_ptr<gs::effect> create(std::string file);
 		static std::shared_ptr<gs::effect> create(std::string code, std::string name);
 	};
+
+	/*!
+	 * \brief Parameter of an effect with a type known at compile time.
+	 *
+	 * Meant to be grouped into a struct describing all parameters of an effect, which is bound
+	 *  right after loading it. Binding throws if the effect has no parameter of that name and
+	 *  type, so an effect and the code using it can't silently disagree, and only the setters
+	 *  matching the type are available.
+	 */
+	template<effect_parameter::type Type>
+	class typed_parameter {
+		effect_parameter* _param;
+
+		// Setters are templates on T (defaulting to Type) so that this only removes the mismatching ones.
+		template<effect_parameter::type T, effect_parameter::type Expected>
+		using only_for = typename std::enable_if<T == Expected, int>::type;
+
+		public:
+		typed_parameter() : _param(nullptr) {}
+
+		void bind(::gs::effect& effect, std::string_view name)
+		{
+			effect_parameter* param = effect.find_parameter(name);
+			if (!param)
+				throw std::runtime_error("Effect has no parameter '" + std::string(name) + "'.");
+			if (param->get_type() != Type)
+				throw std::runtime_error("Effect parameter '" + std::string(name) + "' has an unexpected type.");
+			_param = param;
+		}
+
+		effect_parameter* get()
+		{
+			return _param;
+		}
+
+		template<effect_parameter::type T = Type, only_for<T, effect_parameter::type::Boolean> = 0>
+		inline void set(bool v)
+		{
+			_param->set_bool(v);
+		}
+
+		template<effect_parameter::type T = Type, only_for<T, effect_parameter::type::Float> = 0>
+		inline void set(float_t v)
+		{
+			_param->set_float(v);
+		}
+
+		template<effect_parameter::type T = Type, only_for<T, effect_parameter::type::Float2> = 0>
+		inline void set(float_t x, float_t y)
+		{
+			_param->set_float2(x, y);
+		}
+
+		template<effect_parameter::type T = Type, only_for<T, effect_parameter::type::Float2> = 0>
+		inline void set(vec2 const& v)
+		{
+			_param->set_float2(v);
+		}
+
+		template<effect_parameter::type T = Type, only_for<T, effect_parameter::type::Float3> = 0>
+		inline void set(float_t x, float_t y, float_t z)
+		{
+			_param->set_float3(x, y, z);
+		}
+
+		template<effect_parameter::type T = Type, only_for<T, effect_parameter::type::Float3> = 0>
+		inline void set(vec3 const& v)
+		{
+			_param->set_float3(v);
+		}
+
+		template<effect_parameter::type T = Type, only_for<T, effect_parameter::type::Float4> = 0>
+		inline void set(float_t x, float_t y, float_t z, float_t w)
+		{
+			_param->set_float4(x, y, z, w);
+		}
+
+		template<effect_parameter::type T = Type, only_for<T, effect_parameter::type::Float4> = 0>
+		inline void set(vec4 const& v)
+		{
+			_param->set_float4(v);
+		}
+
+		// Arrays of float or floatN, sz is the number of floats.
+		template<effect_parameter::type T = Type,
+				 typename std::enable_if<(T == effect_parameter::type::Float) || (T == effect_parameter::type::Float2)
+											 || (T == effect_parameter::type::Float3)
+											 || (T == effect_parameter::type::Float4),
+										 int>::type = 0>
+		inline void set_array(float_t v[], size_t sz)
+		{
+			_param->set_float_array(v, sz);
+		}
+
+		template<effect_parameter::type T = Type, only_for<T, effect_parameter::type::Integer> = 0>
+		inline void set(int32_t v)
+		{
+			_param->set_int(v);
+		}
+
+		template<effect_parameter::type T = Type, only_for<T, effect_parameter::type::Matrix> = 0>
+		inline void set(matrix4 const& v)
+		{
+			_param->set_matrix(v);
+		}
+
+		template<effect_parameter::type T = Type, only_for<T, effect_parameter::type::Texture> = 0>
+		inline void set(std::shared_ptr<gs::texture> v)
+		{
+			_param->set_texture(v);
+		}
+
+		template<effect_parameter::type T = Type, only_for<T, effect_parameter::type::Texture> = 0>
+		inline void set(gs_texture_t* v)
+		{
+			_param->set_texture(v);
+		}
+	};
+
+	typedef typed_parameter<effect_parameter::type::Boolean> bool_parameter;
+	typedef typed_parameter<effect_parameter::type::Float>   float_parameter;
+	typedef typed_parameter<effect_parameter::type::Float2>  float2_parameter;
+	typedef typed_parameter<effect_parameter::type::Float3>  float3_parameter;
+	typedef typed_parameter<effect_parameter::type::Float4>  float4_parameter;
+	typedef typed_parameter<effect_parameter::type::Integer> int_parameter;
+	typedef typed_parameter<effect_parameter::type::Matrix>  matrix_parameter;
+	typedef typed_parameter<effect_parameter::type::Texture> texture_parameter;
 } // namespace gs
@@ -0,0 +1,163 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "gs-geometry.hpp"
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include "obs/gs/gs-helper.hpp"
+
+// OBS
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)
+#endif
+#include <graphics/vec3.h>
+#include <graphics/vec4.h>
+#include <util/bmem.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#define MAXIMUM_GRID_CELLS 256
+
+static std::mutex                                       shared_lock;
+static std::weak_ptr<gs::geometry>                      shared_triangle;
+static std::weak_ptr<gs::geometry>                      shared_quad;
+static std::map<uint32_t, std::weak_ptr<gs::geometry>> shared_grids;
+
+static gs_vb_data* create_data(uint32_t vertices)
+{
+	gs_vb_data* data       = gs_vbdata_create();
+	data->num              = vertices;
+	data->points           = static_cast<vec3*>(bzalloc(sizeof(vec3) * vertices));
+	data->normals          = static_cast<vec3*>(bzalloc(sizeof(vec3) * vertices));
+	data->tangents         = static_cast<vec3*>(bzalloc(sizeof(vec3) * vertices));
+	data->colors           = static_cast<uint32_t*>(bzalloc(sizeof(uint32_t) * vertices));
+	data->num_tex          = 1;
+	data->tvarray          = static_cast<gs_tvertarray*>(bzalloc(sizeof(gs_tvertarray)));
+	data->tvarray[0].width = 4;
+	data->tvarray[0].array = bzalloc(sizeof(vec4) * vertices);
+	return data;
+}
+
+static void set_vertex(gs_vb_data* data, size_t idx, float_t x, float_t y)
+{
+	vec3_set(&data->points[idx], x, y, 0);
+	vec4_set(&static_cast<vec4*>(data->tvarray[0].array)[idx], x, y, 0, 0);
+}
+
+static std::shared_ptr<gs::geometry> get_shared(std::weak_ptr<gs::geometry>& slot, gs_vb_data* (*build)())
+{
+	// Creating a shape enters graphics, and callers may already be inside it. Graphics is thus always entered
+	//  before shared_lock, never the other way around.
+	auto                          gctx = gs::context();
+	std::unique_lock<std::mutex>  ul(shared_lock);
+	std::shared_ptr<gs::geometry> shape = slot.lock();
+	if (!shape) {
+		shape = std::make_shared<gs::geometry>(build());
+		slot  = shape;
+	}
+	return shape;
+}
+
+gs::geometry::geometry(gs_vb_data* data) : _buffer(nullptr), _size(uint32_t(data->num))
+{
+	// libobs owns the data from here on, even if creating the buffer fails.
+	auto gctx = gs::context();
+	_buffer   = gs_vertexbuffer_create(data, 0);
+	if (!_buffer)
+		throw std::runtime_error("Failed to create vertex buffer.");
+	gs::count_object(gs::object_type::VertexBuffer, true);
+}
+
+gs::geometry::~geometry()
+{
+	auto gctx = gs::context();
+	gs_vertexbuffer_destroy(_buffer);
+	gs::count_object(gs::object_type::VertexBuffer, false);
+}
+
+gs_vertbuffer_t* gs::geometry::get_object()
+{
+	return _buffer;
+}
+
+uint32_t gs::geometry::size()
+{
+	return _size;
+}
+
+std::shared_ptr<gs::geometry> gs::geometry::get_fullscreen_triangle()
+{
+	return get_shared(shared_triangle, []() {
+		gs_vb_data* data = create_data(3);
+		set_vertex(data, 0, 0, 0);
+		set_vertex(data, 1, 2, 0);
+		set_vertex(data, 2, 0, 2);
+		return data;
+	});
+}
+
+std::shared_ptr<gs::geometry> gs::geometry::get_quad()
+{
+	return get_shared(shared_quad, []() {
+		gs_vb_data* data = create_data(6);
+		set_vertex(data, 0, 0, 0);
+		set_vertex(data, 1, 1, 0);
+		set_vertex(data, 2, 0, 1);
+		set_vertex(data, 3, 0, 1);
+		set_vertex(data, 4, 1, 0);
+		set_vertex(data, 5, 1, 1);
+		return data;
+	});
+}
+
+std::shared_ptr<gs::geometry> gs::geometry::get_grid(uint32_t cells)
+{
+	if ((cells == 0) || (cells > MAXIMUM_GRID_CELLS))
+		throw std::out_of_range("cells out of range");
+
+	// Same order as in get_shared().
+	auto                          gctx = gs::context();
+	std::unique_lock<std::mutex>  ul(shared_lock);
+	std::shared_ptr<gs::geometry> shape = shared_grids[cells].lock();
+	if (shape)
+		return shape;
+
+	gs_vb_data* data = create_data(cells * cells * 6);
+	float_t     step = 1.0f / float_t(cells);
+	size_t      idx  = 0;
+	for (uint32_t y = 0; y < cells; y++) {
+		for (uint32_t x = 0; x < cells; x++) {
+			float_t x0 = step * x, x1 = (x + 1 == cells) ? 1.0f : step * (x + 1);
+			float_t y0 = step * y, y1 = (y + 1 == cells) ? 1.0f : step * (y + 1);
+			set_vertex(data, idx++, x0, y0);
+			set_vertex(data, idx++, x1, y0);
+			set_vertex(data, idx++, x0, y1);
+			set_vertex(data, idx++, x0, y1);
+			set_vertex(data, idx++, x1, y0);
+			set_vertex(data, idx++, x1, y1);
+		}
+	}
+
+	shape               = std::make_shared<gs::geometry>(data);
+	shared_grids[cells] = shape;
+	return shape;
+}
@@ -0,0 +1,76 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <cinttypes>
+#include <memory>
+
+// OBS
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)
+#endif
+#include <graphics/graphics.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+namespace gs {
+	/*!
+	 * \brief Immutable vertex data, created once and shared by every instance drawing it.
+	 *
+	 * The buffers are static: their data is handed over to libobs on creation and never uploaded
+	 *  again. All shapes are triangle lists in the unit square (0,0)-(1,1) with matching uvs, and
+	 *  carry normals, tangents and colors (all zero) so they work with any vertex shader. A shape
+	 *  is released once the last instance using it lets go of it.
+	 */
+	class geometry {
+		gs_vertbuffer_t* _buffer;
+		uint32_t         _size;
+
+		public:
+		// Takes ownership of data, which must have been allocated with bmalloc/bzalloc.
+		geometry(gs_vb_data* data);
+		~geometry();
+
+		gs_vertbuffer_t* get_object();
+
+		// Number of vertices to draw.
+		uint32_t size();
+
+		public: // Shared
+		/*!
+		 * \brief A single triangle spanning (0,0), (2,0) and (0,2).
+		 *
+		 * Covers the whole unit square with one triangle, which avoids shading the pixels along
+		 *  the diagonal of a quad twice.
+		 */
+		static std::shared_ptr<gs::geometry> get_fullscreen_triangle();
+
+		// Two triangles covering the unit square.
+		static std::shared_ptr<gs::geometry> get_quad();
+
+		/*!
+		 * \brief The unit square split into cells by cells quads, for meshes warped in the vertex shader.
+		 *
+		 * Throws std::out_of_range if cells is 0 or above 256.
+		 */
+		static std::shared_ptr<gs::geometry> get_grid(uint32_t cells);
+	};
+} // namespace gs
@@ -18,6 +18,19 @@
  */
 
 #include "gs-helper.hpp"
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include "util-profiler.hpp"
+
+#define OBJECT_TYPES 6
+
+static const char* object_type_names[OBJECT_TYPES] = {
+	"texture", "render target", "vertex buffer", "index buffer", "effect", "sampler",
+};
+
+static std::array<std::atomic<int64_t>, OBJECT_TYPES>  live_objects    = {};
+static std::array<std::atomic<uint64_t>, OBJECT_TYPES> created_objects = {};
 
 gs::context::context()
 {
@@ -28,3 +41,54 @@ gs::context::~context()
 {
 	obs_leave_graphics();
 }
+
+void gs::draw_sprite(gs_texture_t* tex, uint32_t flip, uint32_t width, uint32_t height)
+{
+	util::profiler::count_draw();
+	gs_draw_sprite(tex, flip, width, height);
+}
+
+void gs::draw(gs_draw_mode draw_mode, uint32_t start_vert, uint32_t num_verts)
+{
+	util::profiler::count_draw();
+	gs_draw(draw_mode, start_vert, num_verts);
+}
+
+void gs::count_object(object_type type, bool created)
+{
+	size_t idx = size_t(type);
+	if (created) {
+		live_objects[idx].fetch_add(1, std::memory_order_relaxed);
+		created_objects[idx].fetch_add(1, std::memory_order_relaxed);
+	} else {
+		live_objects[idx].fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+
+int64_t gs::get_live_objects(object_type type)
+{
+	return live_objects[size_t(type)].load(std::memory_order_relaxed);
+}
+
+int64_t gs::get_live_objects()
+{
+	int64_t live = 0;
+	for (size_t idx = 0; idx < OBJECT_TYPES; idx++) {
+		live += live_objects[idx].load(std::memory_order_relaxed);
+	}
+	return live;
+}
+
+bool gs::check_objects()
+{
+	bool clean = true;
+	for (size_t idx = 0; idx < OBJECT_TYPES; idx++) {
+		int64_t live = live_objects[idx].load();
+		if (live != 0) {
+			P_LOG_WARNING("<gs> %" PRId64 " of %" PRIu64 " created %s objects were never destroyed.", live,
+						  created_objects[idx].load(), object_type_names[idx]);
+			clean = false;
+		}
+	}
+	return clean;
+}
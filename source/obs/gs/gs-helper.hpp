@@ -37,4 +37,38 @@ namespace gs {
 		context();
 		~context();
 	};
+
+	// gs_draw_sprite, counted as a draw call by the active util::profiler scope.
+	void draw_sprite(gs_texture_t* tex, uint32_t flip, uint32_t width, uint32_t height);
+
+	// gs_draw, counted as a draw call by the active util::profiler scope.
+	void draw(gs_draw_mode draw_mode, uint32_t start_vert, uint32_t num_verts);
+
+	enum class object_type : uint8_t {
+		Texture,
+		RenderTarget,
+		VertexBuffer,
+		IndexBuffer,
+		Effect,
+		Sampler,
+	};
+
+	// Count a libobs graphics object created or destroyed by one of the wrappers.
+	void count_object(object_type type, bool created);
+
+	// Number of objects of a type the wrappers created and have not destroyed yet.
+	int64_t get_live_objects(object_type type);
+
+	// Number of objects of any type the wrappers created and have not destroyed yet.
+	int64_t get_live_objects();
+
+	/*!
+	 * \brief Log every type of graphics object that was created more often than destroyed.
+	 *
+	 * Meant for when the plugin unloads, at which point every instance and with it every object
+	 *  should be gone.
+	 *
+	 * \return true if nothing was left over.
+	 */
+	bool check_objects();
 } // namespace gs
@@ -36,6 +36,9 @@ gs::index_buffer::index_buffer(uint32_t maximumVertices)
 	this->reserve(maximumVertices);
 	auto gctx     = gs::context();
 	_index_buffer = gs_indexbuffer_create(gs_index_type::GS_UNSIGNED_LONG, this->data(), maximumVertices, GS_DYNAMIC);
+	if (_index_buffer) {
+		gs::count_object(gs::object_type::IndexBuffer, true);
+	}
 }
 
 gs::index_buffer::index_buffer() : index_buffer(MAXIMUM_VERTICES) {}
@@ -53,7 +56,10 @@ gs::index_buffer::index_buffer(std::vector<uint32_t>& other) : index_buffer((uin
 gs::index_buffer::~index_buffer()
 {
 	auto gctx = gs::context();
-	gs_indexbuffer_destroy(_index_buffer);
+	if (_index_buffer) {
+		gs_indexbuffer_destroy(_index_buffer);
+		gs::count_object(gs::object_type::IndexBuffer, false);
+	}
 }
 
 gs_indexbuffer_t* gs::index_buffer::get()
@@ -18,6 +18,7 @@
  */
 
 #include "gs-mipmapper.hpp"
+#include "gs-render-state.hpp"
 #include "obs/gs/gs-helper.hpp"
 #include "plugin.hpp"
 
@@ -72,41 +73,14 @@ struct gs_d3d11_device {
 
 gs::mipmapper::~mipmapper()
 {
-	_vb.reset();
+	_quad.reset();
 	_rt.reset();
 	_effect.reset();
 }
 
 gs::mipmapper::mipmapper()
 {
-	_vb  = std::make_unique<gs::vertex_buffer>(uint32_t(6u), uint8_t(1u));
-	auto v0        = _vb->at(0);
-	v0.position->x = 0;
-	v0.position->y = 0;
-	v0.uv[0]->x    = 0;
-	v0.uv[0]->y    = 0;
-
-	auto v1        = _vb->at(1);
-	auto v4        = _vb->at(4);
-	v4.position->x = v1.position->x = 1.0;
-	v4.position->y = v1.position->y = 0;
-	v4.uv[0]->x = v1.uv[0]->x = 1.0;
-	v4.uv[0]->y = v1.uv[0]->y = 0;
-
-	auto v2        = _vb->at(2);
-	auto v3        = _vb->at(3);
-	v3.position->x = v2.position->x = 0;
-	v3.position->y = v2.position->y = 1.0;
-	v3.uv[0]->x = v2.uv[0]->x = 0;
-	v3.uv[0]->y = v2.uv[0]->y = 1.0;
-
-	auto v5        = _vb->at(5);
-	v5.position->x = 1.0;
-	v5.position->y = 1.0;
-	v5.uv[0]->x    = 1.0;
-	v5.uv[0]->y    = 1.0;
-
-	_vb->update();
+	_quad = gs::geometry::get_quad();
 
 	char* effect_file = obs_module_file("effects/mipgen.effect");
 	_effect            = std::make_unique<gs::effect>(effect_file);
@@ -189,7 +163,7 @@ void gs::mipmapper::rebuild(std::shared_ptr<gs::texture> source, std::shared_ptr
 		break;
 	}
 
-	gs_load_vertexbuffer(_vb->update());
+	gs_load_vertexbuffer(_quad->get_object());
 	gs_load_indexbuffer(nullptr);
 
 	if (source->get_type() == gs::texture::type::Normal) {
@@ -221,6 +195,8 @@ void gs::mipmapper::rebuild(std::shared_ptr<gs::texture> source, std::shared_ptr
 			return;
 		}
 
+		// Every layer is drawn with the same state, it only has to be set once.
+		auto state = ::gs::render_state::opaque().apply();
 		for (size_t mip = 1; mip < mip_levels; mip++) {
 			texture_width /= 2;
 			texture_height /= 2;
@@ -237,28 +213,19 @@ void gs::mipmapper::rebuild(std::shared_ptr<gs::texture> source, std::shared_ptr
 			// Draw mipmap layer
 			try {
 				auto op = _rt->render(uint32_t(texture_width), uint32_t(texture_height));
-
-				gs_set_cull_mode(GS_NEITHER);
-				gs_reset_blend_state();
-				gs_blend_function_separate(gs_blend_type::GS_BLEND_ONE, gs_blend_type::GS_BLEND_ZERO,
-										   gs_blend_type::GS_BLEND_ONE, gs_blend_type::GS_BLEND_ZERO);
-				gs_enable_depth_test(false);
-				gs_enable_stencil_test(false);
-				gs_enable_stencil_write(false);
-				gs_enable_color(true, true, true, true);
 				gs_ortho(0, 1, 0, 1, -1, 1);
 
 				vec4 black;
 				vec4_zero(&black);
 				gs_clear(GS_CLEAR_COLOR | GS_CLEAR_DEPTH, &black, 0, 0);
 
-				_effect->get_parameter("image")->set_texture(target);
-				_effect->get_parameter("level")->set_int(int32_t(mip - 1));
-				_effect->get_parameter("imageTexel")->set_float2(texel_width, texel_height);
-				_effect->get_parameter("strength")->set_float(strength);
+				_effect->find_parameter("image")->set_texture(target);
+				_effect->find_parameter("level")->set_int(int32_t(mip - 1));
+				_effect->find_parameter("imageTexel")->set_float2(texel_width, texel_height);
+				_effect->find_parameter("strength")->set_float(strength);
 
 				while (gs_effect_loop(_effect->get_object(), technique.c_str())) {
-					gs_draw(gs_draw_mode::GS_TRIS, 0, _vb->size());
+					gs::draw(gs_draw_mode::GS_TRIS, 0, _quad->size());
 				}
 			} catch (...) {
 				P_LOG_ERROR("Failed to render mipmap layer.");
@@ -19,9 +19,9 @@
 
 #pragma once
 #include "gs-effect.hpp"
+#include "gs-geometry.hpp"
 #include "gs-rendertarget.hpp"
 #include "gs-texture.hpp"
-#include "gs-vertexbuffer.hpp"
 
 // OBS
 #ifdef _MSC_VER
@@ -35,9 +35,9 @@
 
 namespace gs {
 	class mipmapper {
-		std::unique_ptr<gs::vertex_buffer> _vb;
-		std::unique_ptr<gs::rendertarget>  _rt;
-		std::unique_ptr<gs::effect>        _effect;
+		std::shared_ptr<gs::geometry>     _quad;
+		std::unique_ptr<gs::rendertarget> _rt;
+		std::unique_ptr<gs::effect>       _effect;
 
 		public:
 		enum class generator : uint8_t {
@@ -0,0 +1,134 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "gs-render-state.hpp"
+#include <algorithm>
+#include "util-profiler.hpp"
+
+static thread_local ::gs::render_state::scope* current_scope = nullptr;
+
+gs::render_state::render_state()
+	: _cull_mode(GS_NEITHER), _color{true, true, true, true}, _depth_test(false), _depth_function(GS_ALWAYS),
+	  _blending(false), _blend{GS_BLEND_ONE, GS_BLEND_ZERO, GS_BLEND_ONE, GS_BLEND_ZERO}, _stencil_test(false),
+	  _stencil_write(false), _stencil_function(GS_ALWAYS), _stencil_op{GS_ZERO, GS_ZERO, GS_ZERO}
+{}
+
+gs::render_state::~render_state() {}
+
+gs::render_state gs::render_state::with_blending(gs_blend_type src, gs_blend_type dst) const
+{
+	return with_blending(src, dst, src, dst);
+}
+
+gs::render_state gs::render_state::with_blending(gs_blend_type src_color, gs_blend_type dst_color,
+												 gs_blend_type src_alpha, gs_blend_type dst_alpha) const
+{
+	render_state state = *this;
+	state._blending    = true;
+	state._blend[0]    = src_color;
+	state._blend[1]    = dst_color;
+	state._blend[2]    = src_alpha;
+	state._blend[3]    = dst_alpha;
+	return state;
+}
+
+gs::render_state::scope gs::render_state::apply() const
+{
+	return scope(*this);
+}
+
+gs::render_state const& gs::render_state::opaque()
+{
+	static const render_state instance;
+	return instance;
+}
+
+uint32_t gs::render_state::set(render_state const* from) const
+{
+	uint32_t calls = 0;
+	if (!from || (from->_cull_mode != _cull_mode)) {
+		gs_set_cull_mode(_cull_mode);
+		calls++;
+	}
+	if (!from || !std::equal(_color, _color + 4, from->_color)) {
+		gs_enable_color(_color[0], _color[1], _color[2], _color[3]);
+		calls++;
+	}
+	if (!from || (from->_depth_test != _depth_test)) {
+		gs_enable_depth_test(_depth_test);
+		calls++;
+	}
+	if (!from || (from->_depth_function != _depth_function)) {
+		gs_depth_function(_depth_function);
+		calls++;
+	}
+	if (!from || (from->_blending != _blending)) {
+		gs_enable_blending(_blending);
+		calls++;
+	}
+	if (!from || !std::equal(_blend, _blend + 4, from->_blend)) {
+		gs_blend_function_separate(_blend[0], _blend[1], _blend[2], _blend[3]);
+		calls++;
+	}
+	if (!from || (from->_stencil_test != _stencil_test)) {
+		gs_enable_stencil_test(_stencil_test);
+		calls++;
+	}
+	if (!from || (from->_stencil_write != _stencil_write)) {
+		gs_enable_stencil_write(_stencil_write);
+		calls++;
+	}
+	if (!from || (from->_stencil_function != _stencil_function)) {
+		gs_stencil_function(GS_STENCIL_BOTH, _stencil_function);
+		calls++;
+	}
+	if (!from || !std::equal(_stencil_op, _stencil_op + 3, from->_stencil_op)) {
+		gs_stencil_op(GS_STENCIL_BOTH, _stencil_op[0], _stencil_op[1], _stencil_op[2]);
+		calls++;
+	}
+	return calls;
+}
+
+gs::render_state::scope::scope(render_state const& state) : _state(state), _previous(current_scope)
+{
+	uint32_t calls = 0;
+	if (!_previous) {
+		// Only the blend state can be saved, everything else is left as the last scope set it.
+		gs_blend_state_push();
+		calls++;
+	}
+	calls += _state.set(_previous ? &_previous->_state : nullptr);
+	::util::profiler::count_state(calls);
+
+	current_scope = this;
+}
+
+gs::render_state::scope::~scope()
+{
+	current_scope = _previous;
+
+	uint32_t calls = 0;
+	if (_previous) {
+		calls += _previous->_state.set(&_state);
+	} else {
+		gs_blend_state_pop();
+		calls++;
+	}
+	::util::profiler::count_state(calls);
+}
@@ -0,0 +1,96 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <cinttypes>
+
+// OBS
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)
+#endif
+#include <graphics/graphics.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+namespace gs {
+	/*!
+	 * \brief Rasterizer, depth, stencil and blend state, set as one block.
+	 *
+	 * A render_state never changes once built, variations are derived from it with the with_*()
+	 *  functions. Applying it opens a scope which lasts until the returned object is destroyed.
+	 *  Scopes nest per thread: the outermost one saves the blend state and sets every field, a
+	 *  nested one only sets the fields that differ from the enclosing scope and sets them back
+	 *  when it ends. Every call made is counted towards the active util::profiler scope.
+	 *
+	 * Nested scopes rely on nothing else changing the state while a scope is open, so no scope
+	 *  may be open while other sources are rendered (obs_source_process_filter_end,
+	 *  obs_source_video_render, ...), and code within a scope must not call gs_enable_blending
+	 *  and friends directly.
+	 */
+	class render_state {
+		gs_cull_mode       _cull_mode;
+		bool               _color[4];
+		bool               _depth_test;
+		gs_depth_test      _depth_function;
+		bool               _blending;
+		gs_blend_type      _blend[4];
+		bool               _stencil_test;
+		bool               _stencil_write;
+		gs_depth_test      _stencil_function;
+		gs_stencil_op_type _stencil_op[3];
+
+		// Set every field that differs from 'from', or all of them without it. Returns the number of calls made.
+		uint32_t set(render_state const* from) const;
+
+		public:
+		class scope;
+
+		// Opaque: no culling, all channels written, no depth test, no blending, no stencil.
+		render_state();
+		~render_state();
+
+		// Blending with the same factors for color and alpha.
+		render_state with_blending(gs_blend_type src, gs_blend_type dst) const;
+
+		render_state with_blending(gs_blend_type src_color, gs_blend_type dst_color, gs_blend_type src_alpha,
+								   gs_blend_type dst_alpha) const;
+
+		// Make this the active state until the returned scope is destroyed.
+		scope apply() const;
+
+		// The state nearly every pass in this plugin uses, see render_state().
+		static render_state const& opaque();
+	};
+
+	class render_state::scope {
+		render_state _state;
+		scope*       _previous;
+
+		public:
+		scope(render_state const& state);
+		~scope();
+
+		scope(scope const&) = delete;
+		scope(scope&&)      = delete;
+		scope& operator=(scope const&) = delete;
+		scope& operator=(scope&&) = delete;
+	};
+} // namespace gs
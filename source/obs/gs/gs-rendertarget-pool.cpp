@@ -0,0 +1,241 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "gs-rendertarget-pool.hpp"
+#include <algorithm>
+#include "obs/gs/gs-helper.hpp"
+#include "plugin.hpp"
+
+// OBS
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)
+#endif
+#include <graphics/graphics.h>
+#include <obs.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+// Unused targets are kept around for this long, long enough to survive a scene switch.
+#define UNUSED_TIMEOUT std::chrono::seconds(5)
+
+gs::rendertarget_pool::rendertarget_pool() : _statistics() {}
+
+gs::rendertarget_pool::~rendertarget_pool()
+{
+	P_LOG_DEBUG("<gs::rendertarget_pool> Peak usage was %zu targets with %llu bytes, %llu hits and %llu misses.",
+				_statistics.peak_targets, static_cast<unsigned long long>(_statistics.peak_bytes),
+				static_cast<unsigned long long>(_statistics.hits),
+				static_cast<unsigned long long>(_statistics.misses));
+	clear();
+}
+
+std::shared_ptr<gs::rendertarget> gs::rendertarget_pool::acquire(uint32_t width, uint32_t height,
+																 gs_color_format    color_format,
+																 gs_zstencil_format zstencil_format)
+{
+	auto                              now = std::chrono::steady_clock::now();
+	key_t                             key{width, height, color_format, zstencil_format};
+	std::unique_ptr<gs::rendertarget> target;
+
+	// Expired targets are destroyed outside of the lock, which requires entering the graphics context.
+	std::list<std::unique_ptr<gs::rendertarget>> expired;
+	{
+		std::unique_lock<std::mutex> ul(_lock);
+		expired = collect_expired(now);
+
+		auto kv = _free.find(key);
+		if ((kv != _free.end()) && !kv->second.empty()) {
+			target = std::move(kv->second.front().target);
+			kv->second.pop_front();
+			if (kv->second.empty())
+				_free.erase(kv);
+			_statistics.hits++;
+		} else {
+			_statistics.misses++;
+		}
+	}
+	expired.clear();
+
+	uint64_t bytes = get_size(width, height, color_format, zstencil_format);
+	if (!target) {
+		target = std::make_unique<gs::rendertarget>(color_format, zstencil_format);
+
+		std::unique_lock<std::mutex> ul(_lock);
+		_statistics.targets++;
+		_statistics.bytes += bytes;
+		_statistics.peak_targets = std::max(_statistics.peak_targets, _statistics.targets);
+		_statistics.peak_bytes   = std::max(_statistics.peak_bytes, _statistics.bytes);
+	}
+
+	{
+		std::unique_lock<std::mutex> ul(_lock);
+		_statistics.targets_in_use++;
+		_statistics.bytes_in_use += bytes;
+	}
+
+	std::weak_ptr<gs::rendertarget_pool> pool = shared_from_this();
+	return std::shared_ptr<gs::rendertarget>(target.release(), [pool, key](gs::rendertarget* rt) {
+		if (auto self = pool.lock()) {
+			self->release(rt, key);
+		} else {
+			delete rt;
+		}
+	});
+}
+
+void gs::rendertarget_pool::release(gs::rendertarget* target, key_t key)
+{
+	uint64_t bytes = get_size(std::get<0>(key), std::get<1>(key), std::get<2>(key), std::get<3>(key));
+
+	// File the target under the size it was actually rendered at.
+	key_t actual = key;
+	{
+		auto          gctx    = gs::context();
+		gs_texture_t* texture = target->get_object();
+		if (texture) {
+			std::get<0>(actual) = gs_texture_get_width(texture);
+			std::get<1>(actual) = gs_texture_get_height(texture);
+		}
+	}
+	uint64_t actual_bytes = get_size(std::get<0>(actual), std::get<1>(actual), std::get<2>(actual), std::get<3>(actual));
+
+	std::unique_lock<std::mutex> ul(_lock);
+	_statistics.targets_in_use--;
+	_statistics.bytes_in_use -= bytes;
+	_statistics.bytes         = _statistics.bytes - bytes + actual_bytes;
+	_statistics.peak_bytes    = std::max(_statistics.peak_bytes, _statistics.bytes);
+
+	// Most recently used targets go to the front, so that old ones are the first to expire.
+	entry value;
+	value.target.reset(target);
+	value.released = std::chrono::steady_clock::now();
+	_free[actual].push_front(std::move(value));
+}
+
+std::list<std::unique_ptr<gs::rendertarget>>
+	gs::rendertarget_pool::collect_expired(std::chrono::steady_clock::time_point now)
+{
+	std::list<std::unique_ptr<gs::rendertarget>> expired;
+	for (auto kv = _free.begin(); kv != _free.end();) {
+		auto& entries = kv->second;
+		while (!entries.empty() && ((now - entries.back().released) > UNUSED_TIMEOUT)) {
+			_statistics.targets--;
+			_statistics.bytes -= get_size(std::get<0>(kv->first), std::get<1>(kv->first), std::get<2>(kv->first),
+										  std::get<3>(kv->first));
+			expired.push_back(std::move(entries.back().target));
+			entries.pop_back();
+		}
+
+		if (entries.empty()) {
+			kv = _free.erase(kv);
+		} else {
+			kv++;
+		}
+	}
+	return expired;
+}
+
+gs::rendertarget_pool::statistics gs::rendertarget_pool::get_statistics()
+{
+	std::unique_lock<std::mutex> ul(_lock);
+	return _statistics;
+}
+
+void gs::rendertarget_pool::clear()
+{
+	std::list<std::unique_ptr<gs::rendertarget>> expired;
+	{
+		std::unique_lock<std::mutex> ul(_lock);
+		expired = collect_expired(std::chrono::steady_clock::time_point::max());
+	}
+}
+
+uint64_t gs::rendertarget_pool::get_size(uint32_t width, uint32_t height, gs_color_format color_format,
+										 gs_zstencil_format zstencil_format)
+{
+	// Bits per texel, block compressed formats are never render targets but are listed for completeness.
+	uint64_t bits = 0;
+	switch (color_format) {
+	case GS_UNKNOWN:
+		break;
+	case GS_DXT1:
+		bits = 4;
+		break;
+	case GS_A8:
+	case GS_R8:
+	case GS_DXT3:
+	case GS_DXT5:
+		bits = 8;
+		break;
+	case GS_R16:
+	case GS_R16F:
+	case GS_R8G8:
+		bits = 16;
+		break;
+	case GS_RGBA:
+	case GS_BGRX:
+	case GS_BGRA:
+	case GS_R10G10B10A2:
+	case GS_RG16F:
+	case GS_R32F:
+		bits = 32;
+		break;
+	case GS_RGBA16:
+	case GS_RGBA16F:
+	case GS_RG32F:
+		bits = 64;
+		break;
+	case GS_RGBA32F:
+		bits = 128;
+		break;
+	}
+
+	switch (zstencil_format) {
+	case GS_ZS_NONE:
+		break;
+	case GS_Z16:
+		bits += 16;
+		break;
+	case GS_Z24_S8:
+	case GS_Z32F:
+		bits += 32;
+		break;
+	case GS_Z32F_S8X24:
+		bits += 64;
+		break;
+	}
+
+	return uint64_t(width) * uint64_t(height) * bits / 8;
+}
+
+std::shared_ptr<gs::rendertarget_pool> gs::rendertarget_pool::get()
+{
+	static std::mutex                             instance_lock;
+	static std::weak_ptr<gs::rendertarget_pool> instance;
+
+	std::unique_lock<std::mutex>           ul(instance_lock);
+	std::shared_ptr<gs::rendertarget_pool> pool = instance.lock();
+	if (!pool) {
+		pool     = std::make_shared<gs::rendertarget_pool>();
+		instance = pool;
+	}
+	return pool;
+}
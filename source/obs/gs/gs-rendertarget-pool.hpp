@@ -0,0 +1,109 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <chrono>
+#include <cinttypes>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include "gs-rendertarget.hpp"
+
+// OBS
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)
+#endif
+#include <graphics/graphics.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+namespace gs {
+	/*!
+	 * \brief Render targets shared by all filter and blur instances.
+	 *
+	 * Targets are handed out for a size and format and return to the pool once the last
+	 *  reference to them is gone, where the next acquire() of the same size and format picks
+	 *  them up again. Instances should only hold on to a target for as long as its content is
+	 *  needed: intermediate targets until the end of the pass, output targets until the next
+	 *  video_tick. Targets that stay unused for a while are destroyed.
+	 */
+	class rendertarget_pool : public std::enable_shared_from_this<rendertarget_pool> {
+		public:
+		struct statistics {
+			// Targets alive, including free ones.
+			size_t targets;
+			size_t targets_in_use;
+			size_t peak_targets;
+
+			// Estimated video memory of all targets, including free ones.
+			uint64_t bytes;
+			uint64_t bytes_in_use;
+			uint64_t peak_bytes;
+
+			// Requests served from a free target and requests that needed a new one.
+			uint64_t hits;
+			uint64_t misses;
+		};
+
+		private:
+		typedef std::tuple<uint32_t, uint32_t, gs_color_format, gs_zstencil_format> key_t;
+
+		struct entry {
+			std::unique_ptr<gs::rendertarget>     target;
+			std::chrono::steady_clock::time_point released;
+		};
+
+		std::mutex                           _lock;
+		std::map<key_t, std::list<entry>>    _free;
+		::gs::rendertarget_pool::statistics _statistics;
+
+		void release(gs::rendertarget* target, key_t key);
+
+		std::list<std::unique_ptr<gs::rendertarget>> collect_expired(std::chrono::steady_clock::time_point now);
+
+		public:
+		rendertarget_pool();
+		~rendertarget_pool();
+
+		/*!
+		 * \brief Get a render target for the given size and format.
+		 *
+		 * The content of the target is undefined until it is rendered to, which should happen at
+		 *  the requested size so that the target is found again under the same key.
+		 */
+		std::shared_ptr<gs::rendertarget> acquire(uint32_t width, uint32_t height, gs_color_format color_format,
+												  gs_zstencil_format zstencil_format = GS_ZS_NONE);
+
+		::gs::rendertarget_pool::statistics get_statistics();
+
+		// Destroy all currently unused targets.
+		void clear();
+
+		// Estimated size in bytes of a target of the given size and format.
+		static uint64_t get_size(uint32_t width, uint32_t height, gs_color_format color_format,
+								 gs_zstencil_format zstencil_format);
+
+		public: // Singleton
+		static std::shared_ptr<gs::rendertarget_pool> get();
+	};
+} // namespace gs
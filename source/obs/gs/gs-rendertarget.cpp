@@ -20,6 +20,7 @@
 #include "gs-rendertarget.hpp"
 #include <stdexcept>
 #include "obs/gs/gs-helper.hpp"
+#include "util-profiler.hpp"
 
 // OBS
 #ifdef _MSC_VER
@@ -36,6 +37,7 @@ gs::rendertarget::~rendertarget()
 {
 	auto gctx = gs::context();
 	gs_texrender_destroy(_render_target);
+	gs::count_object(gs::object_type::RenderTarget, false);
 }
 
 gs::rendertarget::rendertarget(gs_color_format colorFormat, gs_zstencil_format zsFormat)
@@ -47,6 +49,7 @@ gs::rendertarget::rendertarget(gs_color_format colorFormat, gs_zstencil_format z
 	if (!_render_target) {
 		throw std::runtime_error("Failed to create render target.");
 	}
+	gs::count_object(gs::object_type::RenderTarget, true);
 }
 
 gs::rendertarget_op gs::rendertarget::render(uint32_t width, uint32_t height)
@@ -104,6 +107,7 @@ gs::rendertarget_op::rendertarget_op(gs::rendertarget* rt, uint32_t width, uint3
 		throw std::runtime_error("Failed to begin rendering to render target.");
 	}
 	parent->_is_being_rendered = true;
+	util::profiler::count_pass();
 }
 
 gs::rendertarget_op::rendertarget_op(gs::rendertarget_op&& r)
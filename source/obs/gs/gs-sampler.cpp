@@ -18,6 +18,7 @@
  */
 
 #include "gs-sampler.hpp"
+#include "obs/gs/gs-helper.hpp"
 
 gs::sampler::sampler()
 {
@@ -28,8 +29,10 @@ gs::sampler::sampler()
 
 gs::sampler::~sampler()
 {
-	if (_sampler_state)
+	if (_sampler_state) {
 		gs_samplerstate_destroy(_sampler_state);
+		gs::count_object(gs::object_type::Sampler, false);
+	}
 }
 
 void gs::sampler::set_filter(gs_sample_filter v)
@@ -119,9 +122,15 @@ uint8_t gs::sampler::get_border_color(bool r, bool g, bool b, bool a)
 
 gs_sampler_state* gs::sampler::refresh()
 {
-	gs_samplerstate_destroy(_sampler_state);
+	if (_sampler_state) {
+		gs_samplerstate_destroy(_sampler_state);
+		gs::count_object(gs::object_type::Sampler, false);
+	}
 	_sampler_state = gs_samplerstate_create(&_sampler_info);
-	_dirty        = false;
+	if (_sampler_state) {
+		gs::count_object(gs::object_type::Sampler, true);
+	}
+	_dirty = false;
 	return _sampler_state;
 }
 
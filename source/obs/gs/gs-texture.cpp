@@ -59,6 +59,7 @@ gs::texture::texture(uint32_t width, uint32_t height, gs_color_format format, ui
 
 	if (!_texture)
 		throw std::runtime_error("Failed to create texture.");
+	gs::count_object(gs::object_type::Texture, true);
 
 	_type = type::Normal;
 }
@@ -91,6 +92,7 @@ gs::texture::texture(uint32_t width, uint32_t height, uint32_t depth, gs_color_f
 
 	if (!_texture)
 		throw std::runtime_error("Failed to create texture.");
+	gs::count_object(gs::object_type::Texture, true);
 
 	_type = type::Volume;
 }
@@ -117,6 +119,7 @@ gs::texture::texture(uint32_t size, gs_color_format format, uint32_t mip_levels,
 
 	if (!_texture)
 		throw std::runtime_error("Failed to create texture.");
+	gs::count_object(gs::object_type::Texture, true);
 
 	_type = type::Cube;
 }
@@ -132,6 +135,7 @@ gs::texture::texture(std::string file)
 
 	if (!_texture)
 		throw std::runtime_error("Failed to load texture.");
+	gs::count_object(gs::object_type::Texture, true);
 }
 
 gs::texture::~texture()
@@ -149,6 +153,7 @@ gs::texture::~texture()
 			gs_cubetexture_destroy(_texture);
 			break;
 		}
+		gs::count_object(gs::object_type::Texture, false);
 	}
 	_texture = nullptr;
 }
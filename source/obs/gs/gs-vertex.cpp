@@ -53,7 +53,7 @@ gs::vertex::~vertex()
 }
 
 gs::vertex::vertex(vec3* p, vec3* n, vec3* t, uint32_t* col, vec4* uvs[MAXIMUM_UVW_LAYERS])
-	: position(p), normal(n), tangent(t), color(col), _has_store(false)
+	: position(p), normal(n), tangent(t), color(col), uv(), _has_store(false), _store(nullptr)
 {
 	if (uvs != nullptr) {
 		for (size_t idx = 0; idx < MAXIMUM_UVW_LAYERS; idx++) {
@@ -18,9 +18,13 @@
  */
 
 #include "gs-vertexbuffer.hpp"
+#include <algorithm>
+#include <new>
 #include <stdexcept>
+#include <utility>
 #include "obs/gs/gs-helper.hpp"
 #include "util-memory.hpp"
+#include "util-profiler.hpp"
 
 // OBS
 #ifdef _MSC_VER
@@ -32,29 +36,33 @@
 #pragma warning(pop)
 #endif
 
-gs::vertex_buffer::~vertex_buffer()
+// Streams start on a 16 byte boundary, as libobs and SSE expect of vec3 and vec4 arrays.
+static size_t stream_size(size_t element_size, uint32_t vertices)
 {
-	if (_positions) {
-		util::free_aligned(_positions);
-		_positions = nullptr;
-	}
-	if (_normals) {
-		util::free_aligned(_normals);
-		_normals = nullptr;
-	}
-	if (_tangents) {
-		util::free_aligned(_tangents);
-		_tangents = nullptr;
-	}
-	if (_colors) {
-		util::free_aligned(_colors);
-		_colors = nullptr;
+	return (element_size * vertices + 15) & ~size_t(15);
+}
+
+static gs_vb_data* get_vertex_data(gs_vertbuffer_t* vb)
+{
+	auto        gctx = gs::context();
+	gs_vb_data* vbd  = gs_vertexbuffer_get_data(vb);
+	if (!vbd)
+		throw std::runtime_error("vertex buffer with no data");
+	return vbd;
+}
+
+void gs::vertex_buffer::release()
+{
+	if (_memory) {
+		util::free_aligned(_memory);
+		_memory = nullptr;
 	}
-	for (size_t n = 0; n < _layers; n++) {
-		if (_uvs[n]) {
-			util::free_aligned(_uvs[n]);
-			_uvs[n] = nullptr;
-		}
+	_positions = nullptr;
+	_normals   = nullptr;
+	_tangents  = nullptr;
+	_colors    = nullptr;
+	for (size_t n = 0; n < MAXIMUM_UVW_LAYERS; n++) {
+		_uvs[n] = nullptr;
 	}
 	if (_layer_data) {
 		util::free_aligned(_layer_data);
@@ -64,14 +72,24 @@ gs::vertex_buffer::~vertex_buffer()
 		memset(_data, 0, sizeof(gs_vb_data));
 		if (!_buffer) {
 			gs_vbdata_destroy(_data);
-			_data = nullptr;
 		}
+		_data = nullptr;
 	}
 	if (_buffer) {
 		auto gctx = gs::context();
 		gs_vertexbuffer_destroy(_buffer);
+		gs::count_object(gs::object_type::VertexBuffer, false);
 		_buffer = nullptr;
 	}
+	_size     = 0;
+	_capacity = 0;
+	_layers   = 0;
+	_dirty    = false;
+}
+
+gs::vertex_buffer::~vertex_buffer()
+{
+	release();
 }
 
 gs::vertex_buffer::vertex_buffer() : vertex_buffer(MAXIMUM_VERTICES, MAXIMUM_UVW_LAYERS) {}
@@ -79,8 +97,13 @@ gs::vertex_buffer::vertex_buffer() : vertex_buffer(MAXIMUM_VERTICES, MAXIMUM_UVW
 gs::vertex_buffer::vertex_buffer(uint32_t vertices) : vertex_buffer(vertices, MAXIMUM_UVW_LAYERS) {}
 
 gs::vertex_buffer::vertex_buffer(uint32_t vertices, uint8_t uvlayers)
-	: _size(vertices), _capacity(vertices), _layers(uvlayers), _positions(nullptr), _normals(nullptr),
-	  _tangents(nullptr), _colors(nullptr), _data(nullptr), _buffer(nullptr), _layer_data(nullptr)
+	: vertex_buffer(vertices, uvlayers, attributes::All)
+{}
+
+gs::vertex_buffer::vertex_buffer(uint32_t vertices, uint8_t uvlayers, gs::vertex_buffer::attributes attribs)
+	: _size(vertices), _capacity(vertices), _layers(uvlayers), _attributes(attribs), _dirty(false), _memory(nullptr),
+	  _positions(nullptr), _normals(nullptr), _tangents(nullptr), _colors(nullptr), _uvs(), _data(nullptr),
+	  _buffer(nullptr), _layer_data(nullptr)
 {
 	if (vertices > MAXIMUM_VERTICES) {
 		throw std::out_of_range("vertices out of range");
@@ -89,30 +112,56 @@ gs::vertex_buffer::vertex_buffer(uint32_t vertices, uint8_t uvlayers)
 		throw std::out_of_range("uvlayers out of range");
 	}
 
-	// Allocate memory for data.
-	_data         = gs_vbdata_create();
-	_data->num    = _capacity;
-	_data->points = _positions = (vec3*)util::malloc_aligned(16, sizeof(vec3) * _capacity);
-	_data->normals = _normals = (vec3*)util::malloc_aligned(16, sizeof(vec3) * _capacity);
-	_data->tangents = _tangents = (vec3*)util::malloc_aligned(16, sizeof(vec3) * _capacity);
-	_data->colors = _colors = (uint32_t*)util::malloc_aligned(16, sizeof(uint32_t) * _capacity);
-
-	// cppcheck-suppress memsetClassFloat
-	memset(_positions, 0, sizeof(vec3) * _capacity);
-	// cppcheck-suppress memsetClassFloat
-	memset(_normals, 0, sizeof(vec3) * _capacity);
-	// cppcheck-suppress memsetClassFloat
-	memset(_tangents, 0, sizeof(vec3) * _capacity);
-	memset(_colors, 0, sizeof(uint32_t) * _capacity);
+	bool has_normals  = (_attributes & attributes::Normal) == attributes::Normal;
+	bool has_tangents = (_attributes & attributes::Tangent) == attributes::Tangent;
+	bool has_colors   = (_attributes & attributes::Color) == attributes::Color;
+
+	// Allocate memory for data, one block holding every stream.
+	size_t vec3_size  = stream_size(sizeof(vec3), _capacity);
+	size_t color_size = stream_size(sizeof(uint32_t), _capacity);
+	size_t uv_size    = stream_size(sizeof(vec4), _capacity);
+	size_t total      = vec3_size * (1 + (has_normals ? 1 : 0) + (has_tangents ? 1 : 0))
+						+ (has_colors ? color_size : 0) + uv_size * _layers;
+	_memory = util::malloc_aligned(16, std::max<size_t>(total, 16));
+	if (!_memory) {
+		throw std::bad_alloc();
+	}
+	memset(_memory, 0, total);
+
+	uint8_t* cursor = reinterpret_cast<uint8_t*>(_memory);
+	_positions      = reinterpret_cast<vec3*>(cursor);
+	cursor += vec3_size;
+	if (has_normals) {
+		_normals = reinterpret_cast<vec3*>(cursor);
+		cursor += vec3_size;
+	}
+	if (has_tangents) {
+		_tangents = reinterpret_cast<vec3*>(cursor);
+		cursor += vec3_size;
+	}
+	if (has_colors) {
+		_colors = reinterpret_cast<uint32_t*>(cursor);
+		cursor += color_size;
+	}
+	for (size_t n = 0; n < _layers; n++) {
+		_uvs[n] = reinterpret_cast<vec4*>(cursor);
+		cursor += uv_size;
+	}
 
-	_data->num_tex = _layers;
+	// libobs creates no GPU buffer for an attribute that is nullptr here, and then also skips it when flushing.
+	_data           = gs_vbdata_create();
+	_data->num      = _capacity;
+	_data->points   = _positions;
+	_data->normals  = _normals;
+	_data->tangents = _tangents;
+	_data->colors   = _colors;
+	_data->num_tex  = _layers;
 	if (_layers > 0) {
 		_data->tvarray = _layer_data =
 			(gs_tvertarray*)util::malloc_aligned(16, sizeof(gs_tvertarray) * _layers);
 		for (size_t n = 0; n < _layers; n++) {
-			_layer_data[n].array = _uvs[n] = (vec4*)util::malloc_aligned(16, sizeof(vec4) * _capacity);
-			_layer_data[n].width            = 4;
-			memset(_uvs[n], 0, sizeof(vec4) * _capacity);
+			_layer_data[n].array = _uvs[n];
+			_layer_data[n].width = 4;
 		}
 	} else {
 		_data->tvarray = nullptr;
@@ -120,26 +169,22 @@ gs::vertex_buffer::vertex_buffer(uint32_t vertices, uint8_t uvlayers)
 
 	// Allocate GPU
 	auto gctx      = gs::context();
-	_buffer = gs_vertexbuffer_create(_data, GS_DYNAMIC);
+	_buffer        = gs_vertexbuffer_create(_data, GS_DYNAMIC);
 	memset(_data, 0, sizeof(gs_vb_data));
 	_data->num     = _capacity;
 	_data->num_tex = _layers;
 	if (!_buffer) {
+		// The destructor does not run for a constructor that throws.
+		release();
 		throw std::runtime_error("Failed to create vertex buffer.");
 	}
+	gs::count_object(gs::object_type::VertexBuffer, true);
 }
 
-// cppcheck-suppress uninitMemberVar
 gs::vertex_buffer::vertex_buffer(gs_vertbuffer_t* vb)
+	: vertex_buffer(uint32_t(get_vertex_data(vb)->num), uint8_t(get_vertex_data(vb)->num_tex))
 {
-	auto        gctx = gs::context();
-	gs_vb_data* vbd  = gs_vertexbuffer_get_data(vb);
-	if (!vbd)
-		throw std::runtime_error("vertex buffer with no data");
-
-	vertex_buffer((uint32_t)vbd->num);
-	this->set_uv_layers((uint32_t)vbd->num_tex);
-
+	gs_vb_data* vbd = get_vertex_data(vb);
 	if (vbd->points != nullptr)
 		memcpy(_positions, vbd->points, vbd->num * sizeof(vec3));
 	if (vbd->normals != nullptr)
@@ -156,102 +201,83 @@ gs::vertex_buffer::vertex_buffer(gs_vertbuffer_t* vb)
 				} else {
 					for (size_t idx = 0; idx < _capacity; idx++) {
 						float* mem = reinterpret_cast<float*>(vbd->tvarray[n].array) + (idx * vbd->tvarray[n].width);
-						// cppcheck-suppress memsetClassFloat
-						memset(&_uvs[n][idx], 0, sizeof(vec4));
-						memcpy(&_uvs[n][idx], mem, vbd->tvarray[n].width);
+						memcpy(&_uvs[n][idx], mem, vbd->tvarray[n].width * sizeof(float));
 					}
 				}
 			}
 		}
 	}
+	_dirty = true;
 }
 
-// cppcheck-suppress uninitMemberVar
-gs::vertex_buffer::vertex_buffer(vertex_buffer const& other) : vertex_buffer(other._capacity)
+gs::vertex_buffer::vertex_buffer(vertex_buffer const& other)
+	: vertex_buffer(other._capacity, uint8_t(other._layers), other._attributes)
 {
 	// Copy Constructor
+	_size = other._size;
 	memcpy(_positions, other._positions, _capacity * sizeof(vec3));
-	memcpy(_normals, other._normals, _capacity * sizeof(vec3));
-	memcpy(_tangents, other._tangents, _capacity * sizeof(vec3));
-	memcpy(_colors, other._colors, _capacity * sizeof(vec3));
-	for (size_t n = 0; n < MAXIMUM_UVW_LAYERS; n++) {
-		memcpy(_uvs[n], other._uvs[n], _capacity * sizeof(vec3));
+	if (_normals)
+		memcpy(_normals, other._normals, _capacity * sizeof(vec3));
+	if (_tangents)
+		memcpy(_tangents, other._tangents, _capacity * sizeof(vec3));
+	if (_colors)
+		memcpy(_colors, other._colors, _capacity * sizeof(uint32_t));
+	for (size_t n = 0; n < _layers; n++) {
+		memcpy(_uvs[n], other._uvs[n], _capacity * sizeof(vec4));
 	}
+	_dirty = true;
 }
 
-gs::vertex_buffer::vertex_buffer(vertex_buffer const&& other)
+gs::vertex_buffer::vertex_buffer(vertex_buffer&& other) noexcept
+	: _size(0), _capacity(0), _layers(0), _attributes(attributes::None), _dirty(false), _memory(nullptr),
+	  _positions(nullptr), _normals(nullptr), _tangents(nullptr), _colors(nullptr), _uvs(), _data(nullptr),
+	  _buffer(nullptr), _layer_data(nullptr)
 {
 	// Move Constructor
-	_capacity  = other._capacity;
-	_size      = other._size;
-	_layers    = other._layers;
-	_positions = other._positions;
-	_normals   = other._normals;
-	_tangents  = other._tangents;
-	for (size_t n = 0; n < MAXIMUM_UVW_LAYERS; n++) {
-		_uvs[n] = other._uvs[n];
-	}
-	_data = other._data;
-	_buffer     = other._buffer;
-	_layer_data        = other._layer_data;
+	*this = std::move(other);
 }
 
-void gs::vertex_buffer::operator=(vertex_buffer const&& other)
+gs::vertex_buffer& gs::vertex_buffer::operator=(vertex_buffer&& other) noexcept
 {
 	// Move Assignment
-	/// First self-destruct (semi-destruct itself).
-	if (_positions) {
-		util::free_aligned(_positions);
-		_positions = nullptr;
-	}
-	if (_normals) {
-		util::free_aligned(_normals);
-		_normals = nullptr;
-	}
-	if (_tangents) {
-		util::free_aligned(_tangents);
-		_tangents = nullptr;
-	}
-	if (_colors) {
-		util::free_aligned(_colors);
-		_colors = nullptr;
-	}
-	for (size_t n = 0; n < MAXIMUM_UVW_LAYERS; n++) {
-		if (_uvs[n]) {
-			util::free_aligned(_uvs[n]);
-			_uvs[n] = nullptr;
-		}
-	}
-	if (_layer_data) {
-		util::free_aligned(_layer_data);
-		_layer_data = nullptr;
-	}
-	if (_data) {
-		memset(_data, 0, sizeof(gs_vb_data));
-		if (!_buffer) {
-			gs_vbdata_destroy(_data);
-			_data = nullptr;
-		}
-	}
-	if (_buffer) {
-		auto gctx = gs::context();
-		gs_vertexbuffer_destroy(_buffer);
-		_buffer = nullptr;
-	}
+	if (this == &other)
+		return *this;
 
-	/// Then assign new values.
-	_capacity  = other._capacity;
-	_size      = other._size;
-	_layers    = other._layers;
-	_positions = other._positions;
-	_normals   = other._normals;
-	_tangents  = other._tangents;
+	/// First self-destruct (semi-destruct itself).
+	release();
+
+	/// Then take over the values of other, and leave it empty so it frees nothing.
+	_size       = other._size;
+	_capacity   = other._capacity;
+	_layers     = other._layers;
+	_attributes = other._attributes;
+	_dirty      = other._dirty;
+	_memory     = other._memory;
+	_positions  = other._positions;
+	_normals    = other._normals;
+	_tangents   = other._tangents;
+	_colors     = other._colors;
 	for (size_t n = 0; n < MAXIMUM_UVW_LAYERS; n++) {
-		_uvs[n] = other._uvs[n];
+		_uvs[n]       = other._uvs[n];
+		other._uvs[n] = nullptr;
 	}
-	_data = other._data;
+	_data       = other._data;
 	_buffer     = other._buffer;
-	_layer_data        = other._layer_data;
+	_layer_data = other._layer_data;
+
+	other._memory     = nullptr;
+	other._positions  = nullptr;
+	other._normals    = nullptr;
+	other._tangents   = nullptr;
+	other._colors     = nullptr;
+	other._data       = nullptr;
+	other._buffer     = nullptr;
+	other._layer_data = nullptr;
+	other._size       = 0;
+	other._capacity   = 0;
+	other._layers     = 0;
+	other._dirty      = false;
+	return *this;
 }
 
 void gs::vertex_buffer::resize(uint32_t new_size)
@@ -259,6 +285,9 @@ void gs::vertex_buffer::resize(uint32_t new_size)
 	if (new_size > _capacity) {
 		throw std::out_of_range("new_size out of range");
 	}
+	// Only the vertices in use are uploaded, any added ones have yet to be.
+	if (new_size > _size)
+		_dirty = true;
 	_size = new_size;
 }
 
@@ -277,8 +306,10 @@ const gs::vertex gs::vertex_buffer::at(uint32_t idx)
 	if ((idx < 0) || (idx >= _size)) {
 		throw std::out_of_range("idx out of range");
 	}
+	_dirty = true;
 
-	gs::vertex vtx(&_positions[idx], &_normals[idx], &_tangents[idx], &_colors[idx], nullptr);
+	gs::vertex vtx(&_positions[idx], _normals ? &_normals[idx] : nullptr, _tangents ? &_tangents[idx] : nullptr,
+				   _colors ? &_colors[idx] : nullptr, nullptr);
 	for (size_t n = 0; n < _layers; n++) {
 		vtx.uv[n] = &_uvs[n][idx];
 	}
@@ -300,23 +331,44 @@ uint32_t gs::vertex_buffer::get_uv_layers()
 	return _layers;
 }
 
+gs::vertex_buffer::attributes gs::vertex_buffer::get_attributes()
+{
+	return _attributes;
+}
+
+size_t gs::vertex_buffer::get_memory_usage()
+{
+	size_t per_vertex = sizeof(vec3) + sizeof(vec4) * _layers;
+	if (_normals)
+		per_vertex += sizeof(vec3);
+	if (_tangents)
+		per_vertex += sizeof(vec3);
+	if (_colors)
+		per_vertex += sizeof(uint32_t);
+	return per_vertex * _capacity;
+}
+
 vec3* gs::vertex_buffer::get_positions()
 {
+	_dirty = true;
 	return _positions;
 }
 
 vec3* gs::vertex_buffer::get_normals()
 {
+	_dirty = true;
 	return _normals;
 }
 
 vec3* gs::vertex_buffer::get_tangents()
 {
+	_dirty = true;
 	return _tangents;
 }
 
 uint32_t* gs::vertex_buffer::get_colors()
 {
+	_dirty = true;
 	return _colors;
 }
 
@@ -325,22 +377,34 @@ vec4* gs::vertex_buffer::get_uv_layer(size_t idx)
 	if ((idx < 0) || (idx >= _layers)) {
 		throw std::out_of_range("idx out of range");
 	}
+	_dirty = true;
 	return _uvs[idx];
 }
 
+void gs::vertex_buffer::mark_dirty()
+{
+	_dirty = true;
+}
+
+bool gs::vertex_buffer::is_dirty()
+{
+	return _dirty;
+}
+
 gs_vertbuffer_t* gs::vertex_buffer::update(bool refreshGPU)
 {
-	if (!refreshGPU)
+	if (!refreshGPU || !_dirty || (_size == 0))
 		return _buffer;
 
 	if (_size > _capacity)
 		throw std::out_of_range("size is larger than capacity");
 
-	// Update VertexBuffer data.
-	auto gctx          = gs::context();
-	_data = gs_vertexbuffer_get_data(_buffer);
+	// Update VertexBuffer data. libobs flushes every attribute at once and discards what was in the
+	//  buffer before, so the vertices in use are uploaded in full, but none past them.
+	auto gctx       = gs::context();
+	_data           = gs_vertexbuffer_get_data(_buffer);
 	memset(_data, 0, sizeof(gs_vb_data));
-	_data->num      = _capacity;
+	_data->num      = _size;
 	_data->points   = _positions;
 	_data->normals  = _normals;
 	_data->tangents = _tangents;
@@ -354,6 +418,8 @@ gs_vertbuffer_t* gs::vertex_buffer::update(bool refreshGPU)
 
 	// Update GPU
 	gs_vertexbuffer_flush(_buffer);
+	_dirty = false;
+	util::profiler::count_upload(uint64_t(get_memory_usage() / _capacity) * _size);
 
 	// WORKAROUND: OBS Studio 20.x and below incorrectly deletes data that it doesn't own.
 	memset(_data, 0, sizeof(gs_vb_data));
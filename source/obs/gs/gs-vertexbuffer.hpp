@@ -23,6 +23,7 @@
 #include "gs-vertex.hpp"
 #include "util-math.hpp"
 #include "util-memory.hpp"
+#include "utility.hpp"
 
 // OBS
 #ifdef _MSC_VER
@@ -36,11 +37,25 @@
 
 namespace gs {
 	class vertex_buffer {
-		uint32_t _size;
-		uint32_t _capacity;
-		uint32_t _layers;
-
-		// Memory Storage
+		public:
+		// Attributes stored in addition to the position, which is always present.
+		enum class attributes : uint8_t {
+			None    = 0,
+			Normal  = 1,
+			Tangent = 2,
+			Color   = 4,
+			All     = 7,
+		};
+
+		private:
+		uint32_t                      _size;
+		uint32_t                      _capacity;
+		uint32_t                      _layers;
+		gs::vertex_buffer::attributes _attributes;
+		bool                          _dirty;
+
+		// Memory Storage, all streams share a single allocation.
+		void*     _memory;
 		vec3*     _positions;
 		vec3*     _normals;
 		vec3*     _tangents;
@@ -52,6 +67,9 @@ namespace gs {
 		gs_vertbuffer_t* _buffer;
 		gs_tvertarray*   _layer_data;
 
+		// Free everything, leaving an empty buffer behind.
+		void release();
+
 		public:
 		virtual ~vertex_buffer();
 
@@ -75,6 +93,17 @@ namespace gs {
 		*/
 		vertex_buffer(uint32_t vertices, uint8_t layers);
 
+		/*!
+		* \brief Create a Vertex Buffer that only stores some attributes.
+		* Attributes that aren't stored are neither allocated nor uploaded, and their pointers are
+		*  nullptr. Shaders reading them can not be used with this buffer.
+		*
+		* \param vertices Number of vertices to store.
+		* \param layers Number of uv layers to store.
+		* \param attribs Attributes to store besides the position.
+		*/
+		vertex_buffer(uint32_t vertices, uint8_t layers, gs::vertex_buffer::attributes attribs);
+
 		/*!
 		* \brief Create a copy of a Vertex Buffer
 		* Full Description below
@@ -105,19 +134,19 @@ namespace gs {
 
 		/*!
 		* \brief Move Constructor
-		*
+		* Takes over the memory and GPU buffer of other, which is left empty.
 		*
 		* \param other
 		*/
-		vertex_buffer(vertex_buffer const&& other);
+		vertex_buffer(vertex_buffer&& other) noexcept;
 
 		/*!
 		* \brief Move Assignment
-		*
+		* Releases the current memory and GPU buffer, then takes over those of other, which is left empty.
 		*
 		* \param other
 		*/
-		void operator=(vertex_buffer const&& other);
+		vertex_buffer& operator=(vertex_buffer&& other) noexcept;
 
 		void resize(uint32_t new_size);
 
@@ -133,6 +162,11 @@ namespace gs {
 
 		uint32_t get_uv_layers();
 
+		gs::vertex_buffer::attributes get_attributes();
+
+		// Memory held for the vertex data on the CPU, which is also what a full upload transfers.
+		size_t get_memory_usage();
+
 		/*!
 		* \brief Directly access the positions buffer
 		* Returns the internal memory that is assigned to hold all vertex positions.
@@ -145,7 +179,7 @@ namespace gs {
 		* \brief Directly access the normals buffer
 		* Returns the internal memory that is assigned to hold all vertex normals.
 		*
-		* \return A <vec3*> that points at the first vertex's normal.
+		* \return A <vec3*> that points at the first vertex's normal, or nullptr if not stored.
 		*/
 		vec3* get_normals();
 
@@ -153,7 +187,7 @@ namespace gs {
 		* \brief Directly access the tangents buffer
 		* Returns the internal memory that is assigned to hold all vertex tangents.
 		*
-		* \return A <vec3*> that points at the first vertex's tangent.
+		* \return A <vec3*> that points at the first vertex's tangent, or nullptr if not stored.
 		*/
 		vec3* get_tangents();
 
@@ -161,7 +195,7 @@ namespace gs {
 		* \brief Directly access the colors buffer
 		* Returns the internal memory that is assigned to hold all vertex colors.
 		*
-		* \return A <uint32_t*> that points at the first vertex's color.
+		* \return A <uint32_t*> that points at the first vertex's color, or nullptr if not stored.
 		*/
 		uint32_t* get_colors();
 
@@ -173,8 +207,27 @@ namespace gs {
 		*/
 		vec4* get_uv_layer(size_t idx);
 
+		/*!
+		* \brief Flag the memory storage as changed
+		* Accessing vertices through at() or one of the buffer getters already does this, which only
+		*  leaves writes through pointers kept from an earlier access.
+		*/
+		void mark_dirty();
+
+		bool is_dirty();
+
 		gs_vertbuffer_t* update();
 
+		/*!
+		* \brief Upload the memory storage to the GPU
+		* Nothing is uploaded unless the storage was changed since the last upload, and then only the
+		*  first size() vertices are.
+		*
+		* \param refreshGPU Upload changes, if false only the current buffer is returned.
+		* \return The buffer to pass to gs_load_vertexbuffer.
+		*/
 		gs_vertbuffer_t* update(bool refreshGPU);
 	};
 } // namespace gs
+
+P_ENABLE_BITMASK_OPERATORS(gs::vertex_buffer::attributes)
@@ -0,0 +1,252 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "obs-static-input.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+
+// OBS
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)
+#endif
+#include <callback/signal.h>
+#include <util/platform.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+// Number of ticks the fingerprint must stay the same before the output is reused.
+#define UNCHANGED_TICKS 2
+// Time between two checks of the file an image is loaded from, in nanoseconds.
+#define FILE_CHECK_INTERVAL 1000000000ull
+
+// 64-bit FNV-1a, continued from the given hash.
+static void hash_bytes(uint64_t& hash, const void* data, size_t length)
+{
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+	for (size_t idx = 0; idx < length; idx++) {
+		hash ^= bytes[idx];
+		hash *= 1099511628211ull;
+	}
+}
+
+template<typename T>
+static void hash_value(uint64_t& hash, T value)
+{
+	hash_bytes(hash, &value, sizeof(T));
+}
+
+static void hash_string(uint64_t& hash, const char* value)
+{
+	if (value) {
+		hash_bytes(hash, value, strlen(value) + 1);
+	} else {
+		hash_value(hash, '\0');
+	}
+}
+
+static void hash_settings(uint64_t& hash, obs_data_t* settings)
+{
+	hash_string(hash, obs_data_get_json(settings));
+}
+
+static bool is_static_source(obs_source_t* source, obs_data_t* settings, std::string& file)
+{
+	file.clear();
+
+	const char* id = obs_source_get_id(source);
+	if (!id)
+		return false;
+
+	if (strcmp(id, "image_source") == 0) {
+		// Animated images keep changing.
+		std::string path      = obs_data_get_string(settings, "file");
+		std::string extension = path.substr(std::min(path.size(), path.find_last_of('.')));
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		if (extension == ".gif")
+			return false;
+
+		// The source reloads the file when it changes on disk, so that is part of its state too.
+		file = path;
+		return true;
+	} else if (strcmp(id, "color_source") == 0) {
+		return true;
+	} else if (strncmp(id, "text_gdiplus", 12) == 0) {
+		return !obs_data_get_bool(settings, "read_from_file");
+	} else if (strncmp(id, "text_ft2_source", 15) == 0) {
+		return !obs_data_get_bool(settings, "from_file");
+	}
+	return false;
+}
+
+static void on_source_update(void* ptr, calldata_t*)
+{
+	// Emitted on whichever thread changed the settings, the tick picks it up.
+	reinterpret_cast<std::atomic<bool>*>(ptr)->store(true, std::memory_order_release);
+}
+
+obs::static_input::static_input() : _input_key(0), _key(0), _unchanged(0) {}
+
+obs::static_input::~static_input()
+{
+	unbind(_target);
+	unbind(_filter);
+	unbind(_dependency);
+}
+
+void obs::static_input::bind(std::unique_ptr<watch>& state, obs_source_t* source)
+{
+	if (state && obs_weak_source_references_source(state->source, source))
+		return;
+
+	unbind(state);
+	if (!source)
+		return;
+
+	state                = std::make_unique<watch>();
+	state->source        = obs_source_get_weak_source(source);
+	state->is_static     = false;
+	state->settings_hash = 0;
+	state->file_hash     = 0;
+	state->file_checked  = 0;
+	state->changed.store(true, std::memory_order_relaxed);
+	signal_handler_connect(obs_source_get_signal_handler(source), "update", &on_source_update, &state->changed);
+}
+
+void obs::static_input::unbind(std::unique_ptr<watch>& state)
+{
+	if (!state)
+		return;
+
+	// A source that is already gone took its signal handler with it.
+	obs_source_t* source = obs_weak_source_get_source(state->source);
+	if (source) {
+		signal_handler_disconnect(obs_source_get_signal_handler(source), "update", &on_source_update,
+								  &state->changed);
+		obs_source_release(source);
+	}
+	obs_weak_source_release(state->source);
+	state.reset();
+}
+
+void obs::static_input::refresh(watch& state, obs_source_t* source)
+{
+	if (state.changed.exchange(false, std::memory_order_acquire)) {
+		obs_data_t* settings = obs_source_get_settings(source);
+		state.settings_hash  = 14695981039346656037ull;
+		hash_settings(state.settings_hash, settings);
+		state.is_static    = is_static_source(source, settings, state.file);
+		state.file_checked = 0;
+		obs_data_release(settings);
+	}
+
+	if (state.is_static && !state.file.empty()) {
+		uint64_t now = os_gettime_ns();
+		if ((state.file_checked == 0) || ((now - state.file_checked) >= FILE_CHECK_INTERVAL)) {
+			struct stat stats;
+			state.file_hash = 14695981039346656037ull;
+			if (os_stat(state.file.c_str(), &stats) == 0) {
+				hash_value(state.file_hash, int64_t(stats.st_mtime));
+				hash_value(state.file_hash, int64_t(stats.st_size));
+			} else {
+				hash_value(state.file_hash, int64_t(-1));
+			}
+			state.file_checked = now;
+		}
+	} else if (state.is_static) {
+		state.file_hash = 0;
+	}
+}
+
+uint64_t obs::static_input::fingerprint(std::unique_ptr<watch>& state, obs_source_t* source)
+{
+	bind(state, source);
+	if (!source)
+		return 0;
+
+	uint32_t output_flags = obs_source_get_output_flags(source);
+	if (output_flags & OBS_SOURCE_ASYNC)
+		return 0;
+
+	refresh(*state, source);
+	if (!state->is_static)
+		return 0;
+
+	uint64_t hash = 14695981039346656037ull;
+	hash_value(hash, state->file_hash);
+	hash_string(hash, obs_source_get_id(source));
+	hash_value(hash, output_flags);
+	hash_value(hash, obs_source_get_flags(source));
+	hash_value(hash, obs_source_get_base_width(source));
+	hash_value(hash, obs_source_get_base_height(source));
+	hash_value(hash, state->settings_hash);
+
+	// 0 means "not static", which a real fingerprint must never collide with.
+	return hash ? hash : 1;
+}
+
+bool obs::static_input::update(obs_source_t* filter, obs_source_t* dependency, uint64_t extra)
+{
+	obs_source_t* target = obs_filter_get_target(filter);
+	obs_source_t* parent = obs_filter_get_parent(filter);
+
+	uint64_t key = 0;
+	_input_key   = fingerprint(_target, (target && (target == parent)) ? target : nullptr);
+	if (_input_key != 0) {
+		bind(_filter, filter);
+		refresh(*_filter, filter);
+
+		key = _input_key;
+		hash_value(key, _filter->settings_hash);
+		hash_value(key, extra);
+		if (dependency) {
+			uint64_t dependency_key = fingerprint(_dependency, dependency);
+			if (dependency_key != 0) {
+				hash_value(key, dependency_key);
+			} else {
+				key = 0;
+			}
+		}
+	}
+
+	if ((key != 0) && (key == _key)) {
+		_unchanged = std::min<uint32_t>(_unchanged + 1, UNCHANGED_TICKS);
+	} else {
+		_unchanged = 0;
+	}
+	_key = key;
+
+	return (_key != 0) && (_unchanged >= UNCHANGED_TICKS);
+}
+
+void obs::static_input::reset()
+{
+	_input_key = 0;
+	_key       = 0;
+	_unchanged = 0;
+}
+
+uint64_t obs::static_input::get_input_key()
+{
+	return _input_key;
+}
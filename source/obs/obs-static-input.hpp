@@ -0,0 +1,104 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <atomic>
+#include <cinttypes>
+#include <memory>
+#include <string>
+
+// OBS
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)
+#endif
+#include <obs.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+namespace obs {
+	/*!
+	 * \brief Detects filters whose input has not changed since the last tick.
+	 *
+	 * Only sources known to show the same picture as long as their settings don't change are
+	 *  considered static: images (except animated ones), colors and text not read from a file.
+	 *  Their fingerprint is made up of the id, flags, settings and size of the source, plus the
+	 *  modification time and size of the file an image is loaded from. Async sources (media,
+	 *  capture devices) never are static, as there is no way to inspect their frames without
+	 *  taking them away from the source.
+	 *
+	 * Settings are only hashed again after the "update" signal of their source, and files are
+	 *  checked at most once per second, so that a tick costs next to nothing.
+	 */
+	class static_input {
+		// Cached state of one source, refreshed when the source signals an update.
+		struct watch {
+			obs_weak_source_t* source;
+			std::atomic<bool>  changed;
+			bool               is_static;
+			uint64_t           settings_hash;
+			std::string        file;
+			uint64_t           file_hash;
+			uint64_t           file_checked;
+		};
+
+		std::unique_ptr<watch> _target;
+		std::unique_ptr<watch> _filter;
+		std::unique_ptr<watch> _dependency;
+
+		uint64_t _input_key;
+		uint64_t _key;
+		uint32_t _unchanged;
+
+		public:
+		static_input();
+		~static_input();
+
+		/*!
+		 * \brief Fingerprint the input and settings of a filter, call once per tick.
+		 *
+		 * The input only counts as static if the filter is the first one on its source, as any
+		 *  filter before it may change the picture at will. A filter that also renders another
+		 *  source can pass it as dependency, which must then be static as well.
+		 *
+		 * \param extra Any other state the output depends on, such as a file read by the filter.
+		 * \return true if the previous output of the filter can be shown again.
+		 */
+		bool update(obs_source_t* filter, obs_source_t* dependency = nullptr, uint64_t extra = 0);
+
+		// Forget the fingerprint, the next update() will not allow reusing the output.
+		void reset();
+
+		// Fingerprint of the filter input alone from the last update(), 0 if it isn't static.
+		uint64_t get_input_key();
+
+		private:
+		static void bind(std::unique_ptr<watch>& state, obs_source_t* source);
+		static void unbind(std::unique_ptr<watch>& state);
+		static void refresh(watch& state, obs_source_t* source);
+
+		/*!
+		 * \brief Fingerprint a source.
+		 *
+		 * \return 0 if the source can't be considered static, otherwise a hash of its state.
+		 */
+		static uint64_t fingerprint(std::unique_ptr<watch>& state, obs_source_t* source);
+	};
+} // namespace obs
@@ -18,6 +18,7 @@
 */
 
 #include "plugin.hpp"
+#include "obs/gs/gs-helper.hpp"
 #include "obs/obs-source-tracker.hpp"
 
 std::list<std::function<void()>> initializer_functions;
@@ -42,6 +43,9 @@ MODULE_EXPORT void obs_module_unload(void)
 		func();
 	}
 	obs::source_tracker::finalize();
+
+	// Every instance is gone by now, so anything the graphics wrappers still hold was leaked.
+	gs::check_objects();
 }
 
 #ifdef _WIN32
@@ -18,11 +18,13 @@
 */
 
 #include "source-mirror.hpp"
-#include <bitset>
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <functional>
 #include <memory>
 #include <vector>
+#include "obs/gs/gs-helper.hpp"
 #include "obs/obs-source-tracker.hpp"
 #include "obs/obs-tools.hpp"
 #include "strings.hpp"
@@ -44,6 +46,7 @@
 #define ST_AUDIO "Source.Mirror.Source.Audio"
 #define ST_AUDIO_LAYOUT ST ".Audio.Layout"
 #define ST_AUDIO_LAYOUT_(x) ST_AUDIO_LAYOUT "." D_VSTR(x)
+#define ST_AUDIO_PASSTHROUGH ST ".Audio.Passthrough"
 #define ST_SCALING "Source.Mirror.Scaling"
 #define ST_SCALING_METHOD "Source.Mirror.Scaling.Method"
 #define ST_SCALING_METHOD_POINT "Source.Mirror.Scaling.Method.Point"
@@ -60,6 +63,10 @@
 #define ST_SCALING_BOUNDS_FILLHEIGHT "Source.Mirror.Scaling.Bounds.FillHeight"
 #define ST_SCALING_ALIGNMENT "Source.Mirror.Scaling.Alignment"
 
+// Audio buffered between the capturing and the outputting thread, anything beyond that is dropped.
+#define AUDIO_BUFFER_MS 250
+#define AUDIO_WAKEUP_TIMEOUT std::chrono::milliseconds(10)
+
 // Initializer & Finalizer
 P_INITIALIZER(SourceMirrorInit)
 {
@@ -122,6 +129,7 @@ void source::mirror::mirror_factory::get_defaults(obs_data_t* data)
 	obs_data_set_default_string(data, ST_SOURCE, "");
 	obs_data_set_default_bool(data, ST_AUDIO, false);
 	obs_data_set_default_int(data, ST_AUDIO_LAYOUT, static_cast<int64_t>(SPEAKERS_UNKNOWN));
+	obs_data_set_default_bool(data, ST_AUDIO_PASSTHROUGH, false);
 	obs_data_set_default_bool(data, ST_SCALING, false);
 	obs_data_set_default_string(data, ST_SCALING_SIZE, "100x100");
 	obs_data_set_default_int(data, ST_SCALING_METHOD, (int64_t)obs_scale_type::OBS_SCALE_BILINEAR);
@@ -148,6 +156,7 @@ bool source::mirror::mirror_factory::modified_properties(obs_properties_t* pr, o
 	if (obs_properties_get(pr, ST_AUDIO) == p) {
 		bool show = obs_data_get_bool(data, ST_AUDIO);
 		obs_property_set_visible(obs_properties_get(pr, ST_AUDIO_LAYOUT), show);
+		obs_property_set_visible(obs_properties_get(pr, ST_AUDIO_PASSTHROUGH), show);
 		return true;
 	}
 
@@ -230,6 +239,8 @@ obs_properties_t* source::mirror::mirror_factory::get_properties(void*)
 	obs_property_list_add_int(p, D_TRANSLATE(ST_AUDIO_LAYOUT_(Surround)), static_cast<int64_t>(SPEAKERS_5POINT1));
 	obs_property_list_add_int(p, D_TRANSLATE(ST_AUDIO_LAYOUT_(FullSurround)), static_cast<int64_t>(SPEAKERS_7POINT1));
 	obs_property_set_long_description(p, D_TRANSLATE(D_DESC(ST_AUDIO_LAYOUT)));
+	p = obs_properties_add_bool(pr, ST_AUDIO_PASSTHROUGH, D_TRANSLATE(ST_AUDIO_PASSTHROUGH));
+	obs_property_set_long_description(p, D_TRANSLATE(D_DESC(ST_AUDIO_PASSTHROUGH)));
 
 	p = obs_properties_add_bool(pr, ST_SCALING, D_TRANSLATE(ST_SCALING));
 	obs_property_set_long_description(p, D_TRANSLATE(D_DESC(ST_SCALING)));
@@ -366,6 +377,75 @@ void source::mirror::mirror_factory::save(void* p, obs_data_t* d)
 	}
 }
 
+source::mirror::audio_worker::audio_worker() : _kill(false), _pending(false)
+{
+	_thread = std::thread(std::bind(&source::mirror::audio_worker::worker, this));
+	P_LOG_DEBUG("<Source Mirror> Started audio worker.");
+}
+
+source::mirror::audio_worker::~audio_worker()
+{
+	{
+		std::unique_lock<std::mutex> ulock(_lock);
+		_kill = true;
+	}
+	_notify.notify_all();
+	if (_thread.joinable()) {
+		_thread.join();
+	}
+	P_LOG_DEBUG("<Source Mirror> Stopped audio worker.");
+}
+
+void source::mirror::audio_worker::worker()
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	while (!_kill) {
+		// Capturing threads notify without taking the lock, so a wake up can be missed and must time out.
+		_notify.wait_for(ulock, AUDIO_WAKEUP_TIMEOUT, [this]() { return _kill || _pending.exchange(false); });
+		if (_kill) {
+			break;
+		}
+
+		// Instances can't be removed while the lock is held, so they stay valid while being serviced.
+		for (auto instance : _instances) {
+			instance->audio_output();
+		}
+	}
+}
+
+void source::mirror::audio_worker::add(mirror_instance* instance)
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	_instances.push_back(instance);
+}
+
+void source::mirror::audio_worker::remove(mirror_instance* instance)
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	_instances.remove(instance);
+}
+
+void source::mirror::audio_worker::notify()
+{
+	if (!_pending.exchange(true)) {
+		_notify.notify_one();
+	}
+}
+
+std::shared_ptr<source::mirror::audio_worker> source::mirror::audio_worker::get()
+{
+	static std::mutex                                  instance_lock;
+	static std::weak_ptr<source::mirror::audio_worker> instance;
+
+	std::unique_lock<std::mutex>                  ul(instance_lock);
+	std::shared_ptr<source::mirror::audio_worker> worker = instance.lock();
+	if (!worker) {
+		worker   = std::make_shared<source::mirror::audio_worker>();
+		instance = worker;
+	}
+	return worker;
+}
+
 void source::mirror::mirror_instance::release_input()
 {
 	// Clear any references to the previous source.
@@ -423,17 +503,16 @@ void source::mirror::mirror_instance::acquire_input(std::string source_name)
 source::mirror::mirror_instance::mirror_instance(obs_data_t*, obs_source_t* src)
 	: _self(src), _active(true), _tick(0), _scene_rendered(false), _rescale_enabled(false), _rescale_width(1),
 	  _rescale_height(1), _rescale_keep_orig_size(false), _rescale_type(obs_scale_type::OBS_SCALE_BICUBIC),
-	  _rescale_bounds(obs_bounds_type::OBS_BOUNDS_STRETCH), _audio_enabled(false), _audio_kill_thread(false),
-	  _audio_have_output(false), _source_item(nullptr)
+	  _rescale_bounds(obs_bounds_type::OBS_BOUNDS_STRETCH), _audio_enabled(false),
+	  _audio_layout(SPEAKERS_UNKNOWN), _audio_passthrough(false), _source_item(nullptr)
 {
+	_profiler.register_procedures(_self);
+
 	// Initialize Video Rendering
 	this->_scene =
 		std::make_shared<obs::source>(obs_scene_get_source(obs_scene_create_private("Source Mirror Internal Scene")));
 	this->_scene_texture_renderer =
 		std::make_shared<gfx::source_texture>(this->_scene, std::make_shared<obs::source>(this->_self, false, false));
-
-	// Initialize Audio Rendering
-	this->_audio_thread = std::thread(std::bind(&source::mirror::mirror_instance::audio_output_cb, this));
 }
 
 source::mirror::mirror_instance::~mirror_instance()
@@ -441,10 +520,9 @@ source::mirror::mirror_instance::~mirror_instance()
 	release_input();
 
 	// Finalize Audio Rendering
-	this->_audio_kill_thread = true;
-	this->_audio_notify.notify_all();
-	if (this->_audio_thread.joinable()) {
-		this->_audio_thread.join();
+	if (this->_audio_worker) {
+		this->_audio_worker->remove(this);
+		this->_audio_worker.reset();
 	}
 
 	// Finalize Video Rendering
@@ -493,8 +571,33 @@ void source::mirror::mirror_instance::update(obs_data_t* data)
 	}
 
 	// Audio
-	this->_audio_enabled = obs_data_get_bool(data, ST_AUDIO);
-	this->_audio_layout  = static_cast<speaker_layout>(obs_data_get_int(data, ST_AUDIO_LAYOUT));
+	this->_audio_layout = static_cast<speaker_layout>(obs_data_get_int(data, ST_AUDIO_LAYOUT));
+
+	// Passthrough outputs from within the capture callback of the input, while libobs holds its callback lock.
+	//  Another mirror as input would nest those locks, and two mirrors of each other could deadlock, so a mirror of
+	//  a mirror always goes through the worker.
+	bool passthrough = obs_data_get_bool(data, ST_AUDIO_PASSTHROUGH);
+	if (this->_source && (strcmp(obs_source_get_id(this->_source->get()), obs_source_get_id(_self)) == 0))
+		passthrough = false;
+	this->_audio_passthrough = passthrough;
+	if (obs_data_get_bool(data, ST_AUDIO)) {
+		// The ring is created once and never replaced, as the audio threads use it without locking.
+		if (!this->_audio_ring) {
+			audio_t*                 aud = obs_get_audio();
+			audio_output_info const* aoi = aud ? audio_output_get_info(aud) : nullptr;
+			if (aoi) {
+				size_t planes  = std::min<size_t>(get_audio_planes(aoi->format, aoi->speakers), MAX_AV_PLANES);
+				size_t packets = size_t(ceil(double_t(aoi->samples_per_sec) * AUDIO_BUFFER_MS / 1000.
+											 / double_t(AUDIO_OUTPUT_FRAMES)));
+				this->_audio_ring = std::make_unique<util::audio_ring>(packets, planes, AUDIO_OUTPUT_FRAMES);
+				this->_audio_worker = source::mirror::audio_worker::get();
+				this->_audio_worker->add(this);
+			}
+		}
+		this->_audio_enabled.store(!!this->_audio_ring, std::memory_order_release);
+	} else {
+		this->_audio_enabled.store(false, std::memory_order_release);
+	}
 
 	// Rescaling
 	this->_rescale_enabled = obs_data_get_bool(data, ST_SCALING);
@@ -551,6 +654,8 @@ void source::mirror::mirror_instance::deactivate()
 
 void source::mirror::mirror_instance::video_tick(float time)
 {
+	auto profile = _profiler.track(util::profiler::stage::Tick);
+
 	this->_tick += time;
 	if (this->_tick > 0.1f) {
 		this->_tick -= 0.1f;
@@ -589,6 +694,8 @@ void source::mirror::mirror_instance::video_tick(float time)
 
 void source::mirror::mirror_instance::video_render(gs_effect_t* effect)
 {
+	auto profile = _profiler.track(util::profiler::stage::Render);
+
 	if ((this->_rescale_width == 0) || (this->_rescale_height == 0) || !this->_source_item
 		|| !this->_scene_texture_renderer || !this->_source) {
 		return;
@@ -632,42 +739,33 @@ void source::mirror::mirror_instance::video_render(gs_effect_t* effect)
 		// Render the cached scene texture.
 		gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), _scene_texture->get_object());
 		while (gs_effect_loop(effect, "Draw")) {
-			gs_draw_sprite(_scene_texture->get_object(), 0, this->get_width(), this->get_height());
+			gs::draw_sprite(_scene_texture->get_object(), 0, this->get_width(), this->get_height());
 		}
 	}
 }
 
-void source::mirror::mirror_instance::audio_output_cb()
+void source::mirror::mirror_instance::audio_output()
 {
-	std::unique_lock<std::mutex> ulock(this->_audio_lock_outputter);
-
-	while (!this->_audio_kill_thread) {
-		this->_audio_notify.wait(ulock, [this]() { return this->_audio_have_output || this->_audio_kill_thread; });
-
-		if (this->_audio_have_output) { // Get used audio element
-			std::shared_ptr<mirror_audio_data> mad;
-			{
-				std::lock_guard<std::mutex> capture_lock(this->_audio_lock_capturer);
-				if (_audio_data_queue.size() > 0) {
-					mad = _audio_data_queue.front();
-					_audio_data_queue.pop();
-				}
-				if (_audio_data_queue.size() == 0) {
-					this->_audio_have_output = false;
-				}
-			}
+	if (!this->_audio_enabled.load(std::memory_order_acquire)) {
+		return;
+	}
 
-			if (mad) {
-				ulock.unlock();
-				obs_source_output_audio(this->_self, &mad->audio);
-				ulock.lock();
+	while (util::audio_ring::packet* packet = this->_audio_ring->begin_read()) {
+		audio_output_info const* aoi    = audio_output_get_info(obs_get_audio());
+		speaker_layout           layout = this->_audio_layout.load(std::memory_order_relaxed);
 
-				{
-					std::lock_guard<std::mutex> capture_lock(this->_audio_lock_capturer);
-					_audio_data_free_queue.push(mad);
-				}
-			}
+		obs_source_audio audio = {};
+		for (size_t plane = 0; plane < packet->planes; plane++) {
+			audio.data[plane] = reinterpret_cast<uint8_t*>(this->_audio_ring->get_plane(packet, plane));
 		}
+		audio.format          = aoi->format;
+		audio.frames          = packet->frames;
+		audio.timestamp       = packet->timestamp;
+		audio.samples_per_sec = aoi->samples_per_sec;
+		audio.speakers        = (layout != SPEAKERS_UNKNOWN) ? layout : aoi->speakers;
+		obs_source_output_audio(this->_self, &audio);
+
+		this->_audio_ring->end_read();
 	}
 }
 
@@ -701,66 +799,61 @@ void source::mirror::mirror_instance::on_source_rename(obs::source* source, std:
 
 void source::mirror::mirror_instance::on_audio_data(obs::source*, const audio_data* audio, bool)
 {
-	if (!this->_audio_enabled) {
+	// Called on the audio thread of libobs, which must never allocate or block here.
+	if (!this->_audio_enabled.load(std::memory_order_acquire)) {
 		return;
 	}
 
-	audio_t* aud = obs_get_audio();
-	if (!aud) {
-		return;
-	}
-	audio_output_info const* aoi = audio_output_get_info(aud);
-	if (!aoi) {
-		return;
-	}
+	// Packets still in the ring have older timestamps, so they have to be output by the worker before passthrough
+	//  can take over.
+	if (this->_audio_passthrough.load(std::memory_order_relaxed) && (this->_audio_ring->size() == 0)) {
+		// libobs copies the data into the buffers of this source itself, so the captured planes can be handed
+		//  over directly as long as there is one for every channel of the layout.
+		audio_output_info const* aoi    = audio_output_get_info(obs_get_audio());
+		speaker_layout           layout = this->_audio_layout.load(std::memory_order_relaxed);
 
-	std::shared_ptr<mirror_audio_data> mad;
-	{ // Get free audio data element.
-		std::lock_guard<std::mutex> capture_lock(this->_audio_lock_capturer);
-		if (_audio_data_free_queue.size() > 0) {
-			mad = _audio_data_free_queue.front();
-			_audio_data_free_queue.pop();
-		} else {
-			mad = std::make_shared<mirror_audio_data>();
-			mad->data.resize(MAX_AUDIO_CHANNELS);
-			for (size_t idx = 0; idx < mad->data.size(); idx++) {
-				mad->data[idx].resize(AUDIO_OUTPUT_FRAMES);
-			}
+		obs_source_audio output = {};
+		output.speakers         = (layout != SPEAKERS_UNKNOWN) ? layout : aoi->speakers;
+		size_t planes           = std::min<size_t>(get_audio_planes(aoi->format, output.speakers), MAX_AV_PLANES);
+		for (size_t plane = 0; plane < planes; plane++) {
+			output.data[plane] = audio->data[plane];
+		}
+		if ((planes == 0) || output.data[planes - 1]) {
+			output.format          = aoi->format;
+			output.frames          = audio->frames;
+			output.timestamp       = audio->timestamp;
+			output.samples_per_sec = aoi->samples_per_sec;
+			obs_source_output_audio(this->_self, &output);
+			return;
 		}
 	}
 
-	{ // Copy data
-		std::bitset<8> layout;
-		for (size_t plane = 0; plane < MAX_AV_PLANES; plane++) {
-			float* samples = reinterpret_cast<float_t*>(audio->data[plane]);
-			if (!samples) {
-				mad->audio.data[plane] = nullptr;
-				continue;
-			}
-			layout.set(plane);
-
-			memcpy(mad->data[plane].data(), audio->data[plane], audio->frames * sizeof(float_t));
-			mad->audio.data[plane] = reinterpret_cast<uint8_t*>(mad->data[plane].data());
+	// Packets longer than a slot are split over consecutive slots, each with the timestamp of its first frame.
+	audio_output_info const* aoi    = audio_output_get_info(obs_get_audio());
+	uint32_t                 offset = 0;
+	while (offset < audio->frames) {
+		util::audio_ring::packet* packet = this->_audio_ring->begin_write();
+		if (!packet) {
+			break;
 		}
-		mad->audio.format = aoi->format;
-		mad->audio.frames          = audio->frames;
-		mad->audio.timestamp       = audio->timestamp;
-		mad->audio.samples_per_sec = aoi->samples_per_sec;
-		if (this->_audio_layout != SPEAKERS_UNKNOWN) {
-			mad->audio.speakers = this->_audio_layout;
-		} else {
-			mad->audio.speakers = aoi->speakers;
+
+		uint32_t frames = std::min<uint32_t>(audio->frames - offset, uint32_t(this->_audio_ring->get_frames()));
+		size_t   planes = 0;
+		for (size_t plane = 0; plane < this->_audio_ring->get_planes(); plane++) {
+			if (!audio->data[plane]) {
+				break;
+			}
+			memcpy(this->_audio_ring->get_plane(packet, plane),
+				   reinterpret_cast<const float_t*>(audio->data[plane]) + offset, frames * sizeof(float_t));
+			planes++;
 		}
-	}
+		packet->frames    = frames;
+		packet->planes    = uint32_t(planes);
+		packet->timestamp = audio->timestamp + uint64_t(offset) * 1000000000ull / aoi->samples_per_sec;
+		this->_audio_ring->end_write();
 
-	{ // Push used audio data element.
-		std::lock_guard<std::mutex> capture_lock(this->_audio_lock_capturer);
-		_audio_data_queue.push(mad);
+		offset += frames;
 	}
 
-	{ // Signal other side.
-		std::lock_guard<std::mutex> output_lock(this->_audio_lock_outputter);
-		this->_audio_have_output = true;
-	}
-	this->_audio_notify.notify_all();
+	this->_audio_worker->notify();
 }
@@ -18,10 +18,11 @@
 */
 
 #pragma once
+#include <atomic>
 #include <condition_variable>
+#include <list>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <vector>
 #include "gfx/gfx-source-texture.hpp"
@@ -29,6 +30,8 @@
 #include "obs/gs/gs-sampler.hpp"
 #include "obs/obs-source.hpp"
 #include "plugin.hpp"
+#include "util-audio-ring.hpp"
+#include "util-profiler.hpp"
 
 // OBS
 #ifdef _MSC_VER
@@ -75,9 +78,38 @@ namespace source {
 			static void save(void*, obs_data_t*);
 		};
 
-		struct mirror_audio_data {
-			obs_source_audio                  audio;
-			std::vector<std::vector<float_t>> data;
+		class mirror_instance;
+
+		/*!
+		 * \brief Outputs the captured audio of all mirror instances from a single thread.
+		 *
+		 * The thread only exists while at least one instance holds a reference, which instances
+		 *  take when audio is first enabled on them.
+		 */
+		class audio_worker {
+			std::thread                 _thread;
+			std::mutex                  _lock;
+			std::condition_variable     _notify;
+			bool                        _kill;
+			std::atomic<bool>           _pending;
+			std::list<mirror_instance*> _instances;
+
+			void worker();
+
+			public:
+			audio_worker();
+			~audio_worker();
+
+			void add(mirror_instance* instance);
+
+			// Blocks until the instance is no longer being serviced.
+			void remove(mirror_instance* instance);
+
+			// Wake up the worker, never blocks.
+			void notify();
+
+			public: // Singleton
+			static std::shared_ptr<audio_worker> get();
 		};
 
 		class mirror_instance {
@@ -85,6 +117,9 @@ namespace source {
 			bool          _active;
 			float_t       _tick;
 
+			// Profiling
+			util::profiler _profiler;
+
 			// Video Rendering
 			std::shared_ptr<obs::source>         _scene;
 			std::shared_ptr<gfx::source_texture> _scene_texture_renderer;
@@ -101,16 +136,11 @@ namespace source {
 			obs_bounds_type _rescale_bounds;
 
 			// Audio Rendering
-			bool                                           _audio_enabled;
-			std::condition_variable                        _audio_notify;
-			std::thread                                    _audio_thread;
-			bool                                           _audio_kill_thread;
-			bool                                           _audio_have_output;
-			std::mutex                                     _audio_lock_outputter;
-			std::mutex                                     _audio_lock_capturer;
-			std::queue<std::shared_ptr<mirror_audio_data>> _audio_data_queue;
-			std::queue<std::shared_ptr<mirror_audio_data>> _audio_data_free_queue;
-			speaker_layout                                 _audio_layout;
+			std::atomic<bool>                 _audio_enabled;
+			std::shared_ptr<audio_worker>     _audio_worker;
+			std::unique_ptr<util::audio_ring> _audio_ring;
+			std::atomic<speaker_layout>       _audio_layout;
+			std::atomic<bool>                 _audio_passthrough;
 
 			// Input
 			std::shared_ptr<obs::source> _source;
@@ -133,7 +163,7 @@ namespace source {
 			void deactivate();
 			void video_tick(float);
 			void video_render(gs_effect_t*);
-			void audio_output_cb();
+			void audio_output();
 			void enum_active_sources(obs_source_enum_proc_t, void*);
 			void load(obs_data_t*);
 			void save(obs_data_t*);
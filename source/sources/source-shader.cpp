@@ -18,6 +18,7 @@
  */
 
 #include "source-shader.hpp"
+#include "obs/gs/gs-helper.hpp"
 #include "strings.hpp"
 #include "utility.hpp"
 
@@ -197,6 +198,8 @@ source::shader::shader_factory::~shader_factory() {}
 source::shader::shader_instance::shader_instance(obs_data_t* data, obs_source_t* self)
 	: _self(self), _active(true), _width(0), _height(0)
 {
+	_profiler.register_procedures(_self);
+
 	_fx = std::make_shared<gfx::effect_source::effect_source>(self);
 	_fx->set_valid_property_cb(std::bind(&source::shader::shader_instance::valid_param, this, std::placeholders::_1));
 	_fx->set_override_cb(std::bind(&source::shader::shader_instance::override_param, this, std::placeholders::_1));
@@ -262,6 +265,8 @@ void source::shader::shader_instance::enum_active_sources(obs_source_enum_proc_t
 
 void source::shader::shader_instance::video_tick(float_t sec_since_last)
 {
+	auto profile = _profiler.track(util::profiler::stage::Tick);
+
 	if (_fx->tick(sec_since_last)) {
 		obs_data_t* data = obs_source_get_settings(_self);
 		update(data);
@@ -273,6 +278,8 @@ void source::shader::shader_instance::video_tick(float_t sec_since_last)
 
 void source::shader::shader_instance::video_render(gs_effect_t* effect)
 {
+	auto profile = _profiler.track(util::profiler::stage::Render);
+
 	// Grab initial values.
 	gs_effect_t* effect_default = obs_get_base_effect(obs_base_effect::OBS_EFFECT_DEFAULT);
 
@@ -300,6 +307,6 @@ void source::shader::shader_instance::video_render(gs_effect_t* effect)
 		gs_effect_set_texture(prm, _rt_tex->get_object());
 
 	while (gs_effect_loop(ef, "Draw")) {
-		gs_draw_sprite(nullptr, 0, _width, _height);
+		gs::draw_sprite(nullptr, 0, _width, _height);
 	}
 }
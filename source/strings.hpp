@@ -34,6 +34,8 @@
 
 #define S_ADVANCED "Advanced"
 
+#define S_STATICINPUT "StaticInput"
+
 #define S_FILETYPE_IMAGE "FileType.Image"
 #define S_FILETYPE_IMAGES "FileType.Images"
 #define S_FILETYPE_VIDEO "FileType.Video"
@@ -0,0 +1,99 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+
+#include "util-audio-ring.hpp"
+
+util::audio_ring::audio_ring(size_t packets, size_t planes, size_t frames)
+	: _planes(planes), _frames(frames), _written(0), _dropped(0), _read(0)
+{
+	size_t capacity = 1;
+	while (capacity < packets)
+		capacity <<= 1;
+
+	_mask = capacity - 1;
+	_packets.resize(capacity);
+	_samples.resize(capacity * planes * frames);
+	for (auto& packet : _packets) {
+		packet.timestamp = 0;
+		packet.frames    = 0;
+		packet.planes    = 0;
+	}
+}
+
+util::audio_ring::~audio_ring() {}
+
+size_t util::audio_ring::get_capacity()
+{
+	return _packets.size();
+}
+
+size_t util::audio_ring::get_planes()
+{
+	return _planes;
+}
+
+size_t util::audio_ring::get_frames()
+{
+	return _frames;
+}
+
+size_t util::audio_ring::size()
+{
+	uint64_t read = _read.load(std::memory_order_acquire);
+	return size_t(_written.load(std::memory_order_acquire) - read);
+}
+
+uint64_t util::audio_ring::get_dropped()
+{
+	return _dropped.load(std::memory_order_relaxed);
+}
+
+util::audio_ring::packet* util::audio_ring::begin_write()
+{
+	uint64_t written = _written.load(std::memory_order_relaxed);
+	if ((written - _read.load(std::memory_order_acquire)) >= _packets.size()) {
+		_dropped.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	return &_packets[written & _mask];
+}
+
+void util::audio_ring::end_write()
+{
+	_written.store(_written.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+util::audio_ring::packet* util::audio_ring::begin_read()
+{
+	uint64_t read = _read.load(std::memory_order_relaxed);
+	if (read == _written.load(std::memory_order_acquire)) {
+		return nullptr;
+	}
+	return &_packets[read & _mask];
+}
+
+void util::audio_ring::end_read()
+{
+	_read.store(_read.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+float_t* util::audio_ring::get_plane(::util::audio_ring::packet* packet, size_t plane)
+{
+	size_t index = size_t(packet - _packets.data());
+	return _samples.data() + (index * _planes + plane) * _frames;
+}
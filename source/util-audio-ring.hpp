@@ -0,0 +1,92 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+
+#pragma once
+#include <atomic>
+#include <cinttypes>
+#include <cmath>
+#include <vector>
+
+namespace util {
+	/*!
+	 * \brief Fixed size single producer, single consumer ring of planar float audio packets.
+	 *
+	 * All memory is allocated up front, so neither side ever allocates or waits on the other:
+	 *  the producer drops packets while the ring is full, the consumer simply finds it empty.
+	 *  Exactly one thread may write and exactly one other thread may read at any time.
+	 */
+	class audio_ring {
+		public:
+		struct packet {
+			uint64_t timestamp;
+			uint32_t frames;
+			uint32_t planes;
+		};
+
+		private:
+		std::vector<::util::audio_ring::packet> _packets;
+		std::vector<float_t>                    _samples;
+		size_t                                  _mask;
+		size_t                                  _planes;
+		size_t                                  _frames;
+
+		// Written by the producer only, on their own cache line to avoid false sharing with the consumer.
+		alignas(64) std::atomic<uint64_t> _written;
+		std::atomic<uint64_t>             _dropped;
+
+		// Written by the consumer only.
+		alignas(64) std::atomic<uint64_t> _read;
+
+		public:
+		/*!
+		 * \param packets Number of packets the ring can hold, rounded up to the next power of two.
+		 * \param planes Maximum number of planes (channels) per packet.
+		 * \param frames Maximum number of frames per packet.
+		 */
+		audio_ring(size_t packets, size_t planes, size_t frames);
+		~audio_ring();
+
+		size_t get_capacity();
+		size_t get_planes();
+		size_t get_frames();
+
+		// Number of packets waiting to be read.
+		size_t size();
+
+		// Number of packets that were dropped because the ring was full.
+		uint64_t get_dropped();
+
+		public: // Producer
+		/*!
+		 * \brief Get the next free packet, or nullptr (counted as a drop) if the ring is full.
+		 *
+		 * The packet is only visible to the consumer after end_write().
+		 */
+		::util::audio_ring::packet* begin_write();
+		void                        end_write();
+
+		public: // Consumer
+		// Get the oldest packet, or nullptr if the ring is empty. It stays valid until end_read().
+		::util::audio_ring::packet* begin_read();
+		void                        end_read();
+
+		public:
+		// Samples of a plane of a packet returned by begin_write() or begin_read().
+		float_t* get_plane(::util::audio_ring::packet* packet, size_t plane);
+	};
+} // namespace util
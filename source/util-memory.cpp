@@ -26,7 +26,8 @@
 #define D_ALIGNED_ALLOC(a, s) _aligned_malloc(s, a)
 #define D_ALIGNED_FREE _aligned_free
 #else
-#define D_ALIGNED_ALLOC(a, s) aligned_alloc(s, a)
+// aligned_alloc wants the size to be a multiple of the alignment.
+#define D_ALIGNED_ALLOC(a, s) aligned_alloc(a, (((s) + (a)-1) / (a)) * (a))
 #define D_ALIGNED_FREE free
 #endif
 
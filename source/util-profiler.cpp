@@ -0,0 +1,300 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "util-profiler.hpp"
+#include <algorithm>
+#include "plugin.hpp"
+
+#define READ_RETRIES 4
+#define PERCENTILE 0.95
+
+struct statistics {
+	size_t   samples;
+	double_t total_avg_ms, total_p95_ms, total_max_ms;
+	double_t self_avg_ms, self_p95_ms, self_max_ms;
+	double_t passes_avg, draws_avg, states_avg, uploaded_avg;
+	uint32_t passes_max, draws_max, states_max;
+	uint64_t uploaded_max;
+};
+
+static thread_local ::util::profiler::scope* current_scope = nullptr;
+
+static const char* get_stage_name(::util::profiler::stage stage)
+{
+	switch (stage) {
+	case ::util::profiler::stage::Tick:
+		return "tick";
+	case ::util::profiler::stage::Render:
+		return "render";
+	}
+	return "unknown";
+}
+
+static double_t get_percentile_ms(std::vector<uint64_t>& values, double_t percentile)
+{
+	size_t index = std::min(size_t(double_t(values.size()) * percentile), values.size() - 1);
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return double_t(values[index]) / 1000000.;
+}
+
+static statistics summarize(std::vector<::util::profiler::sample> const& samples)
+{
+	statistics stats = {};
+	stats.samples    = samples.size();
+	if (samples.size() == 0)
+		return stats;
+
+	std::vector<uint64_t> total(samples.size()), self(samples.size());
+	uint64_t              total_sum = 0, self_sum = 0, passes_sum = 0, draws_sum = 0, states_sum = 0, uploaded_sum = 0;
+	for (size_t idx = 0; idx < samples.size(); idx++) {
+		auto const& sample = samples[idx];
+		total[idx]         = sample.total_ns;
+		self[idx]          = sample.self_ns;
+		total_sum += sample.total_ns;
+		self_sum += sample.self_ns;
+		passes_sum += sample.passes;
+		draws_sum += sample.draws;
+		states_sum += sample.states;
+		uploaded_sum += sample.uploaded;
+		stats.total_max_ms = std::max(stats.total_max_ms, double_t(sample.total_ns) / 1000000.);
+		stats.self_max_ms  = std::max(stats.self_max_ms, double_t(sample.self_ns) / 1000000.);
+		stats.passes_max   = std::max(stats.passes_max, sample.passes);
+		stats.draws_max    = std::max(stats.draws_max, sample.draws);
+		stats.states_max   = std::max(stats.states_max, sample.states);
+		stats.uploaded_max = std::max(stats.uploaded_max, sample.uploaded);
+	}
+
+	double_t count     = double_t(samples.size());
+	stats.total_avg_ms = double_t(total_sum) / count / 1000000.;
+	stats.self_avg_ms  = double_t(self_sum) / count / 1000000.;
+	stats.passes_avg   = double_t(passes_sum) / count;
+	stats.draws_avg    = double_t(draws_sum) / count;
+	stats.states_avg   = double_t(states_sum) / count;
+	stats.uploaded_avg = double_t(uploaded_sum) / count;
+	stats.total_p95_ms = get_percentile_ms(total, PERCENTILE);
+	stats.self_p95_ms  = get_percentile_ms(self, PERCENTILE);
+	return stats;
+}
+
+util::profiler::scope::scope(profiler* parent, ::util::profiler::stage stage)
+	: _parent(parent), _stage(stage), _start(std::chrono::high_resolution_clock::now()), _children_ns(0),
+	  _passes(0), _draws(0), _states(0), _uploaded(0), _previous(current_scope)
+{
+	current_scope = this;
+}
+
+util::profiler::scope::~scope()
+{
+	uint64_t total_ns = uint64_t(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - _start)
+			.count());
+
+	current_scope = _previous;
+	if (_previous)
+		_previous->_children_ns += total_ns;
+
+	::util::profiler::sample sample;
+	sample.total_ns = total_ns;
+	sample.self_ns  = total_ns - std::min(total_ns, _children_ns);
+	sample.passes   = _passes;
+	sample.draws    = _draws;
+	sample.states   = _states;
+	sample.uploaded = _uploaded;
+	_parent->record(_stage, sample);
+}
+
+void util::profiler::record(::util::profiler::stage stage, ::util::profiler::sample const& sample)
+{
+	ring&    rb      = _rings[size_t(stage)];
+	uint64_t written = rb.written.load(std::memory_order_relaxed);
+	slot&    sl      = rb.slots[written % UTIL_PROFILER_SAMPLES];
+
+	// Odd sequence numbers mark a slot that is being written to.
+	uint32_t sequence = sl.sequence.load(std::memory_order_relaxed);
+	sl.sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	sl.total_ns.store(sample.total_ns, std::memory_order_relaxed);
+	sl.self_ns.store(sample.self_ns, std::memory_order_relaxed);
+	sl.passes.store(sample.passes, std::memory_order_relaxed);
+	sl.draws.store(sample.draws, std::memory_order_relaxed);
+	sl.states.store(sample.states, std::memory_order_relaxed);
+	sl.uploaded.store(sample.uploaded, std::memory_order_relaxed);
+	sl.sequence.store(sequence + 2, std::memory_order_release);
+
+	rb.written.store(written + 1, std::memory_order_release);
+}
+
+util::profiler::profiler() : _source(nullptr), _frames_rendered(0), _frames_reused(0)
+{
+	for (ring& rb : _rings) {
+		for (slot& sl : rb.slots) {
+			sl.sequence.store(0);
+			sl.total_ns.store(0);
+			sl.self_ns.store(0);
+			sl.passes.store(0);
+			sl.draws.store(0);
+			sl.states.store(0);
+			sl.uploaded.store(0);
+		}
+		rb.written.store(0);
+	}
+}
+
+util::profiler::~profiler() {}
+
+util::profiler::scope util::profiler::track(::util::profiler::stage stage)
+{
+	return scope(this, stage);
+}
+
+size_t util::profiler::get_samples(::util::profiler::stage stage, std::vector<::util::profiler::sample>& samples)
+{
+	ring&    rb      = _rings[size_t(stage)];
+	uint64_t written = rb.written.load(std::memory_order_acquire);
+	uint64_t count   = std::min<uint64_t>(written, UTIL_PROFILER_SAMPLES);
+
+	samples.clear();
+	samples.reserve(size_t(count));
+	for (uint64_t idx = written - count; idx < written; idx++) {
+		slot& sl = rb.slots[idx % UTIL_PROFILER_SAMPLES];
+		for (size_t attempt = 0; attempt < READ_RETRIES; attempt++) {
+			uint32_t before = sl.sequence.load(std::memory_order_acquire);
+			if (before & 1)
+				continue;
+
+			::util::profiler::sample sample;
+			sample.total_ns = sl.total_ns.load(std::memory_order_relaxed);
+			sample.self_ns  = sl.self_ns.load(std::memory_order_relaxed);
+			sample.passes   = sl.passes.load(std::memory_order_relaxed);
+			sample.draws    = sl.draws.load(std::memory_order_relaxed);
+			sample.states   = sl.states.load(std::memory_order_relaxed);
+			sample.uploaded = sl.uploaded.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (sl.sequence.load(std::memory_order_relaxed) != before)
+				continue;
+
+			samples.push_back(sample);
+			break;
+		}
+	}
+	return samples.size();
+}
+
+obs_data_t* util::profiler::get_statistics()
+{
+	obs_data_t*                           data = obs_data_create();
+	std::vector<::util::profiler::sample> samples;
+	for (auto stage : {::util::profiler::stage::Tick, ::util::profiler::stage::Render}) {
+		get_samples(stage, samples);
+		statistics stats = summarize(samples);
+
+		obs_data_t* stage_data = obs_data_create();
+		obs_data_set_int(stage_data, "samples", static_cast<long long>(stats.samples));
+		obs_data_set_double(stage_data, "total_avg_ms", stats.total_avg_ms);
+		obs_data_set_double(stage_data, "total_p95_ms", stats.total_p95_ms);
+		obs_data_set_double(stage_data, "total_max_ms", stats.total_max_ms);
+		obs_data_set_double(stage_data, "self_avg_ms", stats.self_avg_ms);
+		obs_data_set_double(stage_data, "self_p95_ms", stats.self_p95_ms);
+		obs_data_set_double(stage_data, "self_max_ms", stats.self_max_ms);
+		obs_data_set_double(stage_data, "passes_avg", stats.passes_avg);
+		obs_data_set_int(stage_data, "passes_max", stats.passes_max);
+		obs_data_set_double(stage_data, "draws_avg", stats.draws_avg);
+		obs_data_set_int(stage_data, "draws_max", stats.draws_max);
+		obs_data_set_double(stage_data, "states_avg", stats.states_avg);
+		obs_data_set_int(stage_data, "states_max", stats.states_max);
+		obs_data_set_double(stage_data, "uploaded_avg", stats.uploaded_avg);
+		obs_data_set_int(stage_data, "uploaded_max", static_cast<long long>(stats.uploaded_max));
+		obs_data_set_obj(data, get_stage_name(stage), stage_data);
+		obs_data_release(stage_data);
+	}
+
+	obs_data_t* frames_data = obs_data_create();
+	obs_data_set_int(frames_data, "rendered", static_cast<long long>(_frames_rendered.load()));
+	obs_data_set_int(frames_data, "reused", static_cast<long long>(_frames_reused.load()));
+	obs_data_set_obj(data, "frames", frames_data);
+	obs_data_release(frames_data);
+	return data;
+}
+
+void util::profiler::log_statistics(const char* name)
+{
+	std::vector<::util::profiler::sample> samples;
+	for (auto stage : {::util::profiler::stage::Tick, ::util::profiler::stage::Render}) {
+		get_samples(stage, samples);
+		statistics stats = summarize(samples);
+		P_LOG_INFO("<%s> %s: %zu samples, total %.3f/%.3f/%.3f ms, self %.3f/%.3f/%.3f ms (avg/p95/max), "
+				   "%.1f/%" PRIu32 " passes, %.1f/%" PRIu32 " draws, %.1f/%" PRIu32 " state calls, "
+				   "%.0f/%" PRIu64 " bytes uploaded (avg/max).",
+				   name, get_stage_name(stage), stats.samples, stats.total_avg_ms, stats.total_p95_ms,
+				   stats.total_max_ms, stats.self_avg_ms, stats.self_p95_ms, stats.self_max_ms, stats.passes_avg,
+				   stats.passes_max, stats.draws_avg, stats.draws_max, stats.states_avg, stats.states_max,
+				   stats.uploaded_avg, stats.uploaded_max);
+	}
+	P_LOG_INFO("<%s> frames: %" PRIu64 " rendered, %" PRIu64 " reused.", name, _frames_rendered.load(),
+			   _frames_reused.load());
+}
+
+void util::profiler::register_procedures(obs_source_t* source)
+{
+	_source              = source;
+	proc_handler_t* proc = obs_source_get_proc_handler(source);
+	proc_handler_add(proc, "void get_profiler_statistics(out ptr statistics)",
+					 [](void* ptr, calldata_t* data) {
+						 calldata_set_ptr(data, "statistics",
+										  reinterpret_cast<::util::profiler*>(ptr)->get_statistics());
+					 },
+					 this);
+	proc_handler_add(proc, "void log_profiler_statistics()",
+					 [](void* ptr, calldata_t*) {
+						 auto self = reinterpret_cast<::util::profiler*>(ptr);
+						 self->log_statistics(obs_source_get_name(self->_source));
+					 },
+					 this);
+}
+
+void util::profiler::count_frame(bool reused)
+{
+	if (reused) {
+		_frames_reused.fetch_add(1, std::memory_order_relaxed);
+	} else {
+		_frames_rendered.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void util::profiler::count_pass()
+{
+	if (current_scope)
+		current_scope->_passes++;
+}
+
+void util::profiler::count_draw()
+{
+	if (current_scope)
+		current_scope->_draws++;
+}
+
+void util::profiler::count_state(uint32_t calls)
+{
+	if (current_scope)
+		current_scope->_states += calls;
+}
+
+void util::profiler::count_upload(uint64_t bytes)
+{
+	if (current_scope)
+		current_scope->_uploaded += bytes;
+}
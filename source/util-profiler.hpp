@@ -0,0 +1,165 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <vector>
+
+// OBS
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)
+#endif
+#include <obs.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#define UTIL_PROFILER_SAMPLES 256
+
+namespace util {
+	/*!
+	 * \brief Per-instance frame timing for filters and sources.
+	 *
+	 * Records CPU time, render target passes, draw calls, render state calls and vertex bytes uploaded
+	 *  of the last few hundred calls to video_tick and video_render. Each stage has a single writer (the graphics
+	 *  thread) and any number of readers, which never block the writer: every slot of the ring is
+	 *  guarded by a sequence counter and readers simply retry or skip slots that changed under them.
+	 */
+	class profiler {
+		public:
+		enum class stage : uint8_t {
+			Tick,
+			Render,
+		};
+
+		struct sample {
+			// Wall time spent in the scope, including nested scopes of other instances.
+			uint64_t total_ns;
+			// Wall time spent in the scope, excluding nested scopes (i.e. other filters rendering their input).
+			uint64_t self_ns;
+			uint32_t passes;
+			uint32_t draws;
+			uint32_t states;
+			uint64_t uploaded;
+		};
+
+		class scope {
+			profiler*                                      _parent;
+			::util::profiler::stage                        _stage;
+			std::chrono::high_resolution_clock::time_point _start;
+			uint64_t                                       _children_ns;
+			uint32_t                                       _passes;
+			uint32_t                                       _draws;
+			uint32_t                                       _states;
+			uint64_t                                       _uploaded;
+			scope*                                         _previous;
+
+			public:
+			scope(profiler* parent, ::util::profiler::stage stage);
+			~scope();
+
+			scope(scope const&) = delete;
+			scope(scope&&)      = delete;
+			scope& operator=(scope const&) = delete;
+			scope& operator=(scope&&) = delete;
+
+			friend class ::util::profiler;
+		};
+
+		private:
+		struct slot {
+			std::atomic<uint32_t> sequence;
+			std::atomic<uint64_t> total_ns;
+			std::atomic<uint64_t> self_ns;
+			std::atomic<uint32_t> passes;
+			std::atomic<uint32_t> draws;
+			std::atomic<uint32_t> states;
+			std::atomic<uint64_t> uploaded;
+		};
+
+		struct ring {
+			std::array<slot, UTIL_PROFILER_SAMPLES> slots;
+			std::atomic<uint64_t>                   written;
+		};
+
+		std::array<ring, 2>   _rings;
+		obs_source_t*         _source;
+		std::atomic<uint64_t> _frames_rendered;
+		std::atomic<uint64_t> _frames_reused;
+
+		void record(::util::profiler::stage stage, ::util::profiler::sample const& sample);
+
+		public:
+		profiler();
+		~profiler();
+
+		/*!
+		 * \brief Measure everything until the returned scope is destroyed.
+		 *
+		 * Scopes nest per thread, passes, draw calls, state calls and uploads are attributed to the innermost one.
+		 */
+		scope track(::util::profiler::stage stage);
+
+		/*!
+		 * \brief Copy the recorded samples of a stage, oldest first.
+		 *
+		 * \return Number of samples copied.
+		 */
+		size_t get_samples(::util::profiler::stage stage, std::vector<::util::profiler::sample>& samples);
+
+		/*!
+		 * \brief Summarize the recorded samples into a new obs_data_t, which the caller must release.
+		 *
+		 * Contains an object per stage ("tick", "render") with the sample count, the average,
+		 *  95th percentile and maximum total and self time in milliseconds, and the average and
+		 *  maximum passes, draw calls, state calls and bytes uploaded per frame. The object "frames" holds
+		 *  the counters of count_frame() ("rendered", "reused").
+		 */
+		obs_data_t* get_statistics();
+
+		// Write a summary of the recorded samples to the log.
+		void log_statistics(const char* name);
+
+		/*!
+		 * \brief Register the "get_profiler_statistics" and "log_profiler_statistics" procedures on a source.
+		 *
+		 * "void get_profiler_statistics(out ptr statistics)" returns the result of get_statistics().
+		 * Procedures can't be removed again, so the profiler must live as long as the source does, which is
+		 *  the case for a profiler owned by the instance data of that source.
+		 */
+		void register_procedures(obs_source_t* source);
+
+		// Count a frame whose output was either rendered or reused from an earlier frame.
+		void count_frame(bool reused);
+
+		// Count a render target pass for the innermost active scope on this thread.
+		static void count_pass();
+
+		// Count a draw call for the innermost active scope on this thread.
+		static void count_draw();
+
+		// Count render state calls (gs_set_cull_mode, gs_enable_blending, ...) for the innermost active scope.
+		static void count_state(uint32_t calls = 1);
+
+		// Count bytes of vertex data uploaded to the GPU for the innermost active scope.
+		static void count_upload(uint64_t bytes);
+	};
+} // namespace util
@@ -0,0 +1,96 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "util-worker.hpp"
+
+util::worker::task::task(std::function<void(::util::worker::task&)> function)
+	: _function(std::move(function)), _cancelled(false)
+{}
+
+util::worker::task::~task() {}
+
+void util::worker::task::cancel()
+{
+	_cancelled.store(true, std::memory_order_release);
+}
+
+bool util::worker::task::is_cancelled()
+{
+	return _cancelled.load(std::memory_order_acquire);
+}
+
+const std::atomic<bool>& util::worker::task::get_cancelled()
+{
+	return _cancelled;
+}
+
+util::worker::worker() : _kill(false) {}
+
+util::worker::~worker()
+{
+	{
+		std::unique_lock<std::mutex> ulock(_lock);
+		_kill = true;
+		for (auto& queued : _tasks) {
+			queued->cancel();
+		}
+		if (_current) {
+			_current->cancel();
+		}
+	}
+	_notify.notify_all();
+	if (_thread.joinable()) {
+		_thread.join();
+	}
+}
+
+void util::worker::run()
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	while (!_kill) {
+		_notify.wait(ulock, [this]() { return _kill || !_tasks.empty(); });
+		if (_kill) {
+			break;
+		}
+
+		_current = std::move(_tasks.front());
+		_tasks.pop_front();
+		if (!_current->is_cancelled()) {
+			ulock.unlock();
+			_current->_function(*_current);
+			ulock.lock();
+		}
+
+		// The function may hold the last references to what it captured, which are released here.
+		_current->_function = nullptr;
+		_current.reset();
+	}
+}
+
+std::shared_ptr<::util::worker::task> util::worker::push(std::function<void(::util::worker::task&)> function)
+{
+	auto task = std::make_shared<::util::worker::task>(std::move(function));
+	{
+		std::unique_lock<std::mutex> ulock(_lock);
+		_tasks.push_back(task);
+		if (!_thread.joinable()) {
+			_thread = std::thread(std::bind(&::util::worker::run, this));
+		}
+	}
+	_notify.notify_one();
+	return task;
+}
@@ -0,0 +1,81 @@
+// Modern effects for a modern Streamer
+// Copyright (C) 2019 Michael Fabian Dirks
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace util {
+	/*!
+	 * \brief Runs tasks one after another on a thread of its own.
+	 *
+	 * The thread is started with the first task. Destroying the worker cancels every task that
+	 *  is still queued or running and waits for the running one to return, so no task outlives
+	 *  the worker.
+	 */
+	class worker {
+		public:
+		class task {
+			std::function<void(::util::worker::task&)> _function;
+			std::atomic<bool>                          _cancelled;
+
+			friend class ::util::worker;
+
+			public:
+			task(std::function<void(::util::worker::task&)> function);
+			~task();
+
+			/*!
+			 * \brief Ask the task to stop. A task that has not started yet is skipped entirely.
+			 */
+			void cancel();
+
+			bool is_cancelled();
+
+			/*!
+			 * \brief The flag behind is_cancelled(), for work that checks it on its own.
+			 */
+			const std::atomic<bool>& get_cancelled();
+		};
+
+		private:
+		std::thread                                      _thread;
+		std::mutex                                       _lock;
+		std::condition_variable                          _notify;
+		bool                                             _kill;
+		std::list<std::shared_ptr<::util::worker::task>> _tasks;
+		std::shared_ptr<::util::worker::task>            _current;
+
+		void run();
+
+		public:
+		worker();
+		~worker();
+
+		/*!
+		 * \brief Queue a function, which is called with its own task once all earlier ones are done.
+		 *
+		 * \return The task, which can be used to cancel it.
+		 */
+		std::shared_ptr<::util::worker::task> push(std::function<void(::util::worker::task&)> function);
+	};
+} // namespace util
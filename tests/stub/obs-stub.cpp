@@ -0,0 +1,2909 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "obs-stub.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <sys/stat.h>
+
+// OBS
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)
+#endif
+#include <callback/calldata.h>
+#include <callback/proc.h>
+#include <callback/signal.h>
+#include <media-io/audio-io.h>
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+// Pixels a draw call has to cover before it is split across threads.
+#define PARALLEL_PIXELS (256 * 256)
+
+#define FRAME_INTERVAL_NS 16666667ull
+
+#define RECORD() record(__func__)
+
+////////////////////////////////////////////////////////////////////////////////
+// Bookkeeping
+////////////////////////////////////////////////////////////////////////////////
+
+static std::mutex                                calls_lock;
+static std::unordered_map<std::string, uint64_t> calls;
+
+// libobs serializes graphics with a recursive mutex, so lock order mistakes against it deadlock here too.
+static std::recursive_mutex graphics_lock;
+
+static std::atomic<int64_t>  live_handles     = 0;
+static std::atomic<int64_t>  live_allocations = 0;
+static std::atomic<int64_t>  graphics_depth   = 0;
+static std::atomic<uint64_t> vertex_bytes     = 0;
+static std::atomic<uint64_t> video_frame_time = FRAME_INTERVAL_NS;
+static std::string           data_path        = ".";
+
+static void record(const char* function)
+{
+	std::unique_lock<std::mutex> ul(calls_lock);
+	calls[function]++;
+}
+
+struct shader_entry {
+	std::string    effect;
+	std::string    technique;
+	::stub::shader shader;
+};
+static std::vector<shader_entry> shaders;
+
+////////////////////////////////////////////////////////////////////////////////
+// Color Formats
+////////////////////////////////////////////////////////////////////////////////
+
+static float_t half_to_float(uint16_t h)
+{
+	uint32_t sign     = uint32_t(h & 0x8000) << 16;
+	uint32_t exponent = (h >> 10) & 0x1F;
+	uint32_t mantissa = h & 0x3FF;
+	uint32_t bits;
+	if (exponent == 0) {
+		if (mantissa == 0) {
+			bits = sign;
+		} else {
+			// Denormal, normalize it.
+			exponent = 127 - 15 + 1;
+			while ((mantissa & 0x400) == 0) {
+				mantissa <<= 1;
+				exponent--;
+			}
+			bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+		}
+	} else if (exponent == 0x1F) {
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	} else {
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	}
+	float_t v;
+	memcpy(&v, &bits, sizeof(v));
+	return v;
+}
+
+static uint16_t float_to_half(float_t v)
+{
+	uint32_t bits;
+	memcpy(&bits, &v, sizeof(bits));
+	uint16_t sign     = uint16_t((bits >> 16) & 0x8000);
+	int32_t  exponent = int32_t((bits >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFF;
+	if (((bits >> 23) & 0xFF) == 0xFF)
+		return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+	if (exponent >= 0x1F)
+		return sign | 0x7C00;
+	if (exponent <= 0) {
+		if (exponent < -10)
+			return sign;
+		mantissa |= 0x800000;
+		uint32_t shift = uint32_t(14 - exponent);
+		uint32_t half  = mantissa >> shift;
+		if ((mantissa >> (shift - 1)) & 1)
+			half++;
+		return sign | uint16_t(half);
+	}
+	uint16_t half = sign | uint16_t(exponent << 10) | uint16_t(mantissa >> 13);
+	if (mantissa & 0x1000)
+		half++;
+	return half;
+}
+
+static inline uint32_t to_unorm(float_t v, uint32_t max)
+{
+	return uint32_t(std::clamp(v, 0.f, 1.f) * float_t(max) + 0.5f);
+}
+
+static size_t get_format_size(gs_color_format format)
+{
+	switch (format) {
+	case GS_A8:
+	case GS_R8:
+		return 1;
+	case GS_R16:
+	case GS_R16F:
+	case GS_R8G8:
+		return 2;
+	case GS_RGBA:
+	case GS_BGRX:
+	case GS_BGRA:
+	case GS_R10G10B10A2:
+	case GS_RG16F:
+	case GS_R32F:
+		return 4;
+	case GS_RGBA16:
+	case GS_RGBA16F:
+	case GS_RG32F:
+		return 8;
+	case GS_RGBA32F:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+static void decode(gs_color_format format, const uint8_t* in, float_t out[4])
+{
+	const uint16_t* in16 = reinterpret_cast<const uint16_t*>(in);
+	const float_t*  in32 = reinterpret_cast<const float_t*>(in);
+	out[0] = out[1] = out[2] = 0.f;
+	out[3]                   = 1.f;
+	switch (format) {
+	case GS_A8:
+		out[3] = in[0] / 255.f;
+		break;
+	case GS_R8:
+		out[0] = in[0] / 255.f;
+		break;
+	case GS_R8G8:
+		out[0] = in[0] / 255.f;
+		out[1] = in[1] / 255.f;
+		break;
+	case GS_RGBA:
+		for (size_t c = 0; c < 4; c++)
+			out[c] = in[c] / 255.f;
+		break;
+	case GS_BGRX:
+	case GS_BGRA:
+		out[0] = in[2] / 255.f;
+		out[1] = in[1] / 255.f;
+		out[2] = in[0] / 255.f;
+		out[3] = (format == GS_BGRA) ? in[3] / 255.f : 1.f;
+		break;
+	case GS_R10G10B10A2: {
+		uint32_t v;
+		memcpy(&v, in, sizeof(v));
+		out[0] = (v & 0x3FF) / 1023.f;
+		out[1] = ((v >> 10) & 0x3FF) / 1023.f;
+		out[2] = ((v >> 20) & 0x3FF) / 1023.f;
+		out[3] = ((v >> 30) & 0x3) / 3.f;
+		break;
+	}
+	case GS_R16:
+		out[0] = in16[0] / 65535.f;
+		break;
+	case GS_RGBA16:
+		for (size_t c = 0; c < 4; c++)
+			out[c] = in16[c] / 65535.f;
+		break;
+	case GS_R16F:
+		out[0] = half_to_float(in16[0]);
+		break;
+	case GS_RG16F:
+		out[0] = half_to_float(in16[0]);
+		out[1] = half_to_float(in16[1]);
+		break;
+	case GS_RGBA16F:
+		for (size_t c = 0; c < 4; c++)
+			out[c] = half_to_float(in16[c]);
+		break;
+	case GS_R32F:
+		out[0] = in32[0];
+		break;
+	case GS_RG32F:
+		out[0] = in32[0];
+		out[1] = in32[1];
+		break;
+	case GS_RGBA32F:
+		for (size_t c = 0; c < 4; c++)
+			out[c] = in32[c];
+		break;
+	default:
+		break;
+	}
+}
+
+static void encode(gs_color_format format, const float_t in[4], uint8_t* out)
+{
+	uint16_t* out16 = reinterpret_cast<uint16_t*>(out);
+	float_t*  out32 = reinterpret_cast<float_t*>(out);
+	switch (format) {
+	case GS_A8:
+		out[0] = uint8_t(to_unorm(in[3], 255));
+		break;
+	case GS_R8:
+		out[0] = uint8_t(to_unorm(in[0], 255));
+		break;
+	case GS_R8G8:
+		out[0] = uint8_t(to_unorm(in[0], 255));
+		out[1] = uint8_t(to_unorm(in[1], 255));
+		break;
+	case GS_RGBA:
+		for (size_t c = 0; c < 4; c++)
+			out[c] = uint8_t(to_unorm(in[c], 255));
+		break;
+	case GS_BGRX:
+	case GS_BGRA:
+		out[0] = uint8_t(to_unorm(in[2], 255));
+		out[1] = uint8_t(to_unorm(in[1], 255));
+		out[2] = uint8_t(to_unorm(in[0], 255));
+		out[3] = (format == GS_BGRA) ? uint8_t(to_unorm(in[3], 255)) : 255;
+		break;
+	case GS_R10G10B10A2: {
+		uint32_t v = to_unorm(in[0], 1023) | (to_unorm(in[1], 1023) << 10) | (to_unorm(in[2], 1023) << 20)
+					 | (to_unorm(in[3], 3) << 30);
+		memcpy(out, &v, sizeof(v));
+		break;
+	}
+	case GS_R16:
+		out16[0] = uint16_t(to_unorm(in[0], 65535));
+		break;
+	case GS_RGBA16:
+		for (size_t c = 0; c < 4; c++)
+			out16[c] = uint16_t(to_unorm(in[c], 65535));
+		break;
+	case GS_R16F:
+		out16[0] = float_to_half(in[0]);
+		break;
+	case GS_RG16F:
+		out16[0] = float_to_half(in[0]);
+		out16[1] = float_to_half(in[1]);
+		break;
+	case GS_RGBA16F:
+		for (size_t c = 0; c < 4; c++)
+			out16[c] = float_to_half(in[c]);
+		break;
+	case GS_R32F:
+		out32[0] = in[0];
+		break;
+	case GS_RG32F:
+		out32[0] = in[0];
+		out32[1] = in[1];
+		break;
+	case GS_RGBA32F:
+		for (size_t c = 0; c < 4; c++)
+			out32[c] = in[c];
+		break;
+	default:
+		break;
+	}
+}
+
+// Round a color to what a texture of the format can hold.
+static void quantize(gs_color_format format, float_t color[4])
+{
+	uint8_t buffer[16];
+	encode(format, color, buffer);
+	decode(format, buffer, color);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Objects
+////////////////////////////////////////////////////////////////////////////////
+
+struct graphics_subsystem {
+	void*        module;
+	gs_device_t* device;
+};
+
+struct gs_texture {
+	gs_texture_type      type;
+	uint32_t             width;
+	uint32_t             height;
+	uint32_t             depth;
+	gs_color_format      format;
+	uint32_t             levels;
+	uint32_t             flags;
+	std::vector<float_t> pixels;
+	std::vector<uint8_t> mapped;
+};
+
+struct gs_stage_surface {
+	uint32_t             width;
+	uint32_t             height;
+	gs_color_format      format;
+	std::vector<uint8_t> data;
+	bool                 mapped;
+};
+
+struct gs_texture_render {
+	gs_color_format    format;
+	gs_zstencil_format zsformat;
+	gs_texture*        target;
+	bool               rendered;
+};
+
+struct gs_sampler_state {
+	gs_sampler_info info;
+};
+
+struct gs_vertex_buffer {
+	gs_vb_data*          data;
+	bool                 dynamic;
+	bool                 has_normals;
+	bool                 has_tangents;
+	bool                 has_colors;
+	std::vector<size_t>  uv_widths;
+	size_t               num;
+	std::vector<float_t> points;
+	std::vector<float_t> uvs;
+};
+
+struct gs_index_buffer {
+	gs_index_type type;
+	void*         indices;
+	size_t        num;
+	uint32_t      flags;
+};
+
+struct gs_effect_param {
+	std::string                                   name;
+	gs_shader_param_type                          type;
+	size_t                                        array_count;
+	std::vector<uint8_t>                          value;
+	std::vector<uint8_t>                          default_value;
+	gs_texture_t*                                 texture;
+	gs_samplerstate_t*                            sampler;
+	std::vector<std::unique_ptr<gs_effect_param>> annotations;
+};
+
+struct gs_effect_technique {
+	std::string name;
+	size_t      passes;
+};
+
+struct gs_effect {
+	std::string                                   file;
+	std::vector<std::unique_ptr<gs_effect_param>> params;
+	std::vector<gs_effect_technique>              techniques;
+	gs_effect_technique*                          looping;
+	size_t                                        pass;
+	bool                                          builtin;
+};
+
+struct affine {
+	float_t sx, sy, tx, ty;
+};
+
+struct render_context {
+	gs_texture*         target;
+	float_t             ortho[4];
+	std::vector<affine> matrices;
+	gs_rect             viewport;
+};
+
+struct blend_state {
+	bool          enabled;
+	gs_blend_type src_c, dst_c, src_a, dst_a;
+};
+
+static const blend_state default_blending = {true, GS_BLEND_SRCALPHA, GS_BLEND_INVSRCALPHA, GS_BLEND_SRCALPHA,
+										   GS_BLEND_INVSRCALPHA};
+
+static graphics_subsystem                   context_instance     = {nullptr, nullptr};
+static render_context                       context              = {nullptr, {-1, 1, 1, -1}, {{1, 1, 0, 0}}, {0, 0, 0, 0}};
+static std::vector<render_context>          context_stack;
+static std::vector<std::array<float_t, 4>> projection_stack;
+static std::vector<gs_rect>                 viewport_stack;
+static blend_state                          blending             = default_blending;
+static std::vector<blend_state>             blend_stack;
+static bool                                 color_mask[4]        = {true, true, true, true};
+static gs_effect*                           active_effect        = nullptr;
+static gs_vertex_buffer*                    loaded_vertex_buffer = nullptr;
+
+static gs_texture* create_texture(gs_texture_type type, uint32_t width, uint32_t height, uint32_t depth,
+								  gs_color_format format, uint32_t levels, uint32_t flags)
+{
+	gs_texture* tex = new gs_texture();
+	tex->type       = type;
+	tex->width      = width;
+	tex->height     = height;
+	tex->depth      = depth;
+	tex->format     = format;
+	tex->levels     = levels;
+	tex->flags      = flags;
+	tex->pixels.resize(size_t(width) * height * depth * 4, 0.f);
+	return tex;
+}
+
+static void upload_layer(gs_texture* tex, size_t layer, const uint8_t* data, size_t linesize, bool invert)
+{
+	size_t   bpp    = get_format_size(tex->format);
+	float_t* pixels = tex->pixels.data() + layer * size_t(tex->width) * tex->height * 4;
+	if (bpp == 0)
+		return;
+	for (size_t y = 0; y < tex->height; y++) {
+		const uint8_t* row = data + (invert ? (tex->height - 1 - y) : y) * linesize;
+		for (size_t x = 0; x < tex->width; x++) {
+			decode(tex->format, row + x * bpp, pixels + (y * tex->width + x) * 4);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Stub API
+////////////////////////////////////////////////////////////////////////////////
+
+stub::texture_view::texture_view() : _data(nullptr), _width(0), _height(0) {}
+
+stub::texture_view::texture_view(gs_texture_t* texture)
+	: _data(texture ? texture->pixels.data() : nullptr), _width(texture ? texture->width : 0),
+	  _height(texture ? texture->height : 0)
+{}
+
+bool stub::texture_view::valid() const
+{
+	return _data != nullptr;
+}
+
+uint32_t stub::texture_view::get_width() const
+{
+	return _width;
+}
+
+uint32_t stub::texture_view::get_height() const
+{
+	return _height;
+}
+
+void stub::texture_view::load(int64_t x, int64_t y, float_t out[4]) const
+{
+	if (!_data) {
+		out[0] = out[1] = out[2] = out[3] = 0.f;
+		return;
+	}
+	x                = std::clamp<int64_t>(x, 0, int64_t(_width) - 1);
+	y                = std::clamp<int64_t>(y, 0, int64_t(_height) - 1);
+	const float_t* p = _data + (size_t(y) * _width + size_t(x)) * 4;
+	for (size_t c = 0; c < 4; c++)
+		out[c] = p[c];
+}
+
+void stub::texture_view::sample(float_t u, float_t v, float_t out[4]) const
+{
+	float_t x  = u * _width - 0.5f;
+	float_t y  = v * _height - 0.5f;
+	float_t fx = floor(x);
+	float_t fy = floor(y);
+	float_t wx = x - fx;
+	float_t wy = y - fy;
+
+	float_t p00[4], p10[4], p01[4], p11[4];
+	load(int64_t(fx), int64_t(fy), p00);
+	load(int64_t(fx) + 1, int64_t(fy), p10);
+	load(int64_t(fx), int64_t(fy) + 1, p01);
+	load(int64_t(fx) + 1, int64_t(fy) + 1, p11);
+	for (size_t c = 0; c < 4; c++) {
+		float_t top    = p00[c] + (p10[c] - p00[c]) * wx;
+		float_t bottom = p01[c] + (p11[c] - p01[c]) * wx;
+		out[c]         = top + (bottom - top) * wy;
+	}
+}
+
+stub::shader_context::shader_context(gs_effect_t* effect) : _effect(effect) {}
+
+const void* stub::shader_context::get(const char* name, size_t* size) const
+{
+	// Parameters that were never set read as zero, like uninitialized constant buffer memory.
+	static const uint8_t zero[4096] = {};
+
+	gs_eparam_t* param = gs_effect_get_param_by_name(_effect, name);
+	if (!param)
+		return nullptr;
+	std::vector<uint8_t> const& value = param->value.size() ? param->value : param->default_value;
+	if (size)
+		*size = value.size();
+	if (value.size() < sizeof(zero))
+		return value.size() ? value.data() : zero;
+	return value.data();
+}
+
+float_t stub::shader_context::get_float(const char* name) const
+{
+	const float_t* v = get_floats(name);
+	return v ? v[0] : 0.f;
+}
+
+int32_t stub::shader_context::get_int(const char* name) const
+{
+	const void* v = get(name);
+	return v ? *reinterpret_cast<const int32_t*>(v) : 0;
+}
+
+const float_t* stub::shader_context::get_floats(const char* name) const
+{
+	return reinterpret_cast<const float_t*>(get(name));
+}
+
+stub::texture_view stub::shader_context::get_texture(const char* name) const
+{
+	gs_eparam_t* param = gs_effect_get_param_by_name(_effect, name);
+	return param ? texture_view(param->texture) : texture_view();
+}
+
+void stub::register_shader(std::string effect, std::string technique, ::stub::shader shader)
+{
+	shaders.push_back({effect, technique, shader});
+}
+
+void stub::set_data_path(std::string path)
+{
+	data_path = path;
+}
+
+uint64_t stub::get_calls(std::string const& function)
+{
+	std::unique_lock<std::mutex> ul(calls_lock);
+	auto                         found = calls.find(function);
+	return (found != calls.end()) ? found->second : 0;
+}
+
+void stub::reset_calls()
+{
+	std::unique_lock<std::mutex> ul(calls_lock);
+	calls.clear();
+}
+
+int64_t stub::get_live_handles()
+{
+	return live_handles.load();
+}
+
+int64_t stub::get_live_allocations()
+{
+	return live_allocations.load();
+}
+
+int64_t stub::get_graphics_depth()
+{
+	return graphics_depth.load();
+}
+
+uint64_t stub::get_vertex_bytes_uploaded()
+{
+	return vertex_bytes.load();
+}
+
+void stub::next_frame()
+{
+	video_frame_time += FRAME_INTERVAL_NS;
+}
+
+std::vector<float_t> stub::read_texture(gs_texture_t* texture)
+{
+	if (!texture)
+		return {};
+	return std::vector<float_t>(texture->pixels.begin(),
+								texture->pixels.begin() + size_t(texture->width) * texture->height * 4);
+}
+
+void stub::write_texture(gs_texture_t* texture, std::vector<float_t> const& rgba)
+{
+	size_t count = std::min(rgba.size(), size_t(texture->width) * texture->height * 4) / 4;
+	for (size_t idx = 0; idx < count; idx++) {
+		float_t color[4] = {rgba[idx * 4], rgba[idx * 4 + 1], rgba[idx * 4 + 2], rgba[idx * 4 + 3]};
+		quantize(texture->format, color);
+		memcpy(&texture->pixels[idx * 4], color, sizeof(color));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Memory, Logging, Platform
+////////////////////////////////////////////////////////////////////////////////
+
+void blog(int log_level, const char* format, ...)
+{
+	RECORD();
+	if (log_level > LOG_WARNING)
+		return;
+
+	va_list args;
+	va_start(args, format);
+	fprintf(stderr, "%s: ", (log_level == LOG_ERROR) ? "error" : "warning");
+	vfprintf(stderr, format, args);
+	fprintf(stderr, "\n");
+	va_end(args);
+}
+
+void* bmalloc(size_t size)
+{
+	void* ptr = malloc(size ? size : 1);
+	if (ptr)
+		live_allocations++;
+	return ptr;
+}
+
+void bfree(void* ptr)
+{
+	if (ptr) {
+		live_allocations--;
+		free(ptr);
+	}
+}
+
+static char* bstrdup(std::string const& text)
+{
+	char* copy = static_cast<char*>(bmalloc(text.size() + 1));
+	memcpy(copy, text.c_str(), text.size() + 1);
+	return copy;
+}
+
+#ifndef os_stat
+int os_stat(const char* file, struct stat* st)
+{
+	return stat(file, st);
+}
+#endif
+
+uint64_t os_gettime_ns(void)
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::steady_clock::now().time_since_epoch())
+						.count());
+}
+
+obs_module_t* obs_current_module(void)
+{
+	RECORD();
+	return nullptr;
+}
+
+char* obs_find_module_file(obs_module_t*, const char* file)
+{
+	RECORD();
+	std::string path = data_path + "/" + file;
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0)
+		return nullptr;
+	return bstrdup(path);
+}
+
+const char* obs_module_text(const char* lookup_string)
+{
+	RECORD();
+	return lookup_string;
+}
+
+void obs_enter_graphics(void)
+{
+	RECORD();
+	graphics_lock.lock();
+	graphics_depth++;
+}
+
+void obs_leave_graphics(void)
+{
+	RECORD();
+	graphics_depth--;
+	graphics_lock.unlock();
+}
+
+uint64_t obs_get_video_frame_time(void)
+{
+	RECORD();
+	return video_frame_time.load();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Data, Procedures, Signals
+////////////////////////////////////////////////////////////////////////////////
+
+struct obs_data {
+	std::atomic<int64_t>               references;
+	std::map<std::string, double>      numbers;
+	std::map<std::string, std::string> strings;
+	std::map<std::string, obs_data_t*> objects;
+	// What the getters fall back to for names that were never set.
+	std::map<std::string, double>      default_numbers;
+	std::map<std::string, std::string> default_strings;
+};
+
+obs_data_t* obs_data_create(void)
+{
+	RECORD();
+	obs_data_t* data = new obs_data();
+	data->references = 1;
+	return data;
+}
+
+void obs_data_addref(obs_data_t* data)
+{
+	RECORD();
+	if (data)
+		data->references++;
+}
+
+void obs_data_release(obs_data_t* data)
+{
+	RECORD();
+	if (!data || (--data->references > 0))
+		return;
+	for (auto kv : data->objects)
+		obs_data_release(kv.second);
+	delete data;
+}
+
+void obs_data_set_double(obs_data_t* data, const char* name, double val)
+{
+	RECORD();
+	data->numbers[name] = val;
+}
+
+void obs_data_set_int(obs_data_t* data, const char* name, long long val)
+{
+	RECORD();
+	data->numbers[name] = double(val);
+}
+
+void obs_data_set_bool(obs_data_t* data, const char* name, bool val)
+{
+	RECORD();
+	data->numbers[name] = val ? 1. : 0.;
+}
+
+void obs_data_set_string(obs_data_t* data, const char* name, const char* val)
+{
+	RECORD();
+	data->strings[name] = val ? val : "";
+}
+
+void obs_data_set_default_double(obs_data_t* data, const char* name, double val)
+{
+	RECORD();
+	data->default_numbers[name] = val;
+}
+
+void obs_data_set_default_int(obs_data_t* data, const char* name, long long val)
+{
+	RECORD();
+	data->default_numbers[name] = double(val);
+}
+
+void obs_data_set_default_bool(obs_data_t* data, const char* name, bool val)
+{
+	RECORD();
+	data->default_numbers[name] = val ? 1. : 0.;
+}
+
+void obs_data_set_default_string(obs_data_t* data, const char* name, const char* val)
+{
+	RECORD();
+	data->default_strings[name] = val ? val : "";
+}
+
+double obs_data_get_double(obs_data_t* data, const char* name)
+{
+	RECORD();
+	auto found = data->numbers.find(name);
+	if (found != data->numbers.end())
+		return found->second;
+	found = data->default_numbers.find(name);
+	return (found != data->default_numbers.end()) ? found->second : 0.;
+}
+
+long long obs_data_get_int(obs_data_t* data, const char* name)
+{
+	RECORD();
+	return static_cast<long long>(obs_data_get_double(data, name));
+}
+
+bool obs_data_get_bool(obs_data_t* data, const char* name)
+{
+	RECORD();
+	return obs_data_get_double(data, name) != 0.;
+}
+
+const char* obs_data_get_string(obs_data_t* data, const char* name)
+{
+	RECORD();
+	auto found = data->strings.find(name);
+	if (found != data->strings.end())
+		return found->second.c_str();
+	found = data->default_strings.find(name);
+	return (found != data->default_strings.end()) ? found->second.c_str() : "";
+}
+
+void obs_data_set_obj(obs_data_t* data, const char* name, obs_data_t* obj)
+{
+	RECORD();
+	obs_data_addref(obj);
+	obs_data_release(data->objects[name]);
+	data->objects[name] = obj;
+}
+
+obs_data_t* obs_data_get_obj(obs_data_t* data, const char* name)
+{
+	RECORD();
+	auto found = data->objects.find(name);
+	if (found == data->objects.end())
+		return nullptr;
+	obs_data_addref(found->second);
+	return found->second;
+}
+
+// Copy the user values of one object over those of another, like obs_source_update() does with new settings.
+static void apply_data(obs_data_t* target, obs_data_t* data)
+{
+	if (!data || (data == target))
+		return;
+	for (auto kv : data->numbers)
+		target->numbers[kv.first] = kv.second;
+	for (auto kv : data->strings)
+		target->strings[kv.first] = kv.second;
+	for (auto kv : data->objects)
+		obs_data_set_obj(target, kv.first.c_str(), kv.second);
+}
+
+void proc_handler_add(proc_handler_t*, const char*, proc_handler_proc_t, void*)
+{
+	RECORD();
+}
+
+// Each value on the stack is stored as its name with terminator, its size and its data, one after another.
+static uint8_t* find_calldata(const calldata_t* data, const char* name, size_t* size)
+{
+	size_t offset = 0;
+	while (offset < data->size) {
+		const char* entry_name = reinterpret_cast<const char*>(data->stack + offset);
+		offset += strlen(entry_name) + 1;
+		size_t entry_size;
+		memcpy(&entry_size, data->stack + offset, sizeof(size_t));
+		offset += sizeof(size_t);
+		if (strcmp(entry_name, name) == 0) {
+			*size = entry_size;
+			return data->stack + offset;
+		}
+		offset += entry_size;
+	}
+	return nullptr;
+}
+
+bool calldata_get_data(const calldata_t* data, const char* name, void* out, size_t size)
+{
+	RECORD();
+	size_t   entry_size = 0;
+	uint8_t* value      = find_calldata(data, name, &entry_size);
+	if (!value || (entry_size != size))
+		return false;
+	memcpy(out, value, size);
+	return true;
+}
+
+bool calldata_get_string(const calldata_t* data, const char* name, const char** str)
+{
+	RECORD();
+	size_t   entry_size = 0;
+	uint8_t* value      = find_calldata(data, name, &entry_size);
+	if (!value)
+		return false;
+	*str = entry_size ? reinterpret_cast<const char*>(value) : nullptr;
+	return true;
+}
+
+void calldata_set_data(calldata_t* data, const char* name, const void* in, size_t new_size)
+{
+	RECORD();
+	size_t   entry_size = 0;
+	uint8_t* value      = find_calldata(data, name, &entry_size);
+	if (value && (entry_size == new_size)) {
+		memcpy(value, in, new_size);
+		return;
+	}
+
+	// Rebuild the stack without the old value and the new one appended.
+	std::vector<uint8_t> stack;
+	size_t               offset = 0;
+	while (offset < data->size) {
+		size_t begin = offset;
+		offset += strlen(reinterpret_cast<const char*>(data->stack + offset)) + 1;
+		memcpy(&entry_size, data->stack + offset, sizeof(size_t));
+		offset += sizeof(size_t) + entry_size;
+		if (strcmp(reinterpret_cast<const char*>(data->stack + begin), name) != 0)
+			stack.insert(stack.end(), data->stack + begin, data->stack + offset);
+	}
+	stack.insert(stack.end(), name, name + strlen(name) + 1);
+	stack.insert(stack.end(), reinterpret_cast<uint8_t*>(&new_size),
+				 reinterpret_cast<uint8_t*>(&new_size) + sizeof(size_t));
+	stack.insert(stack.end(), static_cast<const uint8_t*>(in), static_cast<const uint8_t*>(in) + new_size);
+
+	if (data->fixed && (stack.size() > data->capacity)) {
+		blog(LOG_ERROR, "calldata_set_data: fixed stack of %zu bytes is too small", data->capacity);
+		return;
+	}
+	if (!data->fixed && (stack.size() > data->capacity)) {
+		bfree(data->stack);
+		data->stack    = static_cast<uint8_t*>(bmalloc(stack.size()));
+		data->capacity = stack.size();
+	}
+	memcpy(data->stack, stack.data(), stack.size());
+	data->size = stack.size();
+}
+
+struct signal_connection {
+	std::string       signal;
+	signal_callback_t callback;
+	void*             data;
+};
+
+struct signal_handler {
+	std::mutex                   lock;
+	std::list<signal_connection> connections;
+};
+
+static signal_handler global_signals;
+
+void signal_handler_connect(signal_handler_t* handler, const char* signal, signal_callback_t callback, void* data)
+{
+	RECORD();
+	std::unique_lock<std::mutex> ul(handler->lock);
+	handler->connections.push_back({signal, callback, data});
+}
+
+void signal_handler_disconnect(signal_handler_t* handler, const char* signal, signal_callback_t callback, void* data)
+{
+	RECORD();
+	std::unique_lock<std::mutex> ul(handler->lock);
+	for (auto iter = handler->connections.begin(); iter != handler->connections.end(); iter++) {
+		if ((iter->signal == signal) && (iter->callback == callback) && (iter->data == data)) {
+			handler->connections.erase(iter);
+			break;
+		}
+	}
+}
+
+// Handlers may disconnect while the signal is delivered, so they are called from a copy.
+static void emit_signal(signal_handler_t* handler, const char* signal, calldata_t* data)
+{
+	std::list<signal_connection> connections;
+	{
+		std::unique_lock<std::mutex> ul(handler->lock);
+		connections = handler->connections;
+	}
+	for (auto const& connection : connections) {
+		if (connection.signal == signal)
+			connection.callback(connection.data, data);
+	}
+}
+
+signal_handler_t* obs_get_signal_handler(void)
+{
+	RECORD();
+	return &global_signals;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sources, Scenes
+////////////////////////////////////////////////////////////////////////////////
+
+// Shared between a source and its weak references, so these can tell whether the source is still alive.
+struct obs_weak_source {
+	std::atomic<int64_t> references;
+	std::atomic<int64_t> weak_references;
+	obs_source_t*        source;
+};
+
+struct audio_capture {
+	obs_source_audio_capture_t callback;
+	void*                      param;
+};
+
+struct obs_source {
+	obs_weak_source_t*         control;
+	std::string                name;
+	std::string                id;
+	obs_source_info            info;
+	bool                       is_private;
+	void*                      context;
+	obs_data_t*                settings;
+	signal_handler             signals;
+	std::mutex                 audio_lock;
+	std::vector<audio_capture> audio_captures;
+	std::list<obs_source_t*>   active_children;
+	obs_scene_t*               scene;
+};
+
+struct obs_scene {
+	obs_source_t*               source;
+	std::list<obs_sceneitem_t*> items;
+};
+
+struct obs_scene_item {
+	obs_scene_t*  parent;
+	obs_source_t* source;
+};
+
+static std::mutex                             sources_lock;
+static std::map<std::string, obs_source_info> source_types;
+static std::list<obs_source_t*>               public_sources;
+
+// Emit a source signal on the global handler, unless it's private, and on the source itself.
+static void emit_source_signal(obs_source_t* source, const char* global_signal, const char* source_signal)
+{
+	calldata_t data;
+	calldata_init(&data);
+	calldata_set_ptr(&data, "source", source);
+	if (global_signal && !source->is_private)
+		emit_signal(&global_signals, global_signal, &data);
+	if (source_signal)
+		emit_signal(&source->signals, source_signal, &data);
+	calldata_free(&data);
+}
+
+static obs_source_t* create_source(const char* id, const char* name, obs_data_t* settings, bool is_private)
+{
+	obs_source_t* source             = new obs_source();
+	source->control                  = new obs_weak_source();
+	source->control->references      = 1;
+	source->control->weak_references = 1;
+	source->control->source          = source;
+	source->name                     = name ? name : "";
+	source->id                       = id;
+	source->is_private               = is_private;
+	source->settings                 = settings ? settings : obs_data_create();
+	if (settings)
+		obs_data_addref(settings);
+	live_handles++;
+
+	{
+		std::unique_lock<std::mutex> ul(sources_lock);
+		auto                         found = source_types.find(id);
+		if (found != source_types.end())
+			source->info = found->second;
+		if (!is_private)
+			public_sources.push_back(source);
+	}
+
+	if (source->info.get_defaults)
+		source->info.get_defaults(source->settings);
+	if (source->info.create)
+		source->context = source->info.create(source->settings, source);
+	emit_source_signal(source, "source_create", nullptr);
+	return source;
+}
+
+static void destroy_source(obs_source_t* source)
+{
+	emit_source_signal(source, "source_destroy", "destroy");
+	if (source->scene) {
+		for (auto item : std::list<obs_sceneitem_t*>(source->scene->items))
+			obs_sceneitem_remove(item);
+		delete source->scene;
+	}
+	if (source->info.destroy)
+		source->info.destroy(source->context);
+	obs_data_release(source->settings);
+
+	{
+		std::unique_lock<std::mutex> ul(sources_lock);
+		public_sources.remove(source);
+	}
+	obs_weak_source_release(source->control);
+	delete source;
+	live_handles--;
+}
+
+// Take a reference if the source is still alive, which is what weak references and lookups by name do.
+static bool try_addref(obs_weak_source_t* control)
+{
+	int64_t references = control->references.load();
+	while (references > 0) {
+		if (control->references.compare_exchange_weak(references, references + 1))
+			return true;
+	}
+	return false;
+}
+
+void obs_register_source_s(const struct obs_source_info* info, size_t size)
+{
+	RECORD();
+	obs_source_info copy = {};
+	memcpy(&copy, info, std::min(size, sizeof(copy)));
+	std::unique_lock<std::mutex> ul(sources_lock);
+	source_types[info->id] = copy;
+}
+
+obs_source_t* obs_source_create(const char* id, const char* name, obs_data_t* settings, obs_data_t*)
+{
+	RECORD();
+	return create_source(id, name, settings, false);
+}
+
+obs_source_t* obs_source_create_private(const char* id, const char* name, obs_data_t* settings)
+{
+	RECORD();
+	return create_source(id, name, settings, true);
+}
+
+obs_source_t* obs_get_source_by_name(const char* name)
+{
+	RECORD();
+	std::unique_lock<std::mutex> ul(sources_lock);
+	for (auto source : public_sources) {
+		if ((source->name == name) && try_addref(source->control))
+			return source;
+	}
+	return nullptr;
+}
+
+void obs_source_addref(obs_source_t* source)
+{
+	RECORD();
+	if (source)
+		source->control->references++;
+}
+
+void obs_source_release(obs_source_t* source)
+{
+	RECORD();
+	if (source && (--source->control->references == 0))
+		destroy_source(source);
+}
+
+obs_weak_source_t* obs_source_get_weak_source(obs_source_t* source)
+{
+	RECORD();
+	if (!source)
+		return nullptr;
+	source->control->weak_references++;
+	return source->control;
+}
+
+obs_source_t* obs_weak_source_get_source(obs_weak_source_t* weak)
+{
+	RECORD();
+	return (weak && try_addref(weak)) ? weak->source : nullptr;
+}
+
+void obs_weak_source_release(obs_weak_source_t* weak)
+{
+	RECORD();
+	if (weak && (--weak->weak_references == 0))
+		delete weak;
+}
+
+const char* obs_source_get_name(const obs_source_t* source)
+{
+	RECORD();
+	return source ? source->name.c_str() : "";
+}
+
+const char* obs_source_get_id(const obs_source_t* source)
+{
+	RECORD();
+	return source ? source->id.c_str() : nullptr;
+}
+
+enum obs_source_type obs_source_get_type(const obs_source_t* source)
+{
+	RECORD();
+	return source ? source->info.type : OBS_SOURCE_TYPE_INPUT;
+}
+
+uint32_t obs_source_get_output_flags(const obs_source_t* source)
+{
+	RECORD();
+	return source ? source->info.output_flags : 0;
+}
+
+void* obs_source_get_type_data(obs_source_t* source)
+{
+	RECORD();
+	return source ? source->info.type_data : nullptr;
+}
+
+proc_handler_t* obs_source_get_proc_handler(const obs_source_t*)
+{
+	RECORD();
+	return nullptr;
+}
+
+signal_handler_t* obs_source_get_signal_handler(const obs_source_t* source)
+{
+	RECORD();
+	return source ? const_cast<signal_handler_t*>(&source->signals) : nullptr;
+}
+
+obs_data_t* obs_source_get_settings(const obs_source_t* source)
+{
+	RECORD();
+	if (!source)
+		return nullptr;
+	obs_data_addref(source->settings);
+	return source->settings;
+}
+
+void obs_source_update(obs_source_t* source, obs_data_t* settings)
+{
+	RECORD();
+	apply_data(source->settings, settings);
+	if (source->info.update)
+		source->info.update(source->context, source->settings);
+}
+
+uint32_t obs_source_get_width(obs_source_t* source)
+{
+	RECORD();
+	return (source && source->info.get_width) ? source->info.get_width(source->context) : 0;
+}
+
+uint32_t obs_source_get_height(obs_source_t* source)
+{
+	RECORD();
+	return (source && source->info.get_height) ? source->info.get_height(source->context) : 0;
+}
+
+void obs_source_video_render(obs_source_t* source)
+{
+	RECORD();
+	if (source && source->info.video_render)
+		source->info.video_render(source->context, nullptr);
+}
+
+void obs_source_enum_active_sources(obs_source_t* source, obs_source_enum_proc_t enum_callback, void* param)
+{
+	RECORD();
+	if (source->scene) {
+		for (auto item : source->scene->items)
+			enum_callback(source, item->source, param);
+	} else if (source->info.enum_active_sources) {
+		source->info.enum_active_sources(source->context, enum_callback, param);
+	}
+}
+
+static bool is_active_child(obs_source_t* parent, obs_source_t* child)
+{
+	if (parent == child)
+		return true;
+	for (auto active : parent->active_children) {
+		if (is_active_child(active, child))
+			return true;
+	}
+	return false;
+}
+
+bool obs_source_add_active_child(obs_source_t* parent, obs_source_t* child)
+{
+	RECORD();
+	if (!parent || !child || is_active_child(child, parent))
+		return false;
+	parent->active_children.push_back(child);
+	return true;
+}
+
+void obs_source_remove_active_child(obs_source_t* parent, obs_source_t* child)
+{
+	RECORD();
+	if (!parent || !child)
+		return;
+	auto found = std::find(parent->active_children.begin(), parent->active_children.end(), child);
+	if (found != parent->active_children.end())
+		parent->active_children.erase(found);
+}
+
+obs_scene_t* obs_scene_create_private(const char* name)
+{
+	RECORD();
+	obs_source_t* source      = create_source("scene", name, nullptr, true);
+	source->info.type         = OBS_SOURCE_TYPE_SCENE;
+	source->info.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW | OBS_SOURCE_COMPOSITE;
+	source->scene             = new obs_scene();
+	source->scene->source     = source;
+	return source->scene;
+}
+
+obs_scene_t* obs_scene_from_source(const obs_source_t* source)
+{
+	RECORD();
+	return source ? source->scene : nullptr;
+}
+
+obs_source_t* obs_scene_get_source(const obs_scene_t* scene)
+{
+	RECORD();
+	return scene ? scene->source : nullptr;
+}
+
+obs_sceneitem_t* obs_scene_add(obs_scene_t* scene, obs_source_t* source)
+{
+	RECORD();
+	if (!scene || !source || !obs_source_add_active_child(scene->source, source))
+		return nullptr;
+	obs_sceneitem_t* item = new obs_scene_item();
+	item->parent          = scene;
+	item->source          = source;
+	obs_source_addref(source);
+	scene->items.push_back(item);
+	return item;
+}
+
+void obs_scene_enum_items(obs_scene_t* scene, bool (*callback)(obs_scene_t*, obs_sceneitem_t*, void*), void* param)
+{
+	RECORD();
+	for (auto item : std::list<obs_sceneitem_t*>(scene->items)) {
+		if (!callback(scene, item, param))
+			break;
+	}
+}
+
+obs_source_t* obs_sceneitem_get_source(const obs_sceneitem_t* item)
+{
+	RECORD();
+	return item ? item->source : nullptr;
+}
+
+void obs_sceneitem_remove(obs_sceneitem_t* item)
+{
+	RECORD();
+	if (!item)
+		return;
+	item->parent->items.remove(item);
+	obs_source_remove_active_child(item->parent->source, item->source);
+	obs_source_release(item->source);
+	delete item;
+}
+
+void obs_sceneitem_set_info(obs_sceneitem_t*, const struct obs_transform_info*)
+{
+	RECORD();
+}
+
+void obs_sceneitem_set_scale_filter(obs_sceneitem_t*, enum obs_scale_type)
+{
+	RECORD();
+}
+
+void obs_sceneitem_force_update_transform(obs_sceneitem_t*)
+{
+	RECORD();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Audio
+////////////////////////////////////////////////////////////////////////////////
+
+struct audio_output {
+	audio_output_info info;
+};
+
+static audio_output audio_instance = {{"stub", 48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO, nullptr, nullptr}};
+
+static std::mutex                    audio_output_lock;
+static ::stub::audio_output_callback audio_output_hook;
+
+audio_t* obs_get_audio(void)
+{
+	RECORD();
+	return &audio_instance;
+}
+
+const struct audio_output_info* audio_output_get_info(const audio_t* audio)
+{
+	RECORD();
+	return audio ? &audio->info : nullptr;
+}
+
+void obs_source_add_audio_capture_callback(obs_source_t* source, obs_source_audio_capture_t callback, void* param)
+{
+	RECORD();
+	std::unique_lock<std::mutex> ul(source->audio_lock);
+	source->audio_captures.push_back({callback, param});
+}
+
+void obs_source_remove_audio_capture_callback(obs_source_t* source, obs_source_audio_capture_t callback, void* param)
+{
+	RECORD();
+	std::unique_lock<std::mutex> ul(source->audio_lock);
+	for (auto iter = source->audio_captures.begin(); iter != source->audio_captures.end(); iter++) {
+		if ((iter->callback == callback) && (iter->param == param)) {
+			source->audio_captures.erase(iter);
+			break;
+		}
+	}
+}
+
+void obs_source_output_audio(obs_source_t* source, const struct obs_source_audio* audio)
+{
+	RECORD();
+	std::unique_lock<std::mutex> ul(audio_output_lock);
+	if (audio_output_hook)
+		audio_output_hook(source, audio);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Properties
+////////////////////////////////////////////////////////////////////////////////
+
+struct obs_property {
+	std::string             name;
+	bool                    visible;
+	bool                    enabled;
+	obs_property_modified_t modified;
+	size_t                  items;
+};
+
+struct obs_properties {
+	std::list<obs_property> properties;
+};
+
+obs_properties_t* obs_properties_create(void)
+{
+	RECORD();
+	return new obs_properties();
+}
+
+obs_property_t* obs_properties_get(obs_properties_t* props, const char* property)
+{
+	RECORD();
+	for (auto& p : props->properties) {
+		if (p.name == property)
+			return &p;
+	}
+	return nullptr;
+}
+
+static obs_property_t* add_property(obs_properties_t* props, const char* name)
+{
+	props->properties.push_back({name, true, true, nullptr, 0});
+	return &props->properties.back();
+}
+
+obs_property_t* obs_properties_add_bool(obs_properties_t* props, const char* name, const char*)
+{
+	RECORD();
+	return add_property(props, name);
+}
+
+obs_property_t* obs_properties_add_text(obs_properties_t* props, const char* name, const char*, enum obs_text_type)
+{
+	RECORD();
+	return add_property(props, name);
+}
+
+obs_property_t* obs_properties_add_list(obs_properties_t* props, const char* name, const char*, enum obs_combo_type,
+										enum obs_combo_format)
+{
+	RECORD();
+	return add_property(props, name);
+}
+
+size_t obs_property_list_add_string(obs_property_t* p, const char*, const char*)
+{
+	RECORD();
+	return p->items++;
+}
+
+size_t obs_property_list_add_int(obs_property_t* p, const char*, long long)
+{
+	RECORD();
+	return p->items++;
+}
+
+void obs_property_set_visible(obs_property_t* p, bool visible)
+{
+	RECORD();
+	if (p)
+		p->visible = visible;
+}
+
+void obs_property_set_enabled(obs_property_t* p, bool enabled)
+{
+	RECORD();
+	if (p)
+		p->enabled = enabled;
+}
+
+void obs_property_set_long_description(obs_property_t*, const char*)
+{
+	RECORD();
+}
+
+void obs_property_set_modified_callback(obs_property_t* p, obs_property_modified_t modified)
+{
+	RECORD();
+	if (p)
+		p->modified = modified;
+}
+
+void stub::set_audio_info(uint32_t samples_per_sec, speaker_layout speakers)
+{
+	audio_instance.info.samples_per_sec = samples_per_sec;
+	audio_instance.info.speakers        = speakers;
+}
+
+void stub::set_audio_output_callback(::stub::audio_output_callback callback)
+{
+	std::unique_lock<std::mutex> ul(audio_output_lock);
+	audio_output_hook = callback;
+}
+
+void stub::push_audio(obs_source_t* source, audio_data const& audio, bool muted)
+{
+	// libobs holds the lock while calling back, removing a callback waits for it to return.
+	std::unique_lock<std::mutex> ul(source->audio_lock);
+	for (auto const& capture : source->audio_captures)
+		capture.callback(capture.param, source, &audio, muted);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Graphics State
+////////////////////////////////////////////////////////////////////////////////
+
+graphics_t* gs_get_context(void)
+{
+	RECORD();
+	return &context_instance;
+}
+
+int gs_get_device_type(void)
+{
+	RECORD();
+	return GS_DEVICE_OPENGL;
+}
+
+void gs_set_cull_mode(enum gs_cull_mode)
+{
+	RECORD();
+}
+
+void gs_enable_blending(bool enable)
+{
+	RECORD();
+	blending.enabled = enable;
+}
+
+void gs_enable_depth_test(bool)
+{
+	RECORD();
+}
+
+void gs_enable_stencil_test(bool)
+{
+	RECORD();
+}
+
+void gs_enable_stencil_write(bool)
+{
+	RECORD();
+}
+
+void gs_enable_color(bool red, bool green, bool blue, bool alpha)
+{
+	RECORD();
+	color_mask[0] = red;
+	color_mask[1] = green;
+	color_mask[2] = blue;
+	color_mask[3] = alpha;
+}
+
+void gs_blend_function(enum gs_blend_type src, enum gs_blend_type dest)
+{
+	RECORD();
+	gs_blend_function_separate(src, dest, src, dest);
+}
+
+void gs_blend_function_separate(enum gs_blend_type src_c, enum gs_blend_type dest_c, enum gs_blend_type src_a,
+								enum gs_blend_type dest_a)
+{
+	RECORD();
+	blending.src_c = src_c;
+	blending.dst_c = dest_c;
+	blending.src_a = src_a;
+	blending.dst_a = dest_a;
+}
+
+void gs_depth_function(enum gs_depth_test)
+{
+	RECORD();
+}
+
+void gs_stencil_function(enum gs_stencil_side, enum gs_depth_test)
+{
+	RECORD();
+}
+
+void gs_stencil_op(enum gs_stencil_side, enum gs_stencil_op_type, enum gs_stencil_op_type, enum gs_stencil_op_type)
+{
+	RECORD();
+}
+
+void gs_blend_state_push(void)
+{
+	RECORD();
+	blend_stack.push_back(blending);
+}
+
+void gs_blend_state_pop(void)
+{
+	RECORD();
+	if (blend_stack.empty()) {
+		blog(LOG_ERROR, "gs_blend_state_pop: stack is empty");
+		return;
+	}
+	blending = blend_stack.back();
+	blend_stack.pop_back();
+}
+
+void gs_reset_blend_state(void)
+{
+	RECORD();
+	blending = default_blending;
+}
+
+void gs_ortho(float left, float right, float top, float bottom, float, float)
+{
+	RECORD();
+	context.ortho[0] = left;
+	context.ortho[1] = right;
+	context.ortho[2] = top;
+	context.ortho[3] = bottom;
+}
+
+void gs_projection_push(void)
+{
+	RECORD();
+	projection_stack.push_back({context.ortho[0], context.ortho[1], context.ortho[2], context.ortho[3]});
+}
+
+void gs_projection_pop(void)
+{
+	RECORD();
+	if (projection_stack.empty())
+		return;
+	std::copy(projection_stack.back().begin(), projection_stack.back().end(), context.ortho);
+	projection_stack.pop_back();
+}
+
+void gs_set_viewport(int x, int y, int width, int height)
+{
+	RECORD();
+	context.viewport = {x, y, width, height};
+}
+
+void gs_get_viewport(struct gs_rect* rect)
+{
+	RECORD();
+	*rect = context.viewport;
+}
+
+void gs_viewport_push(void)
+{
+	RECORD();
+	viewport_stack.push_back(context.viewport);
+}
+
+void gs_viewport_pop(void)
+{
+	RECORD();
+	if (viewport_stack.empty())
+		return;
+	context.viewport = viewport_stack.back();
+	viewport_stack.pop_back();
+}
+
+void gs_matrix_push(void)
+{
+	RECORD();
+	context.matrices.push_back(context.matrices.back());
+}
+
+void gs_matrix_pop(void)
+{
+	RECORD();
+	if (context.matrices.size() <= 1) {
+		blog(LOG_ERROR, "gs_matrix_pop: stack is empty");
+		return;
+	}
+	context.matrices.pop_back();
+}
+
+void gs_matrix_identity(void)
+{
+	RECORD();
+	context.matrices.back() = {1, 1, 0, 0};
+}
+
+void gs_matrix_translate3f(float x, float y, float)
+{
+	RECORD();
+	context.matrices.back().tx += x;
+	context.matrices.back().ty += y;
+}
+
+void gs_matrix_scale3f(float x, float y, float)
+{
+	RECORD();
+	affine& m = context.matrices.back();
+	m         = {m.sx * x, m.sy * y, m.tx * x, m.ty * y};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Textures
+////////////////////////////////////////////////////////////////////////////////
+
+gs_texture_t* gs_texture_create(uint32_t width, uint32_t height, enum gs_color_format color_format, uint32_t levels,
+								const uint8_t** data, uint32_t flags)
+{
+	RECORD();
+	if ((width == 0) || (height == 0) || (get_format_size(color_format) == 0))
+		return nullptr;
+	gs_texture* tex = create_texture(GS_TEXTURE_2D, width, height, 1, color_format, levels, flags);
+	if (data && data[0])
+		upload_layer(tex, 0, data[0], width * get_format_size(color_format), false);
+	live_handles++;
+	return tex;
+}
+
+gs_texture_t* gs_texture_create_from_file(const char* file)
+{
+	RECORD();
+	// There is no image decoder, any readable file turns into a white texel.
+	std::ifstream stream(file, std::ios::binary);
+	if (!stream.is_open())
+		return nullptr;
+	gs_texture* tex = create_texture(GS_TEXTURE_2D, 1, 1, 1, GS_RGBA, 1, 0);
+	std::fill(tex->pixels.begin(), tex->pixels.end(), 1.f);
+	live_handles++;
+	return tex;
+}
+
+gs_texture_t* gs_voltexture_create(uint32_t width, uint32_t height, uint32_t depth, enum gs_color_format color_format,
+								   uint32_t levels, const uint8_t** data, uint32_t flags)
+{
+	RECORD();
+	if ((width == 0) || (height == 0) || (depth == 0) || (get_format_size(color_format) == 0))
+		return nullptr;
+	gs_texture* tex = create_texture(GS_TEXTURE_3D, width, height, depth, color_format, levels, flags);
+	if (data && data[0]) {
+		size_t layer_size = size_t(width) * height * get_format_size(color_format);
+		for (size_t z = 0; z < depth; z++)
+			upload_layer(tex, z, data[0] + z * layer_size, width * get_format_size(color_format), false);
+	}
+	live_handles++;
+	return tex;
+}
+
+gs_texture_t* gs_cubetexture_create(uint32_t size, enum gs_color_format color_format, uint32_t levels,
+									const uint8_t** data, uint32_t flags)
+{
+	RECORD();
+	if ((size == 0) || (get_format_size(color_format) == 0))
+		return nullptr;
+	gs_texture* tex = create_texture(GS_TEXTURE_CUBE, size, size, 6, color_format, levels, flags);
+	if (data) {
+		for (size_t face = 0; face < 6; face++) {
+			if (data[face * levels])
+				upload_layer(tex, face, data[face * levels], size * get_format_size(color_format), false);
+		}
+	}
+	live_handles++;
+	return tex;
+}
+
+static void destroy_texture(gs_texture_t* tex, gs_texture_type type, const char* function)
+{
+	record(function);
+	if (!tex)
+		return;
+	if (tex->type != type)
+		blog(LOG_ERROR, "%s: texture has the wrong type", function);
+	delete tex;
+	live_handles--;
+}
+
+void gs_texture_destroy(gs_texture_t* tex)
+{
+	destroy_texture(tex, GS_TEXTURE_2D, __func__);
+}
+
+void gs_voltexture_destroy(gs_texture_t* tex)
+{
+	destroy_texture(tex, GS_TEXTURE_3D, __func__);
+}
+
+void gs_cubetexture_destroy(gs_texture_t* tex)
+{
+	destroy_texture(tex, GS_TEXTURE_CUBE, __func__);
+}
+
+uint32_t gs_texture_get_width(const gs_texture_t* tex)
+{
+	RECORD();
+	return tex ? tex->width : 0;
+}
+
+uint32_t gs_texture_get_height(const gs_texture_t* tex)
+{
+	RECORD();
+	return tex ? tex->height : 0;
+}
+
+uint32_t gs_voltexture_get_width(const gs_texture_t* tex)
+{
+	RECORD();
+	return tex ? tex->width : 0;
+}
+
+uint32_t gs_voltexture_get_height(const gs_texture_t* tex)
+{
+	RECORD();
+	return tex ? tex->height : 0;
+}
+
+uint32_t gs_voltexture_get_depth(const gs_texture_t* tex)
+{
+	RECORD();
+	return tex ? tex->depth : 0;
+}
+
+uint32_t gs_cubetexture_get_size(const gs_texture_t* tex)
+{
+	RECORD();
+	return tex ? tex->width : 0;
+}
+
+enum gs_color_format gs_texture_get_color_format(const gs_texture_t* tex)
+{
+	RECORD();
+	return tex ? tex->format : GS_UNKNOWN;
+}
+
+enum gs_color_format gs_voltexture_get_color_format(const gs_texture_t* tex)
+{
+	RECORD();
+	return tex ? tex->format : GS_UNKNOWN;
+}
+
+enum gs_texture_type gs_get_texture_type(const gs_texture_t* tex)
+{
+	RECORD();
+	return tex ? tex->type : GS_TEXTURE_2D;
+}
+
+void* gs_texture_get_obj(gs_texture_t* tex)
+{
+	RECORD();
+	return tex;
+}
+
+bool gs_texture_map(gs_texture_t* tex, uint8_t** ptr, uint32_t* linesize)
+{
+	RECORD();
+	if (!tex || !(tex->flags & GS_DYNAMIC)) {
+		blog(LOG_ERROR, "gs_texture_map: texture is not dynamic");
+		return false;
+	}
+	size_t bpp = get_format_size(tex->format);
+	tex->mapped.resize(size_t(tex->width) * tex->height * bpp);
+	for (size_t idx = 0; idx < size_t(tex->width) * tex->height; idx++)
+		encode(tex->format, &tex->pixels[idx * 4], &tex->mapped[idx * bpp]);
+	*ptr      = tex->mapped.data();
+	*linesize = uint32_t(tex->width * bpp);
+	return true;
+}
+
+void gs_texture_unmap(gs_texture_t* tex)
+{
+	RECORD();
+	upload_layer(tex, 0, tex->mapped.data(), tex->width * get_format_size(tex->format), false);
+	tex->mapped.clear();
+}
+
+void gs_texture_set_image(gs_texture_t* tex, const uint8_t* data, uint32_t linesize, bool invert)
+{
+	RECORD();
+	if (!tex || !data)
+		return;
+	if (!(tex->flags & GS_DYNAMIC)) {
+		blog(LOG_ERROR, "gs_texture_set_image: texture is not dynamic");
+		return;
+	}
+	upload_layer(tex, 0, data, linesize, invert);
+}
+
+void gs_load_texture(gs_texture_t*, int)
+{
+	RECORD();
+}
+
+gs_stagesurf_t* gs_stagesurface_create(uint32_t width, uint32_t height, enum gs_color_format color_format)
+{
+	RECORD();
+	if ((width == 0) || (height == 0) || (get_format_size(color_format) == 0))
+		return nullptr;
+	gs_stage_surface* surface = new gs_stage_surface();
+	surface->width            = width;
+	surface->height           = height;
+	surface->format           = color_format;
+	surface->mapped           = false;
+	surface->data.resize(size_t(width) * height * get_format_size(color_format));
+	live_handles++;
+	return surface;
+}
+
+void gs_stagesurface_destroy(gs_stagesurf_t* stagesurf)
+{
+	RECORD();
+	if (!stagesurf)
+		return;
+	delete stagesurf;
+	live_handles--;
+}
+
+uint32_t gs_stagesurface_get_width(const gs_stagesurf_t* stagesurf)
+{
+	RECORD();
+	return stagesurf ? stagesurf->width : 0;
+}
+
+uint32_t gs_stagesurface_get_height(const gs_stagesurf_t* stagesurf)
+{
+	RECORD();
+	return stagesurf ? stagesurf->height : 0;
+}
+
+void gs_stage_texture(gs_stagesurf_t* dst, gs_texture_t* src)
+{
+	RECORD();
+	if (!dst || !src || (src->width != dst->width) || (src->height != dst->height)
+		|| (src->format != dst->format)) {
+		blog(LOG_ERROR, "gs_stage_texture: surface and texture don't match");
+		return;
+	}
+	size_t bpp = get_format_size(dst->format);
+	for (size_t idx = 0; idx < size_t(dst->width) * dst->height; idx++)
+		encode(dst->format, &src->pixels[idx * 4], &dst->data[idx * bpp]);
+}
+
+bool gs_stagesurface_map(gs_stagesurf_t* stagesurf, uint8_t** data, uint32_t* linesize)
+{
+	RECORD();
+	if (!stagesurf || stagesurf->mapped)
+		return false;
+	stagesurf->mapped = true;
+	*data             = stagesurf->data.data();
+	*linesize         = uint32_t(stagesurf->width * get_format_size(stagesurf->format));
+	return true;
+}
+
+void gs_stagesurface_unmap(gs_stagesurf_t* stagesurf)
+{
+	RECORD();
+	if (stagesurf)
+		stagesurf->mapped = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Render Targets
+////////////////////////////////////////////////////////////////////////////////
+
+gs_texrender_t* gs_texrender_create(enum gs_color_format format, enum gs_zstencil_format zsformat)
+{
+	RECORD();
+	gs_texture_render* rt = new gs_texture_render();
+	rt->format            = format;
+	rt->zsformat          = zsformat;
+	rt->target            = nullptr;
+	rt->rendered          = false;
+	live_handles++;
+	return rt;
+}
+
+void gs_texrender_destroy(gs_texrender_t* texrender)
+{
+	RECORD();
+	if (!texrender)
+		return;
+	delete texrender->target;
+	delete texrender;
+	live_handles--;
+}
+
+bool gs_texrender_begin(gs_texrender_t* texrender, uint32_t cx, uint32_t cy)
+{
+	RECORD();
+	if (!texrender || texrender->rendered || (cx == 0) || (cy == 0))
+		return false;
+
+	if (!texrender->target || (texrender->target->width != cx) || (texrender->target->height != cy)) {
+		delete texrender->target;
+		texrender->target = create_texture(GS_TEXTURE_2D, cx, cy, 1, texrender->format, 1, GS_RENDER_TARGET);
+	}
+
+	context_stack.push_back(context);
+	context.target   = texrender->target;
+	context.matrices = {{1, 1, 0, 0}};
+	context.viewport = {0, 0, int(cx), int(cy)};
+	return true;
+}
+
+void gs_texrender_end(gs_texrender_t* texrender)
+{
+	RECORD();
+	if (!texrender || context_stack.empty() || (context.target != texrender->target)) {
+		blog(LOG_ERROR, "gs_texrender_end: render target is not active");
+		return;
+	}
+	context = context_stack.back();
+	context_stack.pop_back();
+	texrender->rendered = true;
+}
+
+void gs_texrender_reset(gs_texrender_t* texrender)
+{
+	RECORD();
+	if (texrender)
+		texrender->rendered = false;
+}
+
+gs_texture_t* gs_texrender_get_texture(const gs_texrender_t* texrender)
+{
+	RECORD();
+	return texrender ? texrender->target : nullptr;
+}
+
+void gs_clear(uint32_t clear_flags, const struct vec4* color, float, uint8_t)
+{
+	RECORD();
+	if (!context.target || !(clear_flags & GS_CLEAR_COLOR))
+		return;
+	float_t value[4] = {color->x, color->y, color->z, color->w};
+	quantize(context.target->format, value);
+	for (size_t idx = 0; idx < context.target->pixels.size(); idx += 4)
+		memcpy(&context.target->pixels[idx], value, sizeof(value));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Samplers, Buffers
+////////////////////////////////////////////////////////////////////////////////
+
+gs_samplerstate_t* gs_samplerstate_create(const struct gs_sampler_info* info)
+{
+	RECORD();
+	gs_sampler_state* sampler = new gs_sampler_state();
+	sampler->info             = *info;
+	live_handles++;
+	return sampler;
+}
+
+void gs_samplerstate_destroy(gs_samplerstate_t* samplerstate)
+{
+	RECORD();
+	if (!samplerstate)
+		return;
+	delete samplerstate;
+	live_handles--;
+}
+
+// Copy the vertex data to the "GPU", only the attributes that had data at creation have a buffer.
+static bool upload_vertices(gs_vertex_buffer* vb, const gs_vb_data* data, const char* function)
+{
+	if (!data->points || (vb->has_normals && !data->normals) || (vb->has_tangents && !data->tangents)
+		|| (vb->has_colors && !data->colors) || (data->num_tex < vb->uv_widths.size())
+		|| (!vb->uv_widths.empty() && !data->tvarray)) {
+		blog(LOG_ERROR, "%s: attribute without data", function);
+		return false;
+	}
+
+	size_t num = data->num;
+	vb->points.resize(num * 4);
+	vb->uvs.assign(num * 4, 0.f);
+	memcpy(vb->points.data(), data->points, sizeof(vec3) * num);
+	for (size_t n = 0; n < vb->uv_widths.size(); n++) {
+		if (!data->tvarray[n].array) {
+			blog(LOG_ERROR, "%s: uv layer without data", function);
+			return false;
+		}
+		if (n == 0) {
+			const float_t* uvs = static_cast<const float_t*>(data->tvarray[0].array);
+			for (size_t idx = 0; idx < num; idx++) {
+				for (size_t c = 0; c < vb->uv_widths[0]; c++)
+					vb->uvs[idx * 4 + c] = uvs[idx * vb->uv_widths[0] + c];
+			}
+		}
+	}
+
+	uint64_t bytes = sizeof(vec3) * (1 + (vb->has_normals ? 1 : 0) + (vb->has_tangents ? 1 : 0))
+					 + (vb->has_colors ? sizeof(uint32_t) : 0);
+	for (size_t width : vb->uv_widths)
+		bytes += sizeof(float_t) * width;
+	vertex_bytes += bytes * num;
+	vb->num = num;
+	return true;
+}
+
+gs_vertbuffer_t* gs_vertexbuffer_create(struct gs_vb_data* data, uint32_t flags)
+{
+	RECORD();
+	if (!data || !data->num)
+		return nullptr;
+
+	gs_vertex_buffer* vb = new gs_vertex_buffer();
+	vb->data             = data;
+	vb->dynamic          = (flags & GS_DYNAMIC) != 0;
+	vb->has_normals      = data->normals != nullptr;
+	vb->has_tangents     = data->tangents != nullptr;
+	vb->has_colors       = data->colors != nullptr;
+	for (size_t n = 0; n < data->num_tex; n++)
+		vb->uv_widths.push_back(data->tvarray ? data->tvarray[n].width : 0);
+	if (!upload_vertices(vb, data, __func__)) {
+		delete vb;
+		return nullptr;
+	}
+	live_handles++;
+	return vb;
+}
+
+void gs_vertexbuffer_destroy(gs_vertbuffer_t* vertbuffer)
+{
+	RECORD();
+	if (!vertbuffer)
+		return;
+	if (loaded_vertex_buffer == vertbuffer)
+		loaded_vertex_buffer = nullptr;
+	gs_vbdata_destroy(vertbuffer->data);
+	delete vertbuffer;
+	live_handles--;
+}
+
+void gs_vertexbuffer_flush_direct(gs_vertbuffer_t* vertbuffer, const struct gs_vb_data* data)
+{
+	RECORD();
+	if (!vertbuffer->dynamic) {
+		blog(LOG_ERROR, "gs_vertexbuffer_flush: vertex buffer is not dynamic");
+		return;
+	}
+	upload_vertices(vertbuffer, data, __func__);
+}
+
+void gs_vertexbuffer_flush(gs_vertbuffer_t* vertbuffer)
+{
+	RECORD();
+	gs_vertexbuffer_flush_direct(vertbuffer, vertbuffer->data);
+}
+
+struct gs_vb_data* gs_vertexbuffer_get_data(const gs_vertbuffer_t* vertbuffer)
+{
+	RECORD();
+	return vertbuffer ? vertbuffer->data : nullptr;
+}
+
+void gs_load_vertexbuffer(gs_vertbuffer_t* vertbuffer)
+{
+	RECORD();
+	loaded_vertex_buffer = vertbuffer;
+}
+
+gs_indexbuffer_t* gs_indexbuffer_create(enum gs_index_type type, void* indices, size_t num, uint32_t flags)
+{
+	RECORD();
+	gs_index_buffer* ib = new gs_index_buffer();
+	ib->type            = type;
+	ib->indices         = indices;
+	ib->num             = num;
+	ib->flags           = flags;
+	live_handles++;
+	return ib;
+}
+
+void gs_indexbuffer_destroy(gs_indexbuffer_t* indexbuffer)
+{
+	RECORD();
+	if (!indexbuffer)
+		return;
+	delete indexbuffer;
+	live_handles--;
+}
+
+void gs_indexbuffer_flush(gs_indexbuffer_t*)
+{
+	RECORD();
+}
+
+void gs_load_indexbuffer(gs_indexbuffer_t*)
+{
+	RECORD();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Effects
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+	enum class token_type { Identifier, Number, String, Symbol, End };
+
+	struct token {
+		token_type  type;
+		std::string text;
+	};
+
+	// Splits effect code into tokens, dropping comments and preprocessor lines.
+	std::vector<token> tokenize(const char* code)
+	{
+		std::vector<token> tokens;
+		const char*        p = code;
+		while (*p) {
+			if (isspace(static_cast<unsigned char>(*p))) {
+				p++;
+			} else if ((p[0] == '/') && (p[1] == '/')) {
+				while (*p && (*p != '\n'))
+					p++;
+			} else if ((p[0] == '/') && (p[1] == '*')) {
+				const char* end = strstr(p + 2, "*/");
+				p               = end ? end + 2 : p + strlen(p);
+			} else if (*p == '#') {
+				while (*p && (*p != '\n'))
+					p++;
+			} else if (isalpha(static_cast<unsigned char>(*p)) || (*p == '_')) {
+				const char* start = p;
+				while (isalnum(static_cast<unsigned char>(*p)) || (*p == '_'))
+					p++;
+				tokens.push_back({token_type::Identifier, std::string(start, p)});
+			} else if (isdigit(static_cast<unsigned char>(*p)) || ((*p == '.') && isdigit(p[1]))) {
+				char*       end   = nullptr;
+				const char* start = p;
+				strtod(p, &end);
+				p = end;
+				while ((*p == 'f') || (*p == 'F') || (*p == 'u') || (*p == 'U'))
+					p++;
+				tokens.push_back({token_type::Number, std::string(start, const_cast<const char*>(end))});
+			} else if (*p == '"') {
+				const char* start = ++p;
+				while (*p && (*p != '"'))
+					p++;
+				tokens.push_back({token_type::String, std::string(start, p)});
+				if (*p)
+					p++;
+			} else {
+				tokens.push_back({token_type::Symbol, std::string(1, *p)});
+				p++;
+			}
+		}
+		tokens.push_back({token_type::End, ""});
+		return tokens;
+	}
+
+	gs_shader_param_type get_param_type(std::string const& type, size_t& elements)
+	{
+		static const std::map<std::string, std::pair<gs_shader_param_type, size_t>> types = {
+			{"bool", {GS_SHADER_PARAM_BOOL, 1}},       {"float", {GS_SHADER_PARAM_FLOAT, 1}},
+			{"float2", {GS_SHADER_PARAM_VEC2, 2}},     {"float3", {GS_SHADER_PARAM_VEC3, 3}},
+			{"float4", {GS_SHADER_PARAM_VEC4, 4}},     {"int", {GS_SHADER_PARAM_INT, 1}},
+			{"int2", {GS_SHADER_PARAM_INT2, 2}},       {"int3", {GS_SHADER_PARAM_INT3, 3}},
+			{"int4", {GS_SHADER_PARAM_INT4, 4}},       {"float4x4", {GS_SHADER_PARAM_MATRIX4X4, 16}},
+			{"string", {GS_SHADER_PARAM_STRING, 0}},   {"texture2d", {GS_SHADER_PARAM_TEXTURE, 0}},
+			{"texture3d", {GS_SHADER_PARAM_TEXTURE, 0}}, {"texture_cube", {GS_SHADER_PARAM_TEXTURE, 0}},
+			{"texture_rect", {GS_SHADER_PARAM_TEXTURE, 0}},
+		};
+		auto found = types.find(type);
+		if (found == types.end()) {
+			elements = 0;
+			return GS_SHADER_PARAM_UNKNOWN;
+		}
+		elements = found->second.second;
+		return found->second.first;
+	}
+
+	class parser {
+		std::vector<token> _tokens;
+		size_t             _pos;
+
+		public:
+		parser(const char* code) : _tokens(tokenize(code)), _pos(0) {}
+
+		token const& peek(size_t offset = 0)
+		{
+			return _tokens[std::min(_pos + offset, _tokens.size() - 1)];
+		}
+
+		token const& next()
+		{
+			token const& t = peek();
+			if (_pos < _tokens.size() - 1)
+				_pos++;
+			return t;
+		}
+
+		bool accept(const char* symbol)
+		{
+			if (peek().text != symbol)
+				return false;
+			next();
+			return true;
+		}
+
+		// Value after '=', up to but excluding the terminating ';' (or '>' in annotations).
+		std::vector<uint8_t> value(gs_shader_param_type type)
+		{
+			std::vector<uint8_t> bytes;
+			bool                 negate = false;
+			while ((peek().type != token_type::End) && (peek().text != ";")) {
+				token const& t = next();
+				if (t.type == token_type::String) {
+					bytes.insert(bytes.end(), t.text.begin(), t.text.end());
+					bytes.push_back(0);
+				} else if ((t.type == token_type::Number) || (t.text == "true") || (t.text == "false")) {
+					double v = (t.type == token_type::Number) ? strtod(t.text.c_str(), nullptr)
+															  : ((t.text == "true") ? 1. : 0.);
+					v        = negate ? -v : v;
+					if ((type == GS_SHADER_PARAM_BOOL) || (type == GS_SHADER_PARAM_INT)
+						|| (type == GS_SHADER_PARAM_INT2) || (type == GS_SHADER_PARAM_INT3)
+						|| (type == GS_SHADER_PARAM_INT4)) {
+						int32_t i = int32_t(v);
+						bytes.insert(bytes.end(), reinterpret_cast<uint8_t*>(&i), reinterpret_cast<uint8_t*>(&i) + 4);
+					} else {
+						float_t f = float_t(v);
+						bytes.insert(bytes.end(), reinterpret_cast<uint8_t*>(&f), reinterpret_cast<uint8_t*>(&f) + 4);
+					}
+				}
+				negate = (t.text == "-");
+			}
+			return bytes;
+		}
+
+		// "type name [N] <annotations> = value;" following 'uniform', or inside an annotation block.
+		std::unique_ptr<gs_effect_param> declaration(bool annotation)
+		{
+			auto   param = std::make_unique<gs_effect_param>();
+			size_t elements;
+			param->type        = get_param_type(next().text, elements);
+			param->name        = next().text;
+			param->array_count = 0;
+			param->texture     = nullptr;
+			param->sampler     = nullptr;
+			if (accept("[")) {
+				param->array_count = size_t(strtoull(next().text.c_str(), nullptr, 10));
+				accept("]");
+			}
+			if (!annotation && accept("<")) {
+				while ((peek().type != token_type::End) && !accept(">")) {
+					param->annotations.push_back(declaration(true));
+				}
+			}
+			if (accept("=")) {
+				param->default_value = value(param->type);
+			}
+			accept(";");
+			return param;
+		}
+
+		void parse(gs_effect* effect)
+		{
+			while (peek().type != token_type::End) {
+				if (accept("uniform")) {
+					effect->params.push_back(declaration(false));
+				} else if (accept("technique")) {
+					gs_effect_technique technique = {next().text, 0};
+					size_t              depth     = 0;
+					do {
+						token const& t = next();
+						if (t.text == "{")
+							depth++;
+						else if (t.text == "}")
+							depth--;
+						else if ((t.text == "pass") && (depth == 1))
+							technique.passes++;
+					} while ((depth > 0) && (peek().type != token_type::End));
+					effect->techniques.push_back(technique);
+				} else {
+					next();
+				}
+			}
+		}
+	};
+} // namespace
+
+gs_effect_t* gs_effect_create(const char* effect_string, const char* filename, char** error_string)
+{
+	RECORD();
+	if (!effect_string) {
+		if (error_string)
+			*error_string = bstrdup("no effect code");
+		return nullptr;
+	}
+
+	gs_effect* effect = new gs_effect();
+	effect->file      = filename ? filename : "";
+	effect->looping   = nullptr;
+	effect->pass      = 0;
+	effect->builtin   = false;
+	parser(effect_string).parse(effect);
+	if (effect->techniques.empty()) {
+		if (error_string)
+			*error_string = bstrdup(effect->file + ": no techniques");
+		delete effect;
+		return nullptr;
+	}
+	live_handles++;
+	return effect;
+}
+
+gs_effect_t* gs_effect_create_from_file(const char* file, char** error_string)
+{
+	RECORD();
+	std::ifstream stream(file, std::ios::binary);
+	if (!stream.is_open())
+		return nullptr;
+	std::stringstream buffer;
+	buffer << stream.rdbuf();
+	return gs_effect_create(buffer.str().c_str(), file, error_string);
+}
+
+void gs_effect_destroy(gs_effect_t* effect)
+{
+	RECORD();
+	if (!effect)
+		return;
+	if (active_effect == effect)
+		active_effect = nullptr;
+	delete effect;
+	live_handles--;
+}
+
+gs_effect_t* obs_get_base_effect(enum obs_base_effect)
+{
+	RECORD();
+	static std::unique_ptr<gs_effect> base;
+	if (!base) {
+		base.reset(gs_effect_create("uniform float4x4 ViewProj; uniform texture2d image;"
+									"technique Draw { pass { } }",
+									"default.effect", nullptr));
+		base->builtin = true;
+		live_handles--;
+		stub::register_shader("default.effect", "Draw", [](stub::shader_context const& ctx) {
+			stub::texture_view image = ctx.get_texture("image");
+			return [image](float_t u, float_t v, float_t out[4]) { image.sample(u, v, out); };
+		});
+	}
+	return base.get();
+}
+
+size_t gs_effect_get_num_params(const gs_effect_t* effect)
+{
+	RECORD();
+	return effect ? effect->params.size() : 0;
+}
+
+gs_eparam_t* gs_effect_get_param_by_idx(const gs_effect_t* effect, size_t param)
+{
+	RECORD();
+	return (effect && (param < effect->params.size())) ? effect->params[param].get() : nullptr;
+}
+
+gs_eparam_t* gs_effect_get_param_by_name(const gs_effect_t* effect, const char* name)
+{
+	RECORD();
+	if (!effect)
+		return nullptr;
+	for (auto const& param : effect->params) {
+		if (param->name == name)
+			return param.get();
+	}
+	return nullptr;
+}
+
+void gs_effect_get_param_info(const gs_eparam_t* param, struct gs_effect_param_info* info)
+{
+	RECORD();
+	info->name = param->name.c_str();
+	info->type = param->type;
+}
+
+size_t gs_param_get_num_annotations(const gs_eparam_t* param)
+{
+	RECORD();
+	return param ? param->annotations.size() : 0;
+}
+
+gs_eparam_t* gs_param_get_annotation_by_idx(const gs_eparam_t* param, size_t annotation)
+{
+	RECORD();
+	return (param && (annotation < param->annotations.size())) ? param->annotations[annotation].get() : nullptr;
+}
+
+gs_eparam_t* gs_param_get_annotation_by_name(const gs_eparam_t* param, const char* name)
+{
+	RECORD();
+	if (!param)
+		return nullptr;
+	for (auto const& annotation : param->annotations) {
+		if (annotation->name == name)
+			return annotation.get();
+	}
+	return nullptr;
+}
+
+bool gs_effect_loop(gs_effect_t* effect, const char* name)
+{
+	RECORD();
+	if (!effect)
+		return false;
+
+	if (effect->looping) {
+		if (++effect->pass < effect->looping->passes)
+			return true;
+		effect->looping = nullptr;
+		active_effect   = nullptr;
+		return false;
+	}
+
+	for (auto& technique : effect->techniques) {
+		if ((technique.name == name) && (technique.passes > 0)) {
+			effect->looping = &technique;
+			effect->pass    = 0;
+			active_effect   = effect;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void set_value(gs_eparam_t* param, const void* val, size_t size)
+{
+	if (!param)
+		return;
+	const uint8_t* bytes = static_cast<const uint8_t*>(val);
+	param->value.assign(bytes, bytes + size);
+}
+
+void gs_effect_set_bool(gs_eparam_t* param, bool val)
+{
+	RECORD();
+	int32_t v = val ? 1 : 0;
+	set_value(param, &v, sizeof(v));
+}
+
+void gs_effect_set_float(gs_eparam_t* param, float val)
+{
+	RECORD();
+	set_value(param, &val, sizeof(val));
+}
+
+void gs_effect_set_int(gs_eparam_t* param, int val)
+{
+	RECORD();
+	set_value(param, &val, sizeof(val));
+}
+
+void gs_effect_set_matrix4(gs_eparam_t* param, const struct matrix4* val)
+{
+	RECORD();
+	set_value(param, val, sizeof(matrix4));
+}
+
+void gs_effect_set_vec2(gs_eparam_t* param, const struct vec2* val)
+{
+	RECORD();
+	set_value(param, val, sizeof(float_t) * 2);
+}
+
+void gs_effect_set_vec3(gs_eparam_t* param, const struct vec3* val)
+{
+	RECORD();
+	set_value(param, val, sizeof(float_t) * 3);
+}
+
+void gs_effect_set_vec4(gs_eparam_t* param, const struct vec4* val)
+{
+	RECORD();
+	set_value(param, val, sizeof(float_t) * 4);
+}
+
+void gs_effect_set_texture(gs_eparam_t* param, gs_texture_t* val)
+{
+	RECORD();
+	if (param)
+		param->texture = val;
+}
+
+void gs_effect_set_val(gs_eparam_t* param, const void* val, size_t size)
+{
+	RECORD();
+	set_value(param, val, size);
+}
+
+void gs_effect_set_next_sampler(gs_eparam_t* param, gs_samplerstate_t* sampler)
+{
+	RECORD();
+	if (param)
+		param->sampler = sampler;
+}
+
+static void* copy_value(std::vector<uint8_t> const& value)
+{
+	if (value.empty())
+		return nullptr;
+	void* data = bmalloc(value.size());
+	memcpy(data, value.data(), value.size());
+	return data;
+}
+
+void* gs_effect_get_val(gs_eparam_t* param)
+{
+	RECORD();
+	return param ? copy_value(param->value) : nullptr;
+}
+
+size_t gs_effect_get_val_size(gs_eparam_t* param)
+{
+	RECORD();
+	return param ? param->value.size() : 0;
+}
+
+void* gs_effect_get_default_val(gs_eparam_t* param)
+{
+	RECORD();
+	return param ? copy_value(param->default_value) : nullptr;
+}
+
+size_t gs_effect_get_default_val_size(gs_eparam_t* param)
+{
+	RECORD();
+	return param ? param->default_value.size() : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Drawing
+////////////////////////////////////////////////////////////////////////////////
+
+static float_t blend_factor(gs_blend_type type, const float_t src[4], const float_t dst[4], size_t c)
+{
+	switch (type) {
+	case GS_BLEND_ZERO:
+		return 0.f;
+	case GS_BLEND_ONE:
+		return 1.f;
+	case GS_BLEND_SRCCOLOR:
+		return src[c];
+	case GS_BLEND_INVSRCCOLOR:
+		return 1.f - src[c];
+	case GS_BLEND_SRCALPHA:
+		return src[3];
+	case GS_BLEND_INVSRCALPHA:
+		return 1.f - src[3];
+	case GS_BLEND_DSTCOLOR:
+		return dst[c];
+	case GS_BLEND_INVDSTCOLOR:
+		return 1.f - dst[c];
+	case GS_BLEND_DSTALPHA:
+		return dst[3];
+	case GS_BLEND_INVDSTALPHA:
+		return 1.f - dst[3];
+	case GS_BLEND_SRCALPHASAT:
+		return (c == 3) ? 1.f : std::min(src[3], 1.f - dst[3]);
+	}
+	return 1.f;
+}
+
+static void write_pixel(gs_texture* target, size_t x, size_t y, float_t color[4])
+{
+	float_t* dst = &target->pixels[(y * target->width + x) * 4];
+	if (blending.enabled) {
+		float_t src[4] = {color[0], color[1], color[2], color[3]};
+		for (size_t c = 0; c < 4; c++) {
+			gs_blend_type sf = (c < 3) ? blending.src_c : blending.src_a;
+			gs_blend_type df = (c < 3) ? blending.dst_c : blending.dst_a;
+			color[c]         = src[c] * blend_factor(sf, src, dst, c) + dst[c] * blend_factor(df, src, dst, c);
+		}
+	}
+	for (size_t c = 0; c < 4; c++) {
+		if (!color_mask[c])
+			color[c] = dst[c];
+	}
+	quantize(target->format, color);
+	memcpy(dst, color, sizeof(float_t) * 4);
+}
+
+// Pixel shader of the technique that is currently looping, if it has a port.
+static stub::pixel_shader get_pixel_shader()
+{
+	if (!active_effect || !active_effect->looping)
+		return nullptr;
+	std::string const& file = active_effect->file;
+	for (auto const& entry : shaders) {
+		bool matches = (file.size() >= entry.effect.size())
+					   && (file.compare(file.size() - entry.effect.size(), entry.effect.size(), entry.effect) == 0);
+		if (matches && (entry.technique == active_effect->looping->name))
+			return entry.shader(stub::shader_context(active_effect));
+	}
+	return nullptr;
+}
+
+// World position to pixel position in the current render target.
+static void project(float_t x, float_t y, float_t& px, float_t& py)
+{
+	affine const& m = context.matrices.back();
+	x               = x * m.sx + m.tx;
+	y               = y * m.sy + m.ty;
+	px              = (x - context.ortho[0]) / (context.ortho[1] - context.ortho[0]) * float_t(context.target->width);
+	py              = (y - context.ortho[2]) / (context.ortho[3] - context.ortho[2]) * float_t(context.target->height);
+}
+
+// Run fn(y) for every row in [y0, y1), split over several threads for large areas.
+template<typename T>
+static void for_rows(size_t y0, size_t y1, size_t width, T fn)
+{
+	size_t threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	if (((y1 - y0) * width < PARALLEL_PIXELS) || (threads == 1)) {
+		for (size_t y = y0; y < y1; y++)
+			fn(y);
+		return;
+	}
+
+	std::vector<std::thread> workers;
+	std::atomic<size_t>      row = y0;
+	for (size_t n = 0; n < threads; n++) {
+		workers.emplace_back([&row, y1, &fn]() {
+			for (size_t y = row++; y < y1; y = row++)
+				fn(y);
+		});
+	}
+	for (auto& worker : workers)
+		worker.join();
+}
+
+void gs_draw_sprite(gs_texture_t* tex, uint32_t flip, uint32_t width, uint32_t height)
+{
+	RECORD();
+	if (!tex && (!width || !height)) {
+		blog(LOG_ERROR, "gs_draw_sprite: a sprite without a texture needs a size");
+		return;
+	}
+	if (!context.target)
+		return;
+	stub::pixel_shader shader = get_pixel_shader();
+	if (!shader)
+		return;
+
+	float_t w = float_t(width ? width : tex->width);
+	float_t h = float_t(height ? height : tex->height);
+	float_t x0, y0, x1, y1;
+	project(0, 0, x0, y0);
+	project(w, h, x1, y1);
+
+	size_t px0 = size_t(std::clamp<float_t>(ceil(std::min(x0, x1) - 0.5f), 0, float_t(context.target->width)));
+	size_t px1 = size_t(std::clamp<float_t>(ceil(std::max(x0, x1) - 0.5f), 0, float_t(context.target->width)));
+	size_t py0 = size_t(std::clamp<float_t>(ceil(std::min(y0, y1) - 0.5f), 0, float_t(context.target->height)));
+	size_t py1 = size_t(std::clamp<float_t>(ceil(std::max(y0, y1) - 0.5f), 0, float_t(context.target->height)));
+
+	gs_texture* target = context.target;
+	for_rows(py0, py1, px1 - px0, [&](size_t y) {
+		float_t v = ((float_t(y) + 0.5f) - y0) / (y1 - y0);
+		v         = (flip & GS_FLIP_V) ? 1.f - v : v;
+		for (size_t x = px0; x < px1; x++) {
+			float_t u = ((float_t(x) + 0.5f) - x0) / (x1 - x0);
+			u         = (flip & GS_FLIP_U) ? 1.f - u : u;
+			float_t color[4];
+			shader(u, v, color);
+			write_pixel(target, x, y, color);
+		}
+	});
+}
+
+// Rasterize one triangle with the top-left rule, so shared edges are shaded exactly once.
+static void draw_triangle(stub::pixel_shader const& shader, const float_t* p[3], const float_t* uv[3])
+{
+	float_t x[3], y[3];
+	for (size_t n = 0; n < 3; n++)
+		project(p[n][0], p[n][1], x[n], y[n]);
+
+	float_t area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area == 0.f)
+		return;
+	if (area < 0.f) {
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+		std::swap(uv[1], uv[2]);
+		area = -area;
+	}
+
+	gs_texture* target = context.target;
+	size_t      px0 = size_t(std::clamp<float_t>(floor(std::min({x[0], x[1], x[2]})), 0, float_t(target->width)));
+	size_t      px1 = size_t(std::clamp<float_t>(ceil(std::max({x[0], x[1], x[2]})), 0, float_t(target->width)));
+	size_t      py0 = size_t(std::clamp<float_t>(floor(std::min({y[0], y[1], y[2]})), 0, float_t(target->height)));
+	size_t      py1 = size_t(std::clamp<float_t>(ceil(std::max({y[0], y[1], y[2]})), 0, float_t(target->height)));
+
+	auto covers = [&](size_t a, size_t b, float_t cx, float_t cy, float_t& w) {
+		float_t ex = x[b] - x[a];
+		float_t ey = y[b] - y[a];
+		w          = ex * (cy - y[a]) - ey * (cx - x[a]);
+		if (w != 0.f)
+			return w > 0.f;
+		// Top edges (horizontal, going right) and left edges (going up) own the pixels on them.
+		return ((ey == 0.f) && (ex > 0.f)) || (ey < 0.f);
+	};
+
+	for_rows(py0, py1, px1 - px0, [&](size_t py) {
+		float_t cy = float_t(py) + 0.5f;
+		for (size_t px = px0; px < px1; px++) {
+			float_t cx = float_t(px) + 0.5f;
+			float_t w0, w1, w2;
+			if (!covers(1, 2, cx, cy, w0) || !covers(2, 0, cx, cy, w1) || !covers(0, 1, cx, cy, w2))
+				continue;
+			float_t u = (uv[0][0] * w0 + uv[1][0] * w1 + uv[2][0] * w2) / area;
+			float_t v = (uv[0][1] * w0 + uv[1][1] * w1 + uv[2][1] * w2) / area;
+			float_t color[4];
+			shader(u, v, color);
+			write_pixel(target, px, py, color);
+		}
+	});
+}
+
+void gs_draw(enum gs_draw_mode draw_mode, uint32_t start_vert, uint32_t num_verts)
+{
+	RECORD();
+	gs_vertex_buffer* vb = loaded_vertex_buffer;
+	if (!vb) {
+		blog(LOG_ERROR, "gs_draw: no vertex buffer loaded");
+		return;
+	}
+	if (num_verts == 0)
+		num_verts = uint32_t(vb->num);
+	if (size_t(start_vert) + num_verts > vb->num) {
+		blog(LOG_ERROR, "gs_draw: drawing past the end of the vertex buffer");
+		return;
+	}
+	if (!context.target || ((draw_mode != GS_TRIS) && (draw_mode != GS_TRISTRIP)))
+		return;
+	stub::pixel_shader shader = get_pixel_shader();
+	if (!shader)
+		return;
+
+	for (size_t n = 0; n + 2 < num_verts; n += (draw_mode == GS_TRIS) ? 3 : 1) {
+		const float_t* p[3];
+		const float_t* uv[3];
+		for (size_t k = 0; k < 3; k++) {
+			size_t idx = start_vert + n + k;
+			p[k]       = &vb->points[idx * 4];
+			uv[k]      = &vb->uvs[idx * 4];
+		}
+		draw_triangle(shader, p, uv);
+	}
+}
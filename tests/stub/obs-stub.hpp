@@ -0,0 +1,137 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <cinttypes>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+// OBS
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)
+#endif
+#include <graphics/graphics.h>
+#include <obs.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+/*!
+ * \brief Link-time stand-in for the parts of libobs used by the plugin code under test.
+ *
+ * Implements the gs_* and obs_* functions with their libobs signatures, so the plugin sources
+ *  link against this instead of libobs and run without a GPU. Every call is counted. Textures,
+ *  render targets and stage surfaces are backed by RGBA float images in system memory, writes
+ *  to them are quantized to the precision of their color format. Draw calls rasterize the
+ *  sprite or triangles and run a C++ port of the active effect technique per covered pixel,
+ *  registered with register_shader(). Techniques without a port draw nothing. Sources run the
+ *  callbacks of their registered obs_source_info, with settings, signals, scenes and audio
+ *  capture callbacks kept in memory; audio is pushed in and observed with the functions below.
+ */
+namespace stub {
+	// Bilinear view of a texture with clamped addressing, which is what the blur effects sample with.
+	class texture_view {
+		const float_t* _data;
+		uint32_t       _width;
+		uint32_t       _height;
+
+		public:
+		texture_view();
+		texture_view(gs_texture_t* texture);
+
+		bool     valid() const;
+		uint32_t get_width() const;
+		uint32_t get_height() const;
+
+		void sample(float_t u, float_t v, float_t out[4]) const;
+		void load(int64_t x, int64_t y, float_t out[4]) const;
+	};
+
+	// Effect state visible to a shader port for the duration of one draw call.
+	class shader_context {
+		gs_effect_t* _effect;
+
+		public:
+		shader_context(gs_effect_t* effect);
+
+		// Current value of a parameter (or its default), nullptr if the effect has no such parameter.
+		const void* get(const char* name, size_t* size = nullptr) const;
+
+		float_t        get_float(const char* name) const;
+		int32_t        get_int(const char* name) const;
+		const float_t* get_floats(const char* name) const;
+		texture_view   get_texture(const char* name) const;
+	};
+
+	// Runs for every covered pixel with the interpolated texture coordinate, writes the RGBA result.
+	typedef std::function<void(float_t u, float_t v, float_t out[4])> pixel_shader;
+
+	// Called once per draw call to set up the pixel shader from the current parameters.
+	typedef std::function<pixel_shader(shader_context const& ctx)> shader;
+
+	/*!
+	 * \brief Port a technique of an effect file to C++.
+	 *
+	 * \param effect Path of the effect file relative to the data directory, e.g. "effects/mipgen.effect".
+	 * \param technique Name of the technique.
+	 */
+	void register_shader(std::string effect, std::string technique, ::stub::shader shader);
+
+	// Directory obs_module_file() resolves files against.
+	void set_data_path(std::string path);
+
+	// Number of calls to a libobs function since the last reset_calls().
+	uint64_t get_calls(std::string const& function);
+	void     reset_calls();
+
+	// Graphics objects and sources created through the stub and not destroyed yet, excluding the base effects.
+	int64_t get_live_handles();
+
+	// Memory allocated with bmalloc() and not freed yet.
+	int64_t get_live_allocations();
+
+	// How often obs_enter_graphics() was called more often than obs_leave_graphics().
+	int64_t get_graphics_depth();
+
+	// Bytes copied into vertex buffers by gs_vertexbuffer_create() and gs_vertexbuffer_flush().
+	uint64_t get_vertex_bytes_uploaded();
+
+	// Advance the time returned by obs_get_video_frame_time() by one frame at 60 fps.
+	void next_frame();
+
+	// Copy the first layer of a texture as RGBA floats, row by row.
+	std::vector<float_t> read_texture(gs_texture_t* texture);
+
+	// Fill the first layer of a texture from RGBA floats, quantized to its color format.
+	void write_texture(gs_texture_t* texture, std::vector<float_t> const& rgba);
+
+	// Sample rate and speaker layout audio_output_get_info() reports, 48 kHz stereo until changed. The format is always
+	//  planar float.
+	void set_audio_info(uint32_t samples_per_sec, speaker_layout speakers);
+
+	// Called for every obs_source_output_audio(), on whichever thread the plugin outputs audio from.
+	typedef std::function<void(obs_source_t* source, const obs_source_audio* audio)> audio_output_callback;
+	void set_audio_output_callback(::stub::audio_output_callback callback);
+
+	// Hand audio to the capture callbacks of a source, like the libobs audio thread does for every packet.
+	void push_audio(obs_source_t* source, audio_data const& audio, bool muted = false);
+} // namespace stub
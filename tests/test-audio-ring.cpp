@@ -0,0 +1,181 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+// Stresses util::audio_ring with one producer and one consumer thread that both stall at random, like the libobs
+//  audio thread and the mirror source's output thread do.
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include "test-common.hpp"
+#include "util-audio-ring.hpp"
+
+#define PLANES 2
+#define FRAMES 64
+
+// Predictable content, so the consumer can tell a torn or stale packet from the one it expects.
+static inline float_t sample_value(uint64_t sequence, size_t plane, size_t frame)
+{
+	return float_t((sequence * 7 + plane * 131 + frame) & 0xFFFF);
+}
+
+// Either keep going, yield, spin for a little while, or sleep for up to 200 microseconds.
+static void jitter(std::mt19937& rng)
+{
+	uint32_t roll = rng() % 1000;
+	if (roll < 900)
+		return;
+	if (roll < 960) {
+		std::this_thread::yield();
+	} else if (roll < 995) {
+		for (volatile uint32_t spin = rng() % 2000; spin > 0; spin--) {
+		}
+	} else {
+		std::this_thread::sleep_for(std::chrono::microseconds(rng() % 200));
+	}
+}
+
+static void test_single_thread()
+{
+	util::audio_ring ring(5, PLANES, FRAMES);
+	CHECK(ring.get_capacity() == 8);
+	CHECK(ring.begin_read() == nullptr);
+
+	for (uint64_t n = 0; n < 8; n++) {
+		auto packet = ring.begin_write();
+		if (!CHECK(packet != nullptr))
+			return;
+		packet->timestamp = n;
+		ring.end_write();
+	}
+	CHECK(ring.size() == 8);
+	CHECK(ring.begin_write() == nullptr);
+	CHECK(ring.get_dropped() == 1);
+
+	// Slots are reused in order once read.
+	for (uint64_t n = 0; n < 3; n++) {
+		auto packet = ring.begin_read();
+		CHECK(packet && (packet->timestamp == n));
+		ring.end_read();
+	}
+	CHECK(ring.size() == 5);
+	for (uint64_t n = 8; n < 11; n++) {
+		auto packet = ring.begin_write();
+		if (!CHECK(packet != nullptr))
+			return;
+		packet->timestamp = n;
+		ring.end_write();
+	}
+	for (uint64_t n = 3; n < 11; n++) {
+		auto packet = ring.begin_read();
+		CHECK(packet && (packet->timestamp == n));
+		ring.end_read();
+	}
+	CHECK(ring.size() == 0);
+	CHECK(ring.get_dropped() == 1);
+}
+
+static void test_stress(uint64_t count)
+{
+	util::audio_ring  ring(16, PLANES, FRAMES);
+	std::atomic<bool> done{false};
+	uint64_t          refused  = 0;
+	uint64_t          received = 0, skipped = 0, corrupted = 0, reordered = 0, expected = 0;
+	auto              start    = std::chrono::high_resolution_clock::now();
+
+	std::thread producer([&]() {
+		std::mt19937 rng(1);
+		for (uint64_t sequence = 0; sequence < count; sequence++) {
+			jitter(rng);
+
+			auto packet = ring.begin_write();
+			if (!packet) {
+				refused++;
+				continue;
+			}
+			packet->timestamp = sequence;
+			packet->frames    = 1 + rng() % FRAMES;
+			packet->planes    = PLANES;
+			for (size_t plane = 0; plane < PLANES; plane++) {
+				float_t* data = ring.get_plane(packet, plane);
+				for (size_t frame = 0; frame < packet->frames; frame++)
+					data[frame] = sample_value(sequence, plane, frame);
+			}
+			ring.end_write();
+		}
+		done.store(true, std::memory_order_release);
+	});
+
+	std::thread consumer([&]() {
+		std::mt19937 rng(2);
+		while (true) {
+			jitter(rng);
+
+			auto packet = ring.begin_read();
+			if (!packet) {
+				// Everything written before done was set is visible by now, so one more empty read means the end.
+				if (done.load(std::memory_order_acquire) && !ring.begin_read())
+					break;
+				continue;
+			}
+
+			if (packet->timestamp < expected)
+				reordered++;
+			skipped += packet->timestamp - std::min(packet->timestamp, expected);
+			expected = packet->timestamp + 1;
+
+			bool intact = (packet->planes == PLANES) && (packet->frames >= 1) && (packet->frames <= FRAMES);
+			for (size_t plane = 0; intact && (plane < packet->planes); plane++) {
+				float_t* data = ring.get_plane(packet, plane);
+				for (size_t frame = 0; frame < packet->frames; frame++)
+					intact = intact && (data[frame] == sample_value(packet->timestamp, plane, frame));
+			}
+			corrupted += intact ? 0 : 1;
+			received++;
+			ring.end_read();
+		}
+	});
+
+	producer.join();
+	consumer.join();
+	skipped += count - expected;
+	double_t time = std::chrono::duration<double_t>(std::chrono::high_resolution_clock::now() - start).count();
+
+	// Every packet arrives intact and in order, or is refused by the producer and counted as a drop.
+	CHECK(corrupted == 0);
+	CHECK(reordered == 0);
+	CHECK(received + refused == count);
+	CHECK(skipped == refused);
+	CHECK(ring.get_dropped() == refused);
+	CHECK(ring.size() == 0);
+
+	printf("%" PRIu64 " packets in %.3f s (%.0f packets/s), %" PRIu64 " dropped\n", count, time, count / time,
+		   refused);
+}
+
+int main(int argc, const char* argv[])
+{
+	uint64_t count = test::is_quick(argc, argv) ? 200000 : 5000000;
+
+	test::frame("single_thread", test_single_thread);
+	test::frame("stress", [count]() { test_stress(count); });
+
+	return test::failures;
+}
@@ -0,0 +1,163 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+// Measures how far the downsample pyramid of large Gaussian Area blurs strays from a full resolution Gaussian with
+//  the same standard deviation, and what each of them costs on the CPU backend.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include "gfx/blur/gfx-blur-cpu.hpp"
+#include "test-common.hpp"
+
+struct test_image {
+	const char* name;
+	// Width of the flat border in 1/8ths of the image width.
+	uint32_t border;
+	// Largest error in 1/255 steps and smallest PSNR in dB the pyramid may have at any size.
+	double_t max_error;
+	double_t min_psnr;
+};
+
+// Clamped addressing repeats the outermost texel, which in the pyramid is the average of 2^levels input texels
+//  instead of a single one. Detail along the edges of the frame thus shows up in the whole frame, while a flat
+//  border at least 2^levels texels wide leaves only the error of the pyramid itself.
+static const test_image images[] = {
+	{"detail", 0, 48., 26.},
+	{"border", 1, .25, 80.},
+};
+
+static const double_t sizes[] = {500., 750., 1024.};
+
+// Fills everything but a flat gray border of the given width with a checker board, gradients and noise.
+static std::shared_ptr<::gfx::blur::cpu_image> make_test_image(uint32_t width, uint32_t height, uint32_t border)
+{
+	auto     image = std::make_shared<::gfx::blur::cpu_image>(width, height);
+	uint32_t seed  = 0x2545F491;
+	for (uint32_t y = 0; y < height; y++) {
+		for (uint32_t x = 0; x < width; x++) {
+			float_t* px = image->at(x, y);
+			seed        = seed * 1664525 + 1013904223;
+			px[0]       = (((x / 8) + (y / 8)) % 2) ? 1.f : 0.f;
+			px[1]       = float_t(x) / float_t(width - 1);
+			px[2]       = float_t(y) / float_t(height - 1);
+			px[3]       = float_t(seed >> 24) / 255.f;
+			if ((x < border) || (y < border) || (x >= width - border) || (y >= height - border))
+				std::fill_n(px, 4, 0.5f);
+		}
+	}
+	return image;
+}
+
+struct difference {
+	double_t max_error  = 0.;
+	double_t mean_error = 0.;
+	double_t psnr       = INFINITY;
+};
+
+// Compares the texels of the rectangle [x0, x1) x [y0, y1), with errors in 1/255 steps.
+static difference compare(std::shared_ptr<::gfx::blur::cpu_image> actual,
+						  std::shared_ptr<::gfx::blur::cpu_image> expected, uint32_t x0, uint32_t y0, uint32_t x1,
+						  uint32_t y1)
+{
+	difference result;
+	double_t   total = 0., square = 0.;
+	size_t     count = size_t(x1 - x0) * (y1 - y0) * 4;
+	for (uint32_t y = y0; y < y1; y++) {
+		for (uint32_t x = x0; x < x1; x++) {
+			for (size_t c = 0; c < 4; c++) {
+				double_t error   = std::fabs(double_t(actual->at(x, y)[c]) - double_t(expected->at(x, y)[c]));
+				result.max_error = std::max(result.max_error, error * 255.);
+				total += error * 255.;
+				square += error * error;
+			}
+		}
+	}
+	result.mean_error = total / double_t(count);
+	if (square > 0.)
+		result.psnr = 10. * log10(double_t(count) / square);
+	return result;
+}
+
+static difference compare(std::shared_ptr<::gfx::blur::cpu_image> actual,
+						  std::shared_ptr<::gfx::blur::cpu_image> expected)
+{
+	return compare(actual, expected, 0, 0, actual->get_width(), actual->get_height());
+}
+
+// Below the pyramid both paths must blur with the same kernel.
+static void test_small(std::shared_ptr<::gfx::blur::cpu_image> image)
+{
+	::gfx::blur::cpu blur(::gfx::blur::cpu_algorithm::Gaussian, ::gfx::blur::type::Area);
+	blur.set_input(image);
+	blur.set_step_scale(1., 1.);
+	for (double_t size : {15., 64., 127.}) {
+		blur.set_size(size);
+		difference diff = compare(blur.render_image(), blur.render_exact());
+		if (!CHECK(diff.max_error < 0.01))
+			fprintf(stderr, "size %.0f: render_exact() differs by %.4f/255\n", size, diff.max_error);
+	}
+}
+
+static void test_large(uint32_t width, uint32_t height, bool quick)
+{
+	::gfx::blur::cpu blur(::gfx::blur::cpu_algorithm::Gaussian, ::gfx::blur::type::Area);
+	blur.set_step_scale(1., 1.);
+
+	printf("%-8s %6s %10s %10s %10s %15s %12s %12s\n", "image", "size", "max /255", "mean /255", "PSNR dB",
+		   "center max /255", "pyramid ms", "exact ms");
+	for (test_image const& entry : images) {
+		blur.set_input(make_test_image(width, height, width * entry.border / 8));
+		for (double_t size : sizes) {
+			if (quick && (size > 500.))
+				continue;
+			blur.set_size(size);
+
+			std::shared_ptr<::gfx::blur::cpu_image> pyramid, exact;
+			double_t pyramid_time = test::measure(quick ? 1 : 3, [&]() { pyramid = blur.render_image(); });
+			double_t exact_time   = test::measure(1, [&]() { exact = blur.render_exact(); });
+
+			difference frame  = compare(pyramid, exact);
+			difference center = compare(pyramid, exact, width / 4, height / 4, width * 3 / 4, height * 3 / 4);
+			CHECK(frame.max_error < entry.max_error);
+			CHECK(frame.psnr > entry.min_psnr);
+			printf("%-8s %6.0f %10.3f %10.3f %10.2f %15.3f %12.3f %12.3f\n", entry.name, size, frame.max_error,
+				   frame.mean_error, frame.psnr, center.max_error, pyramid_time * 1000., exact_time * 1000.);
+		}
+	}
+}
+
+int main(int argc, const char* argv[])
+{
+	bool     quick  = test::is_quick(argc, argv);
+	uint32_t width  = quick ? 256 : 512;
+	uint32_t height = quick ? 144 : 288;
+
+	auto image = make_test_image(width, height, 0);
+
+	::gfx::blur::cpu box(::gfx::blur::cpu_algorithm::Box, ::gfx::blur::type::Area);
+	box.set_input(image);
+	CHECK_THROWS(std::logic_error, box.render_exact());
+
+	test::frame("small", [image]() { test_small(image); });
+	test::frame("large", [width, height, quick]() { test_large(width, height, quick); });
+
+	return test::failures;
+}
@@ -0,0 +1,189 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+// Measures what the "Processing Scale" of the blur filter costs in quality and gains in speed: the input is reduced
+//  with gfx::downsampler, blurred on the CPU backend at the reduced size and scaled back up bilinearly, then compared
+//  with the same blur at full scale.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "gfx/blur/gfx-blur-cpu.hpp"
+#include "gfx/blur/gfx-blur-gaussian-kernel.hpp"
+#include "gfx/gfx-downsampler.hpp"
+#include "obs/gs/gs-helper.hpp"
+#include "test-common.hpp"
+
+struct blur_scale {
+	double_t scale;
+	// Smallest PSNR in dB against full scale, for each entry of sizes.
+	double_t min_psnr[3];
+};
+
+static const double_t sizes[] = {4., 16., 64.};
+
+static const blur_scale scales[] = {
+	{1., {0., 0., 0.}},
+	{.5, {34., 54., 41.}},
+	{.25, {26., 38., 39.}},
+};
+
+// Random rectangles over noise, with a band of 2px checker board that no reduced scale can hold.
+static std::vector<uint8_t> make_test_image(uint32_t width, uint32_t height)
+{
+	std::vector<uint8_t> pixels(size_t(width) * height * 4);
+	uint32_t             seed = 0x2545F491;
+	auto                 next = [&seed]() {
+		seed = seed * 1664525 + 1013904223;
+		return seed >> 8;
+	};
+
+	for (size_t idx = 0; idx < pixels.size(); idx++)
+		pixels[idx] = uint8_t(next() % 32);
+	for (size_t rect = 0; rect < 64; rect++) {
+		uint32_t x0 = next() % width, x1 = std::min(x0 + 1 + next() % (width / 4), width);
+		uint32_t y0 = next() % height, y1 = std::min(y0 + 1 + next() % (height / 4), height);
+		uint8_t  color[4] = {uint8_t(next()), uint8_t(next()), uint8_t(next()), 255};
+		for (uint32_t y = y0; y < y1; y++)
+			for (uint32_t x = x0; x < x1; x++)
+				std::copy_n(color, 4, &pixels[(size_t(y) * width + x) * 4]);
+	}
+	for (uint32_t y = height * 3 / 8; y < height * 5 / 8; y++)
+		for (uint32_t x = 0; x < width; x++)
+			std::fill_n(&pixels[(size_t(y) * width + x) * 4], 3, (((x / 2) + (y / 2)) % 2) ? 255 : 0);
+	return pixels;
+}
+
+static std::shared_ptr<::gfx::blur::cpu_image> to_image(std::vector<float_t> const& rgba, uint32_t width,
+														 uint32_t height)
+{
+	auto image = std::make_shared<::gfx::blur::cpu_image>(width, height);
+	std::copy(rgba.begin(), rgba.end(), image->get_data());
+	return image;
+}
+
+// Bilinear resize, as the sampler of the final draw of the filter does it.
+static std::shared_ptr<::gfx::blur::cpu_image> resize(std::shared_ptr<::gfx::blur::cpu_image> image, uint32_t width,
+													   uint32_t height)
+{
+	auto output = std::make_shared<::gfx::blur::cpu_image>(width, height);
+	for (uint32_t y = 0; y < height; y++) {
+		for (uint32_t x = 0; x < width; x++) {
+			image->sample((float_t(x) + .5f) / float_t(width), (float_t(y) + .5f) / float_t(height), output->at(x, y));
+		}
+	}
+	return output;
+}
+
+// Compares the texels of the rectangle [x0, x1) x [y0, y1).
+static double_t psnr(std::shared_ptr<::gfx::blur::cpu_image> actual, std::shared_ptr<::gfx::blur::cpu_image> expected,
+					 uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+	size_t   count  = size_t(x1 - x0) * (y1 - y0) * 4;
+	double_t square = 0.;
+	for (uint32_t y = y0; y < y1; y++) {
+		for (uint32_t x = x0; x < x1; x++) {
+			for (size_t c = 0; c < 4; c++) {
+				double_t error = double_t(actual->at(x, y)[c]) - double_t(expected->at(x, y)[c]);
+				square += error * error;
+			}
+		}
+	}
+	return (square > 0.) ? 10. * log10(double_t(count) / square) : INFINITY;
+}
+
+static double_t psnr(std::shared_ptr<::gfx::blur::cpu_image> actual, std::shared_ptr<::gfx::blur::cpu_image> expected)
+{
+	return psnr(actual, expected, 0, 0, actual->get_width(), actual->get_height());
+}
+
+static void test_scales(uint32_t width, uint32_t height, size_t runs)
+{
+	auto gctx = gs::context();
+
+	std::vector<uint8_t> pixels = make_test_image(width, height);
+	const uint8_t*       mips[] = {pixels.data()};
+
+	auto input = std::make_shared<gs::texture>(width, height, GS_RGBA, 1, mips, gs::texture::flags::None);
+	auto image = to_image(stub::read_texture(input->get_object()), width, height);
+
+	::gfx::downsampler downsampler;
+	::gfx::blur::cpu   blur(::gfx::blur::cpu_algorithm::Gaussian, ::gfx::blur::type::Area);
+	blur.set_step_scale(1., 1.);
+
+	printf("%6s %6s %10s %10s %10s %14s %14s\n", "size", "scale", "blur ms", "rel. cost", "PSNR dB", "center PSNR dB",
+		   "bilinear dB");
+	for (size_t size_idx = 0; size_idx < sizeof(sizes) / sizeof(sizes[0]); size_idx++) {
+		std::shared_ptr<::gfx::blur::cpu_image> reference;
+		double_t                                reference_time = 0.;
+		for (blur_scale const& entry : scales) {
+			// Sizes as filter::blur::blur_instance sets them up for the Gaussian engine.
+			uint32_t reduced_width  = std::max(uint32_t(width * entry.scale), 1u);
+			uint32_t reduced_height = std::max(uint32_t(height * entry.scale), 1u);
+			blur.set_size(::gfx::blur::gaussian_kernel_table::get_scaled_width(sizes[size_idx], entry.scale));
+
+			auto reduced = to_image(stub::read_texture(downsampler.render(input, reduced_width, reduced_height)
+														   ->get_object()),
+									reduced_width, reduced_height);
+			blur.set_input(reduced);
+
+			// Only the blur is timed. The filter upscales in the sampler of its final draw, and the downsampling
+			//  only runs emulated here.
+			std::shared_ptr<::gfx::blur::cpu_image> result;
+			double_t                                time = test::measure(runs, [&]() { result = blur.render_image(); });
+			if (entry.scale >= 1.) {
+				reference      = result;
+				reference_time = time;
+				printf("%6.0f %6.2f %10.3f %10.2f %10s %14s %14s\n", sizes[size_idx], entry.scale, time * 1000., 1.,
+					   "ref", "", "");
+				continue;
+			}
+			result = resize(result, width, height);
+
+			// The same blur of a single bilinear tap per reduced texel, which is all a plain resize would give. Stored
+			//  in 8 bits like the render targets of the downsampler.
+			auto single = resize(image, reduced_width, reduced_height);
+			for (size_t idx = 0; idx < size_t(reduced_width) * reduced_height * 4; idx++)
+				single->get_data()[idx] = std::round(single->get_data()[idx] * 255.f) / 255.f;
+			blur.set_input(single);
+			double_t bilinear = psnr(resize(blur.render_image(), width, height), reference);
+
+			double_t quality = psnr(result, reference);
+			double_t center  = psnr(result, reference, width / 4, height / 4, width * 3 / 4, height * 3 / 4);
+			CHECK(quality > entry.min_psnr[size_idx]);
+			CHECK(time < reference_time);
+			CHECK(quality >= bilinear - .01);
+			printf("%6.0f %6.2f %10.3f %10.2f %10.2f %14.2f %14.2f\n", sizes[size_idx], entry.scale, time * 1000.,
+				   time / reference_time, quality, center, bilinear);
+		}
+	}
+}
+
+int main(int argc, const char* argv[])
+{
+	bool     quick  = test::is_quick(argc, argv);
+	uint32_t width  = quick ? 480 : 1920;
+	uint32_t height = quick ? 270 : 1080;
+	size_t   runs   = quick ? 1 : 3;
+
+	test::frame("scales", [width, height, runs]() { test_scales(width, height, runs); });
+
+	return test::failures;
+}
@@ -0,0 +1,114 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+// Area blurs of the CPU backend at every SIMD level the machine supports, checked against the scalar path and timed
+//  at 1080p and 4K.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+#include "gfx/blur/gfx-blur-cpu-simd.hpp"
+#include "gfx/blur/gfx-blur-cpu.hpp"
+#include "test-common.hpp"
+
+struct resolution {
+	uint32_t width;
+	uint32_t height;
+};
+
+int main(int argc, const char* argv[])
+{
+	bool quick = test::is_quick(argc, argv);
+	// Quick runs only check that every level agrees with the scalar path, on an image that is not a multiple of any
+	//  vector width.
+	std::vector<resolution> resolutions = quick ? std::vector<resolution>{{483, 271}}
+												: std::vector<resolution>{{1920, 1080}, {3840, 2160}};
+	std::vector<double_t>   sizes       = quick ? std::vector<double_t>{3, 16} : std::vector<double_t>{4, 16, 64};
+	size_t                  runs        = quick ? 1 : 3;
+
+	std::vector<::gfx::blur::cpu_algorithm> algorithms = {
+		::gfx::blur::cpu_algorithm::Box,
+		::gfx::blur::cpu_algorithm::BoxLinear,
+		::gfx::blur::cpu_algorithm::Gaussian,
+		::gfx::blur::cpu_algorithm::GaussianLinear,
+	};
+	const char* algorithm_names[] = {"box", "box-linear", "gaussian", "gaussian-linear"};
+
+	::gfx::blur::simd::level supported = ::gfx::blur::simd::get_supported_level();
+	printf("Supported: %s\n", ::gfx::blur::simd::get_level_name(supported));
+
+	for (auto const& res : resolutions) {
+		auto     image = std::make_shared<::gfx::blur::cpu_image>(res.width, res.height);
+		uint32_t seed  = 0x2545F491;
+		for (size_t idx = 0; idx < size_t(res.width) * res.height * 4; idx++) {
+			seed                   = seed * 1664525 + 1013904223;
+			image->get_data()[idx] = float_t(seed >> 8) / float_t(1 << 24);
+		}
+		double_t mpix = double_t(res.width) * res.height / 1000000.;
+
+		printf("\n%-18s", (std::to_string(res.width) + "x" + std::to_string(res.height) + ", Mpix/s").c_str());
+		for (uint8_t level = 0; level <= uint8_t(supported); level++)
+			printf(" %10s", ::gfx::blur::simd::get_level_name(::gfx::blur::simd::level(level)));
+		printf(" %10s\n", "speedup");
+
+		for (size_t alg = 0; alg < algorithms.size(); alg++) {
+			for (double_t size : sizes) {
+				auto blur = std::static_pointer_cast<::gfx::blur::cpu>(
+					::gfx::blur::cpu_factory::get(algorithms[alg]).create(::gfx::blur::type::Area));
+				blur->set_size(size);
+				blur->set_step_scale(1., 1.);
+				blur->set_input(image);
+
+				std::vector<float_t>  reference;
+				std::vector<double_t> times;
+				for (uint8_t level = 0; level <= uint8_t(supported); level++) {
+					::gfx::blur::simd::set_level(::gfx::blur::simd::level(level));
+					std::shared_ptr<::gfx::blur::cpu_image> output;
+					times.push_back(test::measure(runs, [&]() { output = blur->render_image(); }));
+
+					float_t* data  = output->get_data();
+					size_t   count = size_t(res.width) * res.height * 4;
+					if (level == 0) {
+						reference.assign(data, data + count);
+						continue;
+					}
+
+					// The vectorized sums add the taps in the same order, only the compiler's rounding may differ.
+					float_t error = 0.f;
+					for (size_t idx = 0; idx < count; idx++)
+						error = std::max(error, std::fabs(data[idx] - reference[idx]));
+					if (!CHECK(error <= 1e-6f))
+						fprintf(stderr, "%s/%d at %s differs from Scalar by %g\n", algorithm_names[alg], int(size),
+								::gfx::blur::simd::get_level_name(::gfx::blur::simd::level(level)), error);
+				}
+
+				std::string name = std::string(algorithm_names[alg]) + "/" + std::to_string(int(size));
+				printf("%-18s", name.c_str());
+				for (double_t time : times)
+					printf(" %10.2f", mpix / time);
+				printf(" %9.2fx\n", times.front() / times.back());
+			}
+		}
+	}
+	::gfx::blur::simd::set_level(supported);
+
+	return test::failures;
+}
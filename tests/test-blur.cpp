@@ -0,0 +1,379 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+// Renders every GPU blur engine through C++ ports of its effects and compares the result against the CPU backend,
+//  then reports the throughput of both per algorithm, size and type.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+#include "gfx/blur/gfx-blur-box-linear.hpp"
+#include "gfx/blur/gfx-blur-box.hpp"
+#include "gfx/blur/gfx-blur-cpu.hpp"
+#include "gfx/blur/gfx-blur-dual-filtering.hpp"
+#include "gfx/blur/gfx-blur-gaussian-linear.hpp"
+#include "gfx/blur/gfx-blur-gaussian.hpp"
+#include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-texture.hpp"
+#include "test-common.hpp"
+
+// Same limits as the blur effects.
+#define MAX_BLUR_SIZE 128
+#define MAX_KERNEL_SIZE 128
+
+struct blur_engine {
+	const char*                name;
+	::gfx::blur::ifactory&     factory;
+	::gfx::blur::cpu_algorithm algorithm;
+	// Largest difference to the CPU result per channel. The engines store every intermediate pass in GS_RGBA, so
+	//  each pass may add up to half a step of 8-bit quantization, more so with the downsampled pyramid of large
+	//  gaussian blurs. Dual filtering works in GS_RGBA32F instead.
+	float_t             tolerance;
+	std::vector<double> sizes;
+	std::vector<double> quick_sizes;
+};
+
+struct blur_result {
+	std::string name;
+	double_t    cpu;
+	double_t    emulated;
+	float_t     error;
+};
+
+static const char* type_names[] = {"area", "directional", "rotational", "zoom"};
+
+static inline void add_sample(stub::texture_view const& image, float_t u, float_t v, float_t weight, float_t out[4])
+{
+	float_t px[4];
+	image.sample(u, v, px);
+	for (size_t c = 0; c < 4; c++)
+		out[c] += px[c] * weight;
+}
+
+static inline void rotate_around(float_t u, float_t v, float_t cu, float_t cv, float_t angle, float_t& ou, float_t& ov)
+{
+	float_t cp = cos(angle);
+	float_t sp = sin(angle);
+	ou         = ((u - cu) * cp) + ((v - cv) * -sp) + cu;
+	ov         = ((u - cu) * sp) + ((v - cv) * cp) + cv;
+}
+
+/*!
+ * \brief Port the Draw, Rotate and Zoom techniques shared by box.effect and gaussian.effect.
+ *
+ * The effects only differ in the weight of each tap, which is one for box.effect and read from pKernel for
+ *  gaussian.effect, and in the final scale, which is pSizeInverseMul for box.effect.
+ */
+static void register_kernel_effect(std::string file, bool has_kernel)
+{
+	struct parameters {
+		stub::texture_view   image;
+		float_t              texel[2];
+		float_t              step_scale[2];
+		float_t              size;
+		float_t              scale;
+		float_t              angle;
+		float_t              center[2];
+		std::vector<float_t> kernel;
+
+		parameters(stub::shader_context const& ctx, bool has_kernel)
+			: image(ctx.get_texture("pImage")), size(ctx.get_float("pSize")), angle(ctx.get_float("pAngle")),
+			  kernel(MAX_KERNEL_SIZE + 1, 1.f)
+		{
+			memcpy(texel, ctx.get_floats("pImageTexel"), sizeof(texel));
+			memcpy(step_scale, ctx.get_floats("pStepScale"), sizeof(step_scale));
+			memcpy(center, ctx.get_floats("pCenter"), sizeof(center));
+			scale = has_kernel ? 1.f : ctx.get_float("pSizeInverseMul");
+			if (has_kernel) {
+				// Reads past the end of pKernel are zero, like an out of bounds constant buffer access.
+				memcpy(kernel.data(), ctx.get_floats("pKernel"), sizeof(float_t) * MAX_KERNEL_SIZE);
+				kernel[MAX_KERNEL_SIZE] = 0.f;
+			}
+		}
+	};
+
+	stub::register_shader(file, "Draw", [has_kernel](stub::shader_context const& ctx) {
+		parameters p(ctx, has_kernel);
+		return [p](float_t u, float_t v, float_t out[4]) {
+			out[0] = out[1] = out[2] = out[3] = 0.f;
+			add_sample(p.image, u, v, p.kernel[0], out);
+			for (int32_t n = 1; n <= MAX_BLUR_SIZE; n++) {
+				float_t su = p.texel[0] * p.step_scale[0] * n;
+				float_t sv = p.texel[1] * p.step_scale[1] * n;
+				add_sample(p.image, u + su, v + sv, p.kernel[n], out);
+				add_sample(p.image, u - su, v - sv, p.kernel[n], out);
+				if (n >= p.size)
+					break;
+			}
+			for (size_t c = 0; c < 4; c++)
+				out[c] *= p.scale;
+		};
+	});
+	stub::register_shader(file, "Rotate", [has_kernel](stub::shader_context const& ctx) {
+		parameters p(ctx, has_kernel);
+		return [p](float_t u, float_t v, float_t out[4]) {
+			float_t angstep = p.angle * p.step_scale[0];
+			out[0] = out[1] = out[2] = out[3] = 0.f;
+			add_sample(p.image, u, v, p.kernel[0], out);
+			for (int32_t n = 1; n <= MAX_BLUR_SIZE; n++) {
+				float_t su, sv;
+				rotate_around(u, v, p.center[0], p.center[1], angstep * n, su, sv);
+				add_sample(p.image, su, sv, p.kernel[n], out);
+				rotate_around(u, v, p.center[0], p.center[1], angstep * -n, su, sv);
+				add_sample(p.image, su, sv, p.kernel[n], out);
+				if (n >= p.size)
+					break;
+			}
+			for (size_t c = 0; c < 4; c++)
+				out[c] *= p.scale;
+		};
+	});
+	stub::register_shader(file, "Zoom", [has_kernel](stub::shader_context const& ctx) {
+		parameters p(ctx, has_kernel);
+		return [p](float_t u, float_t v, float_t out[4]) {
+			// normalize(uv - pCenter) * distance(uv, pCenter), which is undefined in the center itself.
+			float_t du   = u - p.center[0];
+			float_t dv   = v - p.center[1];
+			float_t dist = sqrt(du * du + dv * dv);
+			float_t dir[2] = {0.f, 0.f};
+			if (dist > 0.f) {
+				dir[0] = du / dist * p.step_scale[0] * p.texel[0];
+				dir[1] = dv / dist * p.step_scale[1] * p.texel[1];
+			}
+
+			out[0] = out[1] = out[2] = out[3] = 0.f;
+			add_sample(p.image, u, v, p.kernel[0], out);
+			for (int32_t n = 1; n <= MAX_BLUR_SIZE; n++) {
+				float_t su = dir[0] * n * dist;
+				float_t sv = dir[1] * n * dist;
+				add_sample(p.image, u + su, v + sv, p.kernel[n], out);
+				add_sample(p.image, u - su, v - sv, p.kernel[n], out);
+				if (n >= p.size)
+					break;
+			}
+			for (size_t c = 0; c < 4; c++)
+				out[c] *= p.scale;
+		};
+	});
+}
+
+// Port the Draw technique of box-linear.effect and gaussian-linear.effect, which merge two taps into one.
+static void register_linear_effect(std::string file, bool has_kernel)
+{
+	stub::register_shader(file, "Draw", [has_kernel](stub::shader_context const& ctx) {
+		stub::texture_view   image = ctx.get_texture("pImage");
+		float_t              size  = ctx.get_float("pSize");
+		float_t              scale = has_kernel ? 1.f : ctx.get_float("pSizeInverseMul");
+		float_t              step[2];
+		std::vector<float_t> kernel(MAX_KERNEL_SIZE + 1, 1.f);
+		step[0] = ctx.get_floats("pImageTexel")[0] * ctx.get_floats("pStepScale")[0];
+		step[1] = ctx.get_floats("pImageTexel")[1] * ctx.get_floats("pStepScale")[1];
+		if (has_kernel) {
+			memcpy(kernel.data(), ctx.get_floats("pKernel"), sizeof(float_t) * MAX_KERNEL_SIZE);
+			kernel[MAX_KERNEL_SIZE] = 0.f;
+		}
+
+		// Computed by the vertex shader.
+		bool is_odd = ((int32_t(round(size)) % 2) == 1);
+
+		return [image, size, scale, step, kernel, is_odd](float_t u, float_t v, float_t out[4]) {
+			out[0] = out[1] = out[2] = out[3] = 0.f;
+			add_sample(image, u, v, kernel[0], out);
+			for (int32_t n = 1; n <= MAX_BLUR_SIZE; n += 2) {
+				if (n >= size)
+					break;
+
+				float_t weight = kernel[n] + kernel[n + 1];
+				add_sample(image, u + step[0] * (n + 0.5f), v + step[1] * (n + 0.5f), weight, out);
+				add_sample(image, u - step[0] * (n + 0.5f), v - step[1] * (n + 0.5f), weight, out);
+			}
+			if (is_odd) {
+				float_t weight = kernel[int32_t(size)];
+				add_sample(image, u + step[0] * size, v + step[1] * size, weight, out);
+				add_sample(image, u - step[0] * size, v - step[1] * size, weight, out);
+			}
+			for (size_t c = 0; c < 4; c++)
+				out[c] *= scale;
+		};
+	});
+}
+
+static void register_dual_filtering_effect()
+{
+	stub::register_shader("effects/blur/dual-filtering.effect", "Down", [](stub::shader_context const& ctx) {
+		stub::texture_view image = ctx.get_texture("pImage");
+		float_t            hx    = ctx.get_floats("pImageHalfTexel")[0];
+		float_t            hy    = ctx.get_floats("pImageHalfTexel")[1];
+		return [image, hx, hy](float_t u, float_t v, float_t out[4]) {
+			out[0] = out[1] = out[2] = out[3] = 0.f;
+			add_sample(image, u, v, 4.f, out);
+			add_sample(image, u - hx, v - hy, 1.f, out);
+			add_sample(image, u + hx, v + hy, 1.f, out);
+			add_sample(image, u + hx, v - hy, 1.f, out);
+			add_sample(image, u - hx, v + hy, 1.f, out);
+			for (size_t c = 0; c < 4; c++)
+				out[c] *= 0.125f;
+		};
+	});
+	stub::register_shader("effects/blur/dual-filtering.effect", "Up", [](stub::shader_context const& ctx) {
+		stub::texture_view image = ctx.get_texture("pImage");
+		float_t            hx    = ctx.get_floats("pImageHalfTexel")[0];
+		float_t            hy    = ctx.get_floats("pImageHalfTexel")[1];
+		return [image, hx, hy](float_t u, float_t v, float_t out[4]) {
+			out[0] = out[1] = out[2] = out[3] = 0.f;
+			add_sample(image, u - hx * 2.f, v, 1.f, out);
+			add_sample(image, u - hx, v + hy, 2.f, out);
+			add_sample(image, u, v + hy * 2.f, 1.f, out);
+			add_sample(image, u + hx, v + hy, 2.f, out);
+			add_sample(image, u + hx * 2.f, v, 1.f, out);
+			add_sample(image, u + hx, v - hy, 2.f, out);
+			add_sample(image, u, v - hy * 2.f, 1.f, out);
+			add_sample(image, u - hx, v - hy, 2.f, out);
+			for (size_t c = 0; c < 4; c++)
+				out[c] *= 0.083333333333f;
+		};
+	});
+}
+
+// Hard edges, gradients and noise, so that any misplaced or misweighted tap shows up.
+static std::vector<uint8_t> make_test_image(uint32_t width, uint32_t height)
+{
+	std::vector<uint8_t> pixels(size_t(width) * height * 4);
+	uint32_t             seed = 0x2545F491;
+	for (uint32_t y = 0; y < height; y++) {
+		for (uint32_t x = 0; x < width; x++) {
+			uint8_t* px = &pixels[(size_t(y) * width + x) * 4];
+			seed        = seed * 1664525 + 1013904223;
+			px[0]       = (((x / 8) + (y / 8)) % 2) ? 255 : 0;
+			px[1]       = uint8_t(x * 255 / (width - 1));
+			px[2]       = uint8_t(y * 255 / (height - 1));
+			px[3]       = uint8_t(seed >> 24);
+		}
+	}
+	return pixels;
+}
+
+static void configure(std::shared_ptr<::gfx::blur::base> blur, double_t size)
+{
+	blur->set_size(size);
+	blur->set_step_scale(1., 1.);
+	if (auto angle = std::dynamic_pointer_cast<::gfx::blur::base_angle>(blur))
+		angle->set_angle(blur->get_type() == ::gfx::blur::type::Rotational ? 2.5 : 30.);
+	if (auto center = std::dynamic_pointer_cast<::gfx::blur::base_center>(blur))
+		center->set_center(0.4, 0.6);
+}
+
+int main(int argc, const char* argv[])
+{
+	bool     quick  = test::is_quick(argc, argv);
+	uint32_t width  = quick ? 128 : 512;
+	uint32_t height = quick ? 72 : 288;
+	size_t   runs   = quick ? 1 : 3;
+
+	stub::set_data_path(TESTS_DATA_PATH);
+	register_kernel_effect("effects/blur/box.effect", false);
+	register_kernel_effect("effects/blur/gaussian.effect", true);
+	register_linear_effect("effects/blur/box-linear.effect", false);
+	register_linear_effect("effects/blur/gaussian-linear.effect", true);
+	register_dual_filtering_effect();
+
+	blur_engine engines[] = {
+		{"box", ::gfx::blur::box_factory::get(), ::gfx::blur::cpu_algorithm::Box, 1.5f / 255.f, {1, 4, 15, 64, 127},
+		 {1, 4, 15}},
+		{"box-linear", ::gfx::blur::box_linear_factory::get(), ::gfx::blur::cpu_algorithm::BoxLinear, 1.5f / 255.f,
+		 {1, 4, 15, 64, 127},
+		 {1, 4, 15}},
+		{"gaussian", ::gfx::blur::gaussian_factory::get(), ::gfx::blur::cpu_algorithm::Gaussian, 2.5f / 255.f,
+		 {1, 4, 15, 64, 127, 256},
+		 {1, 4, 15, 200}},
+		{"gaussian-linear", ::gfx::blur::gaussian_linear_factory::get(), ::gfx::blur::cpu_algorithm::GaussianLinear,
+		 1.5f / 255.f, {1, 4, 15, 64, 127},
+		 {1, 4, 15}},
+		{"dual-filtering", ::gfx::blur::dual_filtering_factory::get(), ::gfx::blur::cpu_algorithm::DualFiltering,
+		 1.f / 4096.f, {1, 2, 4, 5},
+		 {1, 2, 3}},
+	};
+
+	std::vector<uint8_t>     pixels = make_test_image(width, height);
+	std::vector<blur_result> results;
+	for (auto& engine : engines) {
+		for (size_t type_idx = 0; type_idx < 4; type_idx++) {
+			auto type = static_cast<::gfx::blur::type>(type_idx);
+			if (!engine.factory.is_type_supported(type)
+				|| !::gfx::blur::cpu_factory::get(engine.algorithm).is_type_supported(type))
+				continue;
+
+			for (double_t size : (quick ? engine.quick_sizes : engine.sizes)) {
+				if (size > engine.factory.get_max_size(type))
+					continue;
+
+				blur_result result;
+				result.name = std::string(engine.name) + "/" + type_names[type_idx] + "/" + std::to_string(int(size));
+
+				test::frame(result.name.c_str(), [&]() {
+					auto gctx = gs::context();
+
+					// The CPU backend gets exactly the 8-bit values the GPU engine reads.
+					auto image = std::make_shared<::gfx::blur::cpu_image>(width, height);
+					for (size_t idx = 0; idx < pixels.size(); idx++)
+						image->get_data()[idx] = pixels[idx] / 255.f;
+					const uint8_t* mips[] = {pixels.data()};
+					auto           input  = std::make_shared<gs::texture>(width, height, GS_RGBA, 1, mips,
+																   gs::texture::flags::None);
+
+					auto cpu = std::static_pointer_cast<::gfx::blur::cpu>(
+						::gfx::blur::cpu_factory::get(engine.algorithm).create(type));
+					configure(cpu, size);
+					cpu->set_input(image);
+					std::shared_ptr<::gfx::blur::cpu_image> expected;
+					result.cpu = test::measure(runs, [&]() { expected = cpu->render_image(); });
+
+					auto gpu = engine.factory.create(type);
+					configure(gpu, size);
+					gpu->set_input(input);
+					std::vector<float_t> actual;
+					result.emulated = test::measure(
+						runs, [&]() { actual = stub::read_texture(gpu->render()->get_object()); });
+
+					result.error = 0.f;
+					if (CHECK(expected && (expected->get_width() == width) && (expected->get_height() == height))
+						&& CHECK(actual.size() == pixels.size())) {
+						for (size_t idx = 0; idx < actual.size(); idx++)
+							result.error = std::max(result.error, std::fabs(actual[idx] - expected->get_data()[idx]));
+					}
+					if (!CHECK(result.error <= engine.tolerance))
+						fprintf(stderr, "%s: differs by %f, at most %f allowed\n", result.name.c_str(), result.error,
+								engine.tolerance);
+				});
+				results.push_back(result);
+			}
+		}
+	}
+
+	double_t mpix = double_t(width) * height / 1000000.;
+	printf("\n%ux%u, Mpix/s     %10s %10s %10s\n", width, height, "cpu", "emulated", "error");
+	for (auto const& result : results) {
+		printf("%-32s %10.2f %10.2f %10.6f\n", result.name.c_str(), mpix / result.cpu, mpix / result.emulated,
+			   result.error);
+	}
+
+	return test::failures;
+}
@@ -0,0 +1,112 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include "obs-stub.hpp"
+#include "obs/gs/gs-helper.hpp"
+
+#define CHECK(expr) ::test::check((expr), #expr, __FILE__, __LINE__)
+
+#define CHECK_THROWS(type, ...)                                                    \
+	do {                                                                           \
+		bool _thrown = false;                                                      \
+		try {                                                                      \
+			__VA_ARGS__;                                                           \
+		} catch (type const&) {                                                    \
+			_thrown = true;                                                        \
+		}                                                                          \
+		::test::check(_thrown, #__VA_ARGS__ " throws " #type, __FILE__, __LINE__); \
+	} while (false)
+
+namespace test {
+	// Number of failed checks, which main() returns.
+	inline int failures = 0;
+
+	inline bool check(bool result, const char* expression, const char* file, int line)
+	{
+		if (!result) {
+			fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+			failures++;
+		}
+		return result;
+	}
+
+	/*!
+	 * \brief Run one simulated frame.
+	 *
+	 * Everything the frame creates has to be gone by the time it returns: any wrapper object or
+	 *  libobs handle still alive afterwards, or an unbalanced obs_enter_graphics(), fails it.
+	 */
+	inline void frame(const char* name, std::function<void()> fn)
+	{
+		int before = failures;
+		try {
+			fn();
+		} catch (std::exception const& ex) {
+			fprintf(stderr, "%s: unexpected exception: %s\n", name, ex.what());
+			failures++;
+		}
+
+		if (gs::get_live_objects() != 0) {
+			fprintf(stderr, "%s: %" PRId64 " wrapper objects alive after the frame\n", name, gs::get_live_objects());
+			failures++;
+		}
+		if (stub::get_live_handles() != 0) {
+			fprintf(stderr, "%s: %" PRId64 " libobs objects alive after the frame\n", name, stub::get_live_handles());
+			failures++;
+		}
+		if (stub::get_graphics_depth() != 0) {
+			fprintf(stderr, "%s: graphics context entered %" PRId64 " times more than left\n", name,
+					stub::get_graphics_depth());
+			failures++;
+		}
+		stub::next_frame();
+
+		printf("%-48s %s\n", name, (failures == before) ? "ok" : "FAILED");
+	}
+
+	// Benchmarks run a reduced set of sizes and iterations when started with --quick, which is how ctest runs them.
+	inline bool is_quick(int argc, const char* argv[])
+	{
+		for (int idx = 1; idx < argc; idx++) {
+			if (strcmp(argv[idx], "--quick") == 0)
+				return true;
+		}
+		return false;
+	}
+
+	// Wall time of fn in seconds, the best of a number of runs.
+	inline double measure(size_t runs, std::function<void()> fn)
+	{
+		double best = 0.;
+		for (size_t run = 0; run < runs; run++) {
+			auto start = std::chrono::high_resolution_clock::now();
+			fn();
+			double time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			best        = ((run == 0) || (time < best)) ? time : best;
+		}
+		return best;
+	}
+} // namespace test
@@ -0,0 +1,114 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+// Checks the Gaussian kernel table against the brute-force search it replaced, and times building all kernels
+//  with either of them, which used to happen at startup.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "gfx/blur/gfx-blur-gaussian-kernel.hpp"
+#include "test-common.hpp"
+#include "util-math.hpp"
+
+#define MAX_KERNEL_SIZE 128
+#define MAX_BLUR_SIZE (MAX_KERNEL_SIZE - 1)
+#define KERNEL_THRESHOLD double_t(1. / (MAX_KERNEL_SIZE * 5))
+
+// The search gaussian_data and gaussian_linear_data used to run on construction, for every width.
+#define SEARCH_DENSITY double_t(1. / 500.)
+#define SEARCH_RANGE MAX_KERNEL_SIZE * 2
+
+static std::vector<std::vector<float_t>> search_kernels()
+{
+	std::vector<std::vector<float_t>> kernels;
+	for (size_t kernel_size = 1; kernel_size <= MAX_BLUR_SIZE; kernel_size++) {
+		std::vector<double_t> kernel_math(MAX_KERNEL_SIZE);
+		std::vector<float_t>  kernel_data(MAX_KERNEL_SIZE);
+		double_t              actual_width = 1.;
+
+		for (double_t h = SEARCH_DENSITY; h < SEARCH_RANGE; h += SEARCH_DENSITY) {
+			if (util::math::gaussian<double_t>(double_t(kernel_size + 1), h) > KERNEL_THRESHOLD) {
+				actual_width = h;
+				break;
+			}
+		}
+
+		double_t sum = 0;
+		for (size_t p = 0; p <= kernel_size; p++) {
+			kernel_math[p] = util::math::gaussian<double_t>(double_t(p), actual_width);
+			sum += kernel_math[p] * (p > 0 ? 2 : 1);
+		}
+		for (size_t p = 0; p <= kernel_size; p++) {
+			kernel_data[p] = float_t(kernel_math[p] / sum);
+		}
+		kernels.push_back(std::move(kernel_data));
+	}
+	return kernels;
+}
+
+int main(int argc, const char* argv[])
+{
+	size_t runs = test::is_quick(argc, argv) ? 1 : 10;
+
+	std::vector<std::vector<float_t>> searched;
+	double_t                          search_time = test::measure(runs, [&]() { searched = search_kernels(); });
+
+	// A fresh table per run, the shared one would only calculate each kernel once.
+	double_t table_time = test::measure(runs, [&]() {
+		auto table = std::make_unique<::gfx::blur::gaussian_kernel_table>();
+		for (size_t width = 1; width <= MAX_BLUR_SIZE; width++)
+			table->get_kernel(width);
+	});
+
+	auto&   table      = ::gfx::blur::gaussian_kernel_table::get();
+	float_t difference = 0.f;
+	for (size_t width = 1; width <= MAX_BLUR_SIZE; width++) {
+		std::vector<float_t> const& kernel = table.get_kernel(width);
+		if (!CHECK(kernel.size() == MAX_KERNEL_SIZE))
+			continue;
+
+		// The solved sigma puts the first tap past the kernel exactly on the threshold.
+		double_t sigma = ::gfx::blur::gaussian_kernel_table::get_sigma(width);
+		CHECK(std::fabs(util::math::gaussian<double_t>(double_t(width + 1), sigma) / KERNEL_THRESHOLD - 1.) < 1e-6);
+		CHECK(sigma < double_t(width + 1));
+
+		double_t sum = kernel[0];
+		for (size_t p = 1; p <= width; p++) {
+			sum += kernel[p] * 2.;
+			CHECK(kernel[p] <= kernel[p - 1]);
+		}
+		CHECK(std::fabs(sum - 1.) < 1e-5);
+		CHECK(std::all_of(kernel.begin() + width + 1, kernel.end(), [](float_t v) { return v == 0.f; }));
+
+		for (size_t p = 0; p < MAX_KERNEL_SIZE; p++)
+			difference = std::max(difference, std::fabs(kernel[p] - searched[width - 1][p]));
+	}
+
+	// The search could only land on multiples of its density.
+	CHECK(difference < 0.002f);
+	CHECK(&table.get_kernel(0) == &table.get_kernel(1));
+	CHECK(&table.get_kernel(MAX_KERNEL_SIZE * 2) == &table.get_kernel(MAX_BLUR_SIZE));
+
+	printf("All %d kernels: search %.3f ms, table %.3f ms, largest difference %f\n", MAX_BLUR_SIZE,
+		   search_time * 1000., table_time * 1000., difference);
+
+	return test::failures;
+}
@@ -0,0 +1,507 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+// Exercises the gs:: wrappers against the libobs stub, one simulated frame per wrapper.
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <ios>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include "obs/gs/gs-effect.hpp"
+#include "obs/gs/gs-geometry.hpp"
+#include "obs/gs/gs-helper.hpp"
+#include "obs/gs/gs-mipmapper.hpp"
+#include "obs/gs/gs-render-state.hpp"
+#include "obs/gs/gs-rendertarget-pool.hpp"
+#include "obs/gs/gs-rendertarget.hpp"
+#include "obs/gs/gs-sampler.hpp"
+#include "obs/gs/gs-texture.hpp"
+#include "obs/gs/gs-vertexbuffer.hpp"
+#include "test-common.hpp"
+
+// OBS
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)
+#endif
+#include <obs.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+static const char* test_effect_code = R"(
+uniform float4x4 ViewProj;
+uniform texture2d image;
+uniform float4 color <
+	string name = "Color";
+	float minimum = 0.0;
+	float maximum = 1.0;
+> = {1.0, 0.5, 0.25, 1.0};
+uniform float2 texel = {0.5, 0.25};
+uniform int count = 3;
+uniform bool enabled = true;
+uniform float kernel[4];
+
+// Not parsed by the stub beyond its techniques.
+float4 PSSolid(VertData v_in) : TARGET
+{
+	return color;
+}
+
+technique Solid
+{
+	pass
+	{
+		vertex_shader = VSDefault(v_in);
+		pixel_shader  = PSSolid(v_in);
+	}
+}
+
+technique Twice
+{
+	pass { vertex_shader = VSDefault(v_in); pixel_shader = PSSolid(v_in); }
+	pass { vertex_shader = VSDefault(v_in); pixel_shader = PSSolid(v_in); }
+}
+)";
+
+static void register_test_shaders()
+{
+	stub::register_shader("test.effect", "Solid", [](stub::shader_context const& ctx) {
+		const float_t* color = ctx.get_floats("color");
+		float_t        value[4] = {color[0], color[1], color[2], color[3]};
+		return [value](float_t, float_t, float_t out[4]) { memcpy(out, value, sizeof(value)); };
+	});
+	stub::register_shader("test.effect", "Twice", [](stub::shader_context const& ctx) {
+		const float_t* color = ctx.get_floats("color");
+		float_t        value[4] = {color[0], color[1], color[2], color[3]};
+		return [value](float_t, float_t, float_t out[4]) { memcpy(out, value, sizeof(value)); };
+	});
+}
+
+static void test_texture()
+{
+	auto gctx = gs::context();
+
+	uint8_t        pixels[2 * 2 * 4] = {255, 0, 0, 255, 0, 255, 0, 255, 0, 0, 255, 255, 255, 255, 255, 0};
+	const uint8_t* mips[]            = {pixels};
+
+	{
+		gs::texture tex(2, 2, GS_RGBA, 1, mips, gs::texture::flags::None);
+		CHECK(tex.get_width() == 2);
+		CHECK(tex.get_height() == 2);
+		CHECK(tex.get_depth() == 1);
+		CHECK(tex.get_type() == gs::texture::type::Normal);
+		CHECK(tex.get_color_format() == GS_RGBA);
+		CHECK(gs::get_live_objects(gs::object_type::Texture) == 1);
+
+		std::vector<float_t> image = stub::read_texture(tex.get_object());
+		CHECK(image.size() == 16);
+		CHECK((image[0] == 1.f) && (image[1] == 0.f) && (image[3] == 1.f));
+		CHECK((image[12] == 1.f) && (image[15] == 0.f));
+
+		// A non-owning wrapper must not destroy the texture.
+		{
+			gs::texture view(tex.get_object(), false);
+			CHECK(view.get_width() == 2);
+		}
+		CHECK(stub::get_live_handles() == 1);
+	}
+
+	{
+		gs::texture volume(4, 4, 2, GS_R32F, 1, nullptr, gs::texture::flags::Dynamic);
+		CHECK(volume.get_type() == gs::texture::type::Volume);
+		CHECK(volume.get_depth() == 2);
+
+		gs::texture cube(8, GS_RGBA16F, 1, nullptr, gs::texture::flags::None);
+		CHECK(cube.get_type() == gs::texture::type::Cube);
+		CHECK(cube.get_width() == 8);
+		CHECK(cube.get_depth() == 6);
+		CHECK(stub::get_live_handles() == 2);
+	}
+	CHECK(stub::get_calls("gs_voltexture_destroy") == 1);
+	CHECK(stub::get_calls("gs_cubetexture_destroy") == 1);
+
+	{
+		gs::texture file(std::string(TESTS_DATA_PATH) + "/effects/mipgen.effect");
+		CHECK(file.get_width() == 1);
+	}
+
+	CHECK_THROWS(std::logic_error, gs::texture(0, 1, GS_RGBA, 1, nullptr, gs::texture::flags::None));
+	CHECK_THROWS(std::logic_error, gs::texture(3, 3, GS_RGBA, 2, nullptr, gs::texture::flags::None));
+	CHECK_THROWS(std::ios_base::failure, gs::texture(std::string(TESTS_DATA_PATH) + "/does-not-exist.png"));
+}
+
+static void test_rendertarget()
+{
+	auto gctx = gs::context();
+
+	auto         effect = gs::effect::create(test_effect_code, "test.effect");
+	gs::rendertarget rt(GS_RGBA, GS_ZS_NONE);
+	CHECK(rt.get_color_format() == GS_RGBA);
+	CHECK(rt.get_object() == nullptr);
+
+	{
+		auto op = rt.render(4, 4);
+		CHECK_THROWS(std::logic_error, rt.render(4, 4));
+
+		vec4 black = {0, 0, 0, 0};
+		gs_clear(GS_CLEAR_COLOR, &black, 0, 0);
+		gs_ortho(0, 1, 0, 1, -1, 1);
+
+		auto state = gs::render_state::opaque().apply();
+		while (gs_effect_loop(effect->get_object(), "Solid")) {
+			gs::draw_sprite(nullptr, 0, 1, 1);
+		}
+	}
+
+	std::shared_ptr<gs::texture> tex = rt.get_texture();
+	CHECK(tex->get_width() == 4);
+	CHECK(tex->get_height() == 4);
+	std::vector<float_t> image = stub::read_texture(tex->get_object());
+	bool                 solid = true;
+	for (size_t idx = 0; idx < image.size(); idx += 4) {
+		solid &= (image[idx] == 1.f) && (fabs(image[idx + 1] - 128.f / 255.f) < 0.001f) && (image[idx + 3] == 1.f);
+	}
+	CHECK(solid);
+	CHECK(stub::get_calls("gs_draw_sprite") >= 1);
+
+	// Render targets can be rendered again after the previous operation ended, also at a new size.
+	{
+		auto op = rt.render(2, 8);
+	}
+	CHECK(rt.get_texture()->get_width() == 2);
+	CHECK(rt.get_texture()->get_height() == 8);
+
+	// A texture wrapping the render target does not own it.
+	tex.reset();
+	CHECK(gs::get_live_objects(gs::object_type::RenderTarget) == 1);
+}
+
+static void test_rendertarget_pool()
+{
+	auto gctx = gs::context();
+
+	auto pool = gs::rendertarget_pool::get();
+	CHECK(pool == gs::rendertarget_pool::get());
+
+	gs::rendertarget* first;
+	{
+		auto rt = pool->acquire(16, 16, GS_RGBA);
+		first   = rt.get();
+		auto op = rt->render(16, 16);
+	}
+	{
+		// Released targets are handed out again for the same size and format.
+		auto rt = pool->acquire(16, 16, GS_RGBA);
+		CHECK(rt.get() == first);
+		auto other = pool->acquire(16, 16, GS_RGBA16F);
+		CHECK(other.get() != first);
+	}
+
+	auto stats = pool->get_statistics();
+	CHECK(stats.hits == 1);
+	CHECK(stats.misses == 2);
+	CHECK(stats.targets == 2);
+	CHECK(stats.targets_in_use == 0);
+}
+
+static void test_vertex_buffer()
+{
+	auto gctx = gs::context();
+
+	auto effect = gs::effect::create(test_effect_code, "test.effect");
+
+	gs::vertex_buffer vb(4, 1);
+	CHECK(vb.size() == 4);
+	CHECK(vb.get_uv_layers() == 1);
+	CHECK(vb.get_attributes() == gs::vertex_buffer::attributes::All);
+
+	// A strip covering the left half of the target.
+	float_t corners[4][2] = {{0, 0}, {0.5f, 0}, {0, 1}, {0.5f, 1}};
+	for (size_t idx = 0; idx < 4; idx++) {
+		vec3_set(vb.get_positions() + idx, corners[idx][0], corners[idx][1], 0);
+		vec4_set(vb.get_uv_layer(0) + idx, corners[idx][0], corners[idx][1], 0, 0);
+	}
+
+	uint64_t uploaded = stub::get_vertex_bytes_uploaded();
+	gs_load_vertexbuffer(vb.update());
+	CHECK(stub::get_vertex_bytes_uploaded() > uploaded);
+
+	gs::rendertarget rt(GS_RGBA, GS_ZS_NONE);
+	{
+		auto op    = rt.render(8, 8);
+		vec4 black = {0, 0, 0, 0};
+		gs_clear(GS_CLEAR_COLOR, &black, 0, 0);
+		gs_ortho(0, 1, 0, 1, -1, 1);
+
+		auto state = gs::render_state::opaque().apply();
+		while (gs_effect_loop(effect->get_object(), "Solid")) {
+			gs::draw(GS_TRISTRIP, 0, vb.size());
+		}
+	}
+	gs_load_vertexbuffer(nullptr);
+
+	std::vector<float_t> image   = stub::read_texture(rt.get_object());
+	size_t               covered = 0;
+	for (size_t y = 0; y < 8; y++) {
+		for (size_t x = 0; x < 8; x++) {
+			bool lit = image[(y * 8 + x) * 4 + 3] == 1.f;
+			CHECK(lit == (x < 4));
+			covered += lit ? 1 : 0;
+		}
+	}
+	CHECK(covered == 32);
+
+	// Copies get their own GPU buffer, moves take it over.
+	gs::vertex_buffer copy(vb);
+	CHECK(copy.size() == vb.size());
+	CHECK(copy.get_positions()[1].x == 0.5f);
+	CHECK(gs::get_live_objects(gs::object_type::VertexBuffer) == 2);
+
+	gs::vertex_buffer moved(std::move(copy));
+	CHECK(moved.get_positions()[1].x == 0.5f);
+	CHECK(copy.empty());
+	CHECK(gs::get_live_objects(gs::object_type::VertexBuffer) == 2);
+
+	CHECK_THROWS(std::out_of_range, gs::vertex_buffer(gs::MAXIMUM_VERTICES + 1));
+	CHECK_THROWS(std::out_of_range, gs::vertex_buffer(4, gs::MAXIMUM_UVW_LAYERS + 1));
+}
+
+static void test_geometry()
+{
+	auto gctx = gs::context();
+
+	auto effect = gs::effect::create(test_effect_code, "test.effect");
+	auto quad   = gs::geometry::get_quad();
+	CHECK(quad == gs::geometry::get_quad());
+	CHECK(quad->size() == 6);
+	CHECK(gs::geometry::get_fullscreen_triangle()->size() == 3);
+	CHECK(gs::geometry::get_grid(4)->size() == 4 * 4 * 6);
+	CHECK_THROWS(std::out_of_range, gs::geometry::get_grid(0));
+
+	// Additive blending shows any pixel that is shaded twice or not at all.
+	gs::rendertarget rt(GS_RGBA32F, GS_ZS_NONE);
+	{
+		auto op    = rt.render(13, 7);
+		vec4 black = {0, 0, 0, 0};
+		gs_clear(GS_CLEAR_COLOR, &black, 0, 0);
+		gs_ortho(0, 1, 0, 1, -1, 1);
+
+		auto state = gs::render_state::opaque().with_blending(GS_BLEND_ONE, GS_BLEND_ONE).apply();
+		effect->find_parameter("color")->set_float4(0.25f, 0.25f, 0.25f, 0.25f);
+		gs_load_vertexbuffer(quad->get_object());
+		while (gs_effect_loop(effect->get_object(), "Solid")) {
+			gs::draw(GS_TRIS, 0, quad->size());
+		}
+		gs_load_vertexbuffer(nullptr);
+	}
+
+	bool                 once  = true;
+	std::vector<float_t> image = stub::read_texture(rt.get_object());
+	for (float_t v : image) {
+		once &= (v == 0.25f);
+	}
+	CHECK(once);
+}
+
+// Effects ask for shared shapes from inside graphics, the mipmapper from outside of it. Doing both at once while the
+//  shapes are created and released again must not deadlock.
+static void test_geometry_threads()
+{
+	const size_t        iterations = 20000;
+	std::atomic<size_t> finished   = 0;
+
+	std::thread inside([&finished, iterations]() {
+		for (size_t idx = 0; idx < iterations; idx++) {
+			auto gctx = gs::context();
+			gs::geometry::get_fullscreen_triangle();
+		}
+		finished++;
+	});
+	std::thread outside([&finished, iterations]() {
+		for (size_t idx = 0; idx < iterations; idx++) {
+			gs::geometry::get_quad();
+		}
+		finished++;
+	});
+
+	// Deadlocked threads can't be joined, so give up on the whole test instead.
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (finished < 2) {
+		if (std::chrono::steady_clock::now() > deadline) {
+			fprintf(stderr, "geometry_threads: deadlocked\n");
+			std::_Exit(EXIT_FAILURE);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	inside.join();
+	outside.join();
+}
+
+static void test_effect()
+{
+	auto gctx = gs::context();
+
+	auto effect = gs::effect::create(test_effect_code, "test.effect");
+	CHECK(effect->count_parameters() == 7);
+	CHECK(effect->has_parameter("color", gs::effect_parameter::type::Float4));
+	CHECK(effect->has_parameter("image", gs::effect_parameter::type::Texture));
+	CHECK(effect->has_parameter("ViewProj", gs::effect_parameter::type::Matrix));
+	CHECK(!effect->has_parameter("missing"));
+	CHECK(effect->find_parameter("missing") == nullptr);
+
+	// Defaults
+	auto color = effect->get_parameter("color");
+	CHECK(color->get_default_float4().y == 0.5f);
+	CHECK(effect->get_parameter("texel")->get_default_float2().y == 0.25f);
+	CHECK(effect->get_parameter("count")->get_default_int() == 3);
+	CHECK(effect->get_parameter("enabled")->get_default_bool() == true);
+
+	// Values
+	color->set_float4(0.1f, 0.2f, 0.3f, 0.4f);
+	CHECK(color->get_float4().z == 0.3f);
+	effect->get_parameter("count")->set_int(7);
+	CHECK(effect->get_parameter("count")->get_int() == 7);
+	effect->get_parameter("enabled")->set_bool(false);
+	CHECK(effect->get_parameter("enabled")->get_bool() == false);
+
+	float_t kernel[4] = {1, 2, 3, 4};
+	effect->get_parameter("kernel")->set_float_array(kernel, 4);
+	CHECK(gs_effect_get_val_size(gs_effect_get_param_by_name(effect->get_object(), "kernel")) == sizeof(kernel));
+
+	// Annotations
+	CHECK(color->count_annotations() == 3);
+	CHECK(color->has_annotation("name", gs::effect_parameter::type::String));
+	CHECK(color->get_annotation("name")->get_default_string() == "Color");
+	CHECK(color->get_annotation("maximum")->get_default_float() == 1.f);
+	CHECK(color->get_annotation(size_t(1))->get_name() == "minimum");
+
+	// Typed parameters
+	gs::float4_parameter typed;
+	typed.bind(*effect, "color");
+	typed.set(1.f, 1.f, 1.f, 1.f);
+	CHECK(color->get_float4().x == 1.f);
+	gs::int_parameter wrong;
+	CHECK_THROWS(std::runtime_error, wrong.bind(*effect, "color"));
+	CHECK_THROWS(std::runtime_error, wrong.bind(*effect, "missing"));
+
+	// Techniques loop once per pass.
+	size_t passes = 0;
+	while (gs_effect_loop(effect->get_object(), "Twice"))
+		passes++;
+	CHECK(passes == 2);
+	CHECK(!gs_effect_loop(effect->get_object(), "Missing"));
+
+	// Effects from files, and errors.
+	auto mipgen = gs::effect::create(std::string(TESTS_DATA_PATH) + "/effects/mipgen.effect");
+	CHECK(mipgen->has_parameter("imageTexel", gs::effect_parameter::type::Float2));
+	CHECK_THROWS(std::runtime_error, gs::effect("uniform float x;", "broken.effect"));
+	CHECK(gs::get_live_objects(gs::object_type::Effect) == 2);
+}
+
+static void test_sampler()
+{
+	auto gctx = gs::context();
+
+	gs::sampler sampler;
+	sampler.set_filter(GS_FILTER_POINT);
+	sampler.set_address_mode_u(GS_ADDRESS_CLAMP);
+	sampler.set_address_mode_v(GS_ADDRESS_MIRROR);
+	sampler.set_border_color(255, 0, 0, 255);
+	CHECK(sampler.get_filter() == GS_FILTER_POINT);
+	CHECK(sampler.get_address_mode_v() == GS_ADDRESS_MIRROR);
+
+	gs_sampler_state* state = sampler.refresh();
+	CHECK(state != nullptr);
+	CHECK(sampler.get_object() == state);
+	CHECK(gs::get_live_objects(gs::object_type::Sampler) == 1);
+
+	// Changing the sampler replaces the state object instead of leaking the old one.
+	sampler.set_max_anisotropy(4);
+	sampler.refresh();
+	CHECK(gs::get_live_objects(gs::object_type::Sampler) == 1);
+	CHECK(stub::get_live_handles() == 1);
+	CHECK(stub::get_calls("gs_samplerstate_destroy") == 1);
+}
+
+static void test_mipmapper()
+{
+	auto gctx = gs::context();
+
+	gs::mipmapper mipmapper;
+	auto source = std::make_shared<gs::texture>(16, 16, GS_RGBA, 5, nullptr, gs::texture::flags::BuildMipMaps);
+	auto target = std::make_shared<gs::texture>(16, 16, GS_RGBA, 5, nullptr, gs::texture::flags::BuildMipMaps);
+	auto other  = std::make_shared<gs::texture>(8, 8, GS_RGBA, 4, nullptr, gs::texture::flags::BuildMipMaps);
+
+	// Only Direct3D 11 textures can be written per mip level, the stub reports OpenGL.
+	mipmapper.rebuild(source, target, gs::mipmapper::generator::Linear, 1.f);
+	CHECK(stub::get_calls("gs_texture_get_obj") == 2);
+	CHECK_THROWS(std::invalid_argument,
+				 mipmapper.rebuild(source, other, gs::mipmapper::generator::Linear, 1.f));
+	mipmapper.rebuild(nullptr, target, gs::mipmapper::generator::Linear, 1.f);
+}
+
+static void test_render_state()
+{
+	auto gctx = gs::context();
+
+	{
+		auto outer = gs::render_state::opaque().apply();
+		CHECK(stub::get_calls("gs_blend_state_push") == 1);
+		CHECK(stub::get_calls("gs_enable_blending") == 1);
+		{
+			// Nested scopes only change what differs, and restore it afterwards.
+			auto     inner = gs::render_state::opaque().with_blending(GS_BLEND_ONE, GS_BLEND_ONE).apply();
+			uint64_t calls = stub::get_calls("gs_set_cull_mode");
+			CHECK(calls == 1);
+			CHECK(stub::get_calls("gs_enable_blending") == 2);
+			CHECK(stub::get_calls("gs_blend_state_push") == 1);
+		}
+		CHECK(stub::get_calls("gs_enable_blending") == 3);
+	}
+	CHECK(stub::get_calls("gs_blend_state_pop") == 1);
+}
+
+int main(int, const char*[])
+{
+	stub::set_data_path(TESTS_DATA_PATH);
+	register_test_shaders();
+
+	std::pair<const char*, void (*)()> tests[] = {
+		{"texture", test_texture},
+		{"rendertarget", test_rendertarget},
+		{"rendertarget_pool", test_rendertarget_pool},
+		{"vertex_buffer", test_vertex_buffer},
+		{"geometry", test_geometry},
+		{"geometry_threads", test_geometry_threads},
+		{"effect", test_effect},
+		{"sampler", test_sampler},
+		{"mipmapper", test_mipmapper},
+		{"render_state", test_render_state},
+	};
+	for (auto const& kv : tests) {
+		stub::reset_calls();
+		test::frame(kv.first, kv.second);
+	}
+
+	return test::failures;
+}
@@ -0,0 +1,187 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+// Compares lookups into a baked gfx::lut::color_grade with the direct port of the grading chain for random 8-bit
+//  colors, and times the bake against grading every entry one by one.
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "gfx/lut/gfx-lut-color-grade.hpp"
+#include "test-common.hpp"
+
+struct grade {
+	const char*                  name;
+	::gfx::lut::grade_parameters params;
+	// Largest error in 1/255 steps a 32^3 and a 64^3 table may have, negative if not checked.
+	double_t max_error_32;
+	double_t max_error_64;
+};
+
+// Effect units, as filter::color_grade::color_grade_instance::update() converts the settings.
+static const grade grades[] = {
+	{"default",
+	 {{0, 0, 0, 0}, {1, 1, 1, 1}, {1, 1, 1, 1}, {0, 0, 0, 0}, {1, 1, 1}, {1, 1, 1}, {1, 1, 1}, {0, 1, 1, 1}},
+	 0.5,
+	 0.5},
+	{"warm",
+	 {{.02f, .01f, 0, 0},
+	  {1.f / 1.1f, 1, 1.1f, 1},
+	  {1.1f, 1, .9f, 1},
+	  {0, 0, 0, .01f},
+	  {1, .95f, .9f},
+	  {1.05f, 1, .95f},
+	  {1, 1, 1.05f},
+	  {.02f, 1.2f, 1, 1.1f}},
+	 8.,
+	 4.},
+	{"cool, desaturated",
+	 {{0, 0, .03f, .01f},
+	  {1, 1.f / 1.05f, 1, 1.f / 1.1f},
+	  {.95f, 1, 1.08f, 1.02f},
+	  {-.01f, 0, .01f, 0},
+	  {.9f, 1, 1.1f},
+	  {.98f, 1, 1.02f},
+	  {1, 1, 1},
+	  {-.03f, .7f, 1.05f, .95f}},
+	 8.,
+	 4.},
+	// Lift pushes the darkest values below zero before Gamma, where the effect itself is discontinuous.
+	{"crushed",
+	 {{0, 0, 0, -.1f},
+	  {1, 1, 1, 1.f / 1.2f},
+	  {1, 1, 1, 1.2f},
+	  {0, 0, 0, 0},
+	  {1, 1, 1},
+	  {1, 1, 1},
+	  {1, 1, 1},
+	  {0, 1, 1, 1.2f}},
+	 -1.,
+	 -1.},
+};
+
+static inline float_t saturate(float_t value)
+{
+	return (value >= 0.f) ? std::min(value, 1.f) : 0.f;
+}
+
+// Every entry has to be exactly what the direct port gives for its node, no matter which path baked it.
+static void test_nodes(grade const& g, uint32_t size)
+{
+	::gfx::lut::color_grade lut(size);
+	lut.bake(g.params);
+
+	size_t mismatched = 0;
+	for (uint32_t b = 0; b < size; b++) {
+		for (uint32_t gr = 0; gr < size; gr++) {
+			for (uint32_t r = 0; r < size; r++) {
+				float_t rgb[3] = {float_t(r) / float_t(size - 1), float_t(gr) / float_t(size - 1),
+								  float_t(b) / float_t(size - 1)};
+				::gfx::lut::color_grade::grade(g.params, rgb);
+
+				const float_t* entry = lut.get_data() + (size_t(gr) * lut.get_width() + size_t(b) * size + r) * 4;
+				for (size_t channel = 0; channel < 3; channel++)
+					mismatched += (entry[channel] != saturate(rgb[channel])) ? 1 : 0;
+				mismatched += (entry[3] != 1.f) ? 1 : 0;
+			}
+		}
+	}
+	if (!CHECK(mismatched == 0))
+		fprintf(stderr, "%s, %u^3: %zu values differ from the direct port\n", g.name, size, mismatched);
+}
+
+static void test_lookups(size_t colors)
+{
+	printf("%-20s %6s %12s %12s\n", "grade", "size", "mean /255", "max /255");
+	for (grade const& g : grades) {
+		for (uint32_t size : {32, 64}) {
+			test_nodes(g, size);
+
+			::gfx::lut::color_grade lut(size);
+			lut.bake(g.params);
+
+			std::mt19937 rng(size);
+			double_t     total = 0., worst = 0.;
+			for (size_t idx = 0; idx < colors; idx++) {
+				float_t rgb[3], expected[3], result[3];
+				for (size_t channel = 0; channel < 3; channel++)
+					rgb[channel] = expected[channel] = float_t(rng() % 256) / 255.f;
+				::gfx::lut::color_grade::grade(g.params, expected);
+				lut.sample(rgb, result);
+
+				for (size_t channel = 0; channel < 3; channel++) {
+					double_t error = std::fabs(double_t(result[channel]) - saturate(expected[channel])) * 255.;
+					total += error;
+					worst = std::max(worst, error);
+				}
+			}
+
+			double_t limit = (size == 32) ? g.max_error_32 : g.max_error_64;
+			if (limit >= 0.)
+				CHECK(worst < limit);
+			printf("%-20s %6u %12.3f %12.3f\n", g.name, size, total / (colors * 3), worst);
+		}
+	}
+}
+
+static void test_bake(size_t runs)
+{
+	grade const& g = grades[1];
+
+	printf("%-6s %10s %14s\n", "size", "bake ms", "per entry ms");
+	for (uint32_t size : {16, 32, 64}) {
+		::gfx::lut::color_grade lut(size);
+		double_t                bake_time = test::measure(runs, [&]() { lut.bake(g.params); });
+
+		// The same entries graded one at a time with the direct port, without the per-axis tables or SSE2.
+		float_t  sink       = 0.f;
+		double_t entry_time = test::measure(runs, [&]() {
+			for (uint32_t b = 0; b < size; b++) {
+				for (uint32_t gr = 0; gr < size; gr++) {
+					for (uint32_t r = 0; r < size; r++) {
+						float_t rgb[3] = {float_t(r) / float_t(size - 1), float_t(gr) / float_t(size - 1),
+										  float_t(b) / float_t(size - 1)};
+						::gfx::lut::color_grade::grade(g.params, rgb);
+						sink += saturate(rgb[0]) + saturate(rgb[1]) + saturate(rgb[2]);
+					}
+				}
+			}
+		});
+		CHECK(sink > 0.f);
+
+		// Anything else would defeat the point of baking.
+		CHECK(bake_time < entry_time);
+		printf("%-6u %10.3f %14.3f\n", size, bake_time * 1000., entry_time * 1000.);
+	}
+}
+
+int main(int argc, const char* argv[])
+{
+	bool   quick  = test::is_quick(argc, argv);
+	size_t colors = quick ? 20000 : 200000;
+	size_t runs   = quick ? 3 : 20;
+
+	CHECK_THROWS(std::invalid_argument, ::gfx::lut::color_grade(1));
+
+	test::frame("lookups", [colors]() { test_lookups(colors); });
+	test::frame("bake", [runs]() { test_bake(runs); });
+
+	return test::failures;
+}
@@ -0,0 +1,184 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+// Parses valid and broken .cube files with gfx::lut::cube, and saves a baked color grade and reads it back to make
+//  sure the table that reaches 'DrawLUT' is the one that was written.
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "gfx/lut/gfx-lut-color-grade.hpp"
+#include "gfx/lut/gfx-lut-cube.hpp"
+#include "test-common.hpp"
+
+static ::gfx::lut::cube parse(std::string const& text)
+{
+	std::istringstream stream(text);
+	return ::gfx::lut::cube(stream);
+}
+
+// Every entry of a table in the layout of ::gfx::lut::color_grade, as red, green and blue index.
+static const float_t* table_entry(std::vector<float_t> const& table, uint32_t size, uint32_t r, uint32_t g, uint32_t b)
+{
+	return &table[(size_t(g) * size * size + size_t(b) * size + r) * 4];
+}
+
+static void test_1d()
+{
+	auto lut = parse("# Curves\n"
+					 "TITLE \"curves\"\n"
+					 "LUT_1D_SIZE 3\r\n"
+					 "DOMAIN_MIN 0 0 0\n"
+					 "DOMAIN_MAX 1 1 2\n"
+					 "\n"
+					 "0 0.1 0.2\n"
+					 "0.5 0.6 0.7\n"
+					 "1.0 1e0 +1.2\n");
+	CHECK(lut.get_title() == "curves");
+	CHECK(!lut.is_3d());
+	CHECK(lut.get_size() == 3);
+	CHECK(lut.get_domain_max()[2] == 2.f);
+	CHECK(lut.get_data()[3] == .5f);
+	CHECK(lut.get_data()[8] == 1.2f);
+
+	// Curves are combined into a 3D table, each channel only depends on its own axis.
+	auto table = lut.to_table();
+	CHECK(lut.get_table_size() == 3);
+	CHECK(table.size() == size_t(3 * 3 * 3 * 4));
+	const float_t* entry = table_entry(table, 3, 2, 0, 1);
+	CHECK((entry[0] == 1.f) && (entry[1] == .1f) && (entry[2] == .7f) && (entry[3] == 1.f));
+}
+
+static void test_3d()
+{
+	// Red changes fastest in the file, then green, then blue.
+	std::string text = "LUT_3D_SIZE 2\n";
+	for (uint32_t b = 0; b < 2; b++) {
+		for (uint32_t g = 0; g < 2; g++) {
+			for (uint32_t r = 0; r < 2; r++)
+				text += std::to_string(r) + " " + std::to_string(g * 2) + " " + std::to_string(b * 4) + "\n";
+		}
+	}
+	auto lut = parse(text);
+	CHECK(lut.is_3d());
+	CHECK(lut.get_size() == 2);
+	CHECK(lut.get_title().empty());
+	CHECK((lut.get_domain_min()[0] == 0.f) && (lut.get_domain_max()[0] == 1.f));
+
+	auto table = lut.to_table();
+	for (uint32_t b = 0; b < 2; b++) {
+		for (uint32_t g = 0; g < 2; g++) {
+			for (uint32_t r = 0; r < 2; r++) {
+				const float_t* entry = table_entry(table, 2, r, g, b);
+				CHECK((entry[0] == r) && (entry[1] == g * 2) && (entry[2] == b * 4) && (entry[3] == 1.f));
+			}
+		}
+	}
+}
+
+static void test_errors()
+{
+	std::string eight = "0 0 0\n0 0 0\n0 0 0\n0 0 0\n0 0 0\n0 0 0\n0 0 0\n0 0 0\n";
+
+	// Entry count must match the size exactly.
+	CHECK_THROWS(std::runtime_error, parse("LUT_3D_SIZE 2\n" + eight.substr(6)));
+	CHECK_THROWS(std::runtime_error, parse("LUT_3D_SIZE 2\n" + eight + "0 0 0\n"));
+	CHECK_THROWS(std::runtime_error, parse("LUT_1D_SIZE 4\n0 0 0\n1 1 1\n"));
+	CHECK_THROWS(std::runtime_error, parse("0 0 0\nLUT_1D_SIZE 2\n1 1 1\n"));
+	CHECK_THROWS(std::runtime_error, parse(""));
+
+	// The domain must not be empty on any axis.
+	CHECK_THROWS(std::runtime_error, parse("LUT_3D_SIZE 2\nDOMAIN_MIN 0 0.5 0\nDOMAIN_MAX 1 0.5 1\n" + eight));
+	CHECK_THROWS(std::runtime_error, parse("LUT_3D_SIZE 2\nDOMAIN_MIN 0 0 1\nDOMAIN_MAX 1 1 0\n" + eight));
+	CHECK_THROWS(std::runtime_error, parse("LUT_3D_INPUT_RANGE 1 1\nLUT_3D_SIZE 2\n" + eight));
+
+	// Sizes beyond what the effect can sample are refused before reading any entries.
+	CHECK_THROWS(std::runtime_error, parse("LUT_3D_SIZE 66\n"));
+	CHECK_THROWS(std::runtime_error, parse("LUT_1D_SIZE 65537\n"));
+	CHECK_THROWS(std::runtime_error, parse("LUT_3D_SIZE 1\n0 0 0\n"));
+
+	// Broken entries and keywords.
+	CHECK_THROWS(std::runtime_error, parse("LUT_1D_SIZE 2\n0 0\n1 1 1\n"));
+	CHECK_THROWS(std::runtime_error, parse("LUT_1D_SIZE 2\n0 0 0,5\n1 1 1\n"));
+	CHECK_THROWS(std::runtime_error, parse("LUT_1D_SIZE 2\nLUT_1D_SIZE 2\n0 0 0\n1 1 1\n"));
+	CHECK_THROWS(std::runtime_error, parse("LUT_1D_SIZE 2\n0 0 0\nTITLE \"late\"\n1 1 1\n"));
+
+	// The message names the line of the problem.
+	try {
+		parse("LUT_1D_SIZE 2\n# comment\n0 0 0\n1 1\n");
+		CHECK(false);
+	} catch (std::runtime_error& ex) {
+		CHECK(std::string(ex.what()).find("line 4") == 0);
+	}
+}
+
+// A baked grade saved as .cube and parsed again must give the baked table back, up to the six decimals written
+//  and the rounding to float after parsing.
+static void test_round_trip(uint32_t size)
+{
+	::gfx::lut::grade_parameters params = {{.02f, .01f, 0, 0},
+										   {1.f / 1.1f, 1, 1.1f, 1},
+										   {1.1f, 1, .9f, 1},
+										   {0, 0, 0, .01f},
+										   {1, .95f, .9f},
+										   {1.05f, 1, .95f},
+										   {1, 1, 1.05f},
+										   {.02f, 1.2f, 1, 1.1f}};
+	::gfx::lut::color_grade      grade(size);
+	grade.bake(params);
+
+	::gfx::lut::cube saved(grade);
+	saved.set_title("round trip");
+	std::stringstream stream;
+	saved.save(stream);
+
+	::gfx::lut::cube loaded(stream);
+	CHECK(loaded.get_title() == "round trip");
+	CHECK(loaded.is_3d());
+	CHECK(loaded.get_size() == size);
+	CHECK(loaded.get_table_size() == size);
+
+	std::vector<float_t> table = loaded.to_table();
+	if (!CHECK(table.size() == size_t(size) * size * size * 4))
+		return;
+	float_t worst = 0.f;
+	for (size_t idx = 0; idx < table.size(); idx++)
+		worst = std::max(worst, std::fabs(table[idx] - grade.get_data()[idx]));
+	if (!CHECK(worst < 1e-6f))
+		fprintf(stderr, "%u^3: entries differ by up to %g\n", size, double_t(worst));
+}
+
+int main(int argc, const char* argv[])
+{
+	bool quick = test::is_quick(argc, argv);
+
+	test::frame("1d", test_1d);
+	test::frame("3d", test_3d);
+	test::frame("errors", test_errors);
+	test::frame("round trip", [quick]() {
+		for (uint32_t size : {2, 17, 33})
+			test_round_trip(size);
+		if (!quick)
+			test_round_trip(65);
+	});
+
+	return test::failures;
+}
@@ -0,0 +1,310 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+// Error of the jump flooding and the iterative SDF producers against the exact distance transform, and how many
+//  frames the iterative one needs to get there. Also checks that refining only the tiles tile_tracker reports ends
+//  up with the same field as refining everything.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "gfx/sdf/gfx-sdf-cpu.hpp"
+#include "gfx/sdf/gfx-sdf-edt.hpp"
+#include "gfx/sdf/gfx-sdf-tiles.hpp"
+#include "test-common.hpp"
+
+// Shadows, glows and outlines of the SDF filter reach at most this far, differences beyond it are never visible.
+#define VISIBLE_RANGE 16.f
+
+// The iterative producer is run for this many frames.
+#define ITERATIVE_FRAMES 24
+
+struct mask {
+	std::string          name;
+	uint32_t             width;
+	uint32_t             height;
+	std::vector<uint8_t> data;
+};
+
+static uint32_t next_random(uint32_t& seed, uint32_t range)
+{
+	seed = seed * 1664525 + 1013904223;
+	return (seed >> 8) % range;
+}
+
+// Scattered discs of random sizes, some of them overlapping.
+static mask make_discs(uint32_t width, uint32_t height)
+{
+	mask     m    = {"discs", width, height, std::vector<uint8_t>(size_t(width) * height, 0)};
+	uint32_t seed = 0x2545F491;
+	for (size_t disc = 0; disc < 12; disc++) {
+		int64_t cx = next_random(seed, width), cy = next_random(seed, height);
+		int64_t r  = 1 + next_random(seed, std::max<uint32_t>(height / 6, 2));
+		for (uint32_t y = 0; y < height; y++) {
+			for (uint32_t x = 0; x < width; x++) {
+				if ((x - cx) * (x - cx) + (y - cy) * (y - cy) <= r * r)
+					m.data[size_t(y) * width + x] = 1;
+			}
+		}
+	}
+	return m;
+}
+
+// Thin strokes in lines, like rendered text.
+static mask make_text(uint32_t width, uint32_t height)
+{
+	mask m = {"text", width, height, std::vector<uint8_t>(size_t(width) * height, 0)};
+	for (uint32_t line = height / 8; line + height / 8 < height; line += height / 4) {
+		for (uint32_t x = width / 10; x < width - width / 10; x++) {
+			bool vertical = (x % 7) < 2;
+			bool bar      = ((x / 7) % 3) == 0;
+			for (uint32_t y = line; y < line + height / 8; y++) {
+				bool top = (y - line) < 2;
+				if (vertical || (bar && top))
+					m.data[size_t(y) * width + x] = 1;
+			}
+		}
+	}
+	return m;
+}
+
+// Signed distance to the nearest texel of the other kind, searching all of them.
+static std::vector<float_t> brute_force(mask const& m)
+{
+	std::vector<float_t> field(m.data.size());
+	for (uint32_t y = 0; y < m.height; y++) {
+		for (uint32_t x = 0; x < m.width; x++) {
+			uint8_t  self = m.data[size_t(y) * m.width + x];
+			uint64_t best = UINT64_MAX;
+			for (uint32_t oy = 0; oy < m.height; oy++) {
+				for (uint32_t ox = 0; ox < m.width; ox++) {
+					if ((m.data[size_t(oy) * m.width + ox] != 0) == (self != 0))
+						continue;
+					int64_t dx = int64_t(ox) - x, dy = int64_t(oy) - y;
+					best       = std::min<uint64_t>(best, uint64_t(dx * dx + dy * dy));
+				}
+			}
+			float_t distance               = float_t(std::sqrt(double_t(best)));
+			field[size_t(y) * m.width + x] = self ? -distance : distance;
+		}
+	}
+	return field;
+}
+
+static std::vector<float_t> distances(::gfx::sdf::cpu_reference& ref)
+{
+	std::vector<float_t> field(size_t(ref.get_width()) * ref.get_height());
+	for (uint32_t y = 0; y < ref.get_height(); y++) {
+		for (uint32_t x = 0; x < ref.get_width(); x++)
+			field[size_t(y) * ref.get_width() + x] = ref.get_distance(x, y);
+	}
+	return field;
+}
+
+struct error {
+	double_t wrong;   // Fraction of texels off by more than a hundredth of a texel.
+	double_t mean;    // Mean absolute error in texels.
+	double_t worst;   // Largest absolute error in texels.
+	double_t visible; // Largest absolute error in texels within the visible range.
+};
+
+static error compare(std::vector<float_t> const& field, std::vector<float_t> const& exact)
+{
+	error  e     = {0, 0, 0, 0};
+	size_t wrong = 0;
+	for (size_t idx = 0; idx < field.size(); idx++) {
+		double_t diff = std::fabs(double_t(field[idx]) - exact[idx]);
+		double_t clamped =
+			std::fabs(double_t(std::clamp(field[idx], -VISIBLE_RANGE, VISIBLE_RANGE))
+					  - std::clamp(exact[idx], -VISIBLE_RANGE, VISIBLE_RANGE));
+		wrong += (diff > 0.01) ? 1 : 0;
+		e.mean += diff;
+		e.worst   = std::max(e.worst, diff);
+		e.visible = std::max(e.visible, clamped);
+	}
+	e.wrong = double_t(wrong) / field.size();
+	e.mean /= field.size();
+	return e;
+}
+
+static void test_exact()
+{
+	for (mask const& m : {make_discs(64, 48), make_text(64, 48)}) {
+		::gfx::sdf::cpu_reference ref(m.width, m.height);
+		ref.render_exact(m.data.data(), m.width);
+		error e = compare(distances(ref), brute_force(m));
+		if (!CHECK(e.worst < 0.001))
+			fprintf(stderr, "exact/%s is off by up to %f texels\n", m.name.c_str(), e.worst);
+
+		// Splitting the work across threads must not change the result.
+		std::vector<float_t> single(m.data.size() * 4), multi(m.data.size() * 4);
+		CHECK(::gfx::sdf::edt(m.width, m.height, 1).bake(m.data.data(), m.width, single.data()));
+		CHECK(::gfx::sdf::edt(m.width, m.height, 4).bake(m.data.data(), m.width, multi.data()));
+		CHECK(single == multi);
+
+		// A cancelled bake stops before writing anything.
+		std::vector<float_t> cancelled(m.data.size() * 4, -1.f);
+		std::atomic<bool>    cancel(true);
+		CHECK(!::gfx::sdf::edt(m.width, m.height).bake(m.data.data(), m.width, cancelled.data(), &cancel));
+		CHECK(std::count(cancelled.begin(), cancelled.end(), -1.f) == ptrdiff_t(cancelled.size()));
+	}
+}
+
+static void test_producers(uint32_t width, uint32_t height, size_t runs)
+{
+	printf("%-24s %8s %8s %8s %8s %10s\n", "producer", "wrong %", "mean", "worst", "visible", "ms");
+	for (mask const& m : {make_discs(width, height), make_text(width, height)}) {
+		::gfx::sdf::cpu_reference ref(width, height);
+
+		double_t exact_time = test::measure(runs, [&]() { ref.render_exact(m.data.data(), width); });
+		std::vector<float_t> exact = distances(ref);
+		printf("%-24s %8s %8s %8s %8s %10.2f\n", (m.name + "/exact").c_str(), "-", "-", "-", "-",
+			   exact_time * 1000.);
+
+		// Jump flooding only misses where the nearest seed was hidden behind another one, and then by little.
+		double_t jfa_time = test::measure(runs, [&]() { ref.render_jump_flooding(m.data.data(), width); });
+		error    jfa      = compare(distances(ref), exact);
+		CHECK(jfa.wrong < 0.01);
+		CHECK(jfa.mean < 0.05);
+		CHECK(jfa.visible < 1.);
+		printf("%-24s %8.3f %8.4f %8.2f %8.2f %10.2f\n", (m.name + "/jump-flooding").c_str(), jfa.wrong * 100.,
+			   jfa.mean, jfa.worst, jfa.visible, jfa_time * 1000.);
+
+		// The iterative producer moves distances a few texels per frame, starting from a cleared field.
+		ref.clear();
+		std::vector<error> frames;
+		double_t           frame_time = 0.;
+		for (size_t frame = 0; frame < ITERATIVE_FRAMES; frame++) {
+			frame_time += test::measure(1, [&]() { ref.render(m.data.data(), width); });
+			frames.push_back(compare(distances(ref), exact));
+		}
+		for (size_t frame : {size_t(1), size_t(2), size_t(4), size_t(8), size_t(16), size_t(ITERATIVE_FRAMES)}) {
+			error const& e = frames[frame - 1];
+			printf("%-24s %8.3f %8.4f %8.2f %8.2f %10.2f\n",
+				   (m.name + "/iterative/" + std::to_string(frame)).c_str(), e.wrong * 100., e.mean, e.worst,
+				   e.visible, frame_time * 1000. / ITERATIVE_FRAMES);
+		}
+
+		// One frame is far from done, by the time shadows and glows are in range it has caught up.
+		CHECK(frames.front().visible > jfa.visible);
+		CHECK(frames[15].visible < 1.);
+		CHECK(frames.back().visible <= frames[15].visible);
+	}
+}
+
+// The discs, plus one more that moves across them during frames 0 to 7 and is gone afterwards.
+static mask make_moving(uint32_t width, uint32_t height, int64_t frame)
+{
+	mask m = make_discs(width, height);
+	if ((frame < 0) || (frame >= 8))
+		return m;
+
+	int64_t cx = width / 4 + frame * 3, cy = height / 2, r = height / 8;
+	for (uint32_t y = 0; y < height; y++) {
+		for (uint32_t x = 0; x < width; x++) {
+			if ((x - cx) * (x - cx) + (y - cy) * (y - cy) <= r * r)
+				m.data[size_t(y) * width + x] = 1;
+		}
+	}
+	return m;
+}
+
+// Drives the tracker like the filter does: each frame compares the mask of the previous frame, which is only read
+//  back from the GPU one frame later, and refines what advance() returns. The discs are left to settle before the
+//  moving one shows up.
+static void test_incremental(uint32_t width, uint32_t height)
+{
+	::gfx::sdf::tile_tracker  tiles;
+	::gfx::sdf::cpu_reference incremental(width, height), full(width, height);
+	tiles.resize(width, height);
+	tiles.set_range(uint32_t(VISIBLE_RANGE));
+
+	const int64_t start   = -64;
+	int64_t       frame   = start;
+	size_t        refined = 0, settled = 0;
+	mask          last    = make_moving(width, height, start);
+	for (; frame < 200; frame++) {
+		mask m = make_moving(width, height, frame);
+		tiles.update(last.data.data(), width);
+		auto const& areas = tiles.advance();
+		if (frame >= 0)
+			refined += tiles.get_pending_tiles();
+		incremental.render(m.data.data(), width, areas);
+		full.render(m.data.data(), width);
+		last = m;
+
+		// Settled once nothing was pending for as many frames as the tracker lags behind.
+		settled = areas.empty() ? settled + 1 : 0;
+		if ((frame >= 8) && (settled > 1))
+			break;
+	}
+	if (!CHECK(settled > 1))
+		return;
+
+	// The full field got as many passes, so both must have arrived at the same distances within the range.
+	std::vector<float_t> a = distances(incremental), b = distances(full);
+	double_t             worst = 0.;
+	for (size_t idx = 0; idx < a.size(); idx++) {
+		worst = std::max(worst, std::fabs(double_t(std::clamp(a[idx], -VISIBLE_RANGE, VISIBLE_RANGE))
+										  - std::clamp(b[idx], -VISIBLE_RANGE, VISIBLE_RANGE)));
+	}
+	if (!CHECK(worst < 0.01))
+		fprintf(stderr, "incremental field is off by up to %f texels within the range\n", worst);
+
+	// Only the neighbourhood of the moving disc should have been refined since it showed up.
+	size_t total = tiles.get_total_tiles() * size_t(frame + 1);
+	CHECK(refined < total);
+
+	// Nothing changes any more, so nothing may become pending again.
+	mask   still   = make_moving(width, height, frame);
+	size_t pending = 0;
+	for (size_t idx = 0; idx < 4; idx++) {
+		tiles.update(still.data.data(), width);
+		pending += tiles.advance().size() + tiles.get_pending_tiles();
+	}
+	CHECK(pending == 0);
+
+	printf("settled %" PRId64 " frames after the change, refined %zu of %zu tiles, largest difference %.4f texels\n",
+		   frame + 1, refined, total, worst);
+}
+
+int main(int argc, const char* argv[])
+{
+	bool quick = test::is_quick(argc, argv);
+
+	test::frame("exact", test_exact);
+	test::frame("producers", [quick]() {
+		if (quick) {
+			test_producers(160, 90, 1);
+		} else {
+			test_producers(640, 360, 3);
+		}
+	});
+	test::frame("incremental", [quick]() {
+		if (quick) {
+			test_incremental(160, 90);
+		} else {
+			test_incremental(640, 360);
+		}
+	});
+
+	return test::failures;
+}
@@ -0,0 +1,408 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+// Mirror sources of one audio input, counting the threads they keep alive and timing how long captured audio takes
+//  to be output again by the shared audio worker. Also measures how much audio a mirror copies with and without
+//  passthrough, and checks that passthrough keeps timestamps in order and is refused for mirrors of mirrors.
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "sources/source-mirror.hpp"
+#include "test-common.hpp"
+
+// Settings of the mirror source.
+#define ST_SOURCE "Source.Mirror.Source"
+#define ST_AUDIO "Source.Mirror.Source.Audio"
+#define ST_AUDIO_PASSTHROUGH "Source.Mirror.Audio.Passthrough"
+
+#define INPUT_ID "test-audio-input"
+#define INPUT_NAME "Microphone"
+#define MIRROR_ID "obs-stream-effects-source-mirror"
+
+// How often the input captures a packet, about ten times as often as libobs does at 48 kHz to keep the run short.
+#define PACKET_INTERVAL std::chrono::milliseconds(2)
+
+typedef std::chrono::high_resolution_clock clock_type;
+
+// Threads of this process, or -1 where that isn't known.
+static int64_t count_threads()
+{
+	std::error_code ec;
+	int64_t         count = 0;
+	for (auto iter = std::filesystem::directory_iterator("/proc/self/task", ec);
+		 !ec && (iter != std::filesystem::directory_iterator()); iter.increment(ec))
+		count++;
+	return ec ? -1 : count;
+}
+
+// A stopped thread can linger in /proc for a moment after being joined.
+static int64_t wait_for_threads(int64_t expected)
+{
+	int64_t count = count_threads();
+	for (size_t attempt = 0; (count != expected) && (attempt < 100); attempt++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		count = count_threads();
+	}
+	return count;
+}
+
+static std::vector<obs_source_t*> create_mirrors(size_t count, bool audio, bool passthrough = false,
+												 const char* input = INPUT_NAME, const char* prefix = "Mirror ")
+{
+	obs_data_t* settings = obs_data_create();
+	obs_data_set_string(settings, ST_SOURCE, input);
+	obs_data_set_bool(settings, ST_AUDIO, audio);
+	obs_data_set_bool(settings, ST_AUDIO_PASSTHROUGH, passthrough);
+
+	std::vector<obs_source_t*> mirrors;
+	for (size_t idx = 0; idx < count; idx++) {
+		std::string   name   = prefix + std::to_string(idx);
+		obs_source_t* mirror = obs_source_create(MIRROR_ID, name.c_str(), nullptr, nullptr);
+		obs_source_update(mirror, settings);
+		mirrors.push_back(mirror);
+	}
+	obs_data_release(settings);
+	return mirrors;
+}
+
+static void release_mirrors(std::vector<obs_source_t*>& mirrors)
+{
+	for (auto mirror : mirrors)
+		obs_source_release(mirror);
+	mirrors.clear();
+}
+
+// Mirrors have to find their input by name, so it has to exist while they do.
+static void test_threads(int64_t baseline)
+{
+	if (baseline < 0) {
+		printf("Thread count unknown on this platform, skipped.\n");
+		return;
+	}
+
+	for (size_t count : {1, 10, 50}) {
+		// Without audio there is nothing to output, and no thread for it.
+		auto mirrors = create_mirrors(count, false);
+		CHECK(wait_for_threads(baseline) == baseline);
+		release_mirrors(mirrors);
+
+		// All mirrors with audio share the one worker, which goes away with the last of them.
+		mirrors         = create_mirrors(count, true);
+		int64_t threads = wait_for_threads(baseline + 1);
+		CHECK(threads == baseline + 1);
+		release_mirrors(mirrors);
+		CHECK(wait_for_threads(baseline) == baseline);
+
+		printf("%3zu mirrors: %" PRId64 " threads with audio, %" PRId64 " without\n", count, threads, baseline);
+	}
+}
+
+static void test_latency(obs_source_t* input, size_t packets)
+{
+	printf("%-8s %10s %10s %10s\n", "mirrors", "outputs", "p50 us", "p99 us");
+	for (size_t count : {1, 10, 50}) {
+		std::vector<clock_type::time_point> pushed(packets);
+		std::vector<double_t>               latencies;
+		std::mutex                          lock;
+		latencies.reserve(packets * count);
+
+		// The ring has handed the packet over with release semantics, so its push time is visible here.
+		stub::set_audio_output_callback([&](obs_source_t*, const obs_source_audio* audio) {
+			auto                         now = clock_type::now();
+			std::unique_lock<std::mutex> ul(lock);
+			latencies.push_back(std::chrono::duration<double_t, std::micro>(now - pushed[audio->timestamp]).count());
+		});
+
+		auto mirrors = create_mirrors(count, true);
+
+		std::vector<float_t> samples(AUDIO_OUTPUT_FRAMES * 2, 0.5f);
+		audio_data           audio = {};
+		audio.data[0]              = reinterpret_cast<uint8_t*>(samples.data());
+		audio.data[1]              = reinterpret_cast<uint8_t*>(samples.data() + AUDIO_OUTPUT_FRAMES);
+		audio.frames               = AUDIO_OUTPUT_FRAMES;
+
+		auto next = clock_type::now();
+		for (size_t sequence = 0; sequence < packets; sequence++) {
+			std::this_thread::sleep_until(next);
+			next += PACKET_INTERVAL;
+			audio.timestamp  = sequence;
+			pushed[sequence] = clock_type::now();
+			stub::push_audio(input, audio);
+		}
+
+		// Wait for the worker to drain what is still buffered.
+		auto deadline = clock_type::now() + std::chrono::seconds(2);
+		while (clock_type::now() < deadline) {
+			std::unique_lock<std::mutex> ul(lock);
+			if (latencies.size() >= packets * count)
+				break;
+			ul.unlock();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		release_mirrors(mirrors);
+		stub::set_audio_output_callback(nullptr);
+
+		// Far less than the ring holds is ever buffered, so nothing may be dropped.
+		CHECK(latencies.size() == packets * count);
+		if (latencies.empty())
+			continue;
+		std::sort(latencies.begin(), latencies.end());
+		printf("%-8zu %10zu %10.1f %10.1f\n", count, latencies.size(), latencies[latencies.size() / 2],
+			   latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)]);
+	}
+}
+
+// Captures 48 kHz 7.1 audio with one mirror, in bursts the ring can always hold. Planes that reach the output at
+//  another address than they were captured at have been copied by the mirror.
+static void test_passthrough(obs_source_t* input, double_t seconds)
+{
+	stub::set_audio_info(48000, SPEAKERS_7POINT1);
+	audio_output_info const* aoi     = audio_output_get_info(obs_get_audio());
+	size_t                   planes  = get_audio_planes(aoi->format, aoi->speakers);
+	size_t                   packets = size_t(seconds * aoi->samples_per_sec / AUDIO_OUTPUT_FRAMES);
+	double_t                 length  = double_t(packets) * AUDIO_OUTPUT_FRAMES / aoi->samples_per_sec;
+
+	std::vector<float_t> samples(AUDIO_OUTPUT_FRAMES * planes);
+	for (size_t idx = 0; idx < samples.size(); idx++)
+		samples[idx] = float_t(idx % 251) / 251.f;
+
+	struct mode {
+		const char* name;
+		bool        passthrough;
+		size_t      captured_planes;
+		bool        copies;
+	};
+	// Without a plane for every channel there is nothing to pass through, so it falls back to the ring.
+	mode modes[] = {
+		{"copy", false, planes, true},
+		{"passthrough", true, planes, false},
+		{"passthrough, stereo", true, 2, true},
+	};
+
+	printf("%-20s %10s %14s %14s\n", "mode", "packets", "copied B/s", "capture us/s");
+	for (auto const& m : modes) {
+		std::mutex lock;
+		size_t     outputs = 0, copied = 0, mismatched = 0;
+		stub::set_audio_output_callback([&](obs_source_t*, const obs_source_audio* audio) {
+			std::unique_lock<std::mutex> ul(lock);
+			for (size_t plane = 0; plane < m.captured_planes; plane++) {
+				const uint8_t* captured = reinterpret_cast<const uint8_t*>(&samples[plane * AUDIO_OUTPUT_FRAMES]);
+				if (audio->data[plane] != captured)
+					copied += audio->frames * sizeof(float_t);
+				// Comparing every packet would add to the capture time in passthrough, where output is synchronous.
+				if ((outputs == 0)
+					&& (!audio->data[plane] || memcmp(audio->data[plane], captured, audio->frames * sizeof(float_t))))
+					mismatched++;
+			}
+			outputs++;
+		});
+
+		auto mirrors = create_mirrors(1, true, m.passthrough);
+
+		audio_data audio = {};
+		for (size_t plane = 0; plane < m.captured_planes; plane++)
+			audio.data[plane] = reinterpret_cast<uint8_t*>(&samples[plane * AUDIO_OUTPUT_FRAMES]);
+		audio.frames = AUDIO_OUTPUT_FRAMES;
+
+		double_t capture_time = 0.;
+		for (size_t sequence = 0; sequence < packets; sequence++) {
+			audio.timestamp = sequence;
+			auto start      = clock_type::now();
+			stub::push_audio(input, audio);
+			capture_time += std::chrono::duration<double_t>(clock_type::now() - start).count();
+
+			// Let the worker drain the ring every few packets, long before it could fill up.
+			if ((sequence % 8) == 7) {
+				for (size_t attempt = 0; attempt < 1000; attempt++) {
+					std::unique_lock<std::mutex> ul(lock);
+					if (outputs > sequence)
+						break;
+					ul.unlock();
+					std::this_thread::sleep_for(std::chrono::microseconds(100));
+				}
+			}
+		}
+		auto deadline = clock_type::now() + std::chrono::seconds(2);
+		while (clock_type::now() < deadline) {
+			std::unique_lock<std::mutex> ul(lock);
+			if (outputs >= packets)
+				break;
+			ul.unlock();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		release_mirrors(mirrors);
+		stub::set_audio_output_callback(nullptr);
+
+		CHECK(outputs == packets);
+		CHECK(mismatched == 0);
+		CHECK((copied == 0) == !m.copies);
+		printf("%-20s %10zu %14.0f %14.2f\n", m.name, outputs, copied / length, capture_time * 1000000. / length);
+	}
+
+	stub::set_audio_info(48000, SPEAKERS_STEREO);
+}
+
+// Switches a mirror to passthrough while the worker still has a burst of packets to output, which it must finish
+//  before the next packet is passed through.
+static void test_switch(obs_source_t* input)
+{
+	std::mutex            lock;
+	std::vector<uint64_t> timestamps;
+	stub::set_audio_output_callback([&](obs_source_t*, const obs_source_audio* audio) {
+		// Slow enough that the burst is still buffered when passthrough is turned on.
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+		std::unique_lock<std::mutex> ul(lock);
+		timestamps.push_back(audio->timestamp);
+	});
+
+	auto mirrors = create_mirrors(1, true, false);
+
+	std::vector<float_t> samples(AUDIO_OUTPUT_FRAMES * 2, 0.5f);
+	audio_data           audio = {};
+	audio.data[0]              = reinterpret_cast<uint8_t*>(samples.data());
+	audio.data[1]              = reinterpret_cast<uint8_t*>(samples.data() + AUDIO_OUTPUT_FRAMES);
+	audio.frames               = AUDIO_OUTPUT_FRAMES;
+
+	// Fewer packets per burst than the ring holds, so none are dropped.
+	const size_t burst = 8;
+	for (size_t sequence = 0; sequence < burst * 2; sequence++) {
+		if (sequence == burst) {
+			obs_data_t* settings = obs_source_get_settings(mirrors[0]);
+			obs_data_set_bool(settings, ST_AUDIO_PASSTHROUGH, true);
+			obs_source_update(mirrors[0], settings);
+			obs_data_release(settings);
+		}
+		audio.timestamp = sequence;
+		stub::push_audio(input, audio);
+	}
+
+	auto deadline = clock_type::now() + std::chrono::seconds(2);
+	while (clock_type::now() < deadline) {
+		std::unique_lock<std::mutex> ul(lock);
+		if (timestamps.size() >= burst * 2)
+			break;
+		ul.unlock();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	release_mirrors(mirrors);
+	stub::set_audio_output_callback(nullptr);
+
+	CHECK(timestamps.size() == burst * 2);
+	for (size_t idx = 0; idx < timestamps.size(); idx++) {
+		if (!CHECK(timestamps[idx] == idx)) {
+			fprintf(stderr, "packet %zu was output as packet %zu\n", size_t(timestamps[idx]), idx);
+			break;
+		}
+	}
+}
+
+// A mirror of a mirror asking for passthrough has to copy, as its input outputs from within a capture callback.
+static void test_chained()
+{
+	auto inner = create_mirrors(1, true, false);
+	auto outer = create_mirrors(1, true, true, obs_source_get_name(inner[0]), "Outer mirror ");
+
+	std::vector<float_t> samples(AUDIO_OUTPUT_FRAMES * 2, 0.5f);
+	audio_data           audio = {};
+	audio.data[0]              = reinterpret_cast<uint8_t*>(samples.data());
+	audio.data[1]              = reinterpret_cast<uint8_t*>(samples.data() + AUDIO_OUTPUT_FRAMES);
+	audio.frames               = AUDIO_OUTPUT_FRAMES;
+
+	std::mutex lock;
+	size_t     outputs = 0, passed = 0;
+	stub::set_audio_output_callback([&](obs_source_t* source, const obs_source_audio* output) {
+		std::unique_lock<std::mutex> ul(lock);
+		if (source != outer[0])
+			return;
+		outputs++;
+		if (output->data[0] == audio.data[0])
+			passed++;
+	});
+
+	// Captured by the inner mirror, as if it had output the packet itself.
+	stub::push_audio(inner[0], audio);
+
+	auto deadline = clock_type::now() + std::chrono::seconds(2);
+	while (clock_type::now() < deadline) {
+		std::unique_lock<std::mutex> ul(lock);
+		if (outputs >= 1)
+			break;
+		ul.unlock();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	release_mirrors(outer);
+	release_mirrors(inner);
+	stub::set_audio_output_callback(nullptr);
+
+	CHECK(outputs == 1);
+	CHECK(passed == 0);
+}
+
+int main(int argc, const char* argv[])
+{
+	bool   quick   = test::is_quick(argc, argv);
+	size_t packets = quick ? 100 : 2000;
+	// Seconds of audio captured per passthrough mode.
+	double_t seconds = quick ? 10. : 600.;
+
+	obs_module_load();
+	if (!CHECK(source::mirror::mirror_factory::get() != nullptr))
+		return test::failures;
+
+	obs_source_info input_info = {};
+	input_info.id              = INPUT_ID;
+	input_info.type            = OBS_SOURCE_TYPE_INPUT;
+	input_info.output_flags    = OBS_SOURCE_AUDIO;
+	obs_register_source(&input_info);
+
+	int64_t baseline = count_threads();
+
+	test::frame("threads", [baseline]() {
+		obs_source_t* input = obs_source_create(INPUT_ID, INPUT_NAME, nullptr, nullptr);
+		test_threads(baseline);
+		obs_source_release(input);
+	});
+	test::frame("latency", [packets]() {
+		obs_source_t* input = obs_source_create(INPUT_ID, INPUT_NAME, nullptr, nullptr);
+		test_latency(input, packets);
+		obs_source_release(input);
+	});
+	test::frame("passthrough", [seconds]() {
+		obs_source_t* input = obs_source_create(INPUT_ID, INPUT_NAME, nullptr, nullptr);
+		test_passthrough(input, seconds);
+		obs_source_release(input);
+	});
+	test::frame("switch", []() {
+		obs_source_t* input = obs_source_create(INPUT_ID, INPUT_NAME, nullptr, nullptr);
+		test_switch(input);
+		obs_source_release(input);
+	});
+	test::frame("chained", []() {
+		obs_source_t* input = obs_source_create(INPUT_ID, INPUT_NAME, nullptr, nullptr);
+		test_chained();
+		obs_source_release(input);
+	});
+
+	obs_module_unload();
+	return test::failures;
+}
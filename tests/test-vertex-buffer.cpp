@@ -0,0 +1,293 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+// When gs::vertex_buffer uploads and how much, counted by the stub at gs_vertexbuffer_flush(), and what storing
+//  fewer attributes saves. Also moves buffers around in a std::vector, which must neither copy nor free twice.
+
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "obs/gs/gs-vertexbuffer.hpp"
+#include "test-common.hpp"
+#include "util-profiler.hpp"
+
+// Bytes update() uploads, or 0 if it doesn't flush at all.
+static uint64_t upload(gs::vertex_buffer& vb, bool refresh = true)
+{
+	uint64_t bytes   = stub::get_vertex_bytes_uploaded();
+	uint64_t flushes = stub::get_calls("gs_vertexbuffer_flush");
+	vb.update(refresh);
+	bytes   = stub::get_vertex_bytes_uploaded() - bytes;
+	flushes = stub::get_calls("gs_vertexbuffer_flush") - flushes;
+	CHECK(flushes == ((bytes > 0) ? 1 : 0));
+	return bytes;
+}
+
+static void test_dirty()
+{
+	gs::vertex_buffer vb(4, 1);
+	uint64_t          full = vb.get_memory_usage();
+
+	// Creating the buffer already uploaded it.
+	CHECK(!vb.is_dirty());
+	CHECK(upload(vb) == 0);
+
+	vec3* positions = vb.get_positions();
+	CHECK(vb.is_dirty());
+	CHECK(upload(vb) == full);
+	CHECK(!vb.is_dirty());
+	CHECK(upload(vb) == 0);
+
+	vb.at(2);
+	CHECK(upload(vb) == full);
+
+	// Writes through a kept pointer aren't seen, mark_dirty() is how they are announced.
+	vec3_set(positions, 1, 1, 0);
+	CHECK(upload(vb) == 0);
+	vb.mark_dirty();
+	CHECK(upload(vb, false) == 0);
+	CHECK(vb.is_dirty());
+	CHECK(upload(vb) == full);
+
+	// Only the vertices in use are uploaded. Shrinking leaves nothing to upload, growing again does.
+	vb.resize(2);
+	CHECK(!vb.is_dirty());
+	vb.mark_dirty();
+	CHECK(upload(vb) == full / 2);
+	vb.resize(3);
+	CHECK(upload(vb) == full / 4 * 3);
+	vb.resize(0);
+	vb.mark_dirty();
+	CHECK(upload(vb) == 0);
+	CHECK_THROWS(std::out_of_range, vb.resize(5));
+
+	// The bytes uploaded inside a profiler scope are attributed to it.
+	util::profiler                      profiler;
+	std::vector<util::profiler::sample> samples;
+	uint64_t                            bytes;
+	{
+		auto scope = profiler.track(util::profiler::stage::Render);
+		vb.resize(4);
+		bytes = upload(vb);
+	}
+	CHECK(profiler.get_samples(util::profiler::stage::Render, samples) == 1);
+	CHECK(!samples.empty() && (samples[0].uploaded == bytes));
+}
+
+static bool has(gs::vertex_buffer::attributes attributes, gs::vertex_buffer::attributes attribute)
+{
+	return (attributes & attribute) == attribute;
+}
+
+static void test_layouts(uint32_t vertices)
+{
+	struct layout {
+		const char*                   name;
+		gs::vertex_buffer::attributes attributes;
+		uint8_t                       layers;
+	};
+	layout layouts[] = {
+		{"position", gs::vertex_buffer::attributes::None, 0},
+		{"position, uv", gs::vertex_buffer::attributes::None, 1},
+		{"position, color", gs::vertex_buffer::attributes::Color, 0},
+		{"all, uv", gs::vertex_buffer::attributes::All, 1},
+		{"all, 8 uv", gs::vertex_buffer::attributes::All, 8},
+	};
+
+	size_t all_memory = gs::vertex_buffer(vertices, 1).get_memory_usage();
+	printf("%-16s %10s %12s %10s\n", "layout", "B/vertex", "memory", "vs all,uv");
+	for (layout const& l : layouts) {
+		// Creating a buffer uploads everything it stores, the stub only counts arrays that aren't nullptr.
+		uint64_t          bytes = stub::get_vertex_bytes_uploaded();
+		gs::vertex_buffer vb(vertices, l.layers, l.attributes);
+		bytes = stub::get_vertex_bytes_uploaded() - bytes;
+
+		bool   normals  = has(l.attributes, gs::vertex_buffer::attributes::Normal);
+		bool   tangents = has(l.attributes, gs::vertex_buffer::attributes::Tangent);
+		bool   colors   = has(l.attributes, gs::vertex_buffer::attributes::Color);
+		size_t expected = sizeof(vec3) * (1 + (normals ? 1 : 0) + (tangents ? 1 : 0)) + (colors ? sizeof(uint32_t) : 0)
+						  + sizeof(vec4) * l.layers;
+		CHECK(vb.get_attributes() == l.attributes);
+		CHECK(vb.get_memory_usage() == expected * vertices);
+		CHECK(bytes == vb.get_memory_usage());
+
+		CHECK(vb.get_positions() != nullptr);
+		CHECK((vb.get_normals() != nullptr) == normals);
+		CHECK((vb.get_tangents() != nullptr) == tangents);
+		CHECK((vb.get_colors() != nullptr) == colors);
+		CHECK_THROWS(std::out_of_range, vb.get_uv_layer(l.layers));
+
+		gs::vertex vtx = vb.at(vertices - 1);
+		CHECK((vtx.normal != nullptr) == normals);
+		CHECK((vtx.color != nullptr) == colors);
+		for (size_t n = 0; n < gs::MAXIMUM_UVW_LAYERS; n++)
+			CHECK((vtx.uv[n] != nullptr) == (n < l.layers));
+
+		// A copy keeps the layout, and with it the size of each upload.
+		vb.resize(vertices / 2);
+		gs::vertex_buffer copy(vb);
+		CHECK(copy.get_attributes() == l.attributes);
+		CHECK(copy.get_uv_layers() == l.layers);
+		CHECK(copy.size() == vertices / 2);
+		CHECK(upload(copy) == vb.get_memory_usage() / 2);
+
+		printf("%-16s %10zu %12zu %9.0f%%\n", l.name, expected, vb.get_memory_usage(),
+			   vb.get_memory_usage() * 100. / all_memory);
+	}
+}
+
+static bool is_aligned(const void* ptr)
+{
+	return (reinterpret_cast<uintptr_t>(ptr) % 16) == 0;
+}
+
+static void test_move(size_t count)
+{
+	// std::vector only moves on reallocation when that can't throw, it copies otherwise.
+	CHECK(std::is_nothrow_move_constructible<gs::vertex_buffer>::value);
+	CHECK(std::is_nothrow_move_assignable<gs::vertex_buffer>::value);
+
+	uint64_t creates  = stub::get_calls("gs_vertexbuffer_create");
+	uint64_t destroys = stub::get_calls("gs_vertexbuffer_destroy");
+	{
+		std::vector<gs::vertex_buffer> pool;
+		for (size_t idx = 0; idx < count; idx++) {
+			pool.emplace_back(uint32_t(3 + idx % 5), uint8_t(idx % 3), gs::vertex_buffer::attributes(idx % 8));
+			vec3_set(pool.back().get_positions(), float_t(idx), 0, 0);
+		}
+		CHECK(gs::get_live_objects(gs::object_type::VertexBuffer) == int64_t(count));
+		CHECK(stub::get_calls("gs_vertexbuffer_create") - creates == count);
+		CHECK(stub::get_calls("gs_vertexbuffer_destroy") == destroys);
+
+		for (size_t idx = 0; idx < count; idx++) {
+			gs::vertex_buffer& vb = pool[idx];
+			CHECK(vb.size() == 3 + idx % 5);
+			CHECK(vb.get_positions()[0].x == float_t(idx));
+			CHECK(vb.get_attributes() == gs::vertex_buffer::attributes(idx % 8));
+
+			// Every stream of the single allocation starts on a 16 byte boundary.
+			CHECK(is_aligned(vb.get_positions()) && is_aligned(vb.get_normals()) && is_aligned(vb.get_tangents())
+				  && is_aligned(vb.get_colors()));
+			for (size_t n = 0; n < vb.get_uv_layers(); n++)
+				CHECK(is_aligned(vb.get_uv_layer(n)));
+		}
+
+		// Erasing from the front moves every following buffer down by one.
+		pool.erase(pool.begin());
+		CHECK(pool.front().get_positions()[0].x == 1.f);
+		CHECK(stub::get_calls("gs_vertexbuffer_destroy") - destroys == 1);
+	}
+	CHECK(stub::get_calls("gs_vertexbuffer_destroy") - destroys == count);
+
+	// Move assignment frees what the target held, the source is left empty but usable.
+	gs::vertex_buffer a(4, 1), b(6, 2);
+	vec3_set(b.get_positions(), 6, 0, 0);
+	destroys = stub::get_calls("gs_vertexbuffer_destroy");
+	a        = std::move(b);
+	CHECK(stub::get_calls("gs_vertexbuffer_destroy") - destroys == 1);
+	CHECK((a.size() == 6) && (a.get_uv_layers() == 2) && (a.get_positions()[0].x == 6.f));
+	CHECK(b.empty() && (b.get_positions() == nullptr) && (b.update() == nullptr));
+	CHECK(gs::get_live_objects(gs::object_type::VertexBuffer) == 1);
+
+	gs::vertex_buffer& self = a;
+	a                       = std::move(self);
+	CHECK((a.size() == 6) && (a.get_positions()[0].x == 6.f));
+
+	b = gs::vertex_buffer(2, 0, gs::vertex_buffer::attributes::None);
+	CHECK((b.size() == 2) && (b.update() != nullptr));
+	CHECK(gs::get_live_objects(gs::object_type::VertexBuffer) == 2);
+}
+
+// Buffers created by libobs or other plugins may hold narrower UV layers than the 4 wide ones this stores.
+static void test_adopt()
+{
+	auto gctx = gs::context();
+
+	gs_vb_data* data = gs_vbdata_create();
+	data->num        = 3;
+	data->points     = static_cast<vec3*>(bzalloc(sizeof(vec3) * 3));
+	data->num_tex    = 1;
+	data->tvarray    = static_cast<gs_tvertarray*>(bzalloc(sizeof(gs_tvertarray)));
+	float_t* uvs     = static_cast<float_t*>(bzalloc(sizeof(float_t) * 2 * 3));
+	for (size_t idx = 0; idx < 3; idx++) {
+		vec3_set(data->points + idx, float_t(idx), 0, 0);
+		uvs[idx * 2 + 0] = float_t(idx) + .25f;
+		uvs[idx * 2 + 1] = float_t(idx) + .5f;
+	}
+	data->tvarray[0].width = 2;
+	data->tvarray[0].array = uvs;
+
+	gs_vertbuffer_t* raw = gs_vertexbuffer_create(data, GS_DYNAMIC);
+	if (!CHECK(raw != nullptr))
+		return;
+	{
+		gs::vertex_buffer vb(raw);
+		CHECK((vb.size() == 3) && (vb.get_uv_layers() == 1));
+		CHECK(vb.is_dirty());
+		for (size_t idx = 0; idx < 3; idx++) {
+			vec4* uv = vb.get_uv_layer(0) + idx;
+			CHECK(vb.get_positions()[idx].x == float_t(idx));
+			CHECK((uv->x == float_t(idx) + .25f) && (uv->y == float_t(idx) + .5f) && (uv->z == 0) && (uv->w == 0));
+		}
+	}
+	gs_vertexbuffer_destroy(raw);
+}
+
+// A quad drawn every frame, either left alone or rewritten each time, like a static and an animated filter.
+static void test_frames(size_t frames)
+{
+	printf("%-12s %10s %12s %12s\n", "quad", "frames", "flushes", "bytes/frame");
+	for (bool animated : {false, true}) {
+		gs::vertex_buffer quad(4, 1);
+		uint64_t          bytes   = stub::get_vertex_bytes_uploaded();
+		uint64_t          flushes = stub::get_calls("gs_vertexbuffer_flush");
+		for (size_t frame = 0; frame < frames; frame++) {
+			if (animated || (frame == 0)) {
+				float_t offset = float_t(frame % 60) / 60.f;
+				for (uint32_t idx = 0; idx < 4; idx++) {
+					vec3_set(quad.get_positions() + idx, float_t(idx & 1) + offset, float_t(idx >> 1), 0);
+					vec4_set(quad.get_uv_layer(0) + idx, float_t(idx & 1), float_t(idx >> 1), 0, 0);
+				}
+			}
+			quad.update();
+			stub::next_frame();
+		}
+		bytes   = stub::get_vertex_bytes_uploaded() - bytes;
+		flushes = stub::get_calls("gs_vertexbuffer_flush") - flushes;
+
+		CHECK(flushes == (animated ? frames : 1));
+		CHECK(bytes == flushes * quad.get_memory_usage());
+		printf("%-12s %10zu %12" PRIu64 " %12.1f\n", animated ? "animated" : "static", frames, flushes,
+			   double_t(bytes) / frames);
+	}
+}
+
+int main(int argc, const char* argv[])
+{
+	size_t frames = test::is_quick(argc, argv) ? 600 : 216000;
+
+	test::frame("dirty", test_dirty);
+	test::frame("layouts", []() { test_layouts(1024); });
+	test::frame("move", []() { test_move(100); });
+	test::frame("adopt", test_adopt);
+	test::frame("frames", [frames]() { test_frames(frames); });
+
+	return test::failures;
+}
@@ -0,0 +1,136 @@
+/*
+ * Modern effects for a modern Streamer
+ * Copyright (C) 2019 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+// Checks that util::worker runs its tasks in order on one thread, skips or stops cancelled ones, and that destroying
+//  it stops and waits for whatever is still running.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "test-common.hpp"
+#include "util-worker.hpp"
+
+typedef std::chrono::high_resolution_clock clock_type;
+
+// Waits up to two seconds for a flag to be set.
+static bool wait_for(std::atomic<bool> const& flag)
+{
+	auto deadline = clock_type::now() + std::chrono::seconds(2);
+	while (!flag.load() && (clock_type::now() < deadline))
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	return flag.load();
+}
+
+static void test_order(size_t count)
+{
+	util::worker                 worker;
+	std::mutex                   lock;
+	std::vector<size_t>          order;
+	std::vector<std::thread::id> threads;
+	std::atomic<bool>            done(false);
+
+	for (size_t idx = 0; idx < count; idx++) {
+		worker.push([&, idx](util::worker::task&) {
+			std::unique_lock<std::mutex> ul(lock);
+			order.push_back(idx);
+			threads.push_back(std::this_thread::get_id());
+		});
+	}
+	worker.push([&](util::worker::task&) { done = true; });
+	if (!CHECK(wait_for(done)))
+		return;
+
+	std::unique_lock<std::mutex> ul(lock);
+	CHECK(order.size() == count);
+	for (size_t idx = 0; idx < order.size(); idx++) {
+		if (!CHECK(order[idx] == idx))
+			break;
+	}
+	CHECK(std::count(threads.begin(), threads.end(), threads.front()) == ptrdiff_t(threads.size()));
+	CHECK(threads.front() != std::this_thread::get_id());
+}
+
+static void test_cancel()
+{
+	util::worker      worker;
+	std::atomic<bool> release(false), started(false), stopped(false), skipped(true), done(false);
+
+	// Blocks the worker until released, so the next task is still queued when it is cancelled.
+	worker.push([&](util::worker::task&) {
+		while (!release.load())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	});
+	auto queued = worker.push([&](util::worker::task&) { skipped = false; });
+	queued->cancel();
+	CHECK(queued->is_cancelled());
+	release = true;
+
+	// A running task sees the cancellation and returns early.
+	auto running = worker.push([&](util::worker::task& task) {
+		started = true;
+		while (!task.is_cancelled())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		stopped = true;
+	});
+	CHECK(wait_for(started));
+	running->cancel();
+	CHECK(wait_for(stopped));
+
+	worker.push([&](util::worker::task&) { done = true; });
+	CHECK(wait_for(done));
+	CHECK(skipped.load());
+}
+
+// Like unloading the module while a bake still runs: the destructor may only return once the task has stopped.
+static void test_destroy()
+{
+	std::atomic<bool> started(false), stopped(false), skipped(true);
+	{
+		util::worker worker;
+		worker.push([&](util::worker::task& task) {
+			started = true;
+			while (!task.get_cancelled().load())
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			stopped = true;
+		});
+		worker.push([&](util::worker::task&) { skipped = false; });
+		CHECK(wait_for(started));
+	}
+	CHECK(stopped.load());
+	CHECK(skipped.load());
+
+	// Nothing was ever pushed, so there is no thread to join.
+	{
+		util::worker idle;
+	}
+}
+
+int main(int argc, const char* argv[])
+{
+	size_t count = test::is_quick(argc, argv) ? 1000 : 100000;
+
+	test::frame("order", [count]() { test_order(count); });
+	test::frame("cancel", test_cancel);
+	test::frame("destroy", test_destroy);
+
+	return test::failures;
+}